@@ -0,0 +1,224 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "blocklog.h"
+
+#define BENCH_CORPUS (64 << 20)
+#define BENCH_READ 4096
+#define BENCH_SEEKS 1000
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void file_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	FILE* fp = context;
+
+	while (count--)
+	{
+		if (fwrite(iov->data, 1, iov->len, fp) != iov->len)
+		{
+			perror("fwrite");
+			exit(1);
+		}
+
+		iov++;
+	}
+}
+
+/* a build log with timestamps, colour and a progress line redrawn in place */
+static size_t generate(unsigned char* buf, size_t size)
+{
+	static const char* dirs[] = { "src", "linux", "win32", "bench" };
+	static const char* files[] = { "blocklog", "escscan", "logwriter", "output", "pump", "render", "screen", "vtparse" };
+	size_t len = 0;
+	unsigned long ms = 0;
+
+	srand(9);
+
+	while (len + 256 < size)
+	{
+		int r = rand() % 20;
+
+		ms += rand() % 50;
+
+		if (r == 0)
+		{
+			len += snprintf((char*)buf + len, 256, "\r\033[1;32m[%3d%%]\033[0m linking %d\033[K", rand() % 100, rand() % 1000);
+		}
+		else if (r == 1)
+		{
+			len += snprintf((char*)buf + len, 256, "\033[1;33mwarning:\033[0m %s/%s.c:%d: unused variable 'n%d'\r\n", dirs[rand() % 4], files[rand() % 8], rand() % 2000, rand() % 100);
+		}
+		else
+		{
+			len += snprintf((char*)buf + len, 256, "%02lu:%02lu.%03lu   CC      %s/%s.c -o obj/%s.o\r\n", ms / 60000 % 60, ms / 1000 % 60, ms % 1000, dirs[rand() % 4], files[rand() % 8], files[rand() % 8]);
+		}
+	}
+
+	return len;
+}
+
+static double compress(const char* path, const unsigned char* corpus, size_t len, size_t blockSize, struct conlog_blocklog_stats* stats)
+{
+	FILE* fp = fopen(path, "wb");
+	struct conlog_blocklog log;
+	size_t offset = 0;
+	double t;
+
+	if (!fp || conlog_blocklog_init(&log, blockSize, file_write, fp))
+	{
+		fprintf(stderr, "Failed to create %s\n", path);
+		exit(1);
+	}
+
+	t = now();
+
+	while (offset < len)
+	{
+		struct conlog_iovec iov;
+
+		iov.data = corpus + offset;
+		iov.len = (len - offset) < BENCH_READ ? (len - offset) : BENCH_READ;
+		conlog_blocklog_write(&log, &iov, 1);
+		offset += iov.len;
+	}
+
+	conlog_blocklog_finish(&log);
+
+	t = now() - t;
+
+	*stats = log.stats;
+	fclose(fp);
+
+	return t;
+}
+
+/* reads the whole stream back, then at random offsets */
+static int verify(const char* path, const unsigned char* corpus, size_t len, double* seekTime)
+{
+	struct conlog_blocklog_reader reader;
+	unsigned char* buf = malloc(len);
+	int i, failed = 0;
+	double t;
+
+	if (!buf || conlog_blocklog_open(&reader, path))
+	{
+		fprintf(stderr, "Failed to open %s\n", path);
+		exit(1);
+	}
+
+	if ((reader.size != len) || (conlog_blocklog_read(&reader, 0, buf, len) != len) || memcmp(buf, corpus, len))
+	{
+		fprintf(stderr, "%s does not read back as written\n", path);
+		failed = 1;
+	}
+
+	srand(1);
+
+	t = now();
+
+	for (i = 0; (i < BENCH_SEEKS) && !failed; i++)
+	{
+		size_t offset = ((size_t)rand() * RAND_MAX + rand()) % len;
+		size_t n = rand() % 2000;
+		size_t expect = (len - offset) < n ? (len - offset) : n;
+
+		if ((conlog_blocklog_read(&reader, offset, buf, n) != expect) || memcmp(buf, corpus + offset, expect))
+		{
+			fprintf(stderr, "%s reads wrong at offset %lu\n", path, (unsigned long)offset);
+			failed = 1;
+		}
+	}
+
+	*seekTime = (now() - t) / BENCH_SEEKS;
+
+	conlog_blocklog_close(&reader);
+	free(buf);
+
+	return failed;
+}
+
+/* writes part of a compressed log, such as one from --log-compress, to stdout */
+static int dump(const char* path, unsigned long long offset, unsigned long long length)
+{
+	struct conlog_blocklog_reader reader;
+	unsigned char buf[BENCH_READ];
+
+	if (conlog_blocklog_open(&reader, path))
+	{
+		fprintf(stderr, "Failed to open %s\n", path);
+		return 1;
+	}
+
+	while (length)
+	{
+		size_t n = conlog_blocklog_read(&reader, offset, buf, length < sizeof(buf) ? (size_t)length : sizeof(buf));
+
+		if (!n)
+		{
+			break;
+		}
+
+		fwrite(buf, 1, n, stdout);
+		offset += n;
+		length -= n;
+	}
+
+	conlog_blocklog_close(&reader);
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	static const size_t sizes[] = { 64 << 10, 256 << 10, 1 << 20, 4 << 20 };
+	const char* path = "blocklog_bench.clz";
+	unsigned char* corpus;
+	size_t len;
+	int i, failed = 0;
+
+	if (argc > 1)
+	{
+		return dump(argv[1], argc > 2 ? strtoull(argv[2], NULL, 0) : 0, argc > 3 ? strtoull(argv[3], NULL, 0) : ~0ULL);
+	}
+
+	corpus = malloc(BENCH_CORPUS);
+
+	if (!corpus)
+	{
+		fprintf(stderr, "Failed to set up\n");
+		return 1;
+	}
+
+	len = generate(corpus, BENCH_CORPUS);
+
+	printf("%lu MB build log\n", (unsigned long)(len >> 20));
+	printf("%-10s %10s %8s %10s %10s %12s\n", "block", "bytes out", "ratio", "seconds", "MB/s", "seek us");
+
+	for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++)
+	{
+		struct conlog_blocklog_stats stats;
+		double t = compress(path, corpus, len, sizes[i], &stats);
+		double seekTime = 0;
+
+		failed |= verify(path, corpus, len, &seekTime);
+
+		printf("%-10lu %10llu %8.2f %10.3f %10.1f %12.1f\n", (unsigned long)sizes[i], stats.bytesOut, (double)stats.bytesIn / stats.bytesOut, t, len / t / 1e6, seekTime * 1e6);
+	}
+
+	remove(path);
+	free(corpus);
+
+	return failed;
+}
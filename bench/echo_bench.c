@@ -0,0 +1,277 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define BENCH_KEYS 500
+#define BENCH_GAP_NS 1000000
+#define BENCH_TIMEOUT_MS 5000
+
+static const char ready[] = "echo ready\r\n";
+
+static unsigned long long now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* the synthetic child, which sends back each byte it reads and nothing else */
+static int echo_child(void)
+{
+	struct termios raw;
+	char c;
+
+	if (!tcgetattr(0, &raw))
+	{
+		cfmakeraw(&raw);
+		tcsetattr(0, TCSANOW, &raw);
+	}
+
+	if (write(1, ready, sizeof(ready) - 1) < 0)
+	{
+		return 1;
+	}
+
+	while (read(0, &c, 1) == 1)
+	{
+		if (c == 4)
+		{
+			break;
+		}
+
+		if (write(1, &c, 1) != 1)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* reads until the byte arrives, anything else the console is sent is passed over */
+static int wait_for(int fd, const char* text, size_t len)
+{
+	char buf[256];
+	size_t matched = 0;
+
+	while (matched < len)
+	{
+		struct pollfd pfd;
+		ssize_t n, i;
+
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+
+		if (poll(&pfd, 1, BENCH_TIMEOUT_MS) != 1)
+		{
+			return -1;
+		}
+
+		n = read(fd, buf, (len - matched == 1) ? 1 : sizeof(buf));
+
+		if (n <= 0)
+		{
+			return -1;
+		}
+
+		for (i = 0; (i < n) && (matched < len); i++)
+		{
+			matched = (buf[i] == text[matched]) ? matched + 1 : (buf[i] == text[0]);
+		}
+	}
+
+	return 0;
+}
+
+static int compare(const void* a, const void* b)
+{
+	unsigned long long x = *(const unsigned long long*)a, y = *(const unsigned long long*)b;
+
+	return (x > y) - (x < y);
+}
+
+/* the number after name in the echo section of the statistics */
+static double stats_value(const char* text, const char* name)
+{
+	const char* echo = strstr(text, "\"echo\"");
+	const char* p = echo ? strstr(echo, name) : NULL;
+
+	return p ? atof(p + strlen(name) + 1) : -1;
+}
+
+/* types the keys one at a time through a pseudo terminal, as a user would, timing each echo */
+static int run(const char* name, char** argv, const char* statsPath)
+{
+	struct winsize ws;
+	unsigned long long times[BENCH_KEYS];
+	int fd, status, i, failed = 0;
+	pid_t pid;
+
+	memset(&ws, 0, sizeof(ws));
+	ws.ws_row = 24;
+	ws.ws_col = 80;
+
+	pid = forkpty(&fd, NULL, NULL, &ws);
+
+	if (pid < 0)
+	{
+		perror("forkpty");
+		return 1;
+	}
+
+	if (!pid)
+	{
+		int null = open("/dev/null", O_WRONLY);
+
+		/* the log goes nowhere, the console is the pseudo terminal */
+		dup2(null, 2);
+		execv(argv[0], argv);
+		_exit(127);
+	}
+
+	if (wait_for(fd, ready, sizeof(ready) - 1))
+	{
+		fprintf(stderr, "%s: the child did not start\n", name);
+		kill(pid, SIGKILL);
+		waitpid(pid, &status, 0);
+		close(fd);
+		return 1;
+	}
+
+	for (i = 0; i < BENCH_KEYS; i++)
+	{
+		struct timespec gap;
+		char c = (char)('a' + i % 26);
+		unsigned long long t = now();
+
+		if ((write(fd, &c, 1) != 1) || wait_for(fd, &c, 1))
+		{
+			fprintf(stderr, "%s: key %d was not echoed\n", name, i);
+			failed = 1;
+			break;
+		}
+
+		times[i] = now() - t;
+
+		/* typing speed, so each key is read on its own */
+		gap.tv_sec = 0;
+		gap.tv_nsec = BENCH_GAP_NS;
+		nanosleep(&gap, NULL);
+	}
+
+	if (write(fd, "\004", 1) != 1)
+	{
+		kill(pid, SIGTERM);
+	}
+
+	/* the master is drained until the session has gone */
+	while (wait_for(fd, "\001", 1) == 0)
+	{
+	}
+
+	waitpid(pid, &status, 0);
+	close(fd);
+
+	if (!failed)
+	{
+		qsort(times, BENCH_KEYS, sizeof(times[0]), compare);
+
+		printf("%-24s %10.1f %10.1f %10.1f", name, times[BENCH_KEYS / 2] / 1e3, times[BENCH_KEYS * 99 / 100] / 1e3, times[BENCH_KEYS - 1] / 1e3);
+
+		if (statsPath)
+		{
+			FILE* fp = fopen(statsPath, "r");
+			char text[65536];
+			size_t len = fp ? fread(text, 1, sizeof(text) - 1, fp) : 0;
+			double count;
+
+			if (fp)
+			{
+				fclose(fp);
+			}
+
+			text[len] = 0;
+			count = stats_value(text, "\"count\"");
+
+			printf(" %10.1f %10.1f %10.1f", stats_value(text, "\"p50Microseconds\""), stats_value(text, "\"p99Microseconds\""), stats_value(text, "\"maxMicroseconds\""));
+
+			/* the child sends nothing of its own, so every key is matched to its echo */
+			if (count != BENCH_KEYS)
+			{
+				fprintf(stderr, "\n%s: %.0f echoes timed, expected %d", name, count, BENCH_KEYS);
+				failed = 1;
+			}
+
+			unlink(statsPath);
+		}
+
+		printf("\n");
+	}
+
+	return failed;
+}
+
+int main(int argc, char** argv)
+{
+	const char* conlog = (argc > 1) ? argv[1] : "../linux/bin/conlog";
+	char statsPath[64], statsArg[80];
+	char* bare[3];
+	char* threads[6];
+	char* events[7];
+	int failed;
+
+	if ((argc > 1) && !strcmp(argv[1], "--child"))
+	{
+		return echo_child();
+	}
+
+	if (access(conlog, X_OK))
+	{
+		fprintf(stderr, "%s not built\n", conlog);
+		return 1;
+	}
+
+	snprintf(statsPath, sizeof(statsPath), "/tmp/echo_bench.%d.json", (int)getpid());
+	snprintf(statsArg, sizeof(statsArg), "--stats=%s", statsPath);
+
+	bare[0] = argv[0];
+	bare[1] = "--child";
+	bare[2] = NULL;
+
+	threads[0] = (char*)conlog;
+	threads[1] = statsArg;
+	threads[2] = "--";
+	threads[3] = argv[0];
+	threads[4] = "--child";
+	threads[5] = NULL;
+
+	events[0] = (char*)conlog;
+	events[1] = statsArg;
+	events[2] = "--io=events";
+	events[3] = "--";
+	events[4] = argv[0];
+	events[5] = "--child";
+	events[6] = NULL;
+
+	printf("%d keys typed %d ms apart to a child that echoes them, microseconds\n", BENCH_KEYS, BENCH_GAP_NS / 1000000);
+	printf("%-24s %10s %10s %10s %10s %10s %10s\n", "", "p50", "p99", "max", "conlog p50", "p99", "max");
+
+	failed = run("pseudo terminal", bare, NULL);
+	failed |= run("conlog --io=threads", threads, statsPath);
+	failed |= run("conlog --io=events", events, statsPath);
+
+	return failed;
+}
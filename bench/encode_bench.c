@@ -0,0 +1,406 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <iconv.h>
+#include "encode.h"
+#include "utf8.h"
+
+#define BENCH_SIZE (32 << 20)
+#define BENCH_READ 4096
+#define BENCH_REPEAT 3
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct buffer
+{
+	unsigned char* data;
+	size_t len, size;
+};
+
+static void buffer_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	struct buffer* buffer = context;
+
+	while (count--)
+	{
+		if (buffer->len + iov->len > buffer->size)
+		{
+			size_t size = buffer->size ? buffer->size : 4096;
+
+			while (size < buffer->len + iov->len)
+			{
+				size <<= 1;
+			}
+
+			buffer->data = realloc(buffer->data, size);
+			buffer->size = size;
+
+			if (!buffer->data)
+			{
+				fprintf(stderr, "Out of memory\n");
+				exit(1);
+			}
+		}
+
+		memcpy(buffer->data + buffer->len, iov->data, iov->len);
+		buffer->len += iov->len;
+		iov++;
+	}
+}
+
+/* bad input and what valid UTF-8 it becomes */
+static const struct
+{
+	const char* in;
+	const char* out;
+} known[] = {
+	{ "plain", "plain" },
+	{ "caf\xc3\xa9 \xe6\x97\xa5\xe6\x9c\xac \xf0\x9f\x98\x80", "caf\xc3\xa9 \xe6\x97\xa5\xe6\x9c\xac \xf0\x9f\x98\x80" },
+	{ "a\x80z", "a\xef\xbf\xbdz" },
+	{ "a\xc3z", "a\xef\xbf\xbdz" },
+	{ "a\xe6\x97z", "a\xef\xbf\xbdz" },
+	{ "a\xf0\x9f\x98z", "a\xef\xbf\xbdz" },
+	{ "\xc0\xaf", "\xef\xbf\xbd\xef\xbf\xbd" },
+	{ "\xe0\x80\xaf", "\xef\xbf\xbd\xef\xbf\xbd\xef\xbf\xbd" },
+	{ "\xed\xa0\x80", "\xef\xbf\xbd\xef\xbf\xbd\xef\xbf\xbd" },
+	{ "\xf4\x90\x80\x80", "\xef\xbf\xbd\xef\xbf\xbd\xef\xbf\xbd\xef\xbf\xbd" },
+	{ "\xff\xfe", "\xef\xbf\xbd\xef\xbf\xbd" },
+	{ "\xef\xbf\xbd", "\xef\xbf\xbd" },
+	{ "end\xe6\x97", "end\xef\xbf\xbd" },
+};
+
+static void encode_all(int encoding, const char* codepage, const unsigned char* data, size_t len, size_t chunk, struct buffer* out, struct conlog_encode_stats* stats)
+{
+	struct conlog_encode encode;
+	size_t offset = 0;
+
+	out->len = 0;
+
+	if (conlog_encode_init(&encode, encoding, codepage, buffer_write, out))
+	{
+		fprintf(stderr, "Failed to set up %s\n", codepage ? codepage : "encoder");
+		exit(1);
+	}
+
+	while (offset < len)
+	{
+		struct conlog_iovec iov;
+
+		iov.data = data + offset;
+		iov.len = (len - offset) < chunk ? (len - offset) : chunk;
+		conlog_encode_write(&encode, &iov, 1);
+		offset += iov.len;
+	}
+
+	conlog_encode_finish(&encode);
+
+	if (stats)
+	{
+		*stats = encode.stats;
+	}
+}
+
+static int check_known(void)
+{
+	struct buffer out = { NULL, 0, 0 };
+	int i, failed = 0;
+
+	for (i = 0; i < (int)(sizeof(known) / sizeof(known[0])); i++)
+	{
+		size_t len = strlen(known[i].in), chunk;
+
+		/* the same whichever way the input is split */
+		for (chunk = 1; chunk <= len; chunk++)
+		{
+			encode_all(CONLOG_ENCODING_UTF8, NULL, (const unsigned char*)known[i].in, len, chunk, &out, NULL);
+
+			if ((out.len != strlen(known[i].out)) || memcmp(out.data, known[i].out, out.len))
+			{
+				fprintf(stderr, "case %d in pieces of %d differs\n", i, (int)chunk);
+				failed = 1;
+				break;
+			}
+		}
+	}
+
+	free(out.data);
+
+	return failed;
+}
+
+/* a build log */
+static size_t corpus_ascii(unsigned char* buf, size_t size)
+{
+	static const char* files[] = { "blocklog", "encode", "escscan", "lines", "output", "pump", "record", "render", "screen" };
+	size_t len = 0;
+
+	while (len + 256 < size)
+	{
+		len += snprintf((char*)buf + len, 256, "\033[32m  CC\033[0m      src/%s.c -o obj/%s.o -O2 -Wall\r\n", files[rand() % 9], files[rand() % 9]);
+	}
+
+	return len;
+}
+
+/* Chinese and Japanese text with a little ASCII, as a localised tool writes it */
+static size_t corpus_cjk(unsigned char* buf, size_t size)
+{
+	size_t len = 0;
+
+	while (len + 256 < size)
+	{
+		int i, n = 10 + rand() % 40;
+
+		len += snprintf((char*)buf + len, 256, "[%d] ", rand() % 1000);
+
+		for (i = 0; i < n; i++)
+		{
+			unsigned c = (rand() % 4) ? 0x4E00 + rand() % 0x5000 : 0x3040 + rand() % 0xC0;
+
+			buf[len++] = (unsigned char)(0xE0 | (c >> 12));
+			buf[len++] = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+			buf[len++] = (unsigned char)(0x80 | (c & 0x3F));
+		}
+
+		buf[len++] = '\r';
+		buf[len++] = '\n';
+	}
+
+	return len;
+}
+
+/* UTF-16 from iconv, on input that is all valid */
+static int check_utf16(const unsigned char* data, size_t len, const struct buffer* out)
+{
+	iconv_t cd = iconv_open("UTF-16LE", "UTF-8");
+	size_t size = len * 2 + 16, inLeft = len, outLeft = size;
+	char* expect = malloc(size);
+	char* in = (char*)data;
+	char* p = expect;
+	int failed;
+
+	if ((cd == (iconv_t)-1) || !expect)
+	{
+		fprintf(stderr, "Failed to set up iconv\n");
+		exit(1);
+	}
+
+	iconv(cd, &in, &inLeft, &p, &outLeft);
+
+	failed = inLeft || ((size_t)(p - expect) != out->len) || memcmp(expect, out->data, out->len);
+
+	iconv_close(cd);
+	free(expect);
+
+	return failed;
+}
+
+static double best(double t, double* min, int i)
+{
+	if (!i || (t < *min))
+	{
+		*min = t;
+	}
+
+	return *min;
+}
+
+/* how fast each validator gets through the corpus */
+static int run_valid(const char* name, const unsigned char* data, size_t len)
+{
+	const struct conlog_utf8_variant* variant;
+	int i = 0, failed = 0;
+
+	while ((variant = conlog_utf8_variant(i++)) != NULL)
+	{
+		double t = 0;
+		int r;
+
+		for (r = 0; r < BENCH_REPEAT; r++)
+		{
+			double start = now();
+
+			if (variant->valid(data, len) != len)
+			{
+				fprintf(stderr, "%s finds the %s corpus is not valid\n", variant->name, name);
+				failed = 1;
+			}
+
+			best(now() - start, &t, r);
+		}
+
+		printf("%-8s %-8s %10.1f\n", name, variant->name, len / t / 1e6);
+	}
+
+	return failed;
+}
+
+static int run(const char* name, size_t (*corpus)(unsigned char*, size_t), unsigned char* data, const char* codepage)
+{
+	struct buffer out = { NULL, 0, 0 };
+	struct conlog_encode_stats stats;
+	double utf8 = 0, utf16 = 0, cp = 0;
+	size_t len, outUtf16 = 0, outCp = 0;
+	int i, failed;
+
+	srand(3);
+
+	len = corpus(data, BENCH_SIZE);
+
+	failed = run_valid(name, data, len);
+
+	for (i = 0; i < BENCH_REPEAT; i++)
+	{
+		double t = now();
+
+		encode_all(CONLOG_ENCODING_UTF8, NULL, data, len, BENCH_READ, &out, &stats);
+		best(now() - t, &utf8, i);
+
+		if ((out.len != len) || memcmp(out.data, data, len) || stats.replaced)
+		{
+			fprintf(stderr, "%s does not pass through\n", name);
+			failed = 1;
+		}
+
+		t = now();
+		encode_all(CONLOG_ENCODING_UTF16, NULL, data, len, BENCH_READ, &out, NULL);
+		best(now() - t, &utf16, i);
+		outUtf16 = out.len;
+
+		if (!i && check_utf16(data, len, &out))
+		{
+			fprintf(stderr, "%s UTF-16 differs from iconv\n", name);
+			failed = 1;
+		}
+
+		t = now();
+		encode_all(CONLOG_ENCODING_CODEPAGE, codepage, data, len, BENCH_READ, &out, NULL);
+		best(now() - t, &cp, i);
+		outCp = out.len;
+	}
+
+	printf("%-8s %-8s %10.1f\n", name, "utf8", len / utf8 / 1e6);
+	printf("%-8s %-8s %10.1f %10.2f\n", name, "utf16", len / utf16 / 1e6, (double)outUtf16 / len);
+	printf("%-8s %-8s %10.1f %10.2f %s\n", name, "cp", len / cp / 1e6, (double)outCp / len, codepage);
+
+	free(out.data);
+
+	return failed;
+}
+
+/* every variant stops at the same place as the scalar one, wherever the damage is */
+static int check_variants(unsigned char* data)
+{
+	const struct conlog_utf8_variant* scalar = NULL;
+	const struct conlog_utf8_variant* variant;
+	size_t len;
+	int i, j, failed = 0;
+
+	for (i = 0; (variant = conlog_utf8_variant(i)) != NULL; i++)
+	{
+		scalar = variant;
+	}
+
+	srand(6);
+
+	len = corpus_cjk(data, 4096);
+
+	for (j = 0; (j < 20000) && !failed; j++)
+	{
+		size_t at = rand() % len, n = 1 + rand() % 3, expect;
+		unsigned char saved[3];
+
+		memcpy(saved, data + at, sizeof(saved));
+
+		while (n--)
+		{
+			data[at + n] = (unsigned char)(rand() % 3 ? 0x80 + rand() % 0x80 : rand());
+		}
+
+		expect = scalar->valid(data, len);
+
+		for (i = 0; (variant = conlog_utf8_variant(i)) != NULL; i++)
+		{
+			size_t cut = rand() % (len + 1);
+
+			if ((variant->valid(data, len) != expect) || (variant->valid(data, cut) != scalar->valid(data, cut)))
+			{
+				fprintf(stderr, "%s stops in the wrong place\n", variant->name);
+				failed = 1;
+			}
+		}
+
+		memcpy(data + at, saved, sizeof(saved));
+	}
+
+	return failed;
+}
+
+/* damaged input, cut into pieces at random, must come out the same as in one piece */
+static int check_split(unsigned char* data)
+{
+	struct buffer whole = { NULL, 0, 0 }, split = { NULL, 0, 0 };
+	struct conlog_encode_stats stats;
+	size_t len, i;
+	int failed;
+
+	srand(4);
+
+	len = corpus_cjk(data, 1 << 20);
+
+	for (i = 0; i < len / 64; i++)
+	{
+		data[rand() % len] = (unsigned char)rand();
+	}
+
+	encode_all(CONLOG_ENCODING_UTF8, NULL, data, len, len, &whole, &stats);
+	encode_all(CONLOG_ENCODING_UTF8, NULL, data, len, 7, &split, NULL);
+
+	failed = (whole.len != split.len) || memcmp(whole.data, split.data, whole.len) || (conlog_utf8_valid(whole.data, whole.len) != whole.len) || !stats.replaced;
+
+	printf("damaged  %lu bytes, %llu replaced, split writes %s\n", (unsigned long)len, stats.replaced, failed ? "differ" : "match");
+
+	free(whole.data);
+	free(split.data);
+
+	return failed;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned char* data = malloc(BENCH_SIZE);
+	int failed;
+
+	if (!data)
+	{
+		fprintf(stderr, "Failed to set up\n");
+		return 1;
+	}
+
+	failed = check_known();
+
+	printf("selected %s\n", conlog_utf8_name());
+	printf("%-8s %-8s %10s %10s\n", "corpus", "pass", "MB/s", "size x");
+
+	failed |= run("ascii", corpus_ascii, data, "CP1252");
+	failed |= run("cjk", corpus_cjk, data, "GB18030");
+	failed |= check_split(data);
+	failed |= check_variants(data);
+
+	printf("%d known sequences %s\n", (int)(sizeof(known) / sizeof(known[0])), failed ? "differ" : "match");
+
+	free(data);
+
+	return failed;
+}
@@ -0,0 +1,144 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "escscan.h"
+
+#define BENCH_SIZE (64 << 20)
+#define BENCH_REPEAT 5
+
+static const double densities[] = { 0.0, 0.001, 0.005, 0.01, 0.02, 0.05 };
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* the byte at a time loop output_thread used before the kernel */
+static size_t escscan_bytewise(const unsigned char* data, size_t len)
+{
+	size_t i = 0;
+
+	while (i < len)
+	{
+		if (data[i] == 27)
+		{
+			return i;
+		}
+
+		i++;
+	}
+
+	return len;
+}
+
+static void fill(unsigned char* buf, size_t len, double density)
+{
+	static const char text[] = "  CC      src/escscan.o\r\n[ 42%] Building C object CMakeFiles/conlog.dir/output.c.o\r\n";
+	size_t i;
+
+	srand(1);
+
+	for (i = 0; i < len; i++)
+	{
+		buf[i] = text[i % (sizeof(text) - 1)];
+	}
+
+	if (density > 0)
+	{
+		size_t count = (size_t)(len * density);
+
+		while (count--)
+		{
+			buf[(((size_t)rand() << 16) ^ (size_t)rand()) % len] = 27;
+		}
+	}
+}
+
+static double run(conlog_escscan_fn scan, const unsigned char* buf, size_t len, size_t* found)
+{
+	double best = 0;
+	int repeat = BENCH_REPEAT;
+
+	while (repeat--)
+	{
+		size_t offset = 0, count = 0;
+		double t = now();
+
+		while (offset < len)
+		{
+			offset += scan(buf + offset, len - offset);
+
+			if (offset < len)
+			{
+				count++;
+				offset++;
+			}
+		}
+
+		t = now() - t;
+
+		if (!best || t < best)
+		{
+			best = t;
+		}
+
+		*found = count;
+	}
+
+	return len / best / 1e9;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned char* buf = malloc(BENCH_SIZE);
+	size_t d;
+
+	if (!buf)
+	{
+		fprintf(stderr, "Failed to allocate buffer\n");
+		return 1;
+	}
+
+	printf("selected %s, %d MB per pass\n", conlog_escscan_name(), BENCH_SIZE >> 20);
+	printf("%-8s %-10s %10s %10s\n", "density", "variant", "GB/s", "escapes");
+
+	for (d = 0; d < sizeof(densities) / sizeof(densities[0]); d++)
+	{
+		const struct conlog_escscan_variant* variant;
+		size_t expected, found;
+		double rate;
+		int i = 0;
+
+		fill(buf, BENCH_SIZE, densities[d]);
+
+		rate = run(escscan_bytewise, buf, BENCH_SIZE, &expected);
+
+		printf("%6.1f%%  %-10s %10.2f %10zu\n", densities[d] * 100, "bytewise", rate, expected);
+
+		while ((variant = conlog_escscan_variant(i++)) != NULL)
+		{
+			rate = run(variant->scan, buf, BENCH_SIZE, &found);
+
+			printf("%6.1f%%  %-10s %10.2f %10zu\n", densities[d] * 100, variant->name, rate, found);
+
+			if (found != expected)
+			{
+				fprintf(stderr, "%s found %zu escapes, expected %zu\n", variant->name, found, expected);
+				free(buf);
+				return 1;
+			}
+		}
+	}
+
+	free(buf);
+
+	return 0;
+}
@@ -0,0 +1,188 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "flight.h"
+#include "logfile.h"
+
+#define BENCH_SIZE (256 << 20)
+#define BENCH_RING (16 << 20)
+#define BENCH_PIECE 4096
+
+struct capture
+{
+	unsigned char* data;
+	size_t len, size;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void capture_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	struct capture* capture = context;
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		if (capture->len + iov[i].len <= capture->size)
+		{
+			memcpy(capture->data + capture->len, iov[i].data, iov[i].len);
+			capture->len += iov[i].len;
+		}
+	}
+}
+
+static void generate(unsigned char* buf, size_t size)
+{
+	size_t len = 0;
+	unsigned n = 0;
+
+	while (len < size)
+	{
+		char line[64];
+		int k = snprintf(line, sizeof(line), "  CC      src/file%u.c -o obj/file%u.o\r\n", n, n);
+
+		if (len + k > size)
+		{
+			k = (int)(size - len);
+		}
+
+		memcpy(buf + len, line, k);
+		len += k;
+		n++;
+	}
+}
+
+static void feed(void* context, conlog_output_fn write, const unsigned char* data, size_t len)
+{
+	size_t offset = 0;
+
+	srand(19);
+
+	while (offset < len)
+	{
+		struct conlog_iovec iov;
+
+		iov.data = data + offset;
+		iov.len = 1 + rand() % BENCH_PIECE;
+
+		if (iov.len > len - offset)
+		{
+			iov.len = len - offset;
+		}
+
+		write(context, &iov, 1);
+		offset += iov.len;
+	}
+}
+
+/* what is dumped is the marker then the input from the first whole line in the last ring full */
+static int check(const unsigned char* data, size_t len, size_t ring)
+{
+	struct capture capture;
+	struct conlog_flight flight;
+	const unsigned char* tail;
+	const unsigned char* body;
+	char marker[80];
+	int n, result;
+
+	capture.size = ring + 128;
+	capture.len = 0;
+	capture.data = malloc(capture.size);
+
+	if (!capture.data || conlog_flight_init(&flight, ring, capture_write, &capture))
+	{
+		free(capture.data);
+		return 1;
+	}
+
+	feed(&flight, conlog_flight_write, data, len);
+	conlog_flight_finish(&flight, 1);
+
+	tail = data + len - ring;
+	tail = (const unsigned char*)memchr(tail, '\n', ring) + 1;
+	n = snprintf(marker, sizeof(marker), "[conlog: %llu bytes before this were not kept]\r\n", (unsigned long long)(tail - data));
+	body = capture.data + n;
+
+	result = (capture.len != n + (size_t)(data + len - tail)) || memcmp(capture.data, marker, n) || memcmp(body, tail, data + len - tail);
+
+	printf("%d MB ring: %s\n", (int)(ring >> 20), result ? "mismatch" : "tail matches");
+
+	free(capture.data);
+
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned char* data = malloc(BENCH_SIZE);
+	struct conlog_flight flight;
+	struct conlog_logfile log;
+	char path[64];
+	double t;
+	int failed = 0;
+
+	if (!data)
+	{
+		fprintf(stderr, "Failed to set up\n");
+		return 1;
+	}
+
+	generate(data, BENCH_SIZE);
+
+	failed |= check(data, BENCH_SIZE, 1 << 20);
+	failed |= check(data, BENCH_SIZE, BENCH_RING);
+
+	snprintf(path, sizeof(path), "/tmp/flight_bench.%d", (int)getpid());
+
+	printf("%d MB of build log in pieces up to %d bytes\n", BENCH_SIZE >> 20, BENCH_PIECE);
+	printf("%-24s %10s %10s\n", "sink", "seconds", "MB/s");
+
+	unlink(path);
+
+	if (conlog_logfile_open(&log, path, 0, 0))
+	{
+		fprintf(stderr, "Failed to open %s\n", path);
+		return 1;
+	}
+
+	t = now();
+	feed(&log, conlog_logfile_write, data, BENCH_SIZE);
+	conlog_logfile_sync(&log);
+	conlog_logfile_close(&log);
+	t = now() - t;
+
+	printf("%-24s %10.3f %10.1f\n", "file, synced", t, BENCH_SIZE / t / 1e6);
+
+	unlink(path);
+
+	if (conlog_logfile_open(&log, path, 0, 0) || conlog_flight_init(&flight, BENCH_RING, conlog_logfile_write, &log))
+	{
+		fprintf(stderr, "Failed to open %s\n", path);
+		return 1;
+	}
+
+	t = now();
+	feed(&flight, conlog_flight_write, data, BENCH_SIZE);
+	conlog_flight_finish(&flight, 0);
+	conlog_logfile_close(&log);
+	t = now() - t;
+
+	printf("%-24s %10.3f %10.1f\n", "16 MB ring, success", t, BENCH_SIZE / t / 1e6);
+
+	unlink(path);
+	free(data);
+
+	return failed;
+}
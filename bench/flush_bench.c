@@ -0,0 +1,218 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "flush.h"
+#include "logfile.h"
+
+#define BENCH_SIZE (16 << 20)
+#define BENCH_PIECE 160
+#define BENCH_TIME_MS 50
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static const struct
+{
+	const char* name;
+	int policy;
+	size_t size;
+	unsigned ms;
+	int sync;
+	unsigned seconds;
+} policies[] = {
+	{ "now", CONLOG_FLUSH_NOW, 0, 0, CONLOG_SYNC_NONE, 0 },
+	{ "line", CONLOG_FLUSH_LINE, 0, 0, CONLOG_SYNC_NONE, 0 },
+	{ "4K", CONLOG_FLUSH_SIZE, 4 << 10, 0, CONLOG_SYNC_NONE, 0 },
+	{ "64K", CONLOG_FLUSH_SIZE, 64 << 10, 0, CONLOG_SYNC_NONE, 0 },
+	{ "100ms", CONLOG_FLUSH_TIME, 0, 100, CONLOG_SYNC_NONE, 0 },
+	{ "64K+exit", CONLOG_FLUSH_SIZE, 64 << 10, 0, CONLOG_SYNC_EXIT, 0 },
+	{ "64K+1s", CONLOG_FLUSH_SIZE, 64 << 10, 0, CONLOG_SYNC_PERIODIC, 1 },
+	{ "now+1s", CONLOG_FLUSH_NOW, 0, 0, CONLOG_SYNC_PERIODIC, 1 },
+};
+
+/* compiler output, a line at a time or in the pieces a chatty child writes */
+static size_t generate(unsigned char* buf, size_t size)
+{
+	static const char* files[] = { "blocklog", "escscan", "flush", "output", "pump", "record", "render", "screen", "vtparse" };
+	size_t len = 0;
+
+	srand(17);
+
+	while (len + 256 < size)
+	{
+		len += snprintf((char*)buf + len, 256, "  CC      src/%s.c -o obj/%s.o -O2 -Wall %d\n", files[rand() % 9], files[rand() % 9], rand() % 1000);
+	}
+
+	return len;
+}
+
+static long file_size(const char* path)
+{
+	FILE* fp = fopen(path, "rb");
+	long n = -1;
+
+	if (fp)
+	{
+		fseek(fp, 0, SEEK_END);
+		n = ftell(fp);
+		fclose(fp);
+	}
+
+	return n;
+}
+
+static int same(const char* path, const unsigned char* data, size_t len)
+{
+	FILE* fp = fopen(path, "rb");
+	unsigned char* buf = malloc(len + 1);
+	int result = fp && buf && (fread(buf, 1, len + 1, fp) == len) && !memcmp(buf, data, len);
+
+	if (fp)
+	{
+		fclose(fp);
+	}
+
+	free(buf);
+
+	return result;
+}
+
+/* each piece is one write from the output thread */
+static int run(const char* path, int p, const unsigned char* data, size_t len, int bLines)
+{
+	struct conlog_logfile log;
+	struct conlog_flush flush;
+	size_t offset = 0;
+	double t;
+
+	unlink(path);
+
+	if (conlog_logfile_open(&log, path, 0, 0) || conlog_flush_init(&flush, policies[p].policy, policies[p].size, policies[p].ms, policies[p].sync, policies[p].seconds, conlog_logfile_write, conlog_logfile_sync, &log))
+	{
+		fprintf(stderr, "Failed to open %s\n", path);
+		return 1;
+	}
+
+	srand(5);
+	t = now();
+
+	while (offset < len)
+	{
+		struct conlog_iovec iov;
+
+		iov.data = data + offset;
+
+		if (bLines)
+		{
+			iov.len = (const unsigned char*)memchr(iov.data, '\n', len - offset) + 1 - iov.data;
+		}
+		else
+		{
+			iov.len = 1 + rand() % BENCH_PIECE;
+
+			if (iov.len > len - offset)
+			{
+				iov.len = len - offset;
+			}
+		}
+
+		conlog_flush_write(&flush, &iov, 1);
+		offset += iov.len;
+	}
+
+	conlog_flush_finish(&flush);
+	conlog_logfile_close(&log);
+
+	t = now() - t;
+
+	printf("%-8s %-10s %10llu %8llu %10.1f\n", bLines ? "lines" : "pieces", policies[p].name, flush.stats.writes, flush.stats.syncs, len / t / 1e6);
+
+	if ((flush.stats.bytesOut != len) || !same(path, data, len))
+	{
+		fprintf(stderr, "%s does not match what was written\n", policies[p].name);
+		return 1;
+	}
+
+	return 0;
+}
+
+/* held output reaches the file once the delay is up, without another write */
+static int check_time(const char* path)
+{
+	struct conlog_logfile log;
+	struct conlog_flush flush;
+	struct conlog_iovec iov;
+	long before, after;
+
+	unlink(path);
+
+	if (conlog_logfile_open(&log, path, 0, 0) || conlog_flush_init(&flush, CONLOG_FLUSH_TIME, 0, BENCH_TIME_MS, CONLOG_SYNC_NONE, 0, conlog_logfile_write, conlog_logfile_sync, &log))
+	{
+		fprintf(stderr, "Failed to open %s\n", path);
+		return 1;
+	}
+
+	iov.data = (const unsigned char*)"partial";
+	iov.len = 7;
+
+	conlog_flush_write(&flush, &iov, 1);
+	before = file_size(path);
+	usleep(BENCH_TIME_MS * 4000);
+	after = file_size(path);
+
+	conlog_flush_finish(&flush);
+	conlog_logfile_close(&log);
+
+	printf("held %ld bytes, %ld after %d ms\n", before, after, BENCH_TIME_MS * 4);
+
+	return (before != 0) || (after != 7);
+}
+
+int main(int argc, char** argv)
+{
+	unsigned char* data = malloc(BENCH_SIZE);
+	char path[64];
+	size_t len;
+	int failed = 0, p;
+
+	if (!data)
+	{
+		fprintf(stderr, "Failed to set up\n");
+		return 1;
+	}
+
+	snprintf(path, sizeof(path), "/tmp/flush_bench.%d", (int)getpid());
+
+	len = generate(data, BENCH_SIZE);
+
+	printf("%d MB to a file\n", (int)(len >> 20));
+	printf("%-8s %-10s %10s %8s %10s\n", "writes", "policy", "syscalls", "syncs", "MB/s");
+
+	for (p = 0; p < (int)(sizeof(policies) / sizeof(policies[0])); p++)
+	{
+		failed |= run(path, p, data, len, 1);
+	}
+
+	for (p = 0; p < (int)(sizeof(policies) / sizeof(policies[0])); p++)
+	{
+		failed |= run(path, p, data, len, 0);
+	}
+
+	failed |= check_time(path);
+
+	unlink(path);
+	free(data);
+
+	return failed;
+}
@@ -0,0 +1,295 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "keys.h"
+
+#define BENCH_CHARS (1 << 20)
+
+struct known
+{
+	unsigned short vk;
+	unsigned short ch;
+	unsigned modifiers;
+	const char* bytes;
+	size_t len;
+};
+
+#define K(vk, ch, m, s) { vk, ch, m, s, sizeof(s) - 1 }
+
+static const struct known known[] =
+{
+	K(0x41, 'a', 0, "a"),
+	K(0x20, ' ', CONLOG_KEY_CTRL, "\0"),
+	K(0x0D, '\r', 0, "\r"),
+	K(0, 0xE9, 0, "\xC3\xA9"),
+	K(0, 0x20AC, 0, "\xE2\x82\xAC"),
+	K(0, 0xDE00, 0, "\xEF\xBF\xBD"),
+	K(CONLOG_KEY_UP, 0, 0, "\033[A"),
+	K(CONLOG_KEY_UP, 0, CONLOG_KEY_SHIFT, "\033[1;2A"),
+	K(CONLOG_KEY_UP, 0, CONLOG_KEY_ALT, "\033[A"),
+	K(CONLOG_KEY_LEFT, 0, CONLOG_KEY_CTRL, "\033[1;5D"),
+	K(CONLOG_KEY_CLEAR, 0, CONLOG_KEY_SHIFT | CONLOG_KEY_ALT, "\033[1;4E"),
+	K(CONLOG_KEY_F1, 0, 0, "\033OP"),
+	K(CONLOG_KEY_F1 + 3, 0, CONLOG_KEY_CTRL, "\033[1;5S"),
+	K(CONLOG_KEY_F1 + 4, 0, 0, "\033[15~"),
+	K(CONLOG_KEY_F12, 0, CONLOG_KEY_SHIFT | CONLOG_KEY_ALT | CONLOG_KEY_CTRL, "\033[24;8~"),
+	K(CONLOG_KEY_HOME, 0, 0, "\033[1~"),
+	K(CONLOG_KEY_DELETE, 0, CONLOG_KEY_ALT | CONLOG_KEY_CTRL, "\033[3;7~"),
+	K(CONLOG_KEY_NEXT, 0, CONLOG_KEY_SHIFT | CONLOG_KEY_CTRL, "\033[6;6~"),
+	K(CONLOG_KEY_ESCAPE, 0, CONLOG_KEY_SHIFT, "\033[P"),
+	K(0x10, 0, CONLOG_KEY_SHIFT, "")
+};
+
+struct drain
+{
+	int fd;
+	unsigned long long bytes;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int expect(const char* name, const struct conlog_keys* keys, const char* bytes, size_t len)
+{
+	if ((keys->len == len) && !memcmp(keys->buf, bytes, len))
+	{
+		return 0;
+	}
+
+	fprintf(stderr, "%s: gave %d bytes, expected %d\n", name, (int)keys->len, (int)len);
+
+	return 1;
+}
+
+static void typed(struct conlog_key* key, const char* text, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		key[i].vk = 0;
+		key[i].ch = (unsigned char)text[i % strlen(text)];
+		key[i].modifiers = 0;
+	}
+}
+
+static int check(void)
+{
+	struct conlog_keys keys;
+	struct conlog_key key[CONLOG_KEYS_BATCH];
+	char expected[CONLOG_KEYS_BATCH + 6];
+	size_t len;
+	int failed = 0, i;
+
+	conlog_keys_init(&keys);
+
+	for (i = 0; i < (int)(sizeof(known) / sizeof(known[0])); i++)
+	{
+		char name[32];
+
+		key[0].vk = known[i].vk;
+		key[0].ch = known[i].ch;
+		key[0].modifiers = known[i].modifiers;
+
+		snprintf(name, sizeof(name), "key %d", i);
+
+		conlog_keys_encode(&keys, key, 1, 0);
+		failed |= expect(name, &keys, known[i].bytes, known[i].len);
+	}
+
+	/* a surrogate pair split between two wakes */
+	key[0].vk = 0;
+	key[0].ch = 0xD83D;
+	key[0].modifiers = 0;
+	conlog_keys_encode(&keys, key, 1, 0);
+	failed |= expect("high surrogate", &keys, "", 0);
+	key[0].ch = 0xDE00;
+	conlog_keys_encode(&keys, key, 1, 0);
+	failed |= expect("low surrogate", &keys, "\xF0\x9F\x98\x80", 4);
+
+	/* typing and short bursts are never bracketed */
+	keys.bBracketed = 1;
+	typed(key, "ls -l\r", 6);
+	conlog_keys_encode(&keys, key, 6, 0);
+	failed |= expect("typed", &keys, "ls -l\r", 6);
+
+	/* a paste read in two wakes is bracketed once, with the escapes in it dropped */
+	typed(key, "echo \033[201~ pasted\r", CONLOG_KEYS_BATCH);
+	conlog_keys_encode(&keys, key, CONLOG_KEYS_BATCH, 1);
+	memcpy(expected, "\033[200~", 6);
+	len = 6;
+
+	for (i = 0; i < CONLOG_KEYS_BATCH; i++)
+	{
+		if (key[i].ch != 033)
+		{
+			expected[len++] = (char)key[i].ch;
+		}
+	}
+
+	failed |= expect("paste start", &keys, expected, len);
+
+	typed(key, "tail\r", 5);
+	conlog_keys_encode(&keys, key, 5, 0);
+	failed |= expect("paste end", &keys, "tail\r\033[201~", 11);
+
+	/* a key that is not a character ends it */
+	typed(key, "x", CONLOG_KEYS_PASTE + 1);
+	key[CONLOG_KEYS_PASTE].vk = CONLOG_KEY_UP;
+	key[CONLOG_KEYS_PASTE].ch = 0;
+	conlog_keys_encode(&keys, key, CONLOG_KEYS_PASTE + 1, 0);
+	failed |= expect("mixed", &keys, "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\033[A", CONLOG_KEYS_PASTE + 3);
+
+	typed(key, "x", CONLOG_KEYS_PASTE);
+	conlog_keys_encode(&keys, key, CONLOG_KEYS_PASTE, 0);
+	failed |= (keys.len != CONLOG_KEYS_PASTE + 12) || memcmp(keys.buf, "\033[200~", 6) || memcmp(keys.buf + keys.len - 6, "\033[201~", 6);
+
+	keys.bBracketed = 0;
+	conlog_keys_encode(&keys, key, CONLOG_KEYS_PASTE, 0);
+	failed |= (keys.len != CONLOG_KEYS_PASTE);
+
+	printf("key encoding: %s\n", failed ? "mismatch" : "as expected");
+
+	return failed;
+}
+
+static void* drain_thread(void* pv)
+{
+	struct drain* drain = pv;
+	char buf[65536];
+	ssize_t n;
+
+	while ((n = read(drain->fd, buf, sizeof(buf))) > 0)
+	{
+		drain->bytes += n;
+	}
+
+	return NULL;
+}
+
+/* a paste into a pipe with a reader on the other end, one key or one wake at a time */
+static int paste(const struct conlog_key* key, int count, int batch, unsigned long long expected)
+{
+	struct conlog_keys keys;
+	struct drain drain;
+	pthread_t thread;
+	unsigned long long writes = 0;
+	int fd[2], i;
+	double t;
+
+	if (pipe(fd))
+	{
+		perror("pipe");
+		return 1;
+	}
+
+	drain.fd = fd[0];
+	drain.bytes = 0;
+
+	pthread_create(&thread, NULL, drain_thread, &drain);
+
+	conlog_keys_init(&keys);
+	keys.bBracketed = 1;
+
+	t = now();
+
+	for (i = 0; i < count; i += batch)
+	{
+		int n = (count - i < batch) ? count - i : batch;
+
+		conlog_keys_encode(&keys, key + i, n, i + n < count);
+
+		if (keys.len)
+		{
+			if (write(fd[1], keys.buf, keys.len) != (ssize_t)keys.len)
+			{
+				perror("write");
+				return 1;
+			}
+
+			writes++;
+		}
+	}
+
+	close(fd[1]);
+	pthread_join(thread, NULL);
+
+	t = now() - t;
+
+	close(fd[0]);
+
+	printf("%-10s %10llu %10.2f %10.1f\n", batch > 1 ? "batched" : "one by one", writes, t, drain.bytes / t / 1e6);
+
+	if (drain.bytes != expected)
+	{
+		fprintf(stderr, "%llu bytes arrived, expected %llu\n", drain.bytes, expected);
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	static const char line[] = "    printf(\"%s: caf\xC3\xA9 \xE2\x82\xAC%d\\n\", name, total);\r";
+	struct conlog_key* key = malloc(BENCH_CHARS * sizeof(*key));
+	unsigned long long bytes = 0;
+	int failed, count = 0;
+	size_t i = 0;
+
+	if (!key)
+	{
+		fprintf(stderr, "Failed to set up\n");
+		return 1;
+	}
+
+	failed = check();
+
+	/* source code with some accents, as the console gives it in UTF-16 */
+	while (count < BENCH_CHARS)
+	{
+		unsigned c = (unsigned char)line[i];
+		size_t n = 1;
+
+		if (c >= 0xE0)
+		{
+			c = ((c & 0x0F) << 12) | ((line[i + 1] & 0x3F) << 6) | (line[i + 2] & 0x3F);
+			n = 3;
+		}
+		else if (c >= 0xC0)
+		{
+			c = ((c & 0x1F) << 6) | (line[i + 1] & 0x3F);
+			n = 2;
+		}
+
+		key[count].vk = 0;
+		key[count].ch = (unsigned short)c;
+		key[count].modifiers = 0;
+		count++;
+		bytes += n;
+
+		i = (i + n) % (sizeof(line) - 1);
+	}
+
+	printf("a paste of %d characters, %llu bytes of UTF-8\n", BENCH_CHARS, bytes);
+	printf("%-10s %10s %10s %10s\n", "", "writes", "seconds", "MB/s");
+
+	failed |= paste(key, count, 1, bytes);
+	failed |= paste(key, count, CONLOG_KEYS_BATCH, bytes + 12);
+
+	free(key);
+
+	return failed;
+}
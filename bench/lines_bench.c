@@ -0,0 +1,367 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "escscan.h"
+#include "lines.h"
+
+#define BENCH_SIZE (32 << 20)
+#define BENCH_READ 4096
+#define BENCH_REPEAT 3
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct buffer
+{
+	unsigned char* data;
+	size_t len, size;
+};
+
+static void buffer_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	struct buffer* buffer = context;
+
+	while (count--)
+	{
+		if (buffer->len + iov->len > buffer->size)
+		{
+			size_t size = buffer->size ? buffer->size : 4096;
+
+			while (size < buffer->len + iov->len)
+			{
+				size <<= 1;
+			}
+
+			buffer->data = realloc(buffer->data, size);
+			buffer->size = size;
+
+			if (!buffer->data)
+			{
+				fprintf(stderr, "Out of memory\n");
+				exit(1);
+			}
+		}
+
+		memcpy(buffer->data + buffer->len, iov->data, iov->len);
+		buffer->len += iov->len;
+		iov++;
+	}
+}
+
+static void file_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	while (count--)
+	{
+		fwrite(iov->data, 1, iov->len, context);
+		iov++;
+	}
+}
+
+/* what each stream leaves in the log */
+static const struct
+{
+	const char* stream;
+	const char* lines;
+} known[] = {
+	{ "abc\r\n", "abc\n" },
+	{ "abc", "abc\n" },
+	{ "10%\r20%\r100%\r\n", "100%\n" },
+	{ "long line\rshort\r\n", "shortline\n" },
+	{ "long line\rshort\033[K\r\n", "short\n" },
+	{ "a\r\nb\r\n\033[2A\033[2Kc\r\n\033[2Kd\r\n", "c\nd\n" },
+	{ "a\r\nb\r\n\033[2F\033[Kc\033[E\033[Kd\r\n", "c\nd\n" },
+	{ "x\r\ny\r\nz\033[2A\033[J\rw\r\n", "w\n" },
+	{ "abcdef\b\b\bX\r\n", "abcXef\n" },
+	{ "a\tb\r\n", "a       b\n" },
+	{ "abc\033[5Gd\r\n", "abc d\n" },
+	{ "abcdef\033[3G\033[2P\r\n", "abef\n" },
+	{ "abcdef\033[2G\033[3X\r\n", "a   ef\n" },
+	{ "abcdef\033[4G\033[1K\r\n", "    ef\n" },
+	{ "\0337one\r\ntwo\0338\033[Kthree\r\n\r\n", "three\ntwo\n" },
+	{ "\033[1;31mred\033[0m \033]0;title\007plain\r\n", "red plain\n" },
+	{ "caf\xc3\xa9\r\xe2\x9c\x93\r\n", "\xe2\x9c\x93" "af\xc3\xa9\n" },
+	{ "a\r\n\r\nb\r\n", "a\n\nb\n" },
+};
+
+static int check_known(void)
+{
+	int i, failed = 0;
+
+	for (i = 0; i < (int)(sizeof(known) / sizeof(known[0])); i++)
+	{
+		struct buffer out = { NULL, 0, 0 };
+		struct conlog_lines lines;
+		struct conlog_iovec iov;
+		size_t len = strlen(known[i].lines);
+
+		if (conlog_lines_init(&lines, buffer_write, &out))
+		{
+			fprintf(stderr, "Failed to set up\n");
+			exit(1);
+		}
+
+		iov.data = (const unsigned char*)known[i].stream;
+		iov.len = strlen(known[i].stream);
+
+		conlog_lines_write(&lines, &iov, 1);
+		conlog_lines_finish(&lines);
+
+		if ((out.len != len) || memcmp(out.data, known[i].lines, len))
+		{
+			fprintf(stderr, "case %d: got \"%.*s\"\n", i, (int)out.len, out.data);
+			failed = 1;
+		}
+
+		free(out.data);
+	}
+
+	return failed;
+}
+
+/* a package manager's progress bar redrawn in place for every file */
+static size_t sample_progress(unsigned char* buf, size_t size)
+{
+	size_t len = 0;
+	int pkg = 0;
+
+	while (len + 512 < size)
+	{
+		int pct;
+
+		for (pct = 0; (pct <= 100) && (len + 512 < size); pct += 1 + rand() % 4)
+		{
+			char bar[41];
+
+			memset(bar, '#', pct * 40 / 100);
+			memset(bar + pct * 40 / 100, '.', 40 - pct * 40 / 100);
+			bar[40] = 0;
+
+			len += snprintf((char*)buf + len, 512, "\rpackage-%04d [%s] %3d%% %5d kB/s", pkg, bar, pct, rand() % 20000);
+		}
+
+		len += snprintf((char*)buf + len, 512, "\r\033[Kinstalled package-%04d\r\n", pkg++);
+	}
+
+	return len;
+}
+
+/* a spinner with the build steps it is waiting on */
+static size_t sample_spinner(unsigned char* buf, size_t size)
+{
+	static const char* spin[] = { "\xe2\xa0\x8b", "\xe2\xa0\x99", "\xe2\xa0\xb9", "\xe2\xa0\xb8", "\xe2\xa0\xbc", "\xe2\xa0\xb4" };
+	size_t len = 0;
+	int step = 0;
+
+	while (len + 512 < size)
+	{
+		int i, n = 20 + rand() % 200;
+
+		for (i = 0; (i < n) && (len + 512 < size); i++)
+		{
+			len += snprintf((char*)buf + len, 512, "\r\033[2K\033[36m%s\033[0m step %d: resolving dependencies", spin[i % 6], step);
+		}
+
+		len += snprintf((char*)buf + len, 512, "\r\033[2K\033[32m\xe2\x9c\x94\033[0m step %d done\r\n", step++);
+	}
+
+	return len;
+}
+
+/* parallel downloads, each on its own line, redrawn together by moving the cursor up */
+static size_t sample_layers(unsigned char* buf, size_t size)
+{
+	size_t len = 0;
+	int group = 0;
+
+	while (len + 4096 < size)
+	{
+		int done[6] = { 0 }, finished = 0, i;
+
+		for (i = 0; i < 6; i++)
+		{
+			len += snprintf((char*)buf + len, 512, "%04x%04x: Waiting\r\n", group, i);
+		}
+
+		while ((finished < 6) && (len + 4096 < size))
+		{
+			len += snprintf((char*)buf + len, 512, "\033[6A");
+
+			for (i = 0; i < 6; i++)
+			{
+				if (done[i] < 100)
+				{
+					done[i] += rand() % 5;
+
+					if (done[i] >= 100)
+					{
+						done[i] = 100;
+						finished++;
+					}
+				}
+
+				if (done[i] < 100)
+				{
+					len += snprintf((char*)buf + len, 512, "\033[2K%04x%04x: Downloading %3d%%\r\n", group, i, done[i]);
+				}
+				else
+				{
+					len += snprintf((char*)buf + len, 512, "\033[2K%04x%04x: Pull complete\r\n", group, i);
+				}
+			}
+		}
+
+		group++;
+	}
+
+	return len;
+}
+
+/* a build log with a status line kept at the bottom */
+static size_t sample_build(unsigned char* buf, size_t size)
+{
+	size_t len = 0;
+	int unit = 0;
+
+	while (len + 512 < size)
+	{
+		len += snprintf((char*)buf + len, 512, "\r\033[K   Compiling crate-%d v0.%d.%d\r\n", unit, rand() % 10, rand() % 10);
+		len += snprintf((char*)buf + len, 512, "    Building [=====>    ] %d/%d: crate-%d", unit, unit + 100, unit + 1);
+		unit++;
+	}
+
+	return len;
+}
+
+static int run(const char* name, size_t (*sample)(unsigned char*, size_t), unsigned char* corpus)
+{
+	struct buffer out = { NULL, 0, 0 };
+	struct conlog_lines_stats stats;
+	double best = 0;
+	size_t len;
+	int i;
+
+	srand(5);
+
+	len = sample(corpus, BENCH_SIZE);
+
+	for (i = 0; i < BENCH_REPEAT; i++)
+	{
+		struct conlog_lines lines;
+		size_t offset = 0;
+		double t;
+
+		out.len = 0;
+
+		if (conlog_lines_init(&lines, buffer_write, &out))
+		{
+			fprintf(stderr, "Failed to set up\n");
+			exit(1);
+		}
+
+		t = now();
+
+		while (offset < len)
+		{
+			struct conlog_iovec iov;
+
+			iov.data = corpus + offset;
+			iov.len = (len - offset) < BENCH_READ ? (len - offset) : BENCH_READ;
+			conlog_lines_write(&lines, &iov, 1);
+			offset += iov.len;
+		}
+
+		conlog_lines_finish(&lines);
+
+		t = now() - t;
+
+		if (!i || (t < best))
+		{
+			best = t;
+		}
+
+		stats = lines.stats;
+	}
+
+	printf("%-10s %12llu %12llu %10.1f %10llu %10.1f\n", name, stats.bytesIn, stats.bytesOut, (double)stats.bytesIn / stats.bytesOut, stats.lines, len / best / 1e6);
+
+	free(out.data);
+
+	return 0;
+}
+
+/* collapses a recorded stream, such as a raw log, to stdout */
+static int collapse(const char* path)
+{
+	FILE* fp = fopen(path, "rb");
+	unsigned char buf[BENCH_READ];
+	struct conlog_lines lines;
+	size_t n;
+
+	if (!fp || conlog_lines_init(&lines, file_write, stdout))
+	{
+		fprintf(stderr, "Failed to open %s\n", path);
+		return 1;
+	}
+
+	while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+	{
+		struct conlog_iovec iov;
+
+		iov.data = buf;
+		iov.len = n;
+		conlog_lines_write(&lines, &iov, 1);
+	}
+
+	conlog_lines_finish(&lines);
+	fclose(fp);
+
+	fprintf(stderr, "%llu bytes in, %llu bytes out, %llu lines\n", lines.stats.bytesIn, lines.stats.bytesOut, lines.stats.lines);
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned char* corpus;
+	int failed;
+
+	conlog_escscan_init();
+
+	if (argc > 1)
+	{
+		return collapse(argv[1]);
+	}
+
+	failed = check_known();
+
+	corpus = malloc(BENCH_SIZE);
+
+	if (!corpus)
+	{
+		fprintf(stderr, "Failed to set up\n");
+		return 1;
+	}
+
+	printf("%-10s %12s %12s %10s %10s %10s\n", "sample", "bytes in", "bytes out", "reduction", "lines", "MB/s");
+
+	run("progress", sample_progress, corpus);
+	run("spinner", sample_spinner, corpus);
+	run("layers", sample_layers, corpus);
+	run("build", sample_build, corpus);
+
+	printf("%d known streams %s\n", (int)(sizeof(known) / sizeof(known[0])), failed ? "differ" : "match");
+
+	free(corpus);
+
+	return failed;
+}
@@ -0,0 +1,258 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "logwriter.h"
+
+#define BENCH_SIZE (4 << 20)
+#define BENCH_RING 4096
+#define BENCH_PIECE 3000
+#define BENCH_ROUNDS 8
+
+static const char marker[] = "\r\n[conlog: ";
+
+/* the log, written slowly enough that the ring fills and wraps */
+struct sink
+{
+	unsigned char* data;
+	size_t len, size;
+	unsigned calls;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void sink_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	struct sink* sink = context;
+
+	while (count--)
+	{
+		if (sink->len + iov->len > sink->size)
+		{
+			fprintf(stderr, "the log is larger than what was written\n");
+			exit(1);
+		}
+
+		memcpy(sink->data + sink->len, iov->data, iov->len);
+		sink->len += iov->len;
+		iov++;
+	}
+
+	if (!(++sink->calls % 8))
+	{
+		struct timespec ts = { 0, 100000 };
+		nanosleep(&ts, NULL);
+	}
+}
+
+/* numbered lines of an odd length, so no two places in the output look alike and none holds a '\r' */
+static size_t generate(unsigned char* buf, size_t size)
+{
+	size_t len = 0;
+	unsigned long long i = 0;
+
+	while (len + 16 < size)
+	{
+		len += snprintf((char*)buf + len, 16, "%010llu\n", i++);
+	}
+
+	return len;
+}
+
+/* the log is the output in order, with what was dropped replaced by a marker saying how much */
+static int check(const unsigned char* out, size_t outLen, const unsigned char* in, size_t inLen, int policy, unsigned long long* markers)
+{
+	size_t o = 0, i = 0;
+
+	*markers = 0;
+
+	while (o < outLen)
+	{
+		const unsigned char* m = memchr(out + o, '\r', outLen - o);
+		size_t n = (m ? (size_t)(m - out) : outLen) - o;
+		unsigned long long dropped;
+		char* end;
+
+		if ((n > inLen - i) || memcmp(out + o, in + i, n))
+		{
+			fprintf(stderr, "log differs at %lu, output %lu\n", (unsigned long)o, (unsigned long)i);
+			return 1;
+		}
+
+		o += n;
+		i += n;
+
+		if (!m)
+		{
+			break;
+		}
+
+		if ((policy != CONLOG_OVERFLOW_DROP) || (outLen - o < sizeof(marker) - 1) || memcmp(out + o, marker, sizeof(marker) - 1))
+		{
+			fprintf(stderr, "unexpected '\\r' in the log at %lu\n", (unsigned long)o);
+			return 1;
+		}
+
+		dropped = strtoull((const char*)out + o + sizeof(marker) - 1, &end, 10);
+
+		if (!dropped || strncmp(end, " bytes dropped]\r\n", 17) || (dropped > inLen - i))
+		{
+			fprintf(stderr, "bad marker at %lu\n", (unsigned long)o);
+			return 1;
+		}
+
+		o = (const unsigned char*)end + 17 - out;
+		i += dropped;
+		(*markers)++;
+	}
+
+	if (i != inLen)
+	{
+		fprintf(stderr, "log ends at output %lu of %lu\n", (unsigned long)i, (unsigned long)inLen);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int run(const char* name, int policy, const unsigned char* in, size_t len)
+{
+	struct sink sink;
+	unsigned long long bytesDropped = 0, bytesSpilled = 0, stalls = 0, markers = 0;
+	size_t spillPeak = 0;
+	double t = now();
+	int failed = 0, round;
+
+	memset(&sink, 0, sizeof(sink));
+
+	/* the markers can make the log longer than the output */
+	sink.size = len * 2;
+	sink.data = malloc(sink.size);
+
+	if (!sink.data)
+	{
+		perror("malloc");
+		exit(1);
+	}
+
+	srand(4);
+
+	for (round = 0; round < BENCH_ROUNDS; round++)
+	{
+		struct conlog_logwriter writer;
+		size_t offset = 0;
+		unsigned long long m;
+
+		sink.len = 0;
+
+		if (conlog_logwriter_start(&writer, BENCH_RING, policy, sink_write, &sink))
+		{
+			perror("conlog_logwriter_start");
+			exit(1);
+		}
+
+		while (offset < len)
+		{
+			struct conlog_iovec iov[2];
+			size_t a = 1 + rand() % BENCH_PIECE, b = rand() % BENCH_PIECE;
+
+			if (a > len - offset)
+			{
+				a = len - offset;
+			}
+
+			if (b > len - offset - a)
+			{
+				b = len - offset - a;
+			}
+
+			iov[0].data = in + offset;
+			iov[0].len = a;
+			iov[1].data = in + offset + a;
+			iov[1].len = b;
+
+			conlog_logwriter_write(&writer, iov, b ? 2 : 1);
+
+			offset += a + b;
+
+			/* the producer pauses too, so the log catches up and the ring starts filling again */
+			if (!(rand() % 16))
+			{
+				struct timespec ts = { 0, 200000 };
+				nanosleep(&ts, NULL);
+			}
+		}
+
+		conlog_logwriter_stop(&writer);
+
+		failed |= check(sink.data, sink.len, in, len, policy, &m);
+
+		bytesDropped += writer.stats.bytesDropped;
+		bytesSpilled += writer.stats.bytesSpilled;
+		stalls += writer.stats.stalls;
+		markers += m;
+
+		if (writer.stats.spillPeak > spillPeak)
+		{
+			spillPeak = writer.stats.spillPeak;
+		}
+	}
+
+	t = now() - t;
+
+	/* each mode must have been pushed past the ring for the check to mean anything */
+	switch (policy)
+	{
+	case CONLOG_OVERFLOW_DROP:
+		failed |= !bytesDropped || !markers;
+		break;
+	case CONLOG_OVERFLOW_SPILL:
+		failed |= !bytesSpilled || bytesDropped;
+		break;
+	default:
+		failed |= !stalls || bytesDropped;
+		break;
+	}
+
+	printf("%-8s %10.1f %10llu %10llu %10llu %10lu %10llu %s\n", name, (double)len * BENCH_ROUNDS / t / 1e6, stalls, bytesDropped, bytesSpilled, (unsigned long)spillPeak, markers, failed ? "out of order" : "in order");
+
+	free(sink.data);
+
+	return failed;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned char* in = malloc(BENCH_SIZE);
+	size_t len;
+	int failed = 0;
+
+	if (!in)
+	{
+		perror("malloc");
+		return 1;
+	}
+
+	len = generate(in, BENCH_SIZE);
+
+	printf("%.1f MB through a %d byte ring %d times, to a log that pauses now and then\n", len / 1e6, BENCH_RING, BENCH_ROUNDS);
+	printf("%-8s %10s %10s %10s %10s %10s %10s\n", "", "MB/s", "stalls", "dropped", "spilled", "spill peak", "markers");
+
+	failed |= run("block", CONLOG_OVERFLOW_BLOCK, in, len);
+	failed |= run("drop", CONLOG_OVERFLOW_DROP, in, len);
+	failed |= run("spill", CONLOG_OVERFLOW_SPILL, in, len);
+
+	free(in);
+
+	return failed;
+}
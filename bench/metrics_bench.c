@@ -0,0 +1,273 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "escscan.h"
+#include "pump.h"
+#include "platform.h"
+
+#define BENCH_SIZE (256 << 20)
+#define BENCH_READ 4096
+#define BENCH_REPEAT 5
+/* the most the timing may add, in percent */
+#define BENCH_LIMIT 1.0
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int backend_cursor(void* context)
+{
+	return 0;
+}
+
+static void backend_focus(void* context, int enable)
+{
+}
+
+static int backend_reply(void* context, const char* data, size_t len)
+{
+	return 1;
+}
+
+static void null_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	unsigned long long* bytes = context;
+
+	while (count--)
+	{
+		*bytes += iov->len;
+		iov++;
+	}
+}
+
+static void fd_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	int fd = *(int*)context;
+
+	while (count--)
+	{
+		if (write(fd, iov->data, iov->len) < 0)
+		{
+			perror("write");
+			exit(1);
+		}
+
+		iov++;
+	}
+}
+
+static void generate(unsigned char* buf, size_t size)
+{
+	size_t len = 0;
+	unsigned n = 0;
+
+	while (len < size)
+	{
+		char line[80];
+		int k = snprintf(line, sizeof(line), "\033[32m  CC\033[0m      src/file%u.c -o obj/file%u.o\r\n", n, n);
+
+		if (len + k > size)
+		{
+			k = (int)(size - len);
+		}
+
+		memcpy(buf + len, line, k);
+		len += k;
+		n++;
+	}
+}
+
+/* bucket n holds 2^(n-1) up to 2^n - 1, and a merge adds the counts and keeps the larger maximum */
+static int check(void)
+{
+	static const unsigned long long values[] = { 0, 1, 2, 3, 4, 7, 8, 4095, 4096, 1ULL << 50 };
+	static const int buckets[] = { 0, 1, 2, 2, 3, 3, 4, 12, 13, CONLOG_HISTOGRAM_BUCKETS - 1 };
+	struct conlog_histogram a, b;
+	unsigned long long total = 0;
+	int i, result = 0;
+
+	memset(&a, 0, sizeof(a));
+	memset(&b, 0, sizeof(b));
+
+	for (i = 0; i < (int)(sizeof(values) / sizeof(values[0])); i++)
+	{
+		struct conlog_histogram one;
+
+		memset(&one, 0, sizeof(one));
+		conlog_histogram_add(&one, values[i]);
+
+		result |= (one.buckets[buckets[i]] != 1) || (one.count != 1) || (one.max != values[i]);
+
+		conlog_histogram_add(i & 1 ? &a : &b, values[i]);
+		total += values[i];
+	}
+
+	conlog_histogram_merge(&a, &b);
+
+	result |= (a.count != sizeof(values) / sizeof(values[0])) || (a.total != total) || (a.max != (1ULL << 50));
+
+	printf("histogram buckets: %s\n", result ? "mismatch" : "as expected");
+
+	return result;
+}
+
+static double run(const unsigned char* data, size_t len, int bTimed, int bNull, struct conlog_output_stats* stats)
+{
+	static const struct conlog_backend backend = { backend_cursor, backend_focus, backend_reply };
+	struct conlog_pump pump;
+	unsigned long long bytes[2] = { 0, 0 };
+	int fd = open("/dev/null", O_WRONLY);
+	size_t offset = 0;
+	double t;
+
+	conlog_pump_init(&pump, &backend, NULL);
+	pump.output.bTimed = bTimed;
+
+	if (bNull)
+	{
+		conlog_output_add(&pump.output, null_write, bytes);
+		conlog_output_add(&pump.output, null_write, bytes + 1);
+	}
+	else
+	{
+		conlog_output_add(&pump.output, fd_write, &fd);
+		conlog_output_add(&pump.output, fd_write, &fd);
+	}
+
+	srand(20);
+
+	t = now();
+
+	while (offset < len)
+	{
+		size_t n = 1 + rand() % BENCH_READ;
+
+		if (n > len - offset)
+		{
+			n = len - offset;
+		}
+
+		conlog_pump_data(&pump, data + offset, n);
+		offset += n;
+	}
+
+	t = now() - t;
+
+	close(fd);
+
+	*stats = pump.output.stats;
+
+	return t;
+}
+
+int main(int argc, char** argv)
+{
+	static const char* sinks[] = { "/dev/null", "counted" };
+	unsigned char* data = malloc(BENCH_SIZE);
+	struct conlog_histogram histogram;
+	unsigned long long start, end;
+	double t, clockNs, addNs;
+	int failed, over = 0, s, i;
+
+	conlog_escscan_init();
+
+	if (!data)
+	{
+		fprintf(stderr, "Failed to set up\n");
+		return 1;
+	}
+
+	failed = check();
+
+	generate(data, BENCH_SIZE);
+
+	/* what each sampled flush adds, a clock read for each channel and one more, and a histogram update for each channel */
+	start = end = conlog_clock();
+
+	for (i = 0; i < 10000000; i++)
+	{
+		end = conlog_clock();
+	}
+
+	clockNs = (end - start) / 1e7;
+
+	memset(&histogram, 0, sizeof(histogram));
+	start = conlog_clock();
+
+	for (i = 0; i < 10000000; i++)
+	{
+		conlog_histogram_add(&histogram, i);
+	}
+
+	addNs = (conlog_clock() - start) / 1e7;
+
+	printf("conlog_clock: %.1f ns, conlog_histogram_add: %.1f ns\n", clockNs, addNs);
+
+	printf("%d MB of build log through the pump to two channels, best of %d, one flush in %d timed\n", BENCH_SIZE >> 20, BENCH_REPEAT, CONLOG_OUTPUT_SAMPLE);
+	printf("%-10s %10s %10s %10s %10s %10s\n", "channels", "untimed", "timed", "measured", "cost", "p50 ns");
+
+	for (s = 0; s < 2; s++)
+	{
+		struct conlog_output_stats stats;
+		double plain = 0, timed = 0, cost;
+		unsigned long long half = 0, seen = 0;
+		int b = 0;
+
+		for (i = 0; i < BENCH_REPEAT; i++)
+		{
+			t = run(data, BENCH_SIZE, 0, s, &stats);
+
+			if (!i || (t < plain))
+			{
+				plain = t;
+			}
+
+			t = run(data, BENCH_SIZE, 1, s, &stats);
+
+			if (!i || (t < timed))
+			{
+				timed = t;
+			}
+		}
+
+		if ((stats.bytesRead != BENCH_SIZE) || (stats.reads.total != BENCH_SIZE) || (stats.channels != 2) || (stats.channelTime[0].count != (stats.flushes + CONLOG_OUTPUT_SAMPLE - 1) / CONLOG_OUTPUT_SAMPLE))
+		{
+			fprintf(stderr, "%s: the statistics do not add up\n", sinks[s]);
+			failed = 1;
+		}
+
+		/* the upper end of the bucket holding the median flush of the first channel */
+		half = (stats.channelTime[0].count + 1) / 2;
+
+		while ((b < CONLOG_HISTOGRAM_BUCKETS) && ((seen += stats.channelTime[0].buckets[b]) < half))
+		{
+			b++;
+		}
+
+		/* the difference of two timings is mostly noise at this size, so the limit is held to the cost of the work the timing adds */
+		cost = stats.channelTime[0].count * (3 * clockNs + 2 * addNs) * 1e-9 * 100 / plain;
+
+		over |= cost > BENCH_LIMIT;
+
+		printf("%-10s %9.3fs %9.3fs %9.2f%% %9.3f%% %10llu\n", sinks[s], plain, timed, (timed - plain) * 100 / plain, cost, b ? (1ULL << b) - 1 : 0);
+	}
+
+	printf("the timing costs %s %.0f%%\n", over ? "more than" : "less than", BENCH_LIMIT);
+
+	failed |= over;
+
+	free(data);
+
+	return failed;
+}
@@ -0,0 +1,402 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "escscan.h"
+#include "vtparse.h"
+#include "output.h"
+
+#define BENCH_SIZE (64 << 20)
+#define BENCH_READ 4096
+#define BENCH_REPEAT 5
+
+struct channel
+{
+	int fd;
+	unsigned long long syscalls;
+};
+
+/* the staging buffer conlog_output used before the fan-out wrote the read buffer directly */
+struct staged
+{
+	struct channel channels[2];
+	unsigned char buffer[4096];
+	size_t bufferLength;
+	unsigned long long copied;
+};
+
+struct direct
+{
+	struct channel channels[2];
+	struct conlog_output output;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void staged_flush(struct staged* state)
+{
+	int i;
+
+	if (state->bufferLength)
+	{
+		for (i = 0; i < 2; i++)
+		{
+			if (write(state->channels[i].fd, state->buffer, state->bufferLength) < 0)
+			{
+				perror("write");
+				exit(1);
+			}
+
+			state->channels[i].syscalls++;
+		}
+
+		state->bufferLength = 0;
+	}
+}
+
+static void staged_pass(void* context, const unsigned char* data, size_t len)
+{
+	struct staged* state = context;
+
+	while (len)
+	{
+		size_t n = sizeof(state->buffer) - state->bufferLength;
+
+		if (n)
+		{
+			if (n > len)
+			{
+				n = len;
+			}
+
+			memcpy(state->buffer + state->bufferLength, data, n);
+			state->copied += n;
+
+			data += n;
+			len -= n;
+			state->bufferLength += n;
+		}
+		else
+		{
+			staged_flush(state);
+		}
+	}
+}
+
+static int staged_report(void* context, int event)
+{
+	if (event == CONLOG_VT_DSR_CPR)
+	{
+		staged_flush(context);
+		return 1;
+	}
+
+	return 0;
+}
+
+static void channel_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	struct channel* channel = context;
+	struct iovec vec[CONLOG_OUTPUT_IOV];
+	ssize_t n;
+	int i;
+
+	if (count == 1)
+	{
+		n = write(channel->fd, iov->data, iov->len);
+	}
+	else
+	{
+		for (i = 0; i < count; i++)
+		{
+			vec[i].iov_base = (void*)iov[i].data;
+			vec[i].iov_len = iov[i].len;
+		}
+
+		n = writev(channel->fd, vec, count);
+	}
+
+	if (n < 0)
+	{
+		perror("write");
+		exit(1);
+	}
+
+	channel->syscalls++;
+}
+
+/* collects what a channel is given */
+struct capture
+{
+	unsigned char* data;
+	size_t len;
+};
+
+static void capture_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	struct capture* capture = context;
+
+	while (count--)
+	{
+		memcpy(capture->data + capture->len, iov->data, iov->len);
+		capture->len += iov->len;
+		iov++;
+	}
+}
+
+static void reference_print(void* context, const unsigned char* data, size_t len)
+{
+	struct capture* capture = context;
+
+	memcpy(capture->data + capture->len, data, len);
+	capture->len += len;
+}
+
+static void reference_execute(void* context, unsigned char c)
+{
+	if ((c != 0x18) && (c != 0x1A))
+	{
+		reference_print(context, &c, 1);
+	}
+}
+
+static void reference_esc(void* context, const struct conlog_vt* vt, unsigned char final)
+{
+}
+
+static void reference_csi(void* context, const struct conlog_vt* vt, unsigned char final)
+{
+}
+
+static void direct_pass(void* context, const unsigned char* data, size_t len)
+{
+	struct direct* state = context;
+	conlog_output_write(&state->output, data, len);
+}
+
+static int direct_report(void* context, int event)
+{
+	struct direct* state = context;
+
+	if (event == CONLOG_VT_DSR_CPR)
+	{
+		conlog_output_flush(&state->output);
+		return 1;
+	}
+
+	return 0;
+}
+
+static void direct_text(void* context, const unsigned char* data, size_t len)
+{
+	struct direct* state = context;
+	conlog_output_text(&state->output, data, len);
+}
+
+/* the text channel against the full parser printing everything outside the sequences */
+static int check_text(const unsigned char* buf, size_t len)
+{
+	static const struct conlog_vt_handler handler = { direct_pass, direct_report, direct_text };
+	static const struct conlog_vt_sink sink = { reference_print, reference_execute, reference_esc, reference_csi };
+	static struct direct state;
+	struct capture text, reference;
+	struct conlog_vt vt;
+	size_t offset = 0;
+	int result;
+
+	text.data = malloc(len);
+	text.len = 0;
+	reference.data = malloc(len);
+	reference.len = 0;
+
+	conlog_output_init(&state.output);
+	conlog_output_add_text(&state.output, capture_write, &text);
+	conlog_vt_init(&vt);
+
+	/* odd sized reads split sequences between buffers */
+	while (offset < len)
+	{
+		size_t n = (len - offset) < 1000 ? (len - offset) : 1000;
+		conlog_vt_parse(&vt, buf + offset, n, &handler, &state);
+		conlog_output_flush(&state.output);
+		offset += n;
+	}
+
+	conlog_vt_init(&vt);
+	conlog_vt_feed(&vt, buf, len, &sink, &reference);
+
+	result = (text.len == reference.len) && !memcmp(text.data, reference.data, text.len);
+
+	if (!result)
+	{
+		fprintf(stderr, "text channel differs from the parser, %lu bytes against %lu\n", (unsigned long)text.len, (unsigned long)reference.len);
+	}
+
+	free(text.data);
+	free(reference.data);
+
+	return result;
+}
+
+static size_t generate(unsigned char* buf, size_t size)
+{
+	static const char* seq[] = { "\033[0m", "\033[1;32m", "\033[K", "\033]0;conlog\007", "\033[6n" };
+	size_t len = 0;
+
+	srand(3);
+
+	while (len + 256 < size)
+	{
+		int r = rand() % 20;
+
+		if (r < 5)
+		{
+			size_t n = strlen(seq[r]);
+			memcpy(buf + len, seq[r], n);
+			len += n;
+		}
+
+		len += snprintf((char*)buf + len, 128, "  CC      src/output.c %d\r\n", rand());
+	}
+
+	return len;
+}
+
+int main(int argc, char** argv)
+{
+	static const struct conlog_vt_handler stagedHandler = { staged_pass, staged_report };
+	static const struct conlog_vt_handler directHandler = { direct_pass, direct_report };
+	static const struct conlog_vt_handler textHandler = { direct_pass, direct_report, direct_text };
+	unsigned char* buf = malloc(BENCH_SIZE);
+	static struct staged staged;
+	static struct direct direct;
+	static struct direct text;
+	double stagedBest = 0, directBest = 0, textBest = 0;
+	unsigned long long directCopied = 0;
+	int fd = open("/dev/null", O_WRONLY);
+	size_t len;
+	int repeat;
+
+	conlog_escscan_init();
+
+	if (!buf || fd < 0)
+	{
+		fprintf(stderr, "Failed to set up\n");
+		return 1;
+	}
+
+	len = generate(buf, BENCH_SIZE);
+
+	for (repeat = 0; repeat < BENCH_REPEAT; repeat++)
+	{
+		struct conlog_vt vt;
+		size_t offset = 0;
+		double t;
+
+		memset(&staged, 0, sizeof(staged));
+		staged.channels[0].fd = staged.channels[1].fd = fd;
+		conlog_vt_init(&vt);
+
+		t = now();
+
+		while (offset < len)
+		{
+			size_t n = (len - offset) < BENCH_READ ? (len - offset) : BENCH_READ;
+			conlog_vt_parse(&vt, buf + offset, n, &stagedHandler, &staged);
+			staged_flush(&staged);
+			offset += n;
+		}
+
+		t = now() - t;
+		staged.copied += vt.copied;
+
+		if (!stagedBest || t < stagedBest)
+		{
+			stagedBest = t;
+		}
+
+		memset(&direct, 0, sizeof(direct));
+		direct.channels[0].fd = direct.channels[1].fd = fd;
+		conlog_output_init(&direct.output);
+		conlog_output_add(&direct.output, channel_write, &direct.channels[0]);
+		conlog_output_add(&direct.output, channel_write, &direct.channels[1]);
+		conlog_vt_init(&vt);
+		offset = 0;
+
+		t = now();
+
+		while (offset < len)
+		{
+			size_t n = (len - offset) < BENCH_READ ? (len - offset) : BENCH_READ;
+			direct.output.stats.bytesRead += n;
+			conlog_vt_parse(&vt, buf + offset, n, &directHandler, &direct);
+			conlog_output_flush(&direct.output);
+			offset += n;
+		}
+
+		t = now() - t;
+		directCopied = direct.output.stats.bytesCopied = vt.copied;
+
+		if (!directBest || t < directBest)
+		{
+			directBest = t;
+		}
+
+		/* the log channel given the text alone, in the same pass */
+		memset(&text, 0, sizeof(text));
+		text.channels[0].fd = text.channels[1].fd = fd;
+		conlog_output_init(&text.output);
+		conlog_output_add(&text.output, channel_write, &text.channels[0]);
+		conlog_output_add_text(&text.output, channel_write, &text.channels[1]);
+		conlog_vt_init(&vt);
+		offset = 0;
+
+		t = now();
+
+		while (offset < len)
+		{
+			size_t n = (len - offset) < BENCH_READ ? (len - offset) : BENCH_READ;
+			text.output.stats.bytesRead += n;
+			conlog_vt_parse(&vt, buf + offset, n, &textHandler, &text);
+			conlog_output_flush(&text.output);
+			offset += n;
+		}
+
+		t = now() - t;
+
+		if (!textBest || t < textBest)
+		{
+			textBest = t;
+		}
+	}
+
+	printf("%-8s %10s %16s %12s\n", "path", "MB/s", "copied/read", "syscalls");
+	printf("%-8s %10.1f %16.4f %12llu\n", "staged", len / stagedBest / 1e6, (double)staged.copied / len, staged.channels[0].syscalls + staged.channels[1].syscalls);
+	printf("%-8s %10.1f %16.4f %12llu\n", "direct", len / directBest / 1e6, (double)directCopied / direct.output.stats.bytesRead, direct.channels[0].syscalls + direct.channels[1].syscalls);
+	printf("%-8s %10.1f %16.4f %12llu\n", "text", len / textBest / 1e6, 0.0, text.channels[0].syscalls + text.channels[1].syscalls);
+	printf("direct: %llu flushes, %.2f vectors per flush\n", direct.output.stats.flushes, (double)direct.output.stats.vectors / direct.output.stats.flushes);
+	printf("text: %.1f%% of the bytes are text\n", 100.0 * text.output.stats.bytesText / text.output.stats.bytesRead);
+
+	if (!check_text(buf, len))
+	{
+		return 1;
+	}
+
+	close(fd);
+	free(buf);
+
+	return 0;
+}
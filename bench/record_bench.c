@@ -0,0 +1,374 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "escscan.h"
+#include "record.h"
+
+#define BENCH_CORPUS (64 << 20)
+#define BENCH_READ 4096
+#define BENCH_REPEAT 3
+#define BENCH_SEEKS 1000
+#define BENCH_ROWS 24
+#define BENCH_COLS 80
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void file_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	FILE* fp = context;
+
+	while (count--)
+	{
+		if (fwrite(iov->data, 1, iov->len, fp) != iov->len)
+		{
+			perror("fwrite");
+			exit(1);
+		}
+
+		iov++;
+	}
+}
+
+/* a build log, with a status screen redrawn in colour on the alternate screen now and then */
+static size_t generate(unsigned char* buf, size_t size)
+{
+	static const char* files[] = { "blocklog", "escscan", "logwriter", "output", "pump", "record", "render", "screen", "vtparse" };
+	size_t len = 0;
+
+	srand(12);
+
+	while (len + 4096 < size)
+	{
+		int r = rand() % 200;
+
+		if (r == 0)
+		{
+			int i;
+
+			len += snprintf((char*)buf + len, 256, "\033[?1049h\033[2;%dr\033[H\033[7m top - %d tasks \033[0m\033[K", BENCH_ROWS - 1, rand() % 500);
+
+			for (i = 2; i < BENCH_ROWS; i++)
+			{
+				len += snprintf((char*)buf + len, 256, "\033[%d;1H\033[3%dm%5d\033[0m %-20s \033[1m%3d%%\033[0m\033[K", i, rand() % 8, rand() % 99999, files[rand() % 9], rand() % 100);
+			}
+
+			if (rand() % 2)
+			{
+				len += snprintf((char*)buf + len, 256, "\033[r\033[?1049l");
+			}
+		}
+		else if (r < 10)
+		{
+			len += snprintf((char*)buf + len, 256, "\r\033[1;32m[%3d%%]\033[0m linking %d\033[K", rand() % 100, rand() % 1000);
+		}
+		else
+		{
+			len += snprintf((char*)buf + len, 256, "\033[44m  CC \033[0m     src/%s.c -o obj/%s.o\r\n", files[rand() % 9], files[rand() % 9]);
+		}
+	}
+
+	return len;
+}
+
+/* the chunks that would have been read from the child */
+static double capture(const char* path, const unsigned char* corpus, size_t len, int bRecord, struct conlog_record_stats* stats)
+{
+	FILE* fp = fopen(path, "wb");
+	struct conlog_record record;
+	size_t offset = 0;
+	double t;
+
+	if (!fp || (bRecord && conlog_record_start(&record, BENCH_ROWS, BENCH_COLS, file_write, fp)))
+	{
+		fprintf(stderr, "Failed to create %s\n", path);
+		exit(1);
+	}
+
+	t = now();
+
+	while (offset < len)
+	{
+		struct conlog_iovec iov;
+
+		iov.data = corpus + offset;
+		iov.len = (len - offset) < BENCH_READ ? (len - offset) : BENCH_READ;
+
+		if (bRecord)
+		{
+			conlog_record_output(&record, &iov, 1);
+
+			/* a keystroke now and then, and a resize that comes back */
+			if (!(offset % (BENCH_READ * 64)))
+			{
+				conlog_record_input(&record, "\033[A", 3);
+			}
+
+			if (offset == BENCH_READ * 1024)
+			{
+				conlog_record_resize(&record, BENCH_ROWS + 6, BENCH_COLS + 20);
+			}
+			else if (offset == BENCH_READ * 2048)
+			{
+				conlog_record_resize(&record, BENCH_ROWS, BENCH_COLS);
+			}
+		}
+		else
+		{
+			file_write(fp, &iov, 1);
+		}
+
+		offset += iov.len;
+	}
+
+	if (bRecord)
+	{
+		conlog_record_stop(&record);
+		*stats = record.stats;
+	}
+
+	fflush(fp);
+
+	t = now() - t;
+
+	fclose(fp);
+
+	return t;
+}
+
+static int same(struct conlog_screen* a, struct conlog_screen* b)
+{
+	int r;
+
+	if ((a->rows != b->rows) || (a->cols != b->cols) || (a->row != b->row) || (a->col != b->col) || (a->attr != b->attr) ||
+		(a->top != b->top) || (a->bottom != b->bottom) || (a->autowrap != b->autowrap) || (a->altActive != b->altActive) ||
+		(a->cursorVisible != b->cursorVisible) || (a->modes != b->modes))
+	{
+		return 0;
+	}
+
+	for (r = 0; r < a->rows; r++)
+	{
+		if (memcmp(conlog_screen_line(a, r), conlog_screen_line(b, r), sizeof(struct conlog_cell) * a->cols))
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* replays the whole recording, checking that each keyframe draws the screen replayed up to it */
+static int verify(const char* path, const unsigned char* corpus, size_t len, double* seekTime)
+{
+	struct conlog_replay replay;
+	struct conlog_replay_event event;
+	struct conlog_screen screen;
+	size_t offset = 0, keyframes = 0, inputs = 0, resizes = 0;
+	int i, failed = 0;
+	double t;
+
+	if (conlog_replay_open(&replay, path) || conlog_screen_init(&screen, replay.rows, replay.cols))
+	{
+		fprintf(stderr, "Failed to open %s\n", path);
+		exit(1);
+	}
+
+	while (!failed && conlog_replay_next(&replay, &event))
+	{
+		struct conlog_screen frame;
+
+		switch (event.type)
+		{
+		case CONLOG_RECORD_OUTPUT:
+			if ((offset + event.len > len) || memcmp(corpus + offset, event.data, event.len))
+			{
+				fprintf(stderr, "%s output differs at offset %lu\n", path, (unsigned long)offset);
+				failed = 1;
+			}
+
+			conlog_screen_feed(&screen, event.data, event.len);
+			offset += event.len;
+			break;
+
+		case CONLOG_RECORD_INPUT:
+			inputs++;
+			break;
+
+		case CONLOG_RECORD_RESIZE:
+			conlog_screen_resize(&screen, event.rows, event.cols);
+			resizes++;
+			break;
+
+		case CONLOG_RECORD_KEYFRAME:
+			if (conlog_screen_init(&frame, event.rows, event.cols))
+			{
+				fprintf(stderr, "Failed to set up\n");
+				exit(1);
+			}
+
+			conlog_screen_feed(&frame, event.data, event.len);
+
+			if ((keyframes != replay.count - 1) && (replay.index[keyframes].time != event.time))
+			{
+				failed = 1;
+			}
+
+			if (!same(&screen, &frame))
+			{
+				fprintf(stderr, "%s keyframe %lu does not draw the screen\n", path, (unsigned long)keyframes);
+				failed = 1;
+			}
+
+			conlog_screen_free(&frame);
+			keyframes++;
+			break;
+		}
+	}
+
+	if (!failed && ((offset != len) || (keyframes != replay.count) || !inputs || (resizes != 2)))
+	{
+		fprintf(stderr, "%s replays %lu bytes, %lu keyframes of %lu, %lu inputs, %lu resizes\n", path,
+			(unsigned long)offset, (unsigned long)keyframes, (unsigned long)replay.count, (unsigned long)inputs, (unsigned long)resizes);
+		failed = 1;
+	}
+
+	srand(1);
+
+	t = now();
+
+	for (i = 0; (i < BENCH_SEEKS) && !failed; i++)
+	{
+		unsigned long long end = replay.index[replay.count - 1].time + 1;
+		unsigned long long target = ((unsigned long long)rand() * RAND_MAX + rand()) % end;
+		unsigned long long found = conlog_replay_seek(&replay, target);
+
+		if ((found > target) || !conlog_replay_next(&replay, &event) || (event.type != CONLOG_RECORD_KEYFRAME) || (event.time != found))
+		{
+			fprintf(stderr, "%s seeks wrong to %llu\n", path, target);
+			failed = 1;
+		}
+	}
+
+	*seekTime = (now() - t) / BENCH_SEEKS;
+
+	conlog_screen_free(&screen);
+	conlog_replay_close(&replay);
+
+	return failed;
+}
+
+/* plays a recording, such as one from --record, to stdout at its own pace from a time in seconds */
+static int play(const char* path, double from)
+{
+	struct conlog_replay replay;
+	struct conlog_replay_event event;
+	unsigned long long start = (unsigned long long)(from * 1e6);
+	double t0 = now();
+
+	if (conlog_replay_open(&replay, path))
+	{
+		fprintf(stderr, "Failed to open %s\n", path);
+		return 1;
+	}
+
+	conlog_replay_seek(&replay, start);
+
+	while (conlog_replay_next(&replay, &event))
+	{
+		if ((event.type != CONLOG_RECORD_OUTPUT) && (event.type != CONLOG_RECORD_KEYFRAME))
+		{
+			continue;
+		}
+
+		if (event.time > start)
+		{
+			double wait = (event.time - start) / 1e6 - (now() - t0);
+
+			if (wait > 0)
+			{
+				struct timespec ts;
+
+				fflush(stdout);
+
+				ts.tv_sec = (time_t)wait;
+				ts.tv_nsec = (long)((wait - ts.tv_sec) * 1e9);
+				nanosleep(&ts, NULL);
+			}
+		}
+
+		fwrite(event.data, 1, event.len, stdout);
+	}
+
+	fflush(stdout);
+
+	conlog_replay_close(&replay);
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	const char* path = "record_bench.rec";
+	struct conlog_record_stats stats;
+	unsigned char* corpus;
+	double plain = 0, recorded = 0, seekTime = 0;
+	size_t len;
+	int i, failed = 0;
+
+	conlog_escscan_init();
+
+	if (argc > 1)
+	{
+		return play(argv[1], argc > 2 ? atof(argv[2]) : 0);
+	}
+
+	corpus = malloc(BENCH_CORPUS);
+
+	if (!corpus)
+	{
+		fprintf(stderr, "Failed to set up\n");
+		return 1;
+	}
+
+	len = generate(corpus, BENCH_CORPUS);
+
+	for (i = 0; i < BENCH_REPEAT; i++)
+	{
+		double t = capture(path, corpus, len, 0, &stats);
+
+		if (!i || (t < plain))
+		{
+			plain = t;
+		}
+
+		t = capture(path, corpus, len, 1, &stats);
+
+		if (!i || (t < recorded))
+		{
+			recorded = t;
+		}
+	}
+
+	failed = verify(path, corpus, len, &seekTime);
+
+	printf("%lu MB session\n", (unsigned long)(len >> 20));
+	printf("%-10s %10s %10s %10s %10s %10s %10s\n", "capture", "bytes out", "seconds", "MB/s", "keyframes", "stalls", "seek us");
+	printf("%-10s %10lu %10.3f %10.1f\n", "plain", (unsigned long)len, plain, len / plain / 1e6);
+	printf("%-10s %10llu %10.3f %10.1f %10llu %10llu %10.1f\n", "record", stats.bytesWritten, recorded, len / recorded / 1e6, stats.keyframes, stats.stalls, seekTime * 1e6);
+
+	remove(path);
+	free(corpus);
+
+	return failed;
+}
@@ -0,0 +1,271 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "escscan.h"
+#include "pump.h"
+
+#define BENCH_MB 256
+#define BENCH_FPS 30
+/* how fast the stand-in console takes bytes, in MB/s */
+#define BENCH_CONSOLE_MBS 100
+#define BENCH_CORPUS (16 << 20)
+#define BENCH_READ 4096
+#define BENCH_ROWS 24
+#define BENCH_COLS 80
+
+/* the console, a real terminal when stdout is one, otherwise a stand-in that is busy for a time for every byte */
+struct console
+{
+	int fd;
+	double rate, busy;
+	unsigned long long bytes;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void console_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	struct console* console = context;
+
+	while (count--)
+	{
+		console->bytes += iov->len;
+
+		if (console->fd < 0)
+		{
+			double t = now();
+
+			console->busy += iov->len / console->rate;
+
+			while (now() - t < iov->len / console->rate)
+			{
+			}
+		}
+		else
+		{
+			const unsigned char* p = iov->data;
+			size_t len = iov->len;
+			double t = now();
+
+			while (len)
+			{
+				ssize_t n = write(console->fd, p, len);
+
+				if (n <= 0)
+				{
+					perror("write");
+					exit(1);
+				}
+
+				p += n;
+				len -= n;
+			}
+
+			console->busy += now() - t;
+		}
+
+		iov++;
+	}
+}
+
+static void log_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	int fd = *(int*)context;
+
+	while (count--)
+	{
+		if (write(fd, iov->data, iov->len) < 0)
+		{
+			perror("write");
+			exit(1);
+		}
+
+		iov++;
+	}
+}
+
+static int bench_cursor(void* context)
+{
+	return 0;
+}
+
+static void bench_focus(void* context, int enable)
+{
+}
+
+static int bench_reply(void* context, const char* data, size_t len)
+{
+	return 1;
+}
+
+/* a build log with colour and a progress line redrawn in place */
+static size_t generate(unsigned char* buf, size_t size)
+{
+	size_t len = 0;
+
+	srand(8);
+
+	while (len + 256 < size)
+	{
+		int r = rand() % 20;
+
+		if (r == 0)
+		{
+			len += snprintf((char*)buf + len, 256, "\r\033[1;32m[%3d%%]\033[0m linking %d\033[K", rand() % 100, rand());
+		}
+		else
+		{
+			len += snprintf((char*)buf + len, 256, "  CC      src/render.c -o obj/render.o %d\r\n", rand());
+		}
+	}
+
+	return len;
+}
+
+static double run(const unsigned char* corpus, size_t len, unsigned long long total, unsigned fps, double rate, int tty, int logFd, struct console* console, struct conlog_render_stats* stats)
+{
+	static const struct conlog_backend backend = { bench_cursor, bench_focus, bench_reply };
+	struct conlog_pump pump;
+	struct conlog_screen screen;
+	struct conlog_render render;
+	unsigned long long sent = 0;
+	double t;
+
+	memset(console, 0, sizeof(*console));
+	console->fd = tty ? STDOUT_FILENO : -1;
+	console->rate = rate;
+
+	conlog_pump_init(&pump, &backend, NULL);
+	conlog_output_add(&pump.output, log_write, &logFd);
+
+	if (fps)
+	{
+		conlog_screen_init(&screen, BENCH_ROWS, BENCH_COLS);
+		conlog_render_init(&render, &screen, fps, console_write, console);
+		conlog_render_start(&render);
+
+		pump.screen = &screen;
+		pump.render = &render;
+	}
+	else
+	{
+		conlog_output_add(&pump.output, console_write, console);
+	}
+
+	t = now();
+
+	while (sent < total)
+	{
+		size_t offset = 0;
+
+		while ((offset < len) && (sent < total))
+		{
+			size_t n = (len - offset) < BENCH_READ ? (len - offset) : BENCH_READ;
+			conlog_pump_data(&pump, corpus + offset, n);
+			offset += n;
+			sent += n;
+		}
+	}
+
+	if (fps)
+	{
+		conlog_render_stop(&render);
+		*stats = render.stats;
+		conlog_screen_free(&screen);
+	}
+
+	t = now() - t;
+
+	return t;
+}
+
+/* the model alone, which the thread reading the child feeds with every byte when drawing frames */
+static double model(const unsigned char* corpus, size_t len, unsigned long long total)
+{
+	struct conlog_screen screen;
+	unsigned long long sent = 0;
+	double t;
+
+	conlog_screen_init(&screen, BENCH_ROWS, BENCH_COLS);
+
+	t = now();
+
+	while (sent < total)
+	{
+		size_t n = (total - sent) < len ? (size_t)(total - sent) : len;
+
+		conlog_screen_feed(&screen, corpus, n);
+		sent += n;
+	}
+
+	t = now() - t;
+
+	conlog_screen_free(&screen);
+
+	return t;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned long long total = (unsigned long long)(argc > 1 ? atoi(argv[1]) : BENCH_MB) << 20;
+	unsigned fps = argc > 2 ? atoi(argv[2]) : BENCH_FPS;
+	double rate = (argc > 3 ? atof(argv[3]) : BENCH_CONSOLE_MBS) * 1e6;
+	unsigned char* corpus = malloc(BENCH_CORPUS);
+	int tty = isatty(STDOUT_FILENO);
+	int logFd = open("/dev/null", O_WRONLY);
+	struct console direct, framed;
+	struct conlog_render_stats stats;
+	double directTime, framedTime, modelTime;
+	size_t len;
+
+	conlog_escscan_init();
+
+	if (!corpus || (logFd < 0) || !fps || (rate <= 0))
+	{
+		fprintf(stderr, "Failed to set up\n");
+		return 1;
+	}
+
+	len = generate(corpus, BENCH_CORPUS);
+
+	directTime = run(corpus, len, total, 0, rate, tty, logFd, &direct, &stats);
+	framedTime = run(corpus, len, total, fps, rate, tty, logFd, &framed, &stats);
+	modelTime = model(corpus, len, total);
+
+	if (tty)
+	{
+		printf("\033[H\033[2J");
+	}
+
+	if (tty)
+	{
+		printf("%llu MB to this terminal, log to /dev/null\n", total >> 20);
+	}
+	else
+	{
+		printf("%llu MB to a console taking %.0f MB/s, log to /dev/null\n", total >> 20, rate / 1e6);
+	}
+
+	printf("%-12s %10s %10s %16s %14s %8s\n", "console", "seconds", "MB/s", "console bytes", "console busy", "frames");
+	printf("%-12s %10.2f %10.1f %16llu %14.2f %8s\n", "every byte", directTime, total / directTime / 1e6, direct.bytes, direct.busy, "-");
+	printf("%-12s %10.2f %10.1f %16llu %14.2f %8llu\n", "frames", framedTime, total / framedTime / 1e6, framed.bytes, framed.busy, stats.frames);
+	printf("%-12s %10.2f %10.1f, the most frames can reach as the model is fed on the thread reading the child\n", "model alone", modelTime, total / modelTime / 1e6);
+
+	close(logFd);
+	free(corpus);
+
+	return 0;
+}
@@ -0,0 +1,397 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "escscan.h"
+#include "screen.h"
+
+#define BENCH_SIZE (32 << 20)
+#define BENCH_READ 4096
+#define BENCH_REPEAT 5
+#define BENCH_ROWS 24
+#define BENCH_COLS 80
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* cursor position reports an xterm gives after each stream on a 24x80 screen */
+static const struct
+{
+	const char* stream;
+	const char* report;
+} known[] = {
+	{ "abc", "\033[1;4R" },
+	{ "\033[5;10H", "\033[5;10R" },
+	{ "\033[5;10Hx\033[2A", "\033[3;11R" },
+	{ "\033[999;999H", "\033[24;80R" },
+	{ "\033[999C", "\033[1;80R" },
+	{ "\033[10;5H\033[3D", "\033[10;2R" },
+	{ "\033[10;5H\033[2E", "\033[12;1R" },
+	{ "\033[10;5H\033[2F", "\033[8;1R" },
+	{ "\033[10;5H\033[20G", "\033[10;20R" },
+	{ "\033[10;5H\033[3d", "\033[3;5R" },
+	{ "\t", "\033[1;9R" },
+	{ "ab\tc\t", "\033[1;17R" },
+	{ "abc\b\b", "\033[1;2R" },
+	{ "abc\r", "\033[1;1R" },
+	{ "abc\n", "\033[2;4R" },
+	{ "abc\r\n", "\033[2;1R" },
+	{ "\033[24;1H\n\n", "\033[24;1R" },
+	{ "\033[1;1H\033M", "\033[1;1R" },
+	{ "\033[5;1H\033M", "\033[4;1R" },
+	{ "\033[5;1H\033D", "\033[6;1R" },
+	{ "\033[5;1Hab\033E", "\033[6;1R" },
+	{ "\033[10;20r", "\033[1;1R" },
+	{ "\033[10;20r\033[20;1H\n", "\033[20;1R" },
+	{ "\033[10;20r\033[?6h\033[2;3H", "\033[2;3R" },
+	{ "\033[10;20r\033[?6h\033[99;1H", "\033[11;1R" },
+	{ "\033[10;20r\033[15;1H\033[99A", "\033[10;1R" },
+	{ "\033[5;5H\0337\033[H\0338", "\033[5;5R" },
+	{ "\033[5;5H\033[s\033[H\033[u", "\033[5;5R" },
+	{ "\033[5;5H\033[?1049h\033[H\033[?1049l", "\033[5;5R" },
+	{ "\033[5;5H\033c", "\033[1;1R" },
+	{ "\xe4\xb8\xad\xe6\x96\x87", "\033[1;5R" },
+	{ "e\xcc\x81", "\033[1;2R" },
+	{ "\033]0;title\007ab", "\033[1;3R" },
+	{ "\033]8;;http://x\033\\ab", "\033[1;3R" },
+	{ "\033P1$r\033\\ab", "\033[1;3R" },
+	{ "\033[1;31mab\033[0m", "\033[1;3R" },
+	{ "\033[?7l\033[1;78Habcdef", "\033[1;80R" },
+	{ "\033[1;79H\xe4\xb8\xad", "\033[1;80R" },
+	{ "\033[1;80H\xe4\xb8\xad", "\033[2;3R" },
+	{ "\033[5;5H\033[2L", "\033[5;1R" },
+	{ "\033[5;5H\033[2M", "\033[5;1R" },
+	{ "\033[5;5H\033[3@\033[2P\033[4X", "\033[5;5R" },
+	{ "\033[5;5H\033[2J\033[K", "\033[5;5R" }
+};
+
+static size_t wrap_stream(char* buf, int count)
+{
+	size_t len = 0;
+
+	while (count--)
+	{
+		buf[len++] = 'a';
+	}
+
+	buf[len] = 0;
+
+	return len;
+}
+
+static int check_report(const char* stream, size_t len, const char* expect)
+{
+	struct conlog_screen screen;
+	char report[32];
+
+	conlog_screen_init(&screen, BENCH_ROWS, BENCH_COLS);
+	conlog_screen_feed(&screen, (const unsigned char*)stream, len);
+	conlog_screen_report(&screen, report, sizeof(report));
+	conlog_screen_free(&screen);
+
+	if (strcmp(report, expect))
+	{
+		fprintf(stderr, "stream \"%s\" reported ESC%s, expected ESC%s\n", stream, report + 1, expect + 1);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int check_known(void)
+{
+	char buf[BENCH_ROWS * BENCH_COLS + 16];
+	size_t i;
+	int failed = 0;
+
+	for (i = 0; i < sizeof(known) / sizeof(known[0]); i++)
+	{
+		failed |= check_report(known[i].stream, strlen(known[i].stream), known[i].report);
+	}
+
+	/* the last column holds the cursor until the next character wraps */
+	failed |= check_report(buf, wrap_stream(buf, 80), "\033[1;80R");
+	failed |= check_report(buf, wrap_stream(buf, 81), "\033[2;2R");
+	failed |= check_report(buf, wrap_stream(buf, 24 * 80 + 5), "\033[24;6R");
+
+	strcpy(buf + wrap_stream(buf, 80), "\b");
+	failed |= check_report(buf, 81, "\033[1;79R");
+
+	return failed;
+}
+
+static size_t append(unsigned char* buf, size_t len, const char* s)
+{
+	size_t n = strlen(s);
+	memcpy(buf + len, s, n);
+	return len + n;
+}
+
+/* build output with colour, a progress line redrawn in place and a full screen editor */
+static size_t generate(unsigned char* buf, size_t size)
+{
+	static const char* seq[] = { "\033[0m", "\033[1;32m", "\033[38;5;208m", "\033[K", "\033[2K\r", "\033[A", "\033[?25l", "\033[?25h" };
+	size_t len = 0;
+	char line[256];
+
+	srand(4);
+
+	while (len + sizeof(line) * 4 < size)
+	{
+		int r = rand() % 100;
+
+		if (r < 40)
+		{
+			len = append(buf, len, seq[rand() % (sizeof(seq) / sizeof(seq[0]))]);
+		}
+
+		if (r == 0)
+		{
+			int i;
+
+			len = append(buf, len, "\033[?1049h\033[H\033[2J\033[1;23r");
+
+			for (i = 0; i < 23; i++)
+			{
+				snprintf(line, sizeof(line), "\033[%d;1H~\033[K", i + 1);
+				len = append(buf, len, line);
+			}
+
+			len = append(buf, len, "\033[r\033[?1049l");
+		}
+		else if (r < 10)
+		{
+			snprintf(line, sizeof(line), "\r[%3d%%] \xe2\x96\x88\xe2\x96\x88\xe2\x96\x91\xe2\x96\x91 %d", r, rand());
+			len = append(buf, len, line);
+		}
+		else
+		{
+			snprintf(line, sizeof(line), "  CC      src/screen.c -o obj/screen.o %d\r\n", rand());
+			len = append(buf, len, line);
+		}
+	}
+
+	return len;
+}
+
+static int compare(struct conlog_screen* a, struct conlog_screen* b)
+{
+	int r;
+
+	if ((a->row != b->row) || (a->col != b->col) || (a->attr != b->attr) || (a->altActive != b->altActive))
+	{
+		return 1;
+	}
+
+	for (r = 0; r < a->rows; r++)
+	{
+		if (memcmp(conlog_screen_line(a, r), conlog_screen_line(b, r), sizeof(struct conlog_cell) * a->cols))
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* feeding the same stream whole and in random slices must agree */
+static int check_sliced(const unsigned char* buf, size_t len)
+{
+	struct conlog_screen a, b;
+	size_t offset = 0;
+	int result;
+
+	conlog_screen_init(&a, BENCH_ROWS, BENCH_COLS);
+	conlog_screen_init(&b, BENCH_ROWS, BENCH_COLS);
+
+	conlog_screen_feed(&a, buf, len);
+
+	while (offset < len)
+	{
+		size_t n = 1 + rand() % 64;
+
+		if (n > len - offset)
+		{
+			n = len - offset;
+		}
+
+		conlog_screen_feed(&b, buf + offset, n);
+		offset += n;
+	}
+
+	result = compare(&a, &b);
+
+	if (result)
+	{
+		fprintf(stderr, "sliced feed differs from whole feed\n");
+	}
+
+	conlog_screen_free(&a);
+	conlog_screen_free(&b);
+
+	return result;
+}
+
+static size_t utf8(unsigned c, char* out)
+{
+	if (c < 0x80)
+	{
+		out[0] = (char)c;
+		return 1;
+	}
+
+	if (c < 0x800)
+	{
+		out[0] = (char)(0xC0 | (c >> 6));
+		out[1] = (char)(0x80 | (c & 0x3F));
+		return 2;
+	}
+
+	if (c < 0x10000)
+	{
+		out[0] = (char)(0xE0 | (c >> 12));
+		out[1] = (char)(0x80 | ((c >> 6) & 0x3F));
+		out[2] = (char)(0x80 | (c & 0x3F));
+		return 3;
+	}
+
+	out[0] = (char)(0xF0 | (c >> 18));
+	out[1] = (char)(0x80 | ((c >> 12) & 0x3F));
+	out[2] = (char)(0x80 | ((c >> 6) & 0x3F));
+	out[3] = (char)(0x80 | (c & 0x3F));
+	return 4;
+}
+
+/* replays a recorded stream, such as a conlog log file, and prints the final screen */
+static int replay(const char* path, int rows, int cols)
+{
+	FILE* fp = fopen(path, "rb");
+	struct conlog_screen screen;
+	unsigned char buf[BENCH_READ];
+	char report[32];
+	size_t n;
+	int r, c;
+
+	if (!fp)
+	{
+		perror(path);
+		return 1;
+	}
+
+	conlog_screen_init(&screen, rows, cols);
+
+	while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+	{
+		conlog_screen_feed(&screen, buf, n);
+	}
+
+	fclose(fp);
+
+	for (r = 0; r < screen.rows; r++)
+	{
+		const struct conlog_cell* cell = conlog_screen_line(&screen, r);
+		char line[4096];
+		size_t len = 0, end = 0;
+
+		for (c = 0; c < screen.cols && len + 4 < sizeof(line); c++)
+		{
+			if (cell[c].ch != CONLOG_CELL_CONTINUE)
+			{
+				len += utf8(cell[c].ch, line + len);
+
+				if (cell[c].ch != ' ')
+				{
+					end = len;
+				}
+			}
+		}
+
+		printf("%.*s\n", (int)end, line);
+	}
+
+	conlog_screen_report(&screen, report, sizeof(report));
+	printf("cursor ESC%s\n", report + 1);
+
+	conlog_screen_free(&screen);
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned char* buf;
+	double best = 0;
+	size_t len;
+	int repeat;
+
+	conlog_escscan_init();
+
+	if (argc > 1)
+	{
+		return replay(argv[1], argc > 3 ? atoi(argv[2]) : BENCH_ROWS, argc > 3 ? atoi(argv[3]) : BENCH_COLS);
+	}
+
+	if (check_known())
+	{
+		return 1;
+	}
+
+	buf = malloc(BENCH_SIZE);
+
+	if (!buf)
+	{
+		fprintf(stderr, "Failed to allocate buffer\n");
+		return 1;
+	}
+
+	len = generate(buf, BENCH_SIZE);
+
+	if (check_sliced(buf, len < (1 << 20) ? len : (1 << 20)))
+	{
+		return 1;
+	}
+
+	for (repeat = 0; repeat < BENCH_REPEAT; repeat++)
+	{
+		struct conlog_screen screen;
+		size_t offset = 0;
+		double t;
+
+		conlog_screen_init(&screen, BENCH_ROWS, BENCH_COLS);
+
+		t = now();
+
+		while (offset < len)
+		{
+			size_t n = (len - offset) < BENCH_READ ? (len - offset) : BENCH_READ;
+			conlog_screen_feed(&screen, buf + offset, n);
+			offset += n;
+		}
+
+		t = now() - t;
+
+		conlog_screen_free(&screen);
+
+		if (!best || t < best)
+		{
+			best = t;
+		}
+	}
+
+	printf("%zu known reports match, sliced feed matches\n", sizeof(known) / sizeof(known[0]) + 4);
+	printf("%-12s %12s\n", "corpus", "screen MB/s");
+	printf("%-12s %12.1f\n", "build", len / best / 1e6);
+
+	free(buf);
+
+	return 0;
+}
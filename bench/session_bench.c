@@ -0,0 +1,413 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define BENCH_CHUNK 4096
+#define BENCH_DSR_TEXT 4096
+
+struct workload
+{
+	const char* name;
+	/* bytes the child writes */
+	unsigned long long size;
+	size_t (*fill)(char* buf, unsigned long long n);
+};
+
+struct sink
+{
+	const char* name;
+	/* added to the conlog command line, up to two */
+	const char* args[2];
+};
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* the number after name in the statistics */
+static unsigned long long stats_value(const char* text, const char* name)
+{
+	const char* p = strstr(text, name);
+
+	return p ? strtoull(p + strlen(name) + 1, NULL, 10) : 0;
+}
+
+/* a build log */
+static size_t fill_text(char* buf, unsigned long long n)
+{
+	return sprintf(buf, "cc -O2 -Wall -c src/module%04llu.c -o obj/module%04llu.o\n", n % 10000, n % 10000);
+}
+
+/* a test runner that colours every field */
+static size_t fill_colour(char* buf, unsigned long long n)
+{
+	return sprintf(buf, "\033[1;32m  PASS \033[0m \033[38;5;%llum%s\033[0m.\033[38;2;%llu;%llu;200mtest_%05llu\033[0m \033[2m(%llu ms)\033[0m\r\n",
+		16 + n % 216, (n & 1) ? "parser" : "render", n % 256, (n * 7) % 256, n % 100000, n % 997);
+}
+
+/* a progress bar redrawn in place, with a line for each file */
+static size_t fill_progress(char* buf, unsigned long long n)
+{
+	static const char bar[] = "########################################";
+	int percent = (int)(n % 101), width = percent * 40 / 100;
+	size_t len = sprintf(buf, "\r\033[K%3d%% [\033[32m%.*s\033[0m%*s] %llu/%llu", percent, width, bar, 40 - width, "", n, n + 1000);
+
+	if (percent == 100)
+	{
+		len += sprintf(buf + len, "\r\ndownloaded package%llu.tar.gz\r\n", n / 101);
+	}
+
+	return len;
+}
+
+/* one row of a full screen application that redraws every row, clearing the screen now and then */
+static size_t fill_tui(char* buf, unsigned long long n)
+{
+	int row = (int)(n % 24) + 1;
+	size_t len = 0;
+
+	if (row == 1)
+	{
+		len += sprintf(buf, ((n / 24) % 50) ? "\033[H" : "\033[H\033[2J");
+	}
+
+	len += sprintf(buf + len, "\033[%d;1H\033[48;5;%dm\033[38;5;%dm %5llu \033[0m\033[K %-64.64s\033[0m",
+		row, (int)(n % 8) + 232, (int)(n % 16), n, "process  1.2%  0.3%  S  00:00:12 /usr/lib/systemd/systemd --user");
+
+	return len;
+}
+
+static const struct workload workloads[] =
+{
+	{ "text", 64 << 20, fill_text },
+	{ "colour", 64 << 20, fill_colour },
+	{ "progress", 16 << 20, fill_progress },
+	{ "tui", 32 << 20, fill_tui },
+	/* text between cursor position requests, each waited for as a shell prompt would */
+	{ "dsr", 8 << 20, fill_text }
+};
+
+static const struct sink sinks[] =
+{
+	{ "stdout", { NULL, NULL } },
+	{ "no log writer", { "--log-buffer=0", NULL } },
+	{ "events", { "--io=events", NULL } },
+	{ "text", { "--log-format=text", NULL } },
+	{ "compress", { "--log-compress=on", NULL } },
+	{ "uring", { "--log-io=uring", NULL } }
+};
+
+static int write_all(const char* p, size_t len)
+{
+	while (len)
+	{
+		ssize_t n = write(1, p, len);
+
+		if (n < 0)
+		{
+			if (errno == EINTR) continue;
+			return -1;
+		}
+
+		p += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/* reads the terminal's reply to a cursor position request, up to its R */
+static int read_reply(void)
+{
+	char c;
+
+	while (read(0, &c, 1) == 1)
+	{
+		if (c == 'R')
+		{
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+/* the synthetic child, writes the workload at rate megabytes a second or as fast as it can */
+static int child(const struct workload* workload, double rate)
+{
+	char buf[BENCH_CHUNK + 512];
+	unsigned long long written = 0, n = 0, nextDsr = BENCH_DSR_TEXT;
+	int bDsr = !strcmp(workload->name, "dsr");
+	double start = now();
+
+	if (bDsr)
+	{
+		struct termios raw;
+
+		if (!tcgetattr(0, &raw))
+		{
+			cfmakeraw(&raw);
+			tcsetattr(0, TCSANOW, &raw);
+		}
+	}
+
+	while (written < workload->size)
+	{
+		size_t len = 0;
+
+		while (len < BENCH_CHUNK)
+		{
+			len += workload->fill(buf + len, n++);
+		}
+
+		if (write_all(buf, len))
+		{
+			return 1;
+		}
+
+		written += len;
+
+		if (bDsr && (written >= nextDsr))
+		{
+			if (write_all("\033[6n", 4) || read_reply())
+			{
+				return 1;
+			}
+
+			nextDsr = written + BENCH_DSR_TEXT;
+		}
+
+		if (rate > 0)
+		{
+			double due = start + written / (rate * 1e6), t = now();
+
+			if (due > t)
+			{
+				struct timespec ts;
+
+				ts.tv_sec = (time_t)(due - t);
+				ts.tv_nsec = (long)((due - t - ts.tv_sec) * 1e9);
+				nanosleep(&ts, NULL);
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* one session headless, the log to a file, what conlog itself used comes from its --stats */
+static int run(FILE* json, const char* conlog, const char* self, const struct workload* workload, const struct sink* sink, double rate, int first)
+{
+	char logPath[64], statsPath[64], statsArg[80], childArg[64], rateArg[64], text[65536];
+	const char* argv[12];
+	unsigned long long bytes, cpu, peak;
+	double t;
+	struct stat st;
+	size_t len = 0;
+	int argc = 0, status, i;
+	FILE* fp;
+	pid_t pid;
+
+	snprintf(logPath, sizeof(logPath), "/tmp/session_bench.%d.log", (int)getpid());
+	snprintf(statsPath, sizeof(statsPath), "/tmp/session_bench.%d.json", (int)getpid());
+	snprintf(statsArg, sizeof(statsArg), "--stats=%s", statsPath);
+	snprintf(childArg, sizeof(childArg), "--child=%s", workload->name);
+	snprintf(rateArg, sizeof(rateArg), "--rate=%g", rate);
+
+	argv[argc++] = conlog;
+	argv[argc++] = "--headless=80x24";
+	argv[argc++] = statsArg;
+
+	for (i = 0; (i < 2) && sink->args[i]; i++)
+	{
+		argv[argc++] = sink->args[i];
+	}
+
+	argv[argc++] = "--";
+	argv[argc++] = self;
+	argv[argc++] = childArg;
+	argv[argc++] = rateArg;
+	argv[argc] = NULL;
+
+	unlink(statsPath);
+
+	t = now();
+	pid = fork();
+
+	if (pid < 0)
+	{
+		perror("fork");
+		return 1;
+	}
+
+	if (!pid)
+	{
+		int fd = open(logPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		int null = open("/dev/null", O_RDWR);
+
+		dup2(null, 0);
+		dup2(fd, 1);
+		dup2(null, 2);
+		execv(conlog, (char**)argv);
+		_exit(127);
+	}
+
+	if (waitpid(pid, &status, 0) != pid)
+	{
+		perror("waitpid");
+		return 1;
+	}
+
+	t = now() - t;
+
+	fp = fopen(statsPath, "r");
+
+	if (fp)
+	{
+		len = fread(text, 1, sizeof(text) - 1, fp);
+		fclose(fp);
+	}
+
+	text[len] = 0;
+	bytes = stats_value(text, "\"bytesRead\"");
+	cpu = stats_value(text, "\"cpuNanoseconds\"");
+	peak = stats_value(text, "\"peakBytes\"");
+
+	unlink(statsPath);
+
+	if (stat(logPath, &st))
+	{
+		st.st_size = 0;
+	}
+
+	unlink(logPath);
+
+	if (!WIFEXITED(status) || WEXITSTATUS(status) || (bytes < workload->size) || !st.st_size)
+	{
+		fprintf(stderr, "%s through %s failed, exit %d, %llu bytes read, %lld logged\n", workload->name, sink->name,
+			WIFEXITED(status) ? WEXITSTATUS(status) : -1, bytes, (long long)st.st_size);
+		return 1;
+	}
+
+	printf("%-10s %-14s %10.1f %10.2f %10llu\n", workload->name, sink->name, bytes / t / 1e6, cpu / 1e6 / (bytes / 1e6), peak >> 10);
+
+	fprintf(json, "%s\t\t{ \"workload\": \"%s\", \"sink\": \"%s\", \"bytes\": %llu, \"seconds\": %.3f, \"megabytesPerSecond\": %.1f, \"cpuMillisecondsPerMegabyte\": %.2f, \"peakKilobytes\": %llu }",
+		first ? "" : ",\n", workload->name, sink->name, bytes, t, bytes / t / 1e6, cpu / 1e6 / (bytes / 1e6), peak >> 10);
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	const char* conlog = "../linux/bin/conlog";
+	const char* path = "bin/session_bench.json";
+	double rate = 0;
+	const struct workload* workload = NULL;
+	int failed = 0, first = 1, i, j;
+	FILE* json;
+
+	for (i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+
+		if (!strncmp(arg, "--child=", 8))
+		{
+			for (j = 0; j < (int)(sizeof(workloads) / sizeof(workloads[0])); j++)
+			{
+				if (!strcmp(arg + 8, workloads[j].name))
+				{
+					workload = workloads + j;
+				}
+			}
+		}
+		else if (!strncmp(arg, "--rate=", 7))
+		{
+			rate = atof(arg + 7);
+		}
+		else if (!strncmp(arg, "--conlog=", 9))
+		{
+			conlog = arg + 9;
+		}
+		else if (!strncmp(arg, "--json=", 7))
+		{
+			path = arg + 7;
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--conlog=PATH] [--json=FILE] [--rate=MB/s]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (workload)
+	{
+		return child(workload, rate);
+	}
+
+	if (access(conlog, X_OK))
+	{
+		fprintf(stderr, "%s not built\n", conlog);
+		return 1;
+	}
+
+	json = fopen(path, "w");
+
+	if (!json)
+	{
+		perror(path);
+		return 1;
+	}
+
+	if (rate > 0)
+	{
+		printf("each child paced to %g MB/s\n", rate);
+	}
+
+	printf("%-10s %-14s %10s %10s %10s\n", "workload", "sink", "MB/s", "cpu ms/MB", "peak KB");
+
+	fprintf(json, "{\n\t\"conlog\": \"%s\",\n\t\"rate\": %g,\n\t\"runs\": [\n", conlog, rate);
+
+	for (i = 0; i < (int)(sizeof(workloads) / sizeof(workloads[0])); i++)
+	{
+		for (j = 0; j < (int)(sizeof(sinks) / sizeof(sinks[0])); j++)
+		{
+			if (run(json, conlog, argv[0], workloads + i, sinks + j, rate, first))
+			{
+				failed = 1;
+			}
+			else
+			{
+				first = 0;
+			}
+
+			fflush(stdout);
+		}
+	}
+
+	fprintf(json, "\n\t]\n}\n");
+
+	if (fclose(json))
+	{
+		perror(path);
+		failed = 1;
+	}
+
+	printf("written to %s\n", path);
+
+	return failed;
+}
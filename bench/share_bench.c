@@ -0,0 +1,471 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "escscan.h"
+#include "share.h"
+
+#define BENCH_CHECK (8 << 20)
+#define BENCH_CORPUS (64 << 20)
+#define BENCH_READ 4096
+#define BENCH_ROWS 24
+#define BENCH_COLS 80
+#define BENCH_TIMEOUT 5.0
+
+/* a viewer on the other end of the socket, keeping what it is sent */
+struct client
+{
+	struct conlog_thread thread;
+	int fd;
+	unsigned char* data;
+	size_t len, size;
+	int bKeep;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void pause_ms(long ms)
+{
+	struct timespec ts;
+
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (ms % 1000) * 1000000L;
+	nanosleep(&ts, NULL);
+}
+
+/* a build log, with a status screen drawn in colour in a scrolling region now and then */
+static size_t generate(unsigned char* buf, size_t size)
+{
+	static const char* files[] = { "blocklog", "escscan", "logwriter", "output", "pump", "record", "render", "screen", "share" };
+	size_t len = 0;
+
+	srand(25);
+
+	while (len + 4096 < size)
+	{
+		int r = rand() % 200;
+
+		if (r == 0)
+		{
+			int i;
+
+			len += snprintf((char*)buf + len, 256, "\033[2;%dr\033[H\033[7m top - %d tasks \033[0m\033[K", BENCH_ROWS - 1, rand() % 500);
+
+			for (i = 2; i < BENCH_ROWS; i++)
+			{
+				len += snprintf((char*)buf + len, 256, "\033[%d;1H\033[3%dm%5d\033[0m %-20s \033[1m%3d%%\033[0m\033[K", i, rand() % 8, rand() % 99999, files[rand() % 9], rand() % 100);
+			}
+
+			if (rand() % 2)
+			{
+				len += snprintf((char*)buf + len, 256, "\033[r\033[%dH", BENCH_ROWS);
+			}
+		}
+		else if (r < 10)
+		{
+			len += snprintf((char*)buf + len, 256, "\r\033[1;32m[%3d%%]\033[0m linking %d\033[K", rand() % 100, rand() % 1000);
+		}
+		else
+		{
+			len += snprintf((char*)buf + len, 256, "\033[44m  CC \033[0m     src/%s.c -o obj/%s.o\r\n", files[rand() % 9], files[rand() % 9]);
+		}
+	}
+
+	return len;
+}
+
+static int same(struct conlog_screen* a, struct conlog_screen* b)
+{
+	int r;
+
+	if ((a->rows != b->rows) || (a->cols != b->cols) || (a->row != b->row) || (a->col != b->col) || (a->attr != b->attr) ||
+		(a->top != b->top) || (a->bottom != b->bottom) || (a->autowrap != b->autowrap) || (a->altActive != b->altActive) ||
+		(a->cursorVisible != b->cursorVisible) || (a->modes != b->modes))
+	{
+		return 0;
+	}
+
+	for (r = 0; r < a->rows; r++)
+	{
+		if (memcmp(conlog_screen_line(a, r), conlog_screen_line(b, r), sizeof(struct conlog_cell) * a->cols))
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static void client_main(void* arg)
+{
+	struct client* client = arg;
+	unsigned char buf[65536];
+
+	for (;;)
+	{
+		ssize_t n = recv(client->fd, buf, sizeof(buf), 0);
+
+		if (n < 0)
+		{
+			if (errno == EINTR) continue;
+			break;
+		}
+
+		if (!n)
+		{
+			break;
+		}
+
+		if (!client->bKeep)
+		{
+			continue;
+		}
+
+		if (client->len + n > client->size)
+		{
+			client->size = client->size ? client->size * 2 : (1 << 20);
+			client->data = realloc(client->data, client->size);
+
+			if (!client->data)
+			{
+				perror("realloc");
+				exit(1);
+			}
+		}
+
+		memcpy(client->data + client->len, buf, n);
+		client->len += n;
+	}
+}
+
+static void client_connect(struct client* client, const char* path, int bKeep)
+{
+	struct sockaddr_un addr;
+
+	memset(client, 0, sizeof(*client));
+	memset(&addr, 0, sizeof(addr));
+
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+	client->bKeep = bKeep;
+	client->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if ((client->fd < 0) || connect(client->fd, (struct sockaddr*)&addr, sizeof(addr)))
+	{
+		perror(path);
+		exit(1);
+	}
+}
+
+/* what the share has counted, taken under its lock */
+static struct conlog_share_stats share_stats(struct conlog_share* share)
+{
+	struct conlog_share_stats stats;
+
+	conlog_mutex_lock(&share->mutex);
+	stats = share->stats;
+	conlog_mutex_unlock(&share->mutex);
+
+	return stats;
+}
+
+/* how far the share thread, and the viewer followed if there is one, are behind the output */
+static unsigned long long share_pending(struct conlog_share* share, struct conlog_share_viewer* follow)
+{
+	unsigned long long len;
+
+	conlog_mutex_lock(&share->mutex);
+
+	len = share->head - share->modelAt;
+
+	if (follow && !follow->bResync && (share->head - follow->cursor > len))
+	{
+		len = share->head - follow->cursor;
+	}
+
+	conlog_mutex_unlock(&share->mutex);
+
+	return len;
+}
+
+/* the viewer that connected last */
+static struct conlog_share_viewer* share_newest(struct conlog_share* share)
+{
+	struct conlog_share_viewer* viewer;
+
+	conlog_mutex_lock(&share->mutex);
+	viewer = share->viewers;
+	conlog_mutex_unlock(&share->mutex);
+
+	return viewer;
+}
+
+static int wait_viewers(struct conlog_share* share, unsigned long long viewers)
+{
+	double deadline = now() + BENCH_TIMEOUT;
+
+	while (share_stats(share).viewers < viewers)
+	{
+		if (now() > deadline)
+		{
+			fprintf(stderr, "viewer %llu was not taken\n", viewers);
+			return -1;
+		}
+
+		pause_ms(1);
+	}
+
+	return 0;
+}
+
+/* the chunks that would have been read from the child, no faster than the share thread and the viewer followed take them so neither loses any */
+static double produce(struct conlog_share* share, struct conlog_share_viewer* follow, const unsigned char* corpus, size_t len, double* slowest)
+{
+	size_t offset = 0;
+	double t = now();
+
+	while (offset < len)
+	{
+		struct conlog_iovec iov;
+		double call;
+
+		iov.data = corpus + offset;
+		iov.len = (len - offset) < BENCH_READ ? (len - offset) : BENCH_READ;
+
+		while (share_pending(share, follow) > share->ringSize / 2)
+		{
+			pause_ms(1);
+		}
+
+		call = now();
+		conlog_share_output(share, &iov, 1);
+		call = now() - call;
+
+		if (slowest && (call > *slowest))
+		{
+			*slowest = call;
+		}
+
+		offset += iov.len;
+	}
+
+	return now() - t;
+}
+
+/* a viewer from the start, one that joins half way and one that does not read until the end all finish with the screen,
+	and the one from the start is sent every byte however far the one not reading falls behind */
+static int check(const char* path, const unsigned char* corpus, size_t len)
+{
+	struct conlog_share share;
+	struct conlog_share_stats stats;
+	struct conlog_share_viewer* first;
+	struct conlog_screen reference;
+	struct client clients[3];
+	static const char* names[] = { "from the start", "joined half way", "fell behind" };
+	double deadline;
+	int failed = 0, bWhole, i;
+
+	if (conlog_share_start(&share, path, BENCH_ROWS, BENCH_COLS, CONLOG_SHARE_BUFFER_DEFAULT))
+	{
+		perror(path);
+		return 1;
+	}
+
+	client_connect(clients, path, 1);
+	conlog_thread_start(&clients[0].thread, client_main, clients);
+
+	if (wait_viewers(&share, 1))
+	{
+		return 1;
+	}
+
+	first = share_newest(&share);
+
+	client_connect(clients + 2, path, 1);
+
+	if (wait_viewers(&share, 2))
+	{
+		return 1;
+	}
+
+	produce(&share, first, corpus, len / 2, NULL);
+
+	client_connect(clients + 1, path, 1);
+	conlog_thread_start(&clients[1].thread, client_main, clients + 1);
+
+	if (wait_viewers(&share, 3))
+	{
+		return 1;
+	}
+
+	produce(&share, first, corpus + len / 2, len - len / 2, NULL);
+
+	/* the viewer that fell behind reads again, and is sent the screen once it has taken what it had */
+	conlog_thread_start(&clients[2].thread, client_main, clients + 2);
+
+	deadline = now() + BENCH_TIMEOUT;
+	stats = share_stats(&share);
+
+	while (stats.snapshots < stats.viewers + stats.drops)
+	{
+		if (now() > deadline)
+		{
+			fprintf(stderr, "%llu screens sent to %llu viewers after %llu drops\n", stats.snapshots, stats.viewers, stats.drops);
+			failed = 1;
+			break;
+		}
+
+		pause_ms(1);
+		stats = share_stats(&share);
+	}
+
+	conlog_share_stop(&share);
+
+	conlog_screen_init(&reference, BENCH_ROWS, BENCH_COLS);
+	conlog_screen_feed(&reference, corpus, len);
+
+	for (i = 0; i < 3; i++)
+	{
+		struct conlog_screen screen;
+		int bSame;
+
+		conlog_thread_join(&clients[i].thread);
+		close(clients[i].fd);
+
+		conlog_screen_init(&screen, BENCH_ROWS, BENCH_COLS);
+		conlog_screen_feed(&screen, clients[i].data, clients[i].len);
+
+		bSame = same(&screen, &reference);
+		failed |= !bSame;
+
+		printf("viewer %-16s %10.1f MB %s\n", names[i], clients[i].len / 1e6, bSame ? "ends on the screen" : "ends on another screen");
+
+		conlog_screen_free(&screen);
+	}
+
+	conlog_screen_free(&reference);
+
+	/* after the empty screen it joined on, the viewer from the start has the output exactly */
+	bWhole = (clients[0].len >= len) && !memcmp(clients[0].data + clients[0].len - len, corpus, len);
+	failed |= !bWhole;
+
+	printf("viewer %-16s %s\n", names[0], bWhole ? "was sent all the output" : "was not sent all the output");
+
+	for (i = 0; i < 3; i++)
+	{
+		free(clients[i].data);
+	}
+
+	/* the viewer that did not read must have fallen behind */
+	if (!share.stats.drops || share.stats.bytesLost || (share.stats.viewers != 3))
+	{
+		failed = 1;
+	}
+
+	printf("%llu viewers, %llu screens sent, %llu drops, %llu bytes lost, %s\n", share.stats.viewers, share.stats.snapshots, share.stats.drops, share.stats.bytesLost, failed ? "not as expected" : "as expected");
+
+	return failed;
+}
+
+/* the producer as fast as the share thread takes it, with no viewer, a viewer that keeps up and one that never reads too */
+static void timing(const char* path, const unsigned char* corpus, size_t len, int viewers)
+{
+	static const char* names[] = { "no viewers", "one viewer", "and one stuck" };
+	struct conlog_share share;
+	struct client clients[2];
+	double t, slowest = 0;
+	int i;
+
+	if (conlog_share_start(&share, path, BENCH_ROWS, BENCH_COLS, CONLOG_SHARE_BUFFER_DEFAULT))
+	{
+		perror(path);
+		exit(1);
+	}
+
+	for (i = 0; i < viewers; i++)
+	{
+		client_connect(clients + i, path, 0);
+
+		if (!i)
+		{
+			conlog_thread_start(&clients[i].thread, client_main, clients + i);
+		}
+	}
+
+	if (wait_viewers(&share, viewers))
+	{
+		exit(1);
+	}
+
+	t = produce(&share, NULL, corpus, len, &slowest);
+
+	/* the stuck viewer is let go so the share can end */
+	if (viewers > 1)
+	{
+		shutdown(clients[1].fd, SHUT_RDWR);
+	}
+
+	conlog_share_stop(&share);
+
+	for (i = 0; i < viewers; i++)
+	{
+		if (!i)
+		{
+			conlog_thread_join(&clients[i].thread);
+		}
+
+		close(clients[i].fd);
+	}
+
+	printf("%-24s %10.1f %10.1f %10.1f %10llu %10llu\n", names[viewers], len / t / 1e6, slowest * 1e6, share.stats.bytesLost / 1e6, share.stats.drops, share.stats.snapshots);
+}
+
+int main(int argc, char** argv)
+{
+	unsigned char* corpus = malloc(BENCH_CORPUS);
+	char path[64];
+	size_t len;
+	int failed, i;
+
+	conlog_escscan_init();
+
+	if (!corpus)
+	{
+		perror("malloc");
+		return 1;
+	}
+
+	snprintf(path, sizeof(path), "/tmp/share_bench.%d.sock", (int)getpid());
+
+	len = generate(corpus, BENCH_CHECK);
+	failed = check(path, corpus, len);
+
+	len = generate(corpus, BENCH_CORPUS);
+
+	printf("%.0f MB produced in %d byte reads\n", len / 1e6, BENCH_READ);
+	printf("%-24s %10s %10s %10s %10s %10s\n", "", "MB/s", "max us", "lost MB", "drops", "screens");
+
+	for (i = 0; i < 3; i++)
+	{
+		timing(path, corpus, len, i);
+	}
+
+	free(corpus);
+
+	return failed;
+}
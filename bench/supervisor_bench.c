@@ -0,0 +1,219 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "escscan.h"
+#include "supervisor.h"
+#include "platform.h"
+
+#define BENCH_TOTAL (64 << 20)
+#define BENCH_CHUNK (64 << 10)
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* resident size now, ru_maxrss is carried over from before exec */
+static long rss_kb(void)
+{
+	FILE* fp = fopen("/proc/self/status", "r");
+	char line[256];
+	long kb = 0;
+
+	while (fp && fgets(line, sizeof(line), fp))
+	{
+		if (!strncmp(line, "VmRSS:", 6))
+		{
+			kb = atol(line + 6);
+			break;
+		}
+	}
+
+	if (fp)
+	{
+		fclose(fp);
+	}
+
+	return kb;
+}
+
+struct sampler
+{
+	size_t stop;
+	long peak;
+};
+
+/* the highest resident size while the sessions run */
+static void sample(void* pv)
+{
+	struct sampler* sampler = pv;
+
+	while (!conlog_atomic_load(&sampler->stop))
+	{
+		long kb = rss_kb();
+
+		if (kb > sampler->peak)
+		{
+			sampler->peak = kb;
+		}
+
+		usleep(5000);
+	}
+}
+
+/* the child each session runs, writing a build log */
+static int child(unsigned long long bytes)
+{
+	static const char* files[] = { "blocklog", "escscan", "manifest", "output", "pump", "record", "render", "screen", "vtparse" };
+	char* buf = malloc(BENCH_CHUNK + 256);
+	unsigned n = 0;
+
+	if (!buf)
+	{
+		return 1;
+	}
+
+	while (bytes)
+	{
+		size_t len = 0;
+
+		while (len < BENCH_CHUNK)
+		{
+			len += snprintf(buf + len, 256, "\033[32m  CC\033[0m      src/%s.c -o obj/%s.o -O2 -Wall %u\n", files[n % 9], files[(n / 9) % 9], n);
+			n++;
+		}
+
+		if (len > bytes)
+		{
+			len = (size_t)bytes;
+		}
+
+		if (write(STDOUT_FILENO, buf, len) != (ssize_t)len)
+		{
+			return 1;
+		}
+
+		bytes -= len;
+	}
+
+	free(buf);
+
+	return 0;
+}
+
+static int run(const char* self, int sessions, unsigned workers)
+{
+	struct sampler sampler;
+	struct conlog_thread thread;
+	long base = rss_kb();
+	struct conlog_options options;
+	struct conlog_manifest_stats stats;
+	struct conlog_output_stats output;
+	unsigned long long each = BENCH_TOTAL / sessions;
+	double t;
+	FILE* fp;
+	int i, e;
+
+	conlog_options_init(&options);
+	options.workers = workers;
+	snprintf(options.manifest, sizeof(options.manifest), "/tmp/supervisor_bench.%d", (int)getpid());
+
+	fp = fopen(options.manifest, "w");
+
+	if (!fp)
+	{
+		perror(options.manifest);
+		return 1;
+	}
+
+	for (i = 0; i < sessions; i++)
+	{
+		fprintf(fp, "/dev/null exec %s --child %llu\n", self, each);
+	}
+
+	fclose(fp);
+
+	sampler.stop = 0;
+	sampler.peak = base;
+
+	if (conlog_thread_start(&thread, sample, &sampler))
+	{
+		fprintf(stderr, "Failed to start sampler\n");
+		return 1;
+	}
+
+	t = now();
+	e = conlog_supervise(&options, &stats, &output);
+	t = now() - t;
+
+	conlog_atomic_store(&sampler.stop, 1);
+	conlog_thread_join(&thread);
+
+	unlink(options.manifest);
+
+	printf("%-8d %-8d %10.3f %10.1f %10.1f\n", sessions, stats.workers, t, output.bytesRead / t / 1e6, (double)(sampler.peak - base) / sessions);
+
+	if (e || stats.failed || (output.bytesRead < each * sessions))
+	{
+		fprintf(stderr, "%d sessions: exit %d, %llu failed, %llu bytes read\n", sessions, e, stats.failed, output.bytesRead);
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	static const int counts[] = { 1, 16, 128 };
+	long processors = sysconf(_SC_NPROCESSORS_ONLN);
+	char self[1024];
+	ssize_t n;
+	int i, failed = 0;
+
+	conlog_escscan_init();
+
+	if ((argc == 3) && !strcmp(argv[1], "--child"))
+	{
+		return child(strtoull(argv[2], NULL, 10));
+	}
+
+	n = readlink("/proc/self/exe", self, sizeof(self) - 1);
+
+	if (n <= 0)
+	{
+		fprintf(stderr, "Failed to find this program\n");
+		return 1;
+	}
+
+	self[n] = 0;
+
+	printf("%d MB build log split between the sessions, logs to /dev/null, %ld processors\n", BENCH_TOTAL >> 20, processors);
+	printf("%-8s %-8s %10s %10s %10s\n", "sessions", "workers", "seconds", "MB/s", "KB each");
+
+	/* one worker, then four, which only scales where there are processors for them */
+	for (i = 0; i < (int)(sizeof(counts) / sizeof(counts[0])); i++)
+	{
+		failed |= run(self, counts[i], 1);
+	}
+
+	for (i = 1; i < (int)(sizeof(counts) / sizeof(counts[0])); i++)
+	{
+		failed |= run(self, counts[i], 4);
+	}
+
+	if (processors < 4)
+	{
+		printf("with fewer processors than workers the sessions share them, this does not show scaling\n");
+	}
+
+	return failed;
+}
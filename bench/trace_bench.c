@@ -0,0 +1,165 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "trace.h"
+#include "platform.h"
+
+#define BENCH_THREADS 4
+#define BENCH_SPANS (1 << 22)
+
+struct worker
+{
+	struct conlog_thread thread;
+	char name[16];
+	unsigned long long spans;
+};
+
+static void worker_main(void* arg)
+{
+	struct worker* worker = arg;
+	unsigned long long i;
+
+	CONLOG_TRACE_THREAD(worker->name);
+
+	for (i = 0; i < worker->spans; i++)
+	{
+		unsigned long long start = CONLOG_TRACE_CLOCK();
+
+		CONLOG_TRACE_SPAN("span", start, i);
+	}
+
+	CONLOG_TRACE_MARK("done", worker->spans);
+}
+
+/* the threads at once, returns the nanoseconds of processor time one trace point took */
+static double run(struct worker* workers, int count, unsigned long long spans)
+{
+	double t = clock();
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		workers[i].spans = spans;
+		conlog_thread_start(&workers[i].thread, worker_main, workers + i);
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		conlog_thread_join(&workers[i].thread);
+	}
+
+	return (clock() - t) * 1e9 / CLOCKS_PER_SEC / (count * (double)spans);
+}
+
+/* reads the trace back a line at a time, each event is one line */
+static int check(const char* path, int threads, unsigned long long spans)
+{
+	FILE* fp = fopen(path, "r");
+	char line[512];
+	int names = 0, marks = 0, lines = 0, failed = 0;
+	unsigned long long events = 0, first = spans, last = 0;
+
+	if (!fp)
+	{
+		perror(path);
+		return 1;
+	}
+
+	while (fgets(line, sizeof(line), fp))
+	{
+		size_t len = strlen(line);
+		const char* value = strstr(line, "\"value\":");
+
+		lines++;
+
+		if (lines == 1)
+		{
+			failed |= strcmp(line, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n") != 0;
+		}
+		else if (strcmp(line, "]}\n"))
+		{
+			failed |= (line[0] != '{') || (len < 3) || (strcmp(line + len - 2, "}\n") && strcmp(line + len - 3, "},\n"));
+		}
+
+		if (strstr(line, "\"ph\":\"M\""))
+		{
+			names += strstr(line, "\"name\":\"worker ") != NULL;
+		}
+		else if (strstr(line, "\"ph\":\"i\""))
+		{
+			marks++;
+		}
+		else if (strstr(line, "\"ph\":\"X\"") && value)
+		{
+			unsigned long long n = strtoull(value + 8, NULL, 10);
+
+			events++;
+
+			if (n < first) first = n;
+			if (n > last) last = n;
+		}
+	}
+
+	fclose(fp);
+
+	/* each ring keeps the latest events, so the oldest spans and one mark per thread have gone */
+	if ((names != threads) || (marks != threads) || (events != threads * (unsigned long long)(CONLOG_TRACE_EVENTS - 1)) ||
+		(first != spans - CONLOG_TRACE_EVENTS + 1) || (last != spans - 1))
+	{
+		failed = 1;
+	}
+
+	printf("trace of %d threads: %llu spans, %s\n", names, events, failed ? "not as expected" : "as expected");
+
+	return failed;
+}
+
+int main(int argc, char** argv)
+{
+	struct worker workers[BENCH_THREADS];
+	char path[64];
+	double on, off, one;
+	int failed, i;
+
+	snprintf(path, sizeof(path), "/tmp/trace_bench.%d.json", (int)getpid());
+
+	for (i = 0; i < BENCH_THREADS; i++)
+	{
+		snprintf(workers[i].name, sizeof(workers[i].name), "worker %d", i);
+	}
+
+	/* more spans than a ring holds, so each wraps */
+	conlog_trace_start();
+	run(workers, BENCH_THREADS, CONLOG_TRACE_EVENTS * 2);
+
+	if (conlog_trace_finish(path))
+	{
+		perror(path);
+		return 1;
+	}
+
+	failed = check(path, BENCH_THREADS, CONLOG_TRACE_EVENTS * 2);
+
+	conlog_trace_start();
+	one = run(workers, 1, BENCH_SPANS);
+	on = run(workers, BENCH_THREADS, BENCH_SPANS);
+	conlog_trace_finish(path);
+
+	off = run(workers, BENCH_THREADS, BENCH_SPANS);
+
+	unlink(path);
+
+	printf("%-28s %10s\n", "", "ns/span");
+	printf("%-28s %10.1f\n", "traced, one thread", one);
+	printf("%-28s %10.1f\n", "traced, threads at once", on);
+	printf("%-28s %10.1f\n", "built in, no --trace", off);
+
+	return failed;
+}
@@ -0,0 +1,172 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "uring.h"
+
+#define BENCH_SIZE (64 << 20)
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare(const void* a, const void* b)
+{
+	unsigned long long x = *(const unsigned long long*)a, y = *(const unsigned long long*)b;
+
+	return (x > y) - (x < y);
+}
+
+static int same(const char* path, const unsigned char* data, size_t len)
+{
+	FILE* fp = fopen(path, "rb");
+	unsigned char* buf = malloc(len + 1);
+	int result = fp && buf && (fread(buf, 1, len + 1, fp) == len) && !memcmp(buf, data, len);
+
+	if (fp)
+	{
+		fclose(fp);
+	}
+
+	free(buf);
+
+	return result;
+}
+
+/* the time each write keeps the thread draining the terminal, and the time to the file closed */
+static int run(const char* dir, const char* fs, int bUring, size_t chunk, const unsigned char* data, size_t len, unsigned long long* lat)
+{
+	struct conlog_logfile log;
+	struct conlog_uring uring;
+	char path[256];
+	size_t offset, n = 0;
+	double t;
+
+	snprintf(path, sizeof(path), "%s/uring_bench.%d", dir, (int)getpid());
+	unlink(path);
+
+	if (conlog_logfile_open(&log, path, 0, 0))
+	{
+		fprintf(stderr, "Failed to open %s\n", path);
+		return 1;
+	}
+
+	if (bUring)
+	{
+		struct conlog_logfile_queue queue;
+
+		if (conlog_uring_init(&uring, log.file))
+		{
+			printf("%-6s %-6s %6d io_uring is not available\n", fs, "uring", (int)chunk);
+			conlog_logfile_close(&log);
+			unlink(path);
+			return 0;
+		}
+
+		queue.write = conlog_uring_write;
+		queue.drain = conlog_uring_drain;
+		queue.context = &uring;
+
+		conlog_logfile_set_queue(&log, &queue);
+	}
+
+	t = now();
+
+	for (offset = 0; offset < len; offset += chunk)
+	{
+		struct conlog_iovec iov;
+		unsigned long long start = conlog_clock();
+
+		iov.data = data + offset;
+		iov.len = (len - offset < chunk) ? len - offset : chunk;
+
+		conlog_logfile_write(&log, &iov, 1);
+
+		lat[n++] = conlog_clock() - start;
+	}
+
+	conlog_logfile_close(&log);
+
+	if (bUring)
+	{
+		conlog_uring_close(&uring);
+	}
+
+	t = now() - t;
+
+	qsort(lat, n, sizeof(*lat), compare);
+
+	printf("%-6s %-6s %6d %10.1f %10.2f %10.2f %10.1f", fs, bUring ? "uring" : "write", (int)chunk, len / t / 1e6, lat[n / 2] / 1e3, lat[n * 99 / 100] / 1e3, lat[n - 1] / 1e3);
+
+	if (bUring)
+	{
+		printf(" %8llu %8llu %6llu", uring.stats.submits, uring.stats.writes, uring.stats.waits);
+	}
+
+	printf("\n");
+
+	if (!same(path, data, len))
+	{
+		fprintf(stderr, "%s on %s does not match what was written\n", path, fs);
+		unlink(path);
+		return 1;
+	}
+
+	unlink(path);
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	static const size_t chunks[] = { 256, 4096, 65536 };
+	static const char* dirs[][2] = { { "/dev/shm", "tmpfs" }, { "/tmp", "ext4" } };
+	unsigned char* data = malloc(BENCH_SIZE);
+	unsigned long long* lat = malloc(BENCH_SIZE / chunks[0] * sizeof(*lat));
+	size_t i;
+	int failed = 0, d, c;
+
+	if (!data || !lat)
+	{
+		fprintf(stderr, "Failed to set up\n");
+		return 1;
+	}
+
+	srand(18);
+
+	for (i = 0; i < BENCH_SIZE; i++)
+	{
+		data[i] = (i % 80 == 79) ? '\n' : (unsigned char)(' ' + rand() % 95);
+	}
+
+	printf("%d MB to a log file, writer latency in microseconds\n", BENCH_SIZE >> 20);
+	printf("%-6s %-6s %6s %10s %10s %10s %10s %8s %8s %6s\n", "fs", "sink", "chunk", "MB/s", "p50", "p99", "max", "submits", "writes", "waits");
+
+	for (d = 0; d < (int)(sizeof(dirs) / sizeof(dirs[0])); d++)
+	{
+		if (access(dirs[d][0], W_OK))
+		{
+			continue;
+		}
+
+		for (c = 0; c < (int)(sizeof(chunks) / sizeof(chunks[0])); c++)
+		{
+			failed |= run(dirs[d][0], dirs[d][1], 0, chunks[c], data, BENCH_SIZE, lat);
+			failed |= run(dirs[d][0], dirs[d][1], 1, chunks[c], data, BENCH_SIZE, lat);
+		}
+	}
+
+	free(lat);
+	free(data);
+
+	return failed;
+}
@@ -0,0 +1,440 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "escscan.h"
+#include "vtparse.h"
+
+#define BENCH_SIZE (32 << 20)
+#define BENCH_READ 4096
+#define BENCH_REPEAT 5
+
+struct sink
+{
+	unsigned char* data;
+	size_t len;
+	int events[4];
+	int keep;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void sink_pass(void* context, const unsigned char* data, size_t len)
+{
+	struct sink* sink = context;
+
+	if (sink->keep)
+	{
+		memcpy(sink->data + sink->len, data, len);
+	}
+
+	sink->len += len;
+}
+
+static int sink_report(void* context, int event)
+{
+	struct sink* sink = context;
+
+	sink->events[event]++;
+
+	return event == CONLOG_VT_DSR_CPR;
+}
+
+static const struct conlog_vt_handler handler = { sink_pass, sink_report };
+
+/* the escapeRoom/escapeCommittee parser from output_thread, kept for comparison */
+struct legacy
+{
+	int colonCount, digitCount, escapeCommittee, escapeLen;
+	int args[5];
+	char escapeRoom[128];
+};
+
+static void legacy_parse(struct legacy* st, const unsigned char* buf, size_t dwRead, struct sink* state)
+{
+	const unsigned char* input = buf;
+	size_t offset = 0;
+
+	while (offset < dwRead)
+	{
+		unsigned char c = input[offset];
+
+		if (st->escapeLen)
+		{
+			if (st->escapeLen < sizeof(st->escapeRoom))
+			{
+				int flush = 0;
+
+				st->escapeRoom[st->escapeLen++] = c;
+				offset++;
+
+				switch (st->escapeCommittee)
+				{
+				case 1:
+					if (c == '[')
+					{
+						st->colonCount = 0;
+						st->digitCount = 0;
+						st->escapeCommittee = 2;
+						st->args[0] = 0;
+					}
+					else
+					{
+						flush = 1;
+					}
+					break;
+
+				case 2:
+				case 3:
+					if (c == ';')
+					{
+						if (st->colonCount < 5)
+						{
+							st->args[st->colonCount++] = 0;
+							st->digitCount = 0;
+						}
+					}
+					else if (c == '?')
+					{
+						if (st->escapeCommittee == 2 && st->colonCount == 0 && st->digitCount == 0)
+						{
+							st->escapeCommittee = 3;
+						}
+						else
+						{
+							flush = 1;
+						}
+					}
+					else if (isdigit(c))
+					{
+						if (st->colonCount < 5)
+						{
+							st->args[st->colonCount] = (st->args[st->colonCount] * 10) + (c - '0');
+							st->digitCount++;
+						}
+					}
+					else
+					{
+						if (st->escapeCommittee == 3 && st->digitCount && st->args[0] == 1004)
+						{
+							if (c == 'h')
+							{
+								sink_report(state, CONLOG_VT_FOCUS_ON);
+							}
+							else if (c == 'l')
+							{
+								sink_report(state, CONLOG_VT_FOCUS_OFF);
+							}
+						}
+						else if (st->escapeCommittee == 2 && c == 'n' && st->digitCount && st->args[0] == 6)
+						{
+							sink_report(state, CONLOG_VT_DSR_CPR);
+							st->escapeLen = 0;
+						}
+
+						flush = 1;
+					}
+					break;
+				}
+
+				if (flush)
+				{
+					sink_pass(state, (const unsigned char*)st->escapeRoom, st->escapeLen);
+					st->escapeCommittee = 0;
+					st->escapeLen = 0;
+					input += offset;
+					dwRead -= offset;
+					offset = 0;
+				}
+			}
+			else
+			{
+				sink_pass(state, (const unsigned char*)st->escapeRoom, st->escapeLen);
+				st->escapeCommittee = 0;
+				st->escapeLen = 0;
+				input += offset;
+				dwRead -= offset;
+				offset = 0;
+			}
+		}
+		else if (c == 27)
+		{
+			sink_pass(state, input, offset);
+
+			st->escapeRoom[st->escapeLen++] = c;
+			offset++;
+			dwRead -= offset;
+			input += offset;
+			offset = 0;
+			st->escapeCommittee = 1;
+		}
+		else
+		{
+			offset++;
+		}
+	}
+
+	sink_pass(state, input, offset);
+}
+
+static size_t append(unsigned char* buf, size_t len, const char* s)
+{
+	size_t n = strlen(s);
+	memcpy(buf + len, s, n);
+	return len + n;
+}
+
+/* mix is the percentage of lines carrying sequences, osc adds long OSC 8 hyperlinks */
+static size_t generate(unsigned char* buf, size_t size, int mix, int osc)
+{
+	static const char* sgr[] = { "\033[0m", "\033[1;31m", "\033[38;5;208m", "\033[K", "\033[2;5H", "\033[?25l", "\033[?25h", "\033(B" };
+	size_t len = 0;
+	char line[512];
+
+	srand(2);
+
+	while (len + sizeof(line) * 2 < size)
+	{
+		int r = rand() % 100;
+
+		if (r < mix)
+		{
+			len = append(buf, len, sgr[rand() % (sizeof(sgr) / sizeof(sgr[0]))]);
+
+			switch (rand() % 16)
+			{
+			case 0:
+				len = append(buf, len, "\033[6n");
+				break;
+			case 1:
+				len = append(buf, len, "\033[?1004h");
+				break;
+			case 2:
+				len = append(buf, len, "\033[?1004l");
+				break;
+			}
+		}
+
+		if (osc && (r % 10) == 0)
+		{
+			int n = 64 + rand() % 256, i;
+
+			len = append(buf, len, "\033]8;;https://example.com/");
+
+			for (i = 0; i < n; i++)
+			{
+				buf[len++] = 'a' + (i % 26);
+			}
+
+			len = append(buf, len, "\033\\link\033]8;;\033\\");
+		}
+
+		snprintf(line, sizeof(line), "[%3d%%] Building C object src/CMakeFiles/conlog.dir/vtparse.c.o %d\r\n", r, rand());
+		len = append(buf, len, line);
+	}
+
+	return len;
+}
+
+static int compare(struct sink* a, struct sink* b)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+	{
+		if (a->events[i] != b->events[i])
+		{
+			return 1;
+		}
+	}
+
+	return (a->len != b->len) || memcmp(a->data, b->data, a->len);
+}
+
+static void reset(struct sink* sink)
+{
+	memset(sink->events, 0, sizeof(sink->events));
+	sink->len = 0;
+}
+
+/* resumability, feeding the same stream whole and in random slices must agree */
+static int check(const unsigned char* buf, size_t len, struct sink* a, struct sink* b)
+{
+	struct conlog_vt vt;
+	struct legacy legacy;
+	size_t offset = 0;
+
+	reset(a);
+	reset(b);
+
+	conlog_vt_init(&vt);
+	conlog_vt_parse(&vt, buf, len, &handler, a);
+
+	conlog_vt_init(&vt);
+
+	while (offset < len)
+	{
+		size_t n = 1 + rand() % 64;
+
+		if (n > len - offset)
+		{
+			n = len - offset;
+		}
+
+		conlog_vt_parse(&vt, buf + offset, n, &handler, b);
+		offset += n;
+	}
+
+	if (compare(a, b))
+	{
+		fprintf(stderr, "sliced parse differs from whole parse\n");
+		return 1;
+	}
+
+	reset(b);
+	memset(&legacy, 0, sizeof(legacy));
+	legacy_parse(&legacy, buf, len, b);
+
+	if (compare(a, b))
+	{
+		fprintf(stderr, "vtparse differs from legacy parser\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+static double run_vt(const unsigned char* buf, size_t len, struct sink* sink, unsigned long long* copied)
+{
+	double best = 0;
+	int repeat = BENCH_REPEAT;
+
+	while (repeat--)
+	{
+		struct conlog_vt vt;
+		size_t offset = 0;
+		double t = now();
+
+		conlog_vt_init(&vt);
+
+		while (offset < len)
+		{
+			size_t n = (len - offset) < BENCH_READ ? (len - offset) : BENCH_READ;
+			conlog_vt_parse(&vt, buf + offset, n, &handler, sink);
+			offset += n;
+		}
+
+		t = now() - t;
+
+		*copied = vt.copied;
+
+		if (!best || t < best)
+		{
+			best = t;
+		}
+	}
+
+	return len / best / 1e6;
+}
+
+static double run_legacy(const unsigned char* buf, size_t len, struct sink* sink)
+{
+	double best = 0;
+	int repeat = BENCH_REPEAT;
+
+	while (repeat--)
+	{
+		struct legacy legacy;
+		size_t offset = 0;
+		double t = now();
+
+		memset(&legacy, 0, sizeof(legacy));
+
+		while (offset < len)
+		{
+			size_t n = (len - offset) < BENCH_READ ? (len - offset) : BENCH_READ;
+			legacy_parse(&legacy, buf + offset, n, sink);
+			offset += n;
+		}
+
+		t = now() - t;
+
+		if (!best || t < best)
+		{
+			best = t;
+		}
+	}
+
+	return len / best / 1e6;
+}
+
+int main(int argc, char** argv)
+{
+	static const struct
+	{
+		const char* name;
+		int mix, osc;
+	} corpus[] = {
+		{ "plain", 0, 0 },
+		{ "colour", 50, 0 },
+		{ "heavy", 100, 0 },
+		{ "hyperlinks", 20, 1 }
+	};
+	unsigned char* buf = malloc(BENCH_SIZE);
+	struct sink a, b;
+	size_t i;
+
+	conlog_escscan_init();
+
+	memset(&a, 0, sizeof(a));
+	memset(&b, 0, sizeof(b));
+	a.data = malloc(BENCH_SIZE);
+	b.data = malloc(BENCH_SIZE);
+
+	if (!buf || !a.data || !b.data)
+	{
+		fprintf(stderr, "Failed to allocate buffers\n");
+		return 1;
+	}
+
+	printf("%-12s %12s %12s %10s\n", "corpus", "legacy MB/s", "vtparse MB/s", "held");
+
+	for (i = 0; i < sizeof(corpus) / sizeof(corpus[0]); i++)
+	{
+		size_t len = generate(buf, BENCH_SIZE, corpus[i].mix, corpus[i].osc);
+		unsigned long long copied;
+		double legacy, vt_rate;
+
+		a.keep = b.keep = 1;
+
+		if (check(buf, len < (1 << 20) ? len : (1 << 20), &a, &b))
+		{
+			fprintf(stderr, "%s: mismatch\n", corpus[i].name);
+			return 1;
+		}
+
+		a.keep = 0;
+
+		legacy = run_legacy(buf, len, &a);
+		vt_rate = run_vt(buf, len, &a, &copied);
+
+		printf("%-12s %12.1f %12.1f %10llu\n", corpus[i].name, legacy, vt_rate, copied);
+	}
+
+	free(a.data);
+	free(b.data);
+	free(buf);
+
+	return 0;
+}
@@ -0,0 +1,1654 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include "escscan.h"
+#include "pump.h"
+#include "logwriter.h"
+#include "blocklog.h"
+#include "logfile.h"
+#include "lines.h"
+#include "encode.h"
+#include "flush.h"
+#include "uring.h"
+#include "flight.h"
+#include "options.h"
+#include "record.h"
+#include "share.h"
+#include "stats.h"
+#include "supervisor.h"
+#include "timer.h"
+#include "trace.h"
+
+#define CONLOG_BACKLOG	4096
+/* how long the terminal must stay quiet once the child has exited, in milliseconds, for a process it left behind holding it open */
+#define CONLOG_LINGER_MS	200
+
+/* input the child is not reading yet, in the event loop */
+struct conlog_backlog
+{
+	unsigned char data[CONLOG_BACKLOG];
+	size_t len;
+};
+
+struct conlog_input
+{
+	struct termios mode;
+	int fdRead, fdWrite, fdControl, fdScreen;
+	struct conlog_stats* stats;
+	struct conlog_screen* screen;
+	struct conlog_record* record;
+	struct conlog_share* share;
+	/* dumped when asked for with SIGUSR1 */
+	struct conlog_flight* flight;
+	/* written when asked for with SIGUSR2 */
+	const char* statsPath;
+	const struct conlog_output_stats* output;
+	/* headless input comes from a file or pipe, and whether it last ended a line */
+	int bHeadless, bLineStart;
+	/* how much of a cursor position report has been read from the terminal */
+	int report;
+};
+
+struct conlog_channel
+{
+	int fd;
+	int bConsole;
+	/* when set, the nanoseconds each write took */
+	struct conlog_histogram* time;
+};
+
+struct conlog_reader
+{
+	int fdRead;
+	int nChannels;
+	struct conlog_channel channels[2];
+	struct conlog_channel* console;
+	struct conlog_stats* stats;
+	struct conlog_pump pump;
+	/* the timer for the next console frame in the event loop */
+	int frame;
+	/* set once the child has been reaped */
+	size_t bReaped;
+	/* in the event loop the child's input, which is not blocking, with what is waiting for it */
+	struct conlog_backlog* backlog;
+};
+
+static int conlog_signal_fd = -1;
+
+static void conlog_channel_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	struct conlog_channel* channel = context;
+	struct iovec vec[CONLOG_OUTPUT_IOV];
+	struct iovec* p = vec;
+	unsigned long long t = channel->time ? conlog_clock() : 0;
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		vec[i].iov_base = (void*)iov[i].data;
+		vec[i].iov_len = iov[i].len;
+	}
+
+	while (count)
+	{
+		ssize_t n = writev(channel->fd, p, count);
+
+		if (n < 0)
+		{
+			if (errno == EINTR) continue;
+			break;
+		}
+
+		if (!n) break;
+
+		while (count && ((size_t)n >= p->iov_len))
+		{
+			n -= p->iov_len;
+			p++;
+			count--;
+		}
+
+		if (count)
+		{
+			p->iov_base = (char*)p->iov_base + n;
+			p->iov_len -= n;
+		}
+	}
+
+	if (channel->time)
+	{
+		conlog_histogram_add(channel->time, conlog_clock() - t);
+	}
+}
+
+/* a pipe cannot be synced, which is harmless */
+static void conlog_channel_sync(void* context)
+{
+	struct conlog_channel* channel = context;
+
+	fsync(channel->fd);
+}
+
+static int conlog_write_all(int fd, const void* data, size_t len)
+{
+	const char* p = data;
+
+	while (len)
+	{
+		ssize_t n = write(fd, p, len);
+
+		if (n < 0)
+		{
+			if (errno == EINTR) continue;
+			return -1;
+		}
+
+		p += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/* in the event loop anything written to the child goes after input waiting for it */
+static int conlog_reader_send(struct conlog_reader* state, const char* data, size_t len)
+{
+	struct conlog_backlog* backlog = state->backlog;
+
+	if (!backlog)
+	{
+		return conlog_write_all(state->fdRead, data, len);
+	}
+
+	if (!backlog->len)
+	{
+		ssize_t n = write(state->fdRead, data, len);
+
+		if (n > 0)
+		{
+			data += n;
+			len -= n;
+		}
+	}
+
+	if (len > sizeof(backlog->data) - backlog->len)
+	{
+		return -1;
+	}
+
+	memcpy(backlog->data + backlog->len, data, len);
+	backlog->len += len;
+
+	return 0;
+}
+
+/* the terminal answers the cursor position itself, the request is kept out of the log */
+static int conlog_reader_cursor(void* context)
+{
+	struct conlog_reader* state = context;
+
+	conlog_stats_dsr_request(state->stats);
+
+	return !conlog_write_all(state->console->fd, "\033[6n", 4);
+}
+
+/* the terminal sends its own focus reports on the input */
+static void conlog_reader_focus(void* context, int enable)
+{
+}
+
+/* a headless child's requests are answered from the model, one that is not goes unanswered */
+static int conlog_headless_cursor(void* context)
+{
+	return 0;
+}
+
+/* a headless console always has the focus */
+static void conlog_headless_focus(void* context, int enable)
+{
+	struct conlog_reader* state = context;
+
+	if (enable)
+	{
+		conlog_reader_send(state, "\033[I", 3);
+	}
+}
+
+/* a reply that cannot be written at once goes to the terminal instead */
+static int conlog_reader_reply(void* context, const char* data, size_t len)
+{
+	struct conlog_reader* state = context;
+
+	conlog_stats_dsr_request(state->stats);
+
+	if (conlog_reader_send(state, data, len))
+	{
+		return 0;
+	}
+
+	conlog_stats_dsr_reply(state->stats);
+
+	return 1;
+}
+
+/*
+ * Follows ESC [ row ; col R through the input, which may come over more
+ * than one read. Returns non-zero when data ends a report.
+ */
+static int conlog_input_report(struct conlog_input* state, const char* data, size_t len)
+{
+	int bReport = 0;
+
+	while (len--)
+	{
+		char c = *data++;
+		int digit = (c >= '0') && (c <= '9');
+
+		switch (state->report)
+		{
+		case 1:
+			state->report = (c == '[') ? 2 : 0;
+			break;
+
+		case 2:
+			state->report = digit ? 3 : 0;
+			break;
+
+		case 3:
+			state->report = digit ? 3 : (c == ';') ? 4 : 0;
+			break;
+
+		case 4:
+			state->report = digit ? 5 : 0;
+			break;
+
+		case 5:
+			bReport |= (c == 'R');
+			state->report = digit ? 5 : 0;
+			break;
+		}
+
+		if (c == '\033')
+		{
+			state->report = 1;
+		}
+	}
+
+	return bReport;
+}
+
+/* a cursor position report from the terminal completes a pending request, anything else is typed */
+static void conlog_input_received(struct conlog_input* state, const char* data, size_t len)
+{
+	if (conlog_input_report(state, data, len) && conlog_atomic_load(&state->stats->dsrPending))
+	{
+		conlog_stats_dsr_reply(state->stats);
+	}
+	else
+	{
+		conlog_stats_key(state->stats);
+	}
+}
+
+/* input passed to the child, counted, noting whether it ended a line */
+static void conlog_input_sent(struct conlog_input* state, const unsigned char* data, size_t len)
+{
+	state->stats->inputEvents++;
+
+	if (len)
+	{
+		state->bLineStart = (data[len - 1] == '\n') || (data[len - 1] == '\r');
+	}
+}
+
+/*
+ * When headless input runs out, a child reading lines is sent end of file,
+ * as it would be from a pipe. The first one only completes a line that was
+ * not ended. Returns the number of bytes put in buf.
+ */
+static size_t conlog_input_eof(struct conlog_input* state, unsigned char* buf)
+{
+	struct termios mode;
+	size_t n = 0;
+
+	if (state->bHeadless && !tcgetattr(state->fdWrite, &mode) && (mode.c_lflag & ICANON) && (mode.c_cc[VEOF] != _POSIX_VDISABLE))
+	{
+		if (!state->bLineStart)
+		{
+			buf[n++] = mode.c_cc[VEOF];
+		}
+
+		buf[n++] = mode.c_cc[VEOF];
+	}
+
+	return n;
+}
+
+static void conlog_input_resize(struct conlog_input* state)
+{
+	struct winsize ws;
+
+	if (!ioctl(state->fdScreen, TIOCGWINSZ, &ws))
+	{
+		ioctl(state->fdWrite, TIOCSWINSZ, &ws);
+
+		if (state->screen)
+		{
+			conlog_screen_resize(state->screen, ws.ws_row, ws.ws_col);
+		}
+
+		if (state->record)
+		{
+			conlog_record_resize(state->record, ws.ws_row, ws.ws_col);
+		}
+
+		if (state->share)
+		{
+			conlog_share_resize(state->share, ws.ws_row, ws.ws_col);
+		}
+	}
+}
+
+static void output_thread(void* pv)
+{
+	struct conlog_reader* state = pv;
+	unsigned char buf[4096];
+	ssize_t n = sizeof(buf);
+
+	CONLOG_TRACE_THREAD("output");
+
+	for (;;)
+	{
+		unsigned long long t;
+
+		/* after a short read it waits in turns, so a terminal held open by something the child left running ends once it goes quiet */
+		if (n < (ssize_t)sizeof(buf))
+		{
+			struct pollfd fd;
+			int r;
+
+			fd.fd = state->fdRead;
+			fd.events = POLLIN;
+
+			r = poll(&fd, 1, CONLOG_LINGER_MS);
+
+			if (r < 0)
+			{
+				if (errno == EINTR) continue;
+				break;
+			}
+
+			if (!r)
+			{
+				if (conlog_atomic_load(&state->bReaped)) break;
+				continue;
+			}
+		}
+
+		t = CONLOG_TRACE_CLOCK();
+		n = read(state->fdRead, buf, sizeof(buf));
+
+		CONLOG_TRACE_SPAN("read", t, (n > 0) ? n : 0);
+
+		if (n < 0)
+		{
+			if (errno == EINTR) continue;
+			break;
+		}
+
+		if (n == 0) break;
+
+		conlog_pump_data(&state->pump, buf, n);
+		conlog_stats_echo(state->stats);
+	}
+}
+
+static void input_thread(void* pv)
+{
+	struct conlog_input* state = pv;
+	int running = 1;
+	struct pollfd fds[2];
+
+	fds[0].fd = state->fdRead;
+	fds[0].events = POLLIN;
+	fds[1].fd = state->fdControl;
+	fds[1].events = POLLIN;
+
+	CONLOG_TRACE_THREAD("input");
+
+	if (fds[0].fd < 0)
+	{
+		unsigned char eof[2];
+
+		running = !conlog_write_all(state->fdWrite, eof, conlog_input_eof(state, eof));
+	}
+
+	while (running)
+	{
+		unsigned long long t = CONLOG_TRACE_CLOCK();
+
+		if (poll(fds, 2, -1) < 0)
+		{
+			if (errno == EINTR) continue;
+			break;
+		}
+
+		CONLOG_TRACE_SPAN("wait", t, 0);
+
+		if (fds[0].revents)
+		{
+			char buf[256];
+			ssize_t n = read(state->fdRead, buf, sizeof(buf));
+
+			if (n > 0)
+			{
+				conlog_input_received(state, buf, n);
+
+				if (state->record)
+				{
+					conlog_record_input(state->record, buf, n);
+				}
+
+				t = CONLOG_TRACE_CLOCK();
+				running = !conlog_write_all(state->fdWrite, buf, n);
+				CONLOG_TRACE_SPAN("write", t, n);
+				conlog_input_sent(state, (unsigned char*)buf, n);
+			}
+			else if ((n == 0) || (errno != EINTR))
+			{
+				unsigned char eof[2];
+
+				fds[0].fd = -1;
+				running = !conlog_write_all(state->fdWrite, eof, conlog_input_eof(state, eof));
+			}
+		}
+
+		if (fds[1].revents)
+		{
+			unsigned char op;
+
+			if (read(state->fdControl, &op, 1) == 1)
+			{
+				t = CONLOG_TRACE_CLOCK();
+
+				switch (op)
+				{
+				case 0:
+					running = 0;
+					break;
+
+				case 3:
+					conlog_input_resize(state);
+					break;
+
+				case 4:
+					conlog_flight_dump(state->flight);
+					break;
+
+				case 5:
+					conlog_stats_write(state->stats, state->statsPath, state->output);
+					break;
+				}
+
+				CONLOG_TRACE_SPAN("control", t, op);
+			}
+		}
+	}
+}
+
+static void conlog_loop_watch(int ep, int fd, unsigned events)
+{
+	struct epoll_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events;
+	ev.data.fd = fd;
+
+	epoll_ctl(ep, EPOLL_CTL_MOD, fd, &ev);
+}
+
+static void conlog_loop_frame(void* context)
+{
+	struct conlog_reader* reader = context;
+
+	reader->frame = -1;
+
+	conlog_render_frame(reader->pump.render);
+}
+
+/* output arriving before the frame interval is up waits for the timer */
+static void conlog_loop_render(struct conlog_reader* reader, struct conlog_timers* timers)
+{
+	if (reader->pump.render && (reader->frame < 0))
+	{
+		unsigned long long due = conlog_render_due(reader->pump.render);
+
+		if (due)
+		{
+			reader->frame = conlog_timers_start(timers, due, conlog_loop_frame, reader);
+		}
+	}
+}
+
+/* services the child, the terminal and the timers from one thread */
+static int conlog_loop(struct conlog_reader* reader, struct conlog_input* input, struct conlog_timers* timers)
+{
+	unsigned char buf[4096];
+	struct conlog_backlog backlog;
+	unsigned long long quiet = 0;
+	int running = 1, bReadInput = 0, i;
+	int fdInput = input->fdRead;
+	int fds[3];
+	int ep = epoll_create1(EPOLL_CLOEXEC);
+
+	if (ep < 0)
+	{
+		return errno;
+	}
+
+	/* input that the child is not reading waits in the backlog rather than blocking the output */
+	fcntl(input->fdWrite, F_SETFL, fcntl(input->fdWrite, F_GETFL) | O_NONBLOCK);
+
+	backlog.len = 0;
+	reader->backlog = &backlog;
+
+	fds[0] = input->fdWrite;
+	fds[1] = fdInput;
+	fds[2] = input->fdControl;
+
+	for (i = 0; i < 3; i++)
+	{
+		struct epoll_event ev;
+
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.fd = fds[i];
+
+		/* a file is always ready, and is read whenever the backlog has room */
+		if (epoll_ctl(ep, EPOLL_CTL_ADD, fds[i], &ev) && (errno == EPERM) && (fds[i] == fdInput))
+		{
+			bReadInput = 1;
+		}
+	}
+
+	if (fdInput < 0)
+	{
+		backlog.len = conlog_input_eof(input, backlog.data);
+
+		if (backlog.len)
+		{
+			conlog_loop_watch(ep, input->fdWrite, EPOLLIN | EPOLLOUT);
+		}
+	}
+
+	CONLOG_TRACE_THREAD("loop");
+
+	while (running)
+	{
+		struct epoll_event ev[4];
+		int bFile = bReadInput && (fdInput >= 0) && (backlog.len < sizeof(backlog.data));
+		unsigned long long now = conlog_clock(), t = CONLOG_TRACE_CLOCK();
+		int wait = bFile ? 0 : conlog_timers_wait(timers, now), n;
+
+		/* once the child has exited, a terminal held open by something it left running ends the loop when it goes quiet */
+		if (quiet)
+		{
+			int left = (quiet > now) ? (int)((quiet - now + 999999) / 1000000) : 0;
+
+			if (!left)
+			{
+				break;
+			}
+
+			if ((wait < 0) || (wait > left))
+			{
+				wait = left;
+			}
+		}
+
+		n = epoll_wait(ep, ev, 3, wait);
+
+		if (n < 0)
+		{
+			if (errno == EINTR) continue;
+			break;
+		}
+
+		CONLOG_TRACE_SPAN("wait", t, n);
+
+		if (bFile)
+		{
+			ev[n].events = EPOLLIN;
+			ev[n++].data.fd = fdInput;
+		}
+
+		for (i = 0; running && (i < n); i++)
+		{
+			int fd = ev[i].data.fd;
+
+			if (fd == input->fdWrite)
+			{
+				if (backlog.len && (ev[i].events & EPOLLOUT))
+				{
+					ssize_t w;
+
+					t = CONLOG_TRACE_CLOCK();
+					w = write(input->fdWrite, backlog.data, backlog.len);
+					CONLOG_TRACE_SPAN("write", t, (w > 0) ? w : 0);
+
+					if (w > 0)
+					{
+						memmove(backlog.data, backlog.data + w, backlog.len - w);
+						backlog.len -= w;
+
+						if (!backlog.len)
+						{
+							conlog_loop_watch(ep, input->fdWrite, EPOLLIN);
+
+							if (fdInput >= 0)
+							{
+								conlog_loop_watch(ep, fdInput, EPOLLIN);
+							}
+						}
+					}
+				}
+
+				if (ev[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+				{
+					ssize_t r;
+
+					t = CONLOG_TRACE_CLOCK();
+					r = read(input->fdWrite, buf, sizeof(buf));
+					CONLOG_TRACE_SPAN("read", t, (r > 0) ? r : 0);
+
+					if (r > 0)
+					{
+						size_t queued = backlog.len;
+
+						conlog_pump_data(&reader->pump, buf, r);
+						conlog_stats_echo(reader->stats);
+						conlog_loop_render(reader, timers);
+
+						/* replies to the child queue behind the input */
+						if (backlog.len != queued)
+						{
+							if (!queued)
+							{
+								conlog_loop_watch(ep, input->fdWrite, EPOLLIN | EPOLLOUT);
+							}
+
+							if ((backlog.len == sizeof(backlog.data)) && (fdInput >= 0))
+							{
+								conlog_loop_watch(ep, fdInput, 0);
+							}
+						}
+
+						if (quiet)
+						{
+							quiet = conlog_clock() + CONLOG_LINGER_MS * 1000000ULL;
+						}
+					}
+					else if ((r == 0) || ((errno != EINTR) && (errno != EAGAIN)))
+					{
+						running = 0;
+					}
+				}
+			}
+			else if (fd == fdInput)
+			{
+				ssize_t r;
+
+				/* a reply may have filled the backlog since the input was found ready */
+				if (backlog.len == sizeof(backlog.data))
+				{
+					continue;
+				}
+
+				r = read(fdInput, backlog.data + backlog.len, sizeof(backlog.data) - backlog.len);
+
+				if (r > 0)
+				{
+					conlog_input_received(input, (const char*)backlog.data + backlog.len, r);
+					conlog_input_sent(input, backlog.data + backlog.len, r);
+
+					if (input->record)
+					{
+						conlog_record_input(input->record, backlog.data + backlog.len, r);
+					}
+
+					if (!backlog.len)
+					{
+						ssize_t w;
+
+						t = CONLOG_TRACE_CLOCK();
+						w = write(input->fdWrite, backlog.data, r);
+						CONLOG_TRACE_SPAN("write", t, (w > 0) ? w : 0);
+
+						if (w > 0)
+						{
+							memmove(backlog.data, backlog.data + w, r - w);
+							r -= w;
+						}
+					}
+
+					backlog.len += r;
+
+					if (backlog.len)
+					{
+						conlog_loop_watch(ep, input->fdWrite, EPOLLIN | EPOLLOUT);
+
+						if (backlog.len == sizeof(backlog.data))
+						{
+							conlog_loop_watch(ep, fdInput, 0);
+						}
+					}
+				}
+				else if ((r == 0) || (errno != EINTR))
+				{
+					epoll_ctl(ep, EPOLL_CTL_DEL, fdInput, NULL);
+					fdInput = -1;
+
+					if (backlog.len + 2 <= sizeof(backlog.data))
+					{
+						size_t eof = conlog_input_eof(input, backlog.data + backlog.len);
+
+						if (eof)
+						{
+							backlog.len += eof;
+							conlog_loop_watch(ep, input->fdWrite, EPOLLIN | EPOLLOUT);
+						}
+					}
+				}
+			}
+			else
+			{
+				unsigned char op;
+
+				if (read(input->fdControl, &op, 1) == 1)
+				{
+					t = CONLOG_TRACE_CLOCK();
+
+					if (op == 3)
+					{
+						conlog_input_resize(input);
+					}
+					else if (op == 4)
+					{
+						conlog_flight_dump(input->flight);
+					}
+					else if (op == 5)
+					{
+						conlog_stats_write(input->stats, input->statsPath, input->output);
+					}
+					else if ((op == 6) && !quiet)
+					{
+						quiet = conlog_clock() + CONLOG_LINGER_MS * 1000000ULL;
+					}
+
+					CONLOG_TRACE_SPAN("control", t, op);
+				}
+			}
+		}
+
+		conlog_timers_run(timers, conlog_clock());
+	}
+
+	conlog_timers_cancel(timers, reader->frame);
+	reader->frame = -1;
+	reader->backlog = NULL;
+
+	close(ep);
+
+	return 0;
+}
+
+/* asks the terminal for the cursor position, waiting briefly for the answer */
+static int conlog_query_cursor(struct conlog_input* state, int* row, int* col)
+{
+	struct termios raw = state->mode;
+	char buf[32];
+	size_t len = 0;
+	int result = -1;
+
+	cfmakeraw(&raw);
+
+	if (tcsetattr(state->fdRead, TCSANOW, &raw))
+	{
+		return -1;
+	}
+
+	if (!conlog_write_all(state->fdScreen, "\033[6n", 4))
+	{
+		struct pollfd fd;
+
+		fd.fd = state->fdRead;
+		fd.events = POLLIN;
+
+		while ((len < sizeof(buf) - 1) && (poll(&fd, 1, 500) > 0))
+		{
+			ssize_t n = read(state->fdRead, buf + len, 1);
+
+			if (n <= 0)
+			{
+				break;
+			}
+
+			if (buf[len++] == 'R')
+			{
+				buf[len] = 0;
+				result = (sscanf(buf, "\033[%d;%dR", row, col) == 2) ? 0 : -1;
+				break;
+			}
+		}
+	}
+
+	tcsetattr(state->fdRead, TCSANOW, &state->mode);
+
+	return result;
+}
+
+/* returns the exit status of the child, or the error waiting for it */
+static int conlog_wait(pid_t pid, int* bWriteError)
+{
+	int status;
+
+	while (waitpid(pid, &status, 0) < 0)
+	{
+		if (errno != EINTR)
+		{
+			return errno;
+		}
+	}
+
+	*bWriteError = 0;
+
+	return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+/* a resize, a request to dump the flight recorder or write the statistics, or the child exiting */
+static void conlog_signal(int sig)
+{
+	int e = errno;
+	unsigned char op = (sig == SIGWINCH) ? 3 : (sig == SIGUSR1) ? 4 : (sig == SIGUSR2) ? 5 : 6;
+
+	if (write(conlog_signal_fd, &op, 1) < 0)
+	{
+	}
+
+	errno = e;
+}
+
+int main(int argc, char** argv)
+{
+	static const struct conlog_backend backend = { conlog_reader_cursor, conlog_reader_focus, conlog_reader_reply };
+	static const struct conlog_backend headlessBackend = { conlog_headless_cursor, conlog_headless_focus, conlog_reader_reply };
+	struct conlog_reader reader;
+	struct conlog_input input;
+	struct conlog_thread threadInput, threadOutput;
+	int exitCode = EINVAL, argi = 1;
+	int nChannels, bWriteError = 1, bLogWriter = 0, bBlockLog = 0, bLines = 0, bEncode = 0, bFlush = 0, bFlight = 0, bUring = 0, bLogFile = 0, bRecord = 0, bShare = 0;
+	int control[2];
+	struct conlog_channel* channel = reader.channels;
+	struct conlog_channel* logChannel = NULL;
+	struct conlog_options options;
+	struct conlog_logwriter logwriter;
+	struct conlog_blocklog blocklog;
+	struct conlog_lines lines;
+	struct conlog_encode encode;
+	struct conlog_flush flush;
+	struct conlog_flight flight;
+	struct conlog_uring uring;
+	struct conlog_logfile logfile, recordFile;
+	struct conlog_record record;
+	struct conlog_share share;
+	struct conlog_stats stats;
+	struct conlog_timers timers;
+	struct conlog_screen screen;
+	struct conlog_render render;
+	int bRender = 0;
+	struct termios raw;
+	struct winsize ws;
+	struct sigaction sa;
+	char* shell[2];
+	char** cmd;
+	pid_t pid;
+
+	/* the scanner is chosen before any thread starts */
+	conlog_escscan_init();
+	conlog_options_init(&options);
+
+	while ((argi < argc) && !strncmp(argv[argi], "--", 2))
+	{
+		const char* arg = argv[argi++];
+
+		if (!strcmp(arg, "--"))
+		{
+			break;
+		}
+
+		if (conlog_options_parse(&options, arg))
+		{
+			fprintf(stderr, "Invalid option %s\n", arg);
+			fflush(stderr);
+
+			return EINVAL;
+		}
+	}
+
+	if ((options.logRotateSize || options.logRotateTime) && !options.log[0])
+	{
+		fprintf(stderr, "Log rotation needs --log\n");
+		fflush(stderr);
+
+		return EINVAL;
+	}
+
+	if ((options.logRotateSize || options.logRotateTime) && options.logCompress)
+	{
+		fprintf(stderr, "A compressed log cannot be rotated\n");
+		fflush(stderr);
+
+		return EINVAL;
+	}
+
+#ifndef CONLOG_TRACE
+	if (options.trace[0])
+	{
+		fprintf(stderr, "Tracing is not built in, rebuild with TRACE=1\n");
+		fflush(stderr);
+
+		return EINVAL;
+	}
+#endif
+
+	if (options.trace[0])
+	{
+		conlog_trace_start();
+		CONLOG_TRACE_THREAD("main");
+	}
+
+	if (options.manifest[0])
+	{
+		struct conlog_manifest_stats supervisor;
+		struct conlog_output_stats output;
+
+		if (options.log[0] || options.record[0] || options.share[0] || options.input[0] || options.frameRate || options.logRotateSize || options.logRotateTime)
+		{
+			fprintf(stderr, "Each session in a manifest has only its own log\n");
+			fflush(stderr);
+
+			return EINVAL;
+		}
+
+		if (options.logIo != CONLOG_LOG_IO_WRITE)
+		{
+			fprintf(stderr, "Sessions in a manifest write their logs with plain writes\n");
+			fflush(stderr);
+
+			return EINVAL;
+		}
+
+		exitCode = conlog_supervise(&options, &supervisor, &output);
+
+		if (options.stats[0])
+		{
+			conlog_stats_init(&stats, "supervisor");
+			stats.threads = supervisor.workers;
+			stats.supervisor = &supervisor;
+
+			if (conlog_stats_write(&stats, options.stats, &output))
+			{
+				fprintf(stderr, "Failed to write statistics to %s\n", options.stats);
+				fflush(stderr);
+			}
+		}
+
+		if (options.trace[0] && conlog_trace_finish(options.trace))
+		{
+			fprintf(stderr, "Failed to write trace to %s\n", options.trace);
+			fflush(stderr);
+		}
+
+		return exitCode;
+	}
+
+	if (options.input[0] && !options.headlessRows)
+	{
+		fprintf(stderr, "Input from a file needs --headless\n");
+		fflush(stderr);
+
+		return EINVAL;
+	}
+
+	if (options.headlessRows && options.frameRate)
+	{
+		fprintf(stderr, "A headless session has no console to draw\n");
+		fflush(stderr);
+
+		return EINVAL;
+	}
+
+	if (options.logEncoding == CONLOG_ENCODING_CODEPAGE)
+	{
+		conlog_codepage cp;
+
+		if (conlog_codepage_open(&cp, options.logCodePage))
+		{
+			fprintf(stderr, "Unknown code page %s\n", options.logCodePage);
+			fflush(stderr);
+
+			return EINVAL;
+		}
+
+		conlog_codepage_close(cp);
+	}
+
+	memset(&reader, 0, sizeof(reader));
+	memset(&input, 0, sizeof(input));
+
+	conlog_stats_init(&stats, (options.io == CONLOG_IO_EVENTS) ? "events" : "threads");
+	conlog_timers_init(&timers);
+
+	reader.stats = &stats;
+	reader.frame = -1;
+	input.stats = &stats;
+
+	input.fdRead = STDIN_FILENO;
+	input.bHeadless = options.headlessRows != 0;
+	input.bLineStart = 1;
+
+	if (input.bHeadless)
+	{
+		/* the child's terminal starts with the system defaults */
+		if (!options.input[0])
+		{
+			input.fdRead = -1;
+		}
+		else if (strcmp(options.input, "-"))
+		{
+			input.fdRead = open(options.input, O_RDONLY | O_CLOEXEC);
+
+			if (input.fdRead < 0)
+			{
+				exitCode = errno;
+
+				fprintf(stderr, "Failed to open input %s\n", options.input);
+				fflush(stderr);
+
+				return exitCode;
+			}
+		}
+	}
+	else if (tcgetattr(input.fdRead, &input.mode))
+	{
+		exitCode = errno;
+
+		fprintf(stderr, "Input is not a terminal\n");
+		fflush(stderr);
+
+		return exitCode;
+	}
+
+	reader.channels[0].fd = STDOUT_FILENO;
+	reader.channels[0].bConsole = !input.bHeadless && isatty(reader.channels[0].fd);
+
+	reader.channels[1].fd = STDERR_FILENO;
+	reader.channels[1].bConsole = !input.bHeadless && isatty(reader.channels[1].fd);
+
+	/* the time blocked on the console and on the redirected handle, for --stats */
+	if (options.stats[0])
+	{
+		reader.channels[0].time = reader.channels[0].bConsole ? &stats.consoleWrite : &stats.fileWrite;
+		reader.channels[1].time = reader.channels[1].bConsole ? &stats.consoleWrite : &stats.fileWrite;
+	}
+
+	if (input.bHeadless)
+	{
+		/* nothing is drawn, the output goes to --log or else to stdout */
+		reader.nChannels = options.log[0] ? 0 : 1;
+		reader.console = NULL;
+	}
+	else if (reader.channels[0].bConsole && reader.channels[1].bConsole && !options.log[0])
+	{
+		fprintf(stderr, "Both stdout and stderr are terminals\n");
+		fflush(stderr);
+
+		return ENOTSUP;
+	}
+	else if (!(reader.channels[0].bConsole || reader.channels[1].bConsole))
+	{
+		fprintf(stderr, "No terminal output\n");
+		fflush(stderr);
+
+		return ENOTSUP;
+	}
+	else
+	{
+		/* with --log the redirected handle is left alone, and stdout is the console if both are terminals */
+		reader.nChannels = (reader.channels[0].bConsole && reader.channels[1].bConsole) ? 1 : 2;
+		reader.console = reader.channels[0].bConsole ? &reader.channels[0] : &reader.channels[1];
+	}
+
+	if (options.log[0])
+	{
+		if (conlog_logfile_open(&logfile, options.log, options.logRotateSize, options.logRotateTime))
+		{
+			exitCode = errno ? errno : EINVAL;
+
+			fprintf(stderr, "Failed to open log %s\n", options.log);
+			fflush(stderr);
+
+			return exitCode;
+		}
+
+		bLogFile = 1;
+
+		if (options.stats[0])
+		{
+			logfile.writeTime = &stats.fileWrite;
+		}
+
+		if (logfile.bThread)
+		{
+			stats.threads++;
+			stats.rotate = &logfile.stats;
+		}
+	}
+
+	memset(&ws, 0, sizeof(ws));
+
+	if (input.bHeadless)
+	{
+		input.fdScreen = -1;
+		ws.ws_row = (unsigned short)options.headlessRows;
+		ws.ws_col = (unsigned short)options.headlessCols;
+	}
+	else
+	{
+		input.fdScreen = reader.console->fd;
+
+		if (ioctl(input.fdScreen, TIOCGWINSZ, &ws))
+		{
+			memset(&ws, 0, sizeof(ws));
+		}
+	}
+
+	if (options.record[0])
+	{
+		if (conlog_logfile_open(&recordFile, options.record, 0, 0))
+		{
+			exitCode = errno ? errno : EINVAL;
+
+			fprintf(stderr, "Failed to open recording %s\n", options.record);
+			fflush(stderr);
+
+			return exitCode;
+		}
+
+		if (conlog_record_start(&record, ws.ws_row ? ws.ws_row : 24, ws.ws_col ? ws.ws_col : 80, conlog_logfile_write, &recordFile))
+		{
+			conlog_logfile_close(&recordFile);
+
+			fprintf(stderr, "Failed to start recording %s\n", options.record);
+			fflush(stderr);
+
+			return ENOMEM;
+		}
+
+		bRecord = 1;
+		input.record = &record;
+		stats.threads++;
+		stats.record = &record.stats;
+	}
+
+	if (options.share[0])
+	{
+		if (conlog_share_start(&share, options.share, ws.ws_row ? ws.ws_row : 24, ws.ws_col ? ws.ws_col : 80, options.shareBuffer))
+		{
+			exitCode = errno ? errno : EINVAL;
+
+			fprintf(stderr, "Failed to share on %s: %s\n", options.share, strerror(exitCode));
+			fflush(stderr);
+
+			return exitCode;
+		}
+
+		bShare = 1;
+		input.share = &share;
+		stats.threads += 2;
+		stats.share = &share.stats;
+	}
+
+	if (pipe2(control, O_CLOEXEC))
+	{
+		exitCode = errno;
+
+		fprintf(stderr, "Failed to create internal pipe\n");
+		fflush(stderr);
+
+		return exitCode;
+	}
+
+	input.fdControl = control[0];
+	conlog_signal_fd = control[1];
+
+	conlog_pump_init(&reader.pump, input.bHeadless ? &headlessBackend : &backend, &reader);
+	reader.pump.output.bTimed = options.stats[0] != 0;
+
+	/* the model starts from where the terminal says the cursor is, a console drawn in frames or no console at all answers from it too */
+	if (((options.dsr == CONLOG_DSR_SCREEN) || options.frameRate || input.bHeadless) && !conlog_screen_init(&screen, ws.ws_row ? ws.ws_row : 24, ws.ws_col ? ws.ws_col : 80))
+	{
+		int row, col;
+
+		if (!input.bHeadless && !conlog_query_cursor(&input, &row, &col))
+		{
+			conlog_screen_move(&screen, row - 1, col - 1);
+		}
+
+		reader.pump.screen = &screen;
+		input.screen = &screen;
+
+		if (options.frameRate && !conlog_render_init(&render, &screen, options.frameRate, conlog_channel_write, reader.console))
+		{
+			bRender = 1;
+			reader.pump.render = &render;
+			stats.render = &render.stats;
+		}
+	}
+
+	nChannels = reader.nChannels;
+
+	while (nChannels--)
+	{
+		if (channel->bConsole && bRender)
+		{
+			/* drawn by the renderer */
+		}
+		else if (!channel->bConsole)
+		{
+			logChannel = channel;
+		}
+		else
+		{
+			conlog_output_add(&reader.pump.output, conlog_channel_write, channel);
+		}
+
+		channel++;
+	}
+
+	/* the log goes after the console */
+	if (bLogFile || logChannel)
+	{
+		conlog_output_fn write = bLogFile ? conlog_logfile_write : conlog_channel_write;
+		conlog_sync_fn sync = bLogFile ? conlog_logfile_sync : conlog_channel_sync;
+		void* context = bLogFile ? (void*)&logfile : (void*)logChannel;
+
+		/* plain writes where the kernel does not allow io_uring */
+		if ((options.logIo == CONLOG_LOG_IO_URING) && !conlog_uring_init(&uring, bLogFile ? logfile.file : logChannel->fd))
+		{
+			bUring = 1;
+			stats.uring = &uring.stats;
+
+			if (bLogFile)
+			{
+				struct conlog_logfile_queue queue;
+
+				queue.write = conlog_uring_write;
+				queue.drain = conlog_uring_drain;
+				queue.context = &uring;
+
+				conlog_logfile_set_queue(&logfile, &queue);
+			}
+			else
+			{
+				write = conlog_uring_channel_write;
+				sync = conlog_uring_channel_sync;
+				context = &uring;
+			}
+		}
+
+		/* the file is written in fewer, larger pieces, the console is not held back */
+		if (((options.logFlush != CONLOG_FLUSH_NOW) || (options.logSync != CONLOG_SYNC_NONE)) &&
+			!conlog_flush_init(&flush, options.logFlush, options.logFlushSize, options.logFlushTime, options.logSync, options.logSyncTime, write, sync, context))
+		{
+			bFlush = 1;
+			stats.flush = &flush.stats;
+			write = conlog_flush_write;
+			context = &flush;
+
+			if (flush.bThread)
+			{
+				stats.threads++;
+			}
+		}
+
+		if (options.logCompress && !conlog_blocklog_init(&blocklog, options.logCompress, write, context))
+		{
+			bBlockLog = 1;
+			stats.compress = &blocklog.stats;
+			write = conlog_blocklog_write;
+			context = &blocklog;
+		}
+
+		/* encoded after the lines are collapsed, which works on UTF-8 */
+		if ((options.logEncoding != CONLOG_ENCODING_RAW) && !conlog_encode_init(&encode, options.logEncoding, options.logCodePage, write, context))
+		{
+			bEncode = 1;
+			stats.encode = &encode.stats;
+			write = conlog_encode_write;
+			context = &encode;
+		}
+
+		/* the collapsed lines are kept, and encoded only if they are written */
+		if (options.logFlight && !conlog_flight_init(&flight, options.logFlight, write, context))
+		{
+			bFlight = 1;
+			stats.flight = &flight.stats;
+			write = conlog_flight_write;
+			context = &flight;
+			input.flight = &flight;
+		}
+
+		/* collapsed on the log writer thread when there is one */
+		if ((options.logFormat == CONLOG_LOG_LINES) && !conlog_lines_init(&lines, write, context))
+		{
+			bLines = 1;
+			stats.lines = &lines.stats;
+			write = conlog_lines_write;
+			context = &lines;
+		}
+
+		if (options.logBuffer && !conlog_logwriter_start(&logwriter, options.logBuffer, options.logOverflow, write, context))
+		{
+			bLogWriter = 1;
+			stats.threads++;
+			stats.log = &logwriter.stats;
+			write = conlog_logwriter_write;
+			context = &logwriter;
+		}
+
+		if (options.logFormat == CONLOG_LOG_TEXT)
+		{
+			conlog_output_add_text(&reader.pump.output, write, context);
+		}
+		else
+		{
+			conlog_output_add(&reader.pump.output, write, context);
+		}
+	}
+
+	if (bRecord)
+	{
+		conlog_output_add(&reader.pump.output, conlog_record_output, &record);
+	}
+
+	if (bShare)
+	{
+		conlog_output_add(&reader.pump.output, conlog_share_output, &share);
+	}
+
+	if (argi < argc)
+	{
+		cmd = argv + argi;
+	}
+	else
+	{
+		shell[0] = getenv("SHELL");
+		shell[1] = NULL;
+
+		if (!(shell[0] && shell[0][0]))
+		{
+			shell[0] = "/bin/sh";
+		}
+
+		cmd = shell;
+	}
+
+	/* a headless terminal keeps its size */
+	if (!input.bHeadless)
+	{
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_handler = conlog_signal;
+		sa.sa_flags = SA_RESTART;
+		sigemptyset(&sa.sa_mask);
+		sigaction(SIGWINCH, &sa, NULL);
+	}
+
+	if (bFlight)
+	{
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_handler = conlog_signal;
+		sa.sa_flags = SA_RESTART;
+		sigemptyset(&sa.sa_mask);
+		sigaction(SIGUSR1, &sa, NULL);
+	}
+
+	if (options.stats[0])
+	{
+		input.statsPath = options.stats;
+		input.output = &reader.pump.output.stats;
+
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_handler = conlog_signal;
+		sa.sa_flags = SA_RESTART;
+		sigemptyset(&sa.sa_mask);
+		sigaction(SIGUSR2, &sa, NULL);
+	}
+
+	/* the event loop is told when the child exits, the threads wait for it */
+	if (options.io == CONLOG_IO_EVENTS)
+	{
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_handler = conlog_signal;
+		sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+		sigemptyset(&sa.sa_mask);
+		sigaction(SIGCHLD, &sa, NULL);
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	pid = forkpty(&input.fdWrite, NULL, input.bHeadless ? NULL : &input.mode, ws.ws_row ? &ws : NULL);
+
+	if (pid == 0)
+	{
+		signal(SIGPIPE, SIG_DFL);
+
+		execvp(cmd[0], cmd);
+
+		fprintf(stderr, "%s: %s\n", cmd[0], strerror(errno));
+		fflush(stderr);
+
+		_exit(127);
+	}
+
+	if (pid < 0)
+	{
+		exitCode = errno;
+	}
+	else
+	{
+		fcntl(input.fdWrite, F_SETFD, FD_CLOEXEC);
+
+		reader.fdRead = input.fdWrite;
+
+		if (!input.bHeadless)
+		{
+			raw = input.mode;
+			cfmakeraw(&raw);
+			tcsetattr(input.fdRead, TCSANOW, &raw);
+		}
+
+		if (options.io == CONLOG_IO_EVENTS)
+		{
+			exitCode = conlog_loop(&reader, &input, &timers);
+
+			if (!exitCode)
+			{
+				exitCode = conlog_wait(pid, &bWriteError);
+			}
+		}
+		else
+		{
+			exitCode = conlog_thread_start(&threadInput, input_thread, &input);
+
+			if (!exitCode)
+			{
+				stats.threads++;
+
+				if (bRender && !conlog_render_start(&render))
+				{
+					stats.threads++;
+				}
+
+				exitCode = conlog_thread_start(&threadOutput, output_thread, &reader);
+
+				if (!exitCode)
+				{
+					stats.threads++;
+
+					exitCode = conlog_wait(pid, &bWriteError);
+
+					/* output ends once every holder of the terminal has closed it, or it has gone quiet with the child gone */
+					conlog_atomic_store(&reader.bReaped, 1);
+					conlog_thread_join(&threadOutput);
+				}
+
+				if (conlog_write_all(control[1], "", 1))
+				{
+					exitCode = errno;
+				}
+
+				conlog_thread_join(&threadInput);
+			}
+		}
+
+		if (bWriteError)
+		{
+			int bIgnore;
+
+			kill(pid, SIGHUP);
+			conlog_wait(pid, &bIgnore);
+		}
+
+		close(input.fdWrite);
+
+		if (!input.bHeadless)
+		{
+			tcsetattr(input.fdRead, TCSANOW, &input.mode);
+		}
+	}
+
+	if (input.bHeadless && (input.fdRead > STDERR_FILENO))
+	{
+		close(input.fdRead);
+	}
+
+	signal(SIGWINCH, SIG_DFL);
+	signal(SIGCHLD, SIG_DFL);
+	/* a late request is ignored rather than ending conlog */
+	signal(SIGUSR1, SIG_IGN);
+	signal(SIGUSR2, SIG_IGN);
+
+	if (bRender)
+	{
+		conlog_render_stop(&render);
+	}
+
+	if (bLogWriter)
+	{
+		conlog_logwriter_stop(&logwriter);
+	}
+
+	if (bLines)
+	{
+		conlog_lines_finish(&lines);
+	}
+
+	/* kept only if the child or conlog failed */
+	if (bFlight)
+	{
+		conlog_flight_finish(&flight, exitCode != 0);
+	}
+
+	if (bEncode)
+	{
+		conlog_encode_finish(&encode);
+	}
+
+	if (bBlockLog)
+	{
+		conlog_blocklog_finish(&blocklog);
+	}
+
+	if (bFlush)
+	{
+		conlog_flush_finish(&flush);
+	}
+
+	if (bLogFile)
+	{
+		conlog_logfile_close(&logfile);
+	}
+
+	if (bUring)
+	{
+		conlog_uring_close(&uring);
+	}
+
+	if (bRecord)
+	{
+		conlog_record_stop(&record);
+		conlog_logfile_close(&recordFile);
+	}
+
+	if (bShare)
+	{
+		conlog_share_stop(&share);
+	}
+
+	close(control[0]);
+	close(control[1]);
+
+	if (reader.pump.screen)
+	{
+		conlog_screen_free(reader.pump.screen);
+	}
+
+	if (options.stats[0] && conlog_stats_write(&stats, options.stats, &reader.pump.output.stats))
+	{
+		fprintf(stderr, "Failed to write statistics to %s\n", options.stats);
+		fflush(stderr);
+	}
+
+	if (options.trace[0] && conlog_trace_finish(options.trace))
+	{
+		fprintf(stderr, "Failed to write trace to %s\n", options.trace);
+		fflush(stderr);
+	}
+
+	if (bWriteError && exitCode)
+	{
+		fprintf(stderr, "%s\n", strerror(exitCode));
+		fflush(stderr);
+	}
+
+	return exitCode;
+}
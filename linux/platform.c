@@ -0,0 +1,420 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <langinfo.h>
+#include <locale.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include "platform.h"
+#include "output.h"
+
+unsigned long long conlog_clock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void conlog_process_usage(unsigned long long* cpu, unsigned long long* peak)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+
+	*cpu = (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000ULL + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000ULL;
+	*peak = ru.ru_maxrss * 1024ULL;
+}
+
+static void* conlog_thread_main(void* pv)
+{
+	struct conlog_thread* thread = pv;
+
+	thread->start(thread->arg);
+
+	return NULL;
+}
+
+int conlog_thread_start(struct conlog_thread* thread, void (*start)(void*), void* arg)
+{
+	thread->start = start;
+	thread->arg = arg;
+
+	return pthread_create(&thread->handle, NULL, conlog_thread_main, thread);
+}
+
+void conlog_thread_join(struct conlog_thread* thread)
+{
+	pthread_join(thread->handle, NULL);
+}
+
+void conlog_mutex_init(conlog_mutex* mutex)
+{
+	pthread_mutex_init(mutex, NULL);
+}
+
+void conlog_mutex_lock(conlog_mutex* mutex)
+{
+	pthread_mutex_lock(mutex);
+}
+
+void conlog_mutex_unlock(conlog_mutex* mutex)
+{
+	pthread_mutex_unlock(mutex);
+}
+
+void conlog_mutex_destroy(conlog_mutex* mutex)
+{
+	pthread_mutex_destroy(mutex);
+}
+
+void conlog_cond_init(conlog_cond* cond)
+{
+	pthread_cond_init(cond, NULL);
+}
+
+void conlog_cond_wait(conlog_cond* cond, conlog_mutex* mutex)
+{
+	pthread_cond_wait(cond, mutex);
+}
+
+void conlog_cond_timedwait(conlog_cond* cond, conlog_mutex* mutex, unsigned ms)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+
+	ts.tv_sec += ms / 1000;
+	ts.tv_nsec += (ms % 1000) * 1000000L;
+
+	if (ts.tv_nsec >= 1000000000L)
+	{
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+
+	pthread_cond_timedwait(cond, mutex, &ts);
+}
+
+void conlog_cond_signal(conlog_cond* cond)
+{
+	pthread_cond_signal(cond);
+}
+
+void conlog_cond_broadcast(conlog_cond* cond)
+{
+	pthread_cond_broadcast(cond);
+}
+
+void conlog_cond_destroy(conlog_cond* cond)
+{
+	pthread_cond_destroy(cond);
+}
+
+int conlog_file_open(conlog_file* file, const char* path)
+{
+	int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+	if (fd < 0)
+	{
+		return -1;
+	}
+
+	*file = fd;
+
+	return 0;
+}
+
+void conlog_file_write(conlog_file file, const struct conlog_iovec* iov, int count)
+{
+	struct iovec vec[CONLOG_OUTPUT_IOV];
+	struct iovec* p = vec;
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		vec[i].iov_base = (void*)iov[i].data;
+		vec[i].iov_len = iov[i].len;
+	}
+
+	while (count)
+	{
+		ssize_t n = writev(file, p, count);
+
+		if (n < 0)
+		{
+			if (errno == EINTR) continue;
+			break;
+		}
+
+		if (!n) break;
+
+		while (count && ((size_t)n >= p->iov_len))
+		{
+			n -= p->iov_len;
+			p++;
+			count--;
+		}
+
+		if (count)
+		{
+			p->iov_base = (char*)p->iov_base + n;
+			p->iov_len -= n;
+		}
+	}
+}
+
+void conlog_file_close(conlog_file file)
+{
+	close(file);
+}
+
+int conlog_file_sync(conlog_file file)
+{
+	return fsync(file) ? -1 : 0;
+}
+
+unsigned long long conlog_file_size(conlog_file file)
+{
+	struct stat st;
+
+	return fstat(file, &st) ? 0 : (unsigned long long)st.st_size;
+}
+
+int conlog_file_rename(const char* from, const char* to)
+{
+	return rename(from, to) ? -1 : 0;
+}
+
+FILE* conlog_fopen(const char* path, const char* mode)
+{
+	return fopen(path, mode);
+}
+
+/* code pages go by their iconv names, acp is the codeset of the locale */
+int conlog_codepage_open(conlog_codepage* cp, const char* name)
+{
+	if (!strcmp(name, "acp"))
+	{
+		setlocale(LC_CTYPE, "");
+		name = nl_langinfo(CODESET);
+	}
+
+	*cp = iconv_open(name, "UTF-16LE");
+
+	return (*cp == (iconv_t)-1) ? -1 : 0;
+}
+
+size_t conlog_codepage_encode(conlog_codepage cp, const unsigned short* wide, size_t count, unsigned char* out, size_t size)
+{
+	char* in = (char*)wide;
+	size_t inLeft = count * sizeof(*wide);
+	char* p = (char*)out;
+	size_t outLeft = size;
+
+	while (inLeft && outLeft)
+	{
+		if (iconv(cp, &in, &inLeft, &p, &outLeft) != (size_t)-1)
+		{
+			break;
+		}
+
+		if (errno != EILSEQ)
+		{
+			break;
+		}
+
+		/* a character the code page does not have, with its low surrogate if it has one */
+		*p++ = '?';
+		outLeft--;
+
+		if ((inLeft >= 4) && ((((unsigned short*)in)[0] & 0xFC00) == 0xD800))
+		{
+			in += 2;
+			inLeft -= 2;
+		}
+
+		in += 2;
+		inLeft -= 2;
+	}
+
+	/* back to the initial shift state, for the stateful code pages */
+	iconv(cp, NULL, NULL, &p, &outLeft);
+
+	return p - (char*)out;
+}
+
+void conlog_codepage_close(conlog_codepage cp)
+{
+	iconv_close(cp);
+}
+
+/* only a socket left behind by a session that did not end cleanly is removed, nothing else at the path is touched */
+static int listener_clear(const char* path, const struct sockaddr_un* addr)
+{
+	struct stat st;
+	int fd, e;
+
+	if (lstat(path, &st))
+	{
+		return (errno == ENOENT) ? 0 : -1;
+	}
+
+	if (!S_ISSOCK(st.st_mode))
+	{
+		errno = EEXIST;
+		return -1;
+	}
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (fd < 0)
+	{
+		return -1;
+	}
+
+	e = connect(fd, (const struct sockaddr*)addr, sizeof(*addr)) ? errno : 0;
+	close(fd);
+
+	/* a live session still answers on it */
+	if (!e)
+	{
+		errno = EADDRINUSE;
+		return -1;
+	}
+
+	if (e != ECONNREFUSED)
+	{
+		errno = e;
+		return -1;
+	}
+
+	return (unlink(path) && (errno != ENOENT)) ? -1 : 0;
+}
+
+int conlog_listener_open(struct conlog_listener* listener, const char* path)
+{
+	struct sockaddr_un addr;
+	size_t len = strlen(path);
+
+	if (len >= sizeof(addr.sun_path) || len >= sizeof(listener->path))
+	{
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	memcpy(addr.sun_path, path, len + 1);
+
+	listener->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (listener->fd < 0)
+	{
+		return -1;
+	}
+
+	if (listener_clear(path, &addr))
+	{
+		int e = errno;
+
+		close(listener->fd);
+		errno = e;
+
+		return -1;
+	}
+
+	if (bind(listener->fd, (struct sockaddr*)&addr, sizeof(addr)) || listen(listener->fd, 16))
+	{
+		int e = errno;
+
+		close(listener->fd);
+		errno = e;
+
+		return -1;
+	}
+
+	memcpy(listener->path, path, len + 1);
+
+	return 0;
+}
+
+int conlog_listener_accept(struct conlog_listener* listener, struct conlog_viewer* viewer)
+{
+	for (;;)
+	{
+		int fd = accept4(listener->fd, NULL, NULL, SOCK_CLOEXEC);
+
+		if (fd >= 0)
+		{
+			viewer->fd = fd;
+			return 0;
+		}
+
+		/* a viewer that went before it was taken is not the end */
+		if ((errno != EINTR) && (errno != ECONNABORTED))
+		{
+			return -1;
+		}
+	}
+}
+
+void conlog_listener_stop(struct conlog_listener* listener)
+{
+	shutdown(listener->fd, SHUT_RDWR);
+}
+
+void conlog_listener_close(struct conlog_listener* listener)
+{
+	close(listener->fd);
+	unlink(listener->path);
+}
+
+int conlog_viewer_send(struct conlog_viewer* viewer, const void* data, size_t len)
+{
+	const char* p = data;
+
+	while (len)
+	{
+		ssize_t n = send(viewer->fd, p, len, MSG_NOSIGNAL);
+
+		if (n < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			return -1;
+		}
+
+		p += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+void conlog_viewer_hangup(struct conlog_viewer* viewer)
+{
+	shutdown(viewer->fd, SHUT_RDWR);
+}
+
+void conlog_viewer_close(struct conlog_viewer* viewer)
+{
+	close(viewer->fd);
+}
@@ -0,0 +1,644 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ *
+ * The main thread starts and reaps every child, so nothing forks while a
+ * worker holds a lock. Each worker waits on its own epoll set and carries
+ * whatever its sessions write through their parsers to their logs.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pty.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include "supervisor.h"
+#include "pump.h"
+#include "logfile.h"
+#include "blocklog.h"
+#include "lines.h"
+#include "encode.h"
+#include "flush.h"
+#include "flight.h"
+#include "trace.h"
+
+#define SUPERVISOR_READ		(64 << 10)
+#define SUPERVISOR_EVENTS	16
+
+struct conlog_supervisor;
+
+struct conlog_session
+{
+	struct conlog_pump pump;
+	struct conlog_screen screen;
+	struct conlog_logfile logfile;
+	/* the parts of the log chain that were asked for */
+	struct conlog_flush* flush;
+	struct conlog_blocklog* blocklog;
+	struct conlog_encode* encode;
+	struct conlog_flight* flight;
+	struct conlog_lines* lines;
+	const struct conlog_manifest_entry* entry;
+	struct conlog_supervisor* supervisor;
+	int fd;
+	int worker;
+	int status;
+	pid_t pid;
+	struct conlog_session* nextDone;
+};
+
+struct conlog_worker
+{
+	struct conlog_supervisor* supervisor;
+	struct conlog_thread thread;
+	int ep;
+	/* sessions given to this worker, only touched by the main thread */
+	int count;
+};
+
+struct conlog_supervisor
+{
+	/* sessions whose output has ended, waiting for the main thread to reap them */
+	conlog_mutex mutex;
+	conlog_cond done;
+	struct conlog_session* finished;
+	int stop[2];
+};
+
+static int session_write_all(int fd, const void* data, size_t len)
+{
+	const char* p = data;
+
+	while (len)
+	{
+		ssize_t n = write(fd, p, len);
+
+		if (n < 0)
+		{
+			if (errno == EINTR) continue;
+			return -1;
+		}
+
+		p += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/* every request is answered from the model */
+static int session_cursor(void* context)
+{
+	return 0;
+}
+
+/* a headless console always has the focus */
+static void session_focus(void* context, int enable)
+{
+	struct conlog_session* session = context;
+
+	if (enable)
+	{
+		session_write_all(session->fd, "\033[I", 3);
+	}
+}
+
+static int session_reply(void* context, const char* data, size_t len)
+{
+	struct conlog_session* session = context;
+
+	return !session_write_all(session->fd, data, len);
+}
+
+static void session_close(struct conlog_session* session)
+{
+	if (session->lines)
+	{
+		conlog_lines_finish(session->lines);
+		free(session->lines);
+	}
+
+	if (session->flight)
+	{
+		conlog_flight_finish(session->flight, session->status != 0);
+		free(session->flight);
+	}
+
+	if (session->encode)
+	{
+		conlog_encode_finish(session->encode);
+		free(session->encode);
+	}
+
+	if (session->blocklog)
+	{
+		conlog_blocklog_finish(session->blocklog);
+		free(session->blocklog);
+	}
+
+	if (session->flush)
+	{
+		conlog_flush_finish(session->flush);
+		free(session->flush);
+	}
+
+	conlog_logfile_close(&session->logfile);
+	conlog_screen_free(&session->screen);
+
+	if (session->fd >= 0)
+	{
+		close(session->fd);
+		session->fd = -1;
+	}
+}
+
+/* the log chain as the single session builds it, without the writer thread */
+static int session_chain(struct conlog_session* session, const struct conlog_options* options)
+{
+	conlog_output_fn write = conlog_logfile_write;
+	void* context = &session->logfile;
+
+	if ((options->logFlush != CONLOG_FLUSH_NOW) || (options->logSync != CONLOG_SYNC_NONE))
+	{
+		session->flush = malloc(sizeof(*session->flush));
+
+		if (!session->flush || conlog_flush_init(session->flush, options->logFlush, options->logFlushSize, options->logFlushTime, options->logSync, options->logSyncTime, write, conlog_logfile_sync, context))
+		{
+			free(session->flush);
+			session->flush = NULL;
+
+			return -1;
+		}
+
+		write = conlog_flush_write;
+		context = session->flush;
+	}
+
+	if (options->logCompress)
+	{
+		session->blocklog = malloc(sizeof(*session->blocklog));
+
+		if (!session->blocklog || conlog_blocklog_init(session->blocklog, options->logCompress, write, context))
+		{
+			free(session->blocklog);
+			session->blocklog = NULL;
+
+			return -1;
+		}
+
+		write = conlog_blocklog_write;
+		context = session->blocklog;
+	}
+
+	if (options->logEncoding != CONLOG_ENCODING_RAW)
+	{
+		session->encode = malloc(sizeof(*session->encode));
+
+		if (!session->encode || conlog_encode_init(session->encode, options->logEncoding, options->logCodePage, write, context))
+		{
+			free(session->encode);
+			session->encode = NULL;
+
+			return -1;
+		}
+
+		write = conlog_encode_write;
+		context = session->encode;
+	}
+
+	if (options->logFlight)
+	{
+		session->flight = malloc(sizeof(*session->flight));
+
+		if (!session->flight || conlog_flight_init(session->flight, options->logFlight, write, context))
+		{
+			free(session->flight);
+			session->flight = NULL;
+
+			return -1;
+		}
+
+		write = conlog_flight_write;
+		context = session->flight;
+	}
+
+	if (options->logFormat == CONLOG_LOG_LINES)
+	{
+		session->lines = malloc(sizeof(*session->lines));
+
+		if (!session->lines || conlog_lines_init(session->lines, write, context))
+		{
+			free(session->lines);
+			session->lines = NULL;
+
+			return -1;
+		}
+
+		write = conlog_lines_write;
+		context = session->lines;
+	}
+
+	if (options->logFormat == CONLOG_LOG_TEXT)
+	{
+		conlog_output_add_text(&session->pump.output, write, context);
+	}
+	else
+	{
+		conlog_output_add(&session->pump.output, write, context);
+	}
+
+	return 0;
+}
+
+static int session_open(struct conlog_session* session, const struct conlog_options* options, struct winsize* ws)
+{
+	static const struct conlog_backend backend = { session_cursor, session_focus, session_reply };
+	struct termios mode;
+	int e;
+
+	session->fd = -1;
+
+	if (conlog_logfile_open(&session->logfile, session->entry->log, 0, 0))
+	{
+		return errno ? errno : EINVAL;
+	}
+
+	if (conlog_screen_init(&session->screen, ws->ws_row, ws->ws_col))
+	{
+		conlog_logfile_close(&session->logfile);
+
+		return ENOMEM;
+	}
+
+	conlog_pump_init(&session->pump, &backend, session);
+	session->pump.screen = &session->screen;
+	session->pump.output.bTimed = options->stats[0] != 0;
+
+	if (session_chain(session, options))
+	{
+		session_close(session);
+
+		return ENOMEM;
+	}
+
+	session->pid = forkpty(&session->fd, NULL, NULL, ws);
+
+	if (session->pid == 0)
+	{
+		signal(SIGPIPE, SIG_DFL);
+
+		execl("/bin/sh", "sh", "-c", session->entry->command, (char*)NULL);
+
+		_exit(127);
+	}
+
+	if (session->pid < 0)
+	{
+		e = errno;
+		session->fd = -1;
+		session_close(session);
+
+		return e;
+	}
+
+	/* only the main thread forks, so the next child cannot inherit this */
+	fcntl(session->fd, F_SETFD, FD_CLOEXEC);
+
+	/* there is no input, a child reading lines is told so at once */
+	if (!tcgetattr(session->fd, &mode) && (mode.c_lflag & ICANON) && (mode.c_cc[VEOF] != _POSIX_VDISABLE))
+	{
+		session_write_all(session->fd, &mode.c_cc[VEOF], 1);
+	}
+
+	return 0;
+}
+
+static void supervisor_worker(void* pv)
+{
+	struct conlog_worker* worker = pv;
+	struct conlog_supervisor* supervisor = worker->supervisor;
+	unsigned char buf[SUPERVISOR_READ];
+	int running = 1;
+
+	CONLOG_TRACE_THREAD("worker");
+
+	while (running)
+	{
+		struct epoll_event ev[SUPERVISOR_EVENTS];
+		int n = epoll_wait(worker->ep, ev, SUPERVISOR_EVENTS, -1), i;
+
+		if (n < 0)
+		{
+			if (errno == EINTR) continue;
+			break;
+		}
+
+		for (i = 0; i < n; i++)
+		{
+			struct conlog_session* session = ev[i].data.ptr;
+			ssize_t r;
+
+			/* the stop pipe */
+			if (!session)
+			{
+				running = 0;
+				continue;
+			}
+
+			r = read(session->fd, buf, sizeof(buf));
+
+			if (r > 0)
+			{
+				conlog_pump_data(&session->pump, buf, r);
+			}
+			else if ((r == 0) || ((errno != EINTR) && (errno != EAGAIN)))
+			{
+				/* EIO once every holder of the terminal has closed it */
+				epoll_ctl(worker->ep, EPOLL_CTL_DEL, session->fd, NULL);
+
+				conlog_mutex_lock(&supervisor->mutex);
+				session->nextDone = supervisor->finished;
+				supervisor->finished = session;
+				conlog_cond_signal(&supervisor->done);
+				conlog_mutex_unlock(&supervisor->mutex);
+			}
+		}
+	}
+}
+
+static void supervisor_reap(struct conlog_session* session, struct conlog_output_stats* output)
+{
+	const struct conlog_output_stats* s = &session->pump.output.stats;
+	int status, i;
+
+	while (waitpid(session->pid, &status, 0) < 0)
+	{
+		if (errno != EINTR)
+		{
+			status = 0;
+			break;
+		}
+	}
+
+	session->status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+
+	output->bytesRead += s->bytesRead;
+	output->bytesWritten += s->bytesWritten;
+	output->bytesCopied += s->bytesCopied;
+	output->flushes += s->flushes;
+	output->vectors += s->vectors;
+	output->bytesText += s->bytesText;
+	output->dsr += s->dsr;
+	output->focus += s->focus;
+	conlog_histogram_merge(&output->reads, &s->reads);
+
+	for (i = 0; i < s->channels; i++)
+	{
+		conlog_histogram_merge(output->channelTime + i, s->channelTime + i);
+	}
+
+	if (output->channels < s->channels)
+	{
+		output->channels = s->channels;
+	}
+
+	session_close(session);
+}
+
+int conlog_supervise(const struct conlog_options* options, struct conlog_manifest_stats* stats, struct conlog_output_stats* output)
+{
+	struct conlog_manifest manifest;
+	struct conlog_supervisor supervisor;
+	struct conlog_session* sessions;
+	struct conlog_worker* workers;
+	struct winsize ws;
+	int nWorkers, started = 0, limit, next = 0, running = 0, line, i;
+	int exitCode = 0;
+
+	memset(stats, 0, sizeof(*stats));
+	memset(output, 0, sizeof(*output));
+
+	if (conlog_manifest_load(&manifest, options->manifest, &line))
+	{
+		exitCode = errno ? errno : EINVAL;
+
+		fprintf(stderr, "Failed to read manifest %s\n", options->manifest);
+		fflush(stderr);
+
+		return exitCode;
+	}
+
+	if (line)
+	{
+		fprintf(stderr, "Invalid manifest line %d\n", line);
+		fflush(stderr);
+
+		return EINVAL;
+	}
+
+	if (!manifest.count)
+	{
+		conlog_manifest_free(&manifest);
+
+		return 0;
+	}
+
+	limit = (options->sessions && ((int)options->sessions < manifest.count)) ? (int)options->sessions : manifest.count;
+	nWorkers = options->workers ? (int)options->workers : (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (nWorkers < 1)
+	{
+		nWorkers = 1;
+	}
+
+	if (nWorkers > limit)
+	{
+		nWorkers = limit;
+	}
+
+	memset(&ws, 0, sizeof(ws));
+	ws.ws_row = (unsigned short)(options->headlessRows ? options->headlessRows : CONLOG_HEADLESS_ROWS);
+	ws.ws_col = (unsigned short)(options->headlessCols ? options->headlessCols : CONLOG_HEADLESS_COLS);
+
+	sessions = calloc(manifest.count, sizeof(*sessions));
+	workers = calloc(nWorkers, sizeof(*workers));
+
+	if (!sessions || !workers || pipe2(supervisor.stop, O_CLOEXEC))
+	{
+		exitCode = (sessions && workers) ? errno : ENOMEM;
+
+		free(sessions);
+		free(workers);
+		conlog_manifest_free(&manifest);
+
+		fprintf(stderr, "Failed to set up %d sessions\n", manifest.count);
+		fflush(stderr);
+
+		return exitCode;
+	}
+
+	conlog_mutex_init(&supervisor.mutex);
+	conlog_cond_init(&supervisor.done);
+	supervisor.finished = NULL;
+
+	signal(SIGPIPE, SIG_IGN);
+
+	for (i = 0; i < nWorkers; i++)
+	{
+		struct epoll_event ev;
+
+		workers[i].supervisor = &supervisor;
+		workers[i].ep = epoll_create1(EPOLL_CLOEXEC);
+
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.ptr = NULL;
+
+		if ((workers[i].ep < 0) || epoll_ctl(workers[i].ep, EPOLL_CTL_ADD, supervisor.stop[0], &ev) || conlog_thread_start(&workers[i].thread, supervisor_worker, &workers[i]))
+		{
+			exitCode = errno;
+
+			if (workers[i].ep >= 0)
+			{
+				close(workers[i].ep);
+			}
+
+			break;
+		}
+
+		started++;
+	}
+
+	stats->workers = started;
+
+	while (started && !exitCode && ((next < manifest.count) || running))
+	{
+		struct conlog_session* done;
+
+		while ((next < manifest.count) && (running < limit))
+		{
+			struct conlog_session* session = &sessions[next];
+			struct epoll_event ev;
+			int w, e;
+
+			session->entry = &manifest.entries[next++];
+			session->supervisor = &supervisor;
+			stats->sessions++;
+
+			e = session_open(session, options, &ws);
+
+			if (e)
+			{
+				session->status = e;
+				stats->failed++;
+
+				fprintf(stderr, "Failed to start %s: %s\n", session->entry->command, strerror(e));
+				fflush(stderr);
+
+				continue;
+			}
+
+			/* the worker with the fewest sessions takes the next */
+			session->worker = 0;
+
+			for (w = 1; w < started; w++)
+			{
+				if (workers[w].count < workers[session->worker].count)
+				{
+					session->worker = w;
+				}
+			}
+
+			workers[session->worker].count++;
+
+			memset(&ev, 0, sizeof(ev));
+			ev.events = EPOLLIN;
+			ev.data.ptr = session;
+
+			epoll_ctl(workers[session->worker].ep, EPOLL_CTL_ADD, session->fd, &ev);
+
+			if ((unsigned long long)++running > stats->peak)
+			{
+				stats->peak = running;
+			}
+		}
+
+		if (!running)
+		{
+			break;
+		}
+
+		conlog_mutex_lock(&supervisor.mutex);
+
+		while (!supervisor.finished)
+		{
+			conlog_cond_wait(&supervisor.done, &supervisor.mutex);
+		}
+
+		done = supervisor.finished;
+		supervisor.finished = NULL;
+
+		conlog_mutex_unlock(&supervisor.mutex);
+
+		while (done)
+		{
+			struct conlog_session* session = done;
+
+			done = session->nextDone;
+
+			supervisor_reap(session, output);
+
+			workers[session->worker].count--;
+			running--;
+
+			if (session->status)
+			{
+				stats->failed++;
+
+				fprintf(stderr, "%s: exit status %d\n", session->entry->command, session->status);
+				fflush(stderr);
+			}
+		}
+	}
+
+	/* every worker sees the end of the stop pipe */
+	close(supervisor.stop[1]);
+
+	for (i = 0; i < started; i++)
+	{
+		conlog_thread_join(&workers[i].thread);
+		close(workers[i].ep);
+	}
+
+	close(supervisor.stop[0]);
+
+	if (!exitCode)
+	{
+		for (i = 0; i < next; i++)
+		{
+			if (sessions[i].status)
+			{
+				exitCode = sessions[i].status;
+				break;
+			}
+		}
+	}
+
+	conlog_cond_destroy(&supervisor.done);
+	conlog_mutex_destroy(&supervisor.mutex);
+
+	free(sessions);
+	free(workers);
+	conlog_manifest_free(&manifest);
+
+	return exitCode;
+}
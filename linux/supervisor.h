@@ -0,0 +1,21 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_SUPERVISOR_H
+#define CONLOG_SUPERVISOR_H
+
+#include "manifest.h"
+#include "options.h"
+#include "output.h"
+
+/*
+ * Runs the sessions in options->manifest, each on a headless terminal of
+ * its own with its own log, served by a fixed pool of worker threads.
+ * Returns zero when every session succeeded, otherwise the exit status of
+ * the first in the manifest that did not, or an errno value.
+ */
+int conlog_supervise(const struct conlog_options* options, struct conlog_manifest_stats* stats, struct conlog_output_stats* output);
+
+#endif
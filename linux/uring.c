@@ -0,0 +1,406 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ *
+ * The rings are driven with the raw system calls rather than liburing.
+ * Only the writer touches them, so the one ordering that matters is
+ * with the kernel, through the head and tail of each ring.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include "uring.h"
+
+#ifdef __NR_io_uring_setup
+
+static int uring_enter(struct conlog_uring* uring, unsigned submit, unsigned wait)
+{
+	int n;
+
+	do
+	{
+		n = (int)syscall(__NR_io_uring_enter, uring->fd, submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+	}
+	while ((n < 0) && (errno == EINTR));
+
+	return n;
+}
+
+/* the chain is done, a write cut short or cancelled behind it is finished in turn */
+static void uring_complete(struct conlog_uring* uring)
+{
+	unsigned i;
+
+	for (i = 0; i < uring->inflight; i++)
+	{
+		unsigned b = (uring->first + i) % CONLOG_URING_BUFFERS;
+		int result = uring->result[b];
+		size_t done = (result == -ECANCELED) ? 0 : (size_t)result;
+
+		if ((result == -ECANCELED) || ((result >= 0) && (done < uring->len[b])))
+		{
+			struct conlog_iovec iov;
+
+			iov.data = uring->buffers + b * CONLOG_URING_BUFFER + done;
+			iov.len = uring->len[b] - done;
+
+			conlog_file_write(uring->file, &iov, 1);
+			uring->stats.retries++;
+		}
+	}
+
+	uring->first = (uring->first + uring->inflight) % CONLOG_URING_BUFFERS;
+	uring->inflight = 0;
+	uring->completed = 0;
+}
+
+static void uring_reap(struct conlog_uring* uring, int bWait)
+{
+	while (uring->completed < uring->inflight)
+	{
+		unsigned head = *uring->cqHead;
+		struct io_uring_cqe* cqe;
+
+		if (head == __atomic_load_n(uring->cqTail, __ATOMIC_ACQUIRE))
+		{
+			if (!bWait)
+			{
+				return;
+			}
+
+			if (uring_enter(uring, 0, 1) < 0)
+			{
+				/* what is in flight cannot be known, so it is given up */
+				uring->bFailed = 1;
+				uring->first = (uring->first + uring->inflight) % CONLOG_URING_BUFFERS;
+				uring->inflight = 0;
+				uring->completed = 0;
+				return;
+			}
+
+			continue;
+		}
+
+		cqe = uring->cqes + (head & *uring->cqMask);
+		uring->result[cqe->user_data] = cqe->res;
+		uring->completed++;
+
+		__atomic_store_n(uring->cqHead, head + 1, __ATOMIC_RELEASE);
+	}
+
+	if (uring->inflight)
+	{
+		uring_complete(uring);
+	}
+}
+
+/* the buffers being filled, once the kernel has refused a call */
+static void uring_plain(struct conlog_uring* uring)
+{
+	unsigned i;
+
+	for (i = 0; i < uring->filling; i++)
+	{
+		unsigned b = (uring->first + i) % CONLOG_URING_BUFFERS;
+		struct conlog_iovec iov;
+
+		iov.data = uring->buffers + b * CONLOG_URING_BUFFER;
+		iov.len = uring->len[b];
+
+		conlog_file_write(uring->file, &iov, 1);
+	}
+
+	uring->first = (uring->first + uring->filling) % CONLOG_URING_BUFFERS;
+	uring->filling = 0;
+}
+
+/* sends every buffer filled as one chain, once the last chain is done */
+static void uring_submit(struct conlog_uring* uring)
+{
+	unsigned tail = *uring->sqTail;
+	unsigned i;
+
+	if (uring->inflight || !uring->filling)
+	{
+		return;
+	}
+
+	if (uring->bFailed)
+	{
+		uring_plain(uring);
+		return;
+	}
+
+	for (i = 0; i < uring->filling; i++)
+	{
+		unsigned b = (uring->first + i) % CONLOG_URING_BUFFERS;
+		unsigned index = (tail + i) & *uring->sqMask;
+		struct io_uring_sqe* sqe = uring->sqes + index;
+
+		memset(sqe, 0, sizeof(*sqe));
+
+		sqe->opcode = IORING_OP_WRITE_FIXED;
+		sqe->fd = uring->file;
+		/* the file position, which for a log is its end */
+		sqe->off = (unsigned long long)-1;
+		sqe->addr = (unsigned long long)(size_t)(uring->buffers + b * CONLOG_URING_BUFFER);
+		sqe->len = (unsigned)uring->len[b];
+		sqe->buf_index = (unsigned short)b;
+		sqe->user_data = b;
+
+		if (i + 1 < uring->filling)
+		{
+			sqe->flags = IOSQE_IO_LINK;
+		}
+
+		uring->sqArray[index] = index;
+	}
+
+	__atomic_store_n(uring->sqTail, tail + uring->filling, __ATOMIC_RELEASE);
+
+	if (uring_enter(uring, uring->filling, 0) < 0)
+	{
+		uring->bFailed = 1;
+		uring_plain(uring);
+
+		return;
+	}
+
+	uring->stats.submits++;
+	uring->stats.writes += uring->filling;
+	uring->inflight = uring->filling;
+	uring->filling = 0;
+}
+
+static void uring_unmap(struct conlog_uring* uring)
+{
+	if (uring->buffers)
+	{
+		munmap(uring->buffers, CONLOG_URING_BUFFERS * CONLOG_URING_BUFFER);
+	}
+
+	if (uring->sqes)
+	{
+		munmap(uring->sqes, uring->sqesSize);
+	}
+
+	if (uring->cq)
+	{
+		munmap(uring->cq, uring->cqSize);
+	}
+
+	if (uring->sq)
+	{
+		munmap(uring->sq, uring->sqSize);
+	}
+
+	if (uring->fd >= 0)
+	{
+		close(uring->fd);
+	}
+}
+
+static void* uring_map(int fd, size_t size, off_t offset)
+{
+	void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+
+	return (p == MAP_FAILED) ? NULL : p;
+}
+
+int conlog_uring_init(struct conlog_uring* uring, conlog_file channel)
+{
+	struct io_uring_params params;
+	struct iovec iov[CONLOG_URING_BUFFERS];
+	int i;
+
+	memset(uring, 0, sizeof(*uring));
+	memset(&params, 0, sizeof(params));
+
+	uring->file = channel;
+	uring->channel = channel;
+	uring->fd = (int)syscall(__NR_io_uring_setup, CONLOG_URING_BUFFERS, &params);
+
+	/* the current position is needed to write to the end of a log, or to a pipe */
+	if ((uring->fd < 0) || !(params.features & IORING_FEAT_RW_CUR_POS))
+	{
+		uring_unmap(uring);
+		return -1;
+	}
+
+	uring->sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	uring->cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	uring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+	uring->sq = uring_map(uring->fd, uring->sqSize, IORING_OFF_SQ_RING);
+	uring->cq = uring_map(uring->fd, uring->cqSize, IORING_OFF_CQ_RING);
+	uring->sqes = uring_map(uring->fd, uring->sqesSize, IORING_OFF_SQES);
+	uring->buffers = mmap(NULL, CONLOG_URING_BUFFERS * CONLOG_URING_BUFFER, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (uring->buffers == MAP_FAILED)
+	{
+		uring->buffers = NULL;
+	}
+
+	if (!uring->sq || !uring->cq || !uring->sqes || !uring->buffers)
+	{
+		uring_unmap(uring);
+		return -1;
+	}
+
+	uring->sqTail = (unsigned*)(uring->sq + params.sq_off.tail);
+	uring->sqMask = (unsigned*)(uring->sq + params.sq_off.ring_mask);
+	uring->sqArray = (unsigned*)(uring->sq + params.sq_off.array);
+	uring->cqHead = (unsigned*)(uring->cq + params.cq_off.head);
+	uring->cqTail = (unsigned*)(uring->cq + params.cq_off.tail);
+	uring->cqMask = (unsigned*)(uring->cq + params.cq_off.ring_mask);
+	uring->cqes = (struct io_uring_cqe*)(uring->cq + params.cq_off.cqes);
+
+	for (i = 0; i < CONLOG_URING_BUFFERS; i++)
+	{
+		iov[i].iov_base = uring->buffers + i * CONLOG_URING_BUFFER;
+		iov[i].iov_len = CONLOG_URING_BUFFER;
+	}
+
+	if (syscall(__NR_io_uring_register, uring->fd, IORING_REGISTER_BUFFERS, iov, CONLOG_URING_BUFFERS) < 0)
+	{
+		uring_unmap(uring);
+		return -1;
+	}
+
+	return 0;
+}
+
+void conlog_uring_write(void* context, conlog_file file, const struct conlog_iovec* iov, int count)
+{
+	struct conlog_uring* uring = context;
+	int i;
+
+	if (file != uring->file)
+	{
+		conlog_uring_drain(uring);
+		uring->file = file;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		const unsigned char* data = iov[i].data;
+		size_t len = iov[i].len;
+
+		uring->stats.bytes += len;
+
+		while (len)
+		{
+			unsigned last = (uring->first + uring->inflight + uring->filling + CONLOG_URING_BUFFERS - 1) % CONLOG_URING_BUFFERS;
+			size_t n;
+
+			if (uring->bFailed)
+			{
+				struct conlog_iovec rest;
+
+				rest.data = data;
+				rest.len = len;
+
+				conlog_file_write(file, &rest, 1);
+				conlog_file_write(file, iov + i + 1, count - i - 1);
+
+				return;
+			}
+
+			if (!uring->filling || (uring->len[last] == CONLOG_URING_BUFFER))
+			{
+				if (uring->inflight + uring->filling == CONLOG_URING_BUFFERS)
+				{
+					uring->stats.waits++;
+					uring_reap(uring, 1);
+					uring_submit(uring);
+					continue;
+				}
+
+				last = (last + 1) % CONLOG_URING_BUFFERS;
+				uring->len[last] = 0;
+				uring->filling++;
+			}
+
+			n = CONLOG_URING_BUFFER - uring->len[last];
+
+			if (n > len)
+			{
+				n = len;
+			}
+
+			memcpy(uring->buffers + last * CONLOG_URING_BUFFER + uring->len[last], data, n);
+			uring->len[last] += n;
+			data += n;
+			len -= n;
+
+			/* a full buffer goes as soon as nothing is in flight */
+			if (uring->len[last] == CONLOG_URING_BUFFER)
+			{
+				uring_reap(uring, 0);
+				uring_submit(uring);
+			}
+		}
+	}
+
+	uring_reap(uring, 0);
+	uring_submit(uring);
+}
+
+void conlog_uring_drain(void* context)
+{
+	struct conlog_uring* uring = context;
+
+	while (uring->inflight || uring->filling)
+	{
+		uring_reap(uring, 1);
+		uring_submit(uring);
+	}
+}
+
+void conlog_uring_close(struct conlog_uring* uring)
+{
+	conlog_uring_drain(uring);
+	uring_unmap(uring);
+}
+
+#else
+
+int conlog_uring_init(struct conlog_uring* uring, conlog_file channel)
+{
+	return -1;
+}
+
+void conlog_uring_write(void* context, conlog_file file, const struct conlog_iovec* iov, int count)
+{
+	conlog_file_write(file, iov, count);
+}
+
+void conlog_uring_drain(void* context)
+{
+}
+
+void conlog_uring_close(struct conlog_uring* uring)
+{
+}
+
+#endif
+
+void conlog_uring_channel_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	struct conlog_uring* uring = context;
+
+	conlog_uring_write(uring, uring->channel, iov, count);
+}
+
+void conlog_uring_channel_sync(void* context)
+{
+	struct conlog_uring* uring = context;
+
+	conlog_uring_drain(uring);
+	conlog_file_sync(uring->channel);
+}
@@ -0,0 +1,63 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_URING_H
+#define CONLOG_URING_H
+
+#include "logfile.h"
+
+#define CONLOG_URING_BUFFERS	8
+#define CONLOG_URING_BUFFER		(64 << 10)
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/*
+ * Writes a file through io_uring from buffers registered with the kernel
+ * once. The writer copies into the next free buffer and returns, while
+ * the buffers already filled are submitted together as one linked chain
+ * so they land in order. It only waits when every buffer is in flight.
+ */
+struct conlog_uring
+{
+	int fd;
+	/* the rings shared with the kernel */
+	unsigned char* sq;
+	size_t sqSize;
+	unsigned char* cq;
+	size_t cqSize;
+	struct io_uring_sqe* sqes;
+	size_t sqesSize;
+	unsigned *sqTail, *sqMask, *sqArray;
+	unsigned *cqHead, *cqTail, *cqMask;
+	struct io_uring_cqe* cqes;
+	unsigned char* buffers;
+	size_t len[CONLOG_URING_BUFFERS];
+	int result[CONLOG_URING_BUFFERS];
+	/* from first, the buffers in flight then the ones being filled */
+	unsigned first, inflight, filling, completed;
+	conlog_file file;
+	/* what the channel functions write to */
+	conlog_file channel;
+	/* the kernel refused a call, everything after is a plain write */
+	int bFailed;
+	struct conlog_logfile_queue_stats stats;
+};
+
+/* fails where the kernel has no io_uring or does not allow it */
+int conlog_uring_init(struct conlog_uring* uring, conlog_file channel);
+
+/* the conlog_logfile_queue functions, a new file is only started once the last is drained */
+void conlog_uring_write(void* context, conlog_file file, const struct conlog_iovec* iov, int count);
+void conlog_uring_drain(void* context);
+
+/* a conlog_output_fn and conlog_sync_fn for the channel */
+void conlog_uring_channel_write(void* context, const struct conlog_iovec* iov, int count);
+void conlog_uring_channel_sync(void* context);
+
+/* drains what is left */
+void conlog_uring_close(struct conlog_uring* uring);
+
+#endif
@@ -0,0 +1,495 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef _WIN32
+#	define _FILE_OFFSET_BITS 64
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include "blocklog.h"
+#include "lz.h"
+#include "platform.h"
+
+#ifdef _WIN32
+#	define blocklog_seek(fp, offset) _fseeki64((fp), (long long)(offset), SEEK_SET)
+#	define blocklog_tell(fp) ((unsigned long long)_ftelli64(fp))
+#	define blocklog_seek_end(fp) _fseeki64((fp), 0, SEEK_END)
+#else
+#	define blocklog_seek(fp, offset) fseeko((fp), (off_t)(offset), SEEK_SET)
+#	define blocklog_tell(fp) ((unsigned long long)ftello(fp))
+#	define blocklog_seek_end(fp) fseeko((fp), 0, SEEK_END)
+#endif
+
+#define BLOCKLOG_MAGIC		"CONLOGZ1"
+#define BLOCKLOG_FOOTER		"CONLOGI1"
+#define BLOCKLOG_HEADER		16
+#define BLOCKLOG_BLOCK		8
+#define BLOCKLOG_STORED		0x80000000u
+
+static void blocklog_put32(unsigned char* p, unsigned v)
+{
+	p[0] = (unsigned char)v;
+	p[1] = (unsigned char)(v >> 8);
+	p[2] = (unsigned char)(v >> 16);
+	p[3] = (unsigned char)(v >> 24);
+}
+
+static void blocklog_put64(unsigned char* p, unsigned long long v)
+{
+	blocklog_put32(p, (unsigned)v);
+	blocklog_put32(p + 4, (unsigned)(v >> 32));
+}
+
+static unsigned blocklog_get32(const unsigned char* p)
+{
+	return p[0] | ((unsigned)p[1] << 8) | ((unsigned)p[2] << 16) | ((unsigned)p[3] << 24);
+}
+
+static unsigned long long blocklog_get64(const unsigned char* p)
+{
+	return blocklog_get32(p) | ((unsigned long long)blocklog_get32(p + 4) << 32);
+}
+
+static void blocklog_emit(struct conlog_blocklog* log, const unsigned char* data, size_t len)
+{
+	struct conlog_iovec iov;
+
+	iov.data = data;
+	iov.len = len;
+
+	log->write(log->context, &iov, 1);
+
+	log->file += len;
+	log->stats.bytesOut += len;
+}
+
+/* compresses the block, keeping it as it is when that does not make it smaller */
+static void blocklog_flush(struct conlog_blocklog* log)
+{
+	unsigned long long start = conlog_clock();
+	size_t packed;
+	unsigned header;
+
+	if (!log->blockLen)
+	{
+		return;
+	}
+
+	if (log->count == log->capacity)
+	{
+		size_t capacity = log->capacity ? log->capacity * 2 : 256;
+		struct conlog_blocklog_entry* index = realloc(log->index, sizeof(*index) * capacity);
+
+		if (index)
+		{
+			log->index = index;
+			log->capacity = capacity;
+		}
+	}
+
+	/* without room the block is still written, and the index is not */
+	if (log->count < log->capacity)
+	{
+		log->index[log->count].raw = log->raw;
+		log->index[log->count].file = log->file;
+		log->count++;
+	}
+
+	packed = conlog_lz_compress(log->block, log->blockLen, log->packed + BLOCKLOG_BLOCK, log->blockLen, log->table);
+
+	if (packed)
+	{
+		header = (unsigned)packed;
+	}
+	else
+	{
+		memcpy(log->packed + BLOCKLOG_BLOCK, log->block, log->blockLen);
+		packed = log->blockLen;
+		header = (unsigned)packed | BLOCKLOG_STORED;
+	}
+
+	blocklog_put32(log->packed, header);
+	blocklog_put32(log->packed + 4, (unsigned)log->blockLen);
+
+	log->stats.compressTime += conlog_clock() - start;
+	log->stats.blocks++;
+
+	blocklog_emit(log, log->packed, BLOCKLOG_BLOCK + packed);
+
+	log->raw += log->blockLen;
+	log->blockLen = 0;
+}
+
+int conlog_blocklog_init(struct conlog_blocklog* log, size_t blockSize, conlog_output_fn write, void* context)
+{
+	unsigned char header[BLOCKLOG_HEADER];
+
+	memset(log, 0, sizeof(*log));
+
+	if (!blockSize || (blockSize > CONLOG_BLOCKLOG_MAX))
+	{
+		return -1;
+	}
+
+	log->write = write;
+	log->context = context;
+	log->blockSize = blockSize;
+	log->block = malloc(blockSize);
+	log->packed = malloc(BLOCKLOG_BLOCK + blockSize);
+	log->table = malloc(sizeof(*log->table) * CONLOG_LZ_TABLE);
+
+	if (!(log->block && log->packed && log->table))
+	{
+		free(log->block);
+		free(log->packed);
+		free(log->table);
+
+		return -1;
+	}
+
+	memcpy(header, BLOCKLOG_MAGIC, 8);
+	blocklog_put32(header + 8, (unsigned)blockSize);
+	blocklog_put32(header + 12, 0);
+
+	blocklog_emit(log, header, sizeof(header));
+
+	return 0;
+}
+
+void conlog_blocklog_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	struct conlog_blocklog* log = context;
+
+	while (count--)
+	{
+		const unsigned char* data = iov->data;
+		size_t len = iov->len;
+
+		log->stats.bytesIn += len;
+
+		while (len)
+		{
+			size_t n = log->blockSize - log->blockLen;
+
+			if (n > len)
+			{
+				n = len;
+			}
+
+			memcpy(log->block + log->blockLen, data, n);
+
+			log->blockLen += n;
+			data += n;
+			len -= n;
+
+			if (log->blockLen == log->blockSize)
+			{
+				blocklog_flush(log);
+			}
+		}
+
+		iov++;
+	}
+}
+
+void conlog_blocklog_finish(struct conlog_blocklog* log)
+{
+	unsigned char entry[16], footer[24];
+	unsigned long long indexOffset;
+	size_t i;
+
+	blocklog_flush(log);
+
+	/* an index missing blocks is left out, readers walk the blocks instead */
+	if (log->count == log->stats.blocks)
+	{
+		indexOffset = log->file;
+
+		for (i = 0; i < log->count; i++)
+		{
+			blocklog_put64(entry, log->index[i].raw);
+			blocklog_put64(entry + 8, log->index[i].file);
+
+			blocklog_emit(log, entry, sizeof(entry));
+		}
+
+		blocklog_put64(footer, log->count);
+		blocklog_put64(footer + 8, indexOffset);
+		memcpy(footer + 16, BLOCKLOG_FOOTER, 8);
+
+		blocklog_emit(log, footer, sizeof(footer));
+	}
+
+	free(log->block);
+	free(log->packed);
+	free(log->table);
+	free(log->index);
+
+	log->block = NULL;
+	log->packed = NULL;
+	log->table = NULL;
+	log->index = NULL;
+}
+
+static int blocklog_append(struct conlog_blocklog_reader* reader, size_t* capacity, unsigned long long raw, unsigned long long file)
+{
+	if (reader->count == *capacity)
+	{
+		size_t n = *capacity ? *capacity * 2 : 256;
+		struct conlog_blocklog_entry* index = realloc(reader->index, sizeof(*index) * n);
+
+		if (!index)
+		{
+			return -1;
+		}
+
+		reader->index = index;
+		*capacity = n;
+	}
+
+	reader->index[reader->count].raw = raw;
+	reader->index[reader->count].file = file;
+	reader->count++;
+
+	return 0;
+}
+
+/* reads the index from the footer */
+static int blocklog_load_index(struct conlog_blocklog_reader* reader, unsigned long long fileSize)
+{
+	unsigned char footer[24], entry[16];
+	unsigned long long count, offset;
+	size_t capacity = 0, i;
+
+	if ((fileSize < BLOCKLOG_HEADER + sizeof(footer)) ||
+		blocklog_seek(reader->fp, fileSize - sizeof(footer)) ||
+		(fread(footer, sizeof(footer), 1, reader->fp) != 1) ||
+		memcmp(footer + 16, BLOCKLOG_FOOTER, 8))
+	{
+		return -1;
+	}
+
+	count = blocklog_get64(footer);
+	offset = blocklog_get64(footer + 8);
+
+	if ((offset + count * sizeof(entry) + sizeof(footer) != fileSize) || blocklog_seek(reader->fp, offset))
+	{
+		return -1;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		if ((fread(entry, sizeof(entry), 1, reader->fp) != 1) ||
+			blocklog_append(reader, &capacity, blocklog_get64(entry), blocklog_get64(entry + 8)))
+		{
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* a log without its footer is indexed by walking the block headers */
+static void blocklog_walk(struct conlog_blocklog_reader* reader, unsigned long long fileSize)
+{
+	unsigned long long file = BLOCKLOG_HEADER, raw = 0;
+	size_t capacity = 0;
+
+	reader->count = 0;
+
+	while (file + BLOCKLOG_BLOCK <= fileSize)
+	{
+		unsigned char header[BLOCKLOG_BLOCK];
+		unsigned packed, len;
+
+		if (blocklog_seek(reader->fp, file) || (fread(header, sizeof(header), 1, reader->fp) != 1))
+		{
+			break;
+		}
+
+		packed = blocklog_get32(header) & ~BLOCKLOG_STORED;
+		len = blocklog_get32(header + 4);
+
+		if (!len || (len > reader->blockSize) || (packed > reader->blockSize) || (file + BLOCKLOG_BLOCK + packed > fileSize))
+		{
+			break;
+		}
+
+		if (blocklog_append(reader, &capacity, raw, file))
+		{
+			break;
+		}
+
+		raw += len;
+		file += BLOCKLOG_BLOCK + packed;
+	}
+}
+
+/* the raw length of a block is where the next starts, the last is read from its header */
+static int blocklog_load(struct conlog_blocklog_reader* reader, size_t i)
+{
+	unsigned char header[BLOCKLOG_BLOCK];
+	unsigned packed, len;
+
+	if (reader->cached == i)
+	{
+		return 0;
+	}
+
+	reader->cached = (size_t)-1;
+
+	if (blocklog_seek(reader->fp, reader->index[i].file) || (fread(header, sizeof(header), 1, reader->fp) != 1))
+	{
+		return -1;
+	}
+
+	packed = blocklog_get32(header);
+	len = blocklog_get32(header + 4);
+
+	if ((len > reader->blockSize) || ((packed & ~BLOCKLOG_STORED) > reader->blockSize))
+	{
+		return -1;
+	}
+
+	if (packed & BLOCKLOG_STORED)
+	{
+		packed &= ~BLOCKLOG_STORED;
+
+		if ((packed != len) || (fread(reader->block, 1, len, reader->fp) != len))
+		{
+			return -1;
+		}
+	}
+	else if ((fread(reader->packed, 1, packed, reader->fp) != packed) ||
+		(conlog_lz_decompress(reader->packed, packed, reader->block, len) != (long)len))
+	{
+		return -1;
+	}
+
+	reader->cached = i;
+	reader->cachedLen = len;
+
+	return 0;
+}
+
+int conlog_blocklog_open(struct conlog_blocklog_reader* reader, const char* path)
+{
+	unsigned char header[BLOCKLOG_HEADER];
+	unsigned long long fileSize;
+
+	memset(reader, 0, sizeof(*reader));
+
+	reader->cached = (size_t)-1;
+	reader->fp = conlog_fopen(path, "rb");
+
+	if (!reader->fp)
+	{
+		return -1;
+	}
+
+	if ((fread(header, sizeof(header), 1, reader->fp) != 1) || memcmp(header, BLOCKLOG_MAGIC, 8) ||
+		!(reader->blockSize = blocklog_get32(header + 8)) || (reader->blockSize > CONLOG_BLOCKLOG_MAX) ||
+		blocklog_seek_end(reader->fp))
+	{
+		conlog_blocklog_close(reader);
+
+		return -1;
+	}
+
+	fileSize = blocklog_tell(reader->fp);
+
+	reader->block = malloc(reader->blockSize);
+	reader->packed = malloc(reader->blockSize);
+
+	if (!(reader->block && reader->packed))
+	{
+		conlog_blocklog_close(reader);
+
+		return -1;
+	}
+
+	if (blocklog_load_index(reader, fileSize))
+	{
+		blocklog_walk(reader, fileSize);
+	}
+
+	if (reader->count)
+	{
+		size_t last = reader->count - 1;
+
+		if (blocklog_load(reader, last))
+		{
+			conlog_blocklog_close(reader);
+
+			return -1;
+		}
+
+		reader->size = reader->index[last].raw + reader->cachedLen;
+	}
+
+	return 0;
+}
+
+size_t conlog_blocklog_read(struct conlog_blocklog_reader* reader, unsigned long long offset, unsigned char* data, size_t len)
+{
+	size_t lo = 0, hi = reader->count, done = 0;
+
+	if (offset >= reader->size)
+	{
+		return 0;
+	}
+
+	/* the last block starting at or before offset */
+	while (hi - lo > 1)
+	{
+		size_t mid = (lo + hi) / 2;
+
+		if (reader->index[mid].raw <= offset)
+		{
+			lo = mid;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	while ((done < len) && (lo < reader->count) && !blocklog_load(reader, lo))
+	{
+		size_t skip = (size_t)(offset - reader->index[lo].raw);
+		size_t n = reader->cachedLen - skip;
+
+		if (n > len - done)
+		{
+			n = len - done;
+		}
+
+		memcpy(data + done, reader->block + skip, n);
+
+		done += n;
+		offset += n;
+		lo++;
+	}
+
+	return done;
+}
+
+void conlog_blocklog_close(struct conlog_blocklog_reader* reader)
+{
+	if (reader->fp)
+	{
+		fclose(reader->fp);
+	}
+
+	free(reader->index);
+	free(reader->block);
+	free(reader->packed);
+
+	reader->fp = NULL;
+	reader->index = NULL;
+	reader->block = NULL;
+	reader->packed = NULL;
+}
@@ -0,0 +1,81 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ *
+ * Compressed log made of independently compressed blocks.
+ *
+ *   header   "CONLOGZ1", u32 block size, u32 zero
+ *   block    u32 packed length, top bit set when stored, u32 raw length, data
+ *   index    u64 raw offset, u64 file offset, for each block
+ *   footer   u64 block count, u64 file offset of the index, "CONLOGI1"
+ *
+ * Integers are little endian. A file without its footer, from a session
+ * that did not end cleanly, is read by walking the block headers.
+ */
+
+#ifndef CONLOG_BLOCKLOG_H
+#define CONLOG_BLOCKLOG_H
+
+#include <stdio.h>
+#include "output.h"
+
+#define CONLOG_BLOCKLOG_DEFAULT	(1 << 20)
+#define CONLOG_BLOCKLOG_MAX		(1 << 30)
+
+struct conlog_blocklog_entry
+{
+	unsigned long long raw;
+	unsigned long long file;
+};
+
+struct conlog_blocklog_stats
+{
+	unsigned long long bytesIn;
+	unsigned long long bytesOut;
+	unsigned long long blocks;
+	unsigned long long compressTime;
+};
+
+/* a channel that compresses what it is given and passes the blocks on */
+struct conlog_blocklog
+{
+	conlog_output_fn write;
+	void* context;
+	size_t blockSize, blockLen;
+	unsigned char *block, *packed;
+	unsigned* table;
+	unsigned long long raw, file;
+	struct conlog_blocklog_entry* index;
+	size_t count, capacity;
+	struct conlog_blocklog_stats stats;
+};
+
+/* writes the header */
+int conlog_blocklog_init(struct conlog_blocklog* log, size_t blockSize, conlog_output_fn write, void* context);
+
+/* a conlog_output_fn */
+void conlog_blocklog_write(void* context, const struct conlog_iovec* iov, int count);
+
+/* writes the last block and the index */
+void conlog_blocklog_finish(struct conlog_blocklog* log);
+
+/* random access to a compressed log */
+struct conlog_blocklog_reader
+{
+	FILE* fp;
+	size_t blockSize;
+	struct conlog_blocklog_entry* index;
+	size_t count;
+	unsigned long long size;
+	unsigned char *block, *packed;
+	size_t cached, cachedLen;
+};
+
+int conlog_blocklog_open(struct conlog_blocklog_reader* reader, const char* path);
+
+/* reads from any offset in the uncompressed stream, decompressing only the blocks it covers */
+size_t conlog_blocklog_read(struct conlog_blocklog_reader* reader, unsigned long long offset, unsigned char* data, size_t len);
+
+void conlog_blocklog_close(struct conlog_blocklog_reader* reader);
+
+#endif
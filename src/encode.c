@@ -0,0 +1,386 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ *
+ * Valid UTF-8 going out as UTF-8 is passed on as it is. A sequence that
+ * is not well formed becomes a single U+FFFD for its maximal subpart, as
+ * the WHATWG decoder does.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "encode.h"
+#include "utf8.h"
+
+#define ENCODE_WIDE			(CONLOG_ENCODE_BUFFER / 4)
+
+static void encode_flush_out(struct conlog_encode* encode)
+{
+	if (encode->outLen)
+	{
+		struct conlog_iovec iov;
+
+		iov.data = encode->out;
+		iov.len = encode->outLen;
+
+		encode->write(encode->context, &iov, 1);
+
+		encode->stats.bytesOut += encode->outLen;
+		encode->outLen = 0;
+	}
+}
+
+static void encode_put(struct conlog_encode* encode, const unsigned char* data, size_t len)
+{
+	while (len)
+	{
+		size_t n = CONLOG_ENCODE_BUFFER - encode->outLen;
+
+		if (!n)
+		{
+			encode_flush_out(encode);
+			continue;
+		}
+
+		if (n > len)
+		{
+			n = len;
+		}
+
+		memcpy(encode->out + encode->outLen, data, n);
+		encode->outLen += n;
+		data += n;
+		len -= n;
+	}
+}
+
+/* converts the UTF-16 gathered so far into the output */
+static void encode_flush_wide(struct conlog_encode* encode)
+{
+	if (!encode->wideLen)
+	{
+		return;
+	}
+
+	/* a code page may take four bytes for a character */
+	if (encode->outLen + encode->wideLen * 4 > CONLOG_ENCODE_BUFFER)
+	{
+		encode_flush_out(encode);
+	}
+
+	if (encode->encoding == CONLOG_ENCODING_UTF16)
+	{
+		unsigned char* p = encode->out + encode->outLen;
+		size_t i;
+
+		for (i = 0; i < encode->wideLen; i++)
+		{
+			*p++ = (unsigned char)encode->wide[i];
+			*p++ = (unsigned char)(encode->wide[i] >> 8);
+		}
+
+		encode->outLen = p - encode->out;
+	}
+	else
+	{
+		encode->outLen += conlog_codepage_encode(encode->cp, encode->wide, encode->wideLen, encode->out + encode->outLen, CONLOG_ENCODE_BUFFER - encode->outLen);
+	}
+
+	encode->wideLen = 0;
+}
+
+static void encode_point(struct conlog_encode* encode, unsigned c)
+{
+	if (encode->encoding == CONLOG_ENCODING_UTF8)
+	{
+		unsigned char buf[4];
+		size_t n;
+
+		if (c < 0x80)
+		{
+			buf[0] = (unsigned char)c;
+			n = 1;
+		}
+		else if (c < 0x800)
+		{
+			buf[0] = (unsigned char)(0xC0 | (c >> 6));
+			buf[1] = (unsigned char)(0x80 | (c & 0x3F));
+			n = 2;
+		}
+		else if (c < 0x10000)
+		{
+			buf[0] = (unsigned char)(0xE0 | (c >> 12));
+			buf[1] = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+			buf[2] = (unsigned char)(0x80 | (c & 0x3F));
+			n = 3;
+		}
+		else
+		{
+			buf[0] = (unsigned char)(0xF0 | (c >> 18));
+			buf[1] = (unsigned char)(0x80 | ((c >> 12) & 0x3F));
+			buf[2] = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+			buf[3] = (unsigned char)(0x80 | (c & 0x3F));
+			n = 4;
+		}
+
+		encode_put(encode, buf, n);
+
+		return;
+	}
+
+	if (encode->wideLen + 2 > ENCODE_WIDE)
+	{
+		encode_flush_wide(encode);
+	}
+
+	if (c < 0x10000)
+	{
+		encode->wide[encode->wideLen++] = (unsigned short)c;
+	}
+	else
+	{
+		c -= 0x10000;
+		encode->wide[encode->wideLen++] = (unsigned short)(0xD800 | (c >> 10));
+		encode->wide[encode->wideLen++] = (unsigned short)(0xDC00 | (c & 0x3FF));
+	}
+}
+
+/* ASCII is the same in UTF-16 and every code page that can be asked for */
+static void encode_widen(struct conlog_encode* encode, const unsigned char* data, size_t len)
+{
+	while (len)
+	{
+		size_t n = ENCODE_WIDE - encode->wideLen;
+		unsigned short* p;
+
+		if (!n)
+		{
+			encode_flush_wide(encode);
+			continue;
+		}
+
+		if (n > len)
+		{
+			n = len;
+		}
+
+		p = encode->wide + encode->wideLen;
+		encode->wideLen += n;
+		len -= n;
+
+		while (n--)
+		{
+			*p++ = *data++;
+		}
+	}
+}
+
+/* decodes a run already found to be valid, without checking it again */
+static void encode_widen_valid(struct conlog_encode* encode, const unsigned char* data, size_t len)
+{
+	const unsigned char* end = data + len;
+
+	while (data < end)
+	{
+		unsigned char b = *data;
+
+		if (b < 0x80)
+		{
+			size_t n = conlog_utf8_ascii(data, end - data);
+
+			encode_widen(encode, data, n);
+			data += n;
+		}
+		else if (b < 0xE0)
+		{
+			encode_point(encode, ((b & 0x1F) << 6) | (data[1] & 0x3F));
+			data += 2;
+		}
+		else if (b < 0xF0)
+		{
+			encode_point(encode, ((b & 0x0F) << 12) | ((data[1] & 0x3F) << 6) | (data[2] & 0x3F));
+			data += 3;
+		}
+		else
+		{
+			encode_point(encode, ((b & 0x07) << 18) | ((data[1] & 0x3F) << 12) | ((data[2] & 0x3F) << 6) | (data[3] & 0x3F));
+			data += 4;
+		}
+	}
+}
+
+static void encode_bytes(struct conlog_encode* encode, const unsigned char* data, size_t len)
+{
+	/* the held start of a sequence takes one byte at a time until it is decided */
+	while (encode->pendingLen && len)
+	{
+		unsigned c;
+		size_t n;
+
+		encode->pending[encode->pendingLen++] = *data++;
+		len--;
+
+		n = conlog_utf8_decode(encode->pending, encode->pendingLen, &c);
+
+		if (n)
+		{
+			if (c == CONLOG_UTF8_BAD)
+			{
+				encode->stats.replaced++;
+				c = 0xFFFD;
+			}
+
+			encode_point(encode, c);
+
+			/* only the byte just taken can be left over */
+			data -= encode->pendingLen - n;
+			len += encode->pendingLen - n;
+			encode->pendingLen = 0;
+		}
+	}
+
+	while (len)
+	{
+		unsigned c;
+		size_t n;
+
+		n = conlog_utf8_valid(data, len);
+
+		if (encode->encoding == CONLOG_ENCODING_UTF8)
+		{
+			encode_put(encode, data, n);
+		}
+		else
+		{
+			encode_widen_valid(encode, data, n);
+		}
+
+		data += n;
+		len -= n;
+
+		if (!len)
+		{
+			break;
+		}
+
+		n = conlog_utf8_decode(data, len, &c);
+
+		if (!n)
+		{
+			memcpy(encode->pending, data, len);
+			encode->pendingLen = len;
+			break;
+		}
+
+		if (c == CONLOG_UTF8_BAD)
+		{
+			encode->stats.replaced++;
+			c = 0xFFFD;
+		}
+
+		encode_point(encode, c);
+
+		data += n;
+		len -= n;
+	}
+}
+
+int conlog_encode_init(struct conlog_encode* encode, int encoding, const char* codepage, conlog_output_fn write, void* context)
+{
+	memset(encode, 0, sizeof(*encode));
+
+	encode->write = write;
+	encode->context = context;
+	encode->encoding = encoding;
+
+	if ((encoding == CONLOG_ENCODING_CODEPAGE) && conlog_codepage_open(&encode->cp, codepage))
+	{
+		return -1;
+	}
+
+	encode->out = malloc(CONLOG_ENCODE_BUFFER);
+	encode->wide = (encoding == CONLOG_ENCODING_UTF8) ? NULL : malloc(sizeof(*encode->wide) * ENCODE_WIDE);
+
+	if (!encode->out || ((encoding != CONLOG_ENCODING_UTF8) && !encode->wide))
+	{
+		free(encode->out);
+		free(encode->wide);
+
+		if (encoding == CONLOG_ENCODING_CODEPAGE)
+		{
+			conlog_codepage_close(encode->cp);
+		}
+
+		return -1;
+	}
+
+	return 0;
+}
+
+void conlog_encode_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	struct conlog_encode* encode = context;
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		encode->stats.bytesIn += iov[i].len;
+	}
+
+	/* valid UTF-8 going out as UTF-8 is passed on without a copy */
+	if ((encode->encoding == CONLOG_ENCODING_UTF8) && !encode->pendingLen)
+	{
+		size_t total = 0;
+
+		for (i = 0; i < count; i++)
+		{
+			if (conlog_utf8_valid(iov[i].data, iov[i].len) != iov[i].len)
+			{
+				break;
+			}
+
+			total += iov[i].len;
+		}
+
+		if (i == count)
+		{
+			encode->write(encode->context, iov, count);
+			encode->stats.bytesOut += total;
+
+			return;
+		}
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		encode_bytes(encode, iov[i].data, iov[i].len);
+	}
+
+	encode_flush_wide(encode);
+	encode_flush_out(encode);
+}
+
+void conlog_encode_finish(struct conlog_encode* encode)
+{
+	if (encode->pendingLen)
+	{
+		encode->stats.replaced++;
+		encode->pendingLen = 0;
+
+		encode_point(encode, 0xFFFD);
+	}
+
+	encode_flush_wide(encode);
+	encode_flush_out(encode);
+
+	if (encode->encoding == CONLOG_ENCODING_CODEPAGE)
+	{
+		conlog_codepage_close(encode->cp);
+	}
+
+	free(encode->out);
+	free(encode->wide);
+
+	encode->out = NULL;
+	encode->wide = NULL;
+}
@@ -0,0 +1,57 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_ENCODE_H
+#define CONLOG_ENCODE_H
+
+#include "output.h"
+#include "platform.h"
+
+/* what a log channel is written in */
+#define CONLOG_ENCODING_RAW			0
+#define CONLOG_ENCODING_UTF8		1
+#define CONLOG_ENCODING_UTF16		2
+#define CONLOG_ENCODING_CODEPAGE	3
+
+#define CONLOG_ENCODE_BUFFER	(64 << 10)
+
+struct conlog_encode_stats
+{
+	unsigned long long bytesIn;
+	unsigned long long bytesOut;
+	/* invalid UTF-8, each maximal bad part counts once */
+	unsigned long long replaced;
+};
+
+/*
+ * A channel that takes UTF-8 and writes it valid, with U+FFFD for what is
+ * not, or as UTF-16LE or in a legacy code page. A sequence split between
+ * writes is held until the rest arrives.
+ */
+struct conlog_encode
+{
+	conlog_output_fn write;
+	void* context;
+	int encoding;
+	conlog_codepage cp;
+	unsigned char pending[4];
+	size_t pendingLen;
+	unsigned char* out;
+	size_t outLen;
+	unsigned short* wide;
+	size_t wideLen;
+	struct conlog_encode_stats stats;
+};
+
+/* codepage is only used for CONLOG_ENCODING_CODEPAGE */
+int conlog_encode_init(struct conlog_encode* encode, int encoding, const char* codepage, conlog_output_fn write, void* context);
+
+/* a conlog_output_fn */
+void conlog_encode_write(void* context, const struct conlog_iovec* iov, int count);
+
+/* replaces a sequence left incomplete */
+void conlog_encode_finish(struct conlog_encode* encode);
+
+#endif
@@ -0,0 +1,283 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <string.h>
+#include "escscan.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#	define CONLOG_ESCSCAN_X86
+#	ifdef _MSC_VER
+#		include <intrin.h>
+#		define CONLOG_TARGET_AVX2
+#	else
+#		include <cpuid.h>
+#		define CONLOG_TARGET_AVX2 __attribute__((target("avx2")))
+#	endif
+#	include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#	include <intrin.h>
+#endif
+
+/* where the lowest flag of a word marks its first byte */
+#if defined(_MSC_VER) || (defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__))
+#	define CONLOG_ESCSCAN_LE
+#endif
+
+#define ESC 27
+
+static size_t escscan_tail(const unsigned char* data, size_t i, size_t len)
+{
+	while (i < len)
+	{
+		if (data[i] == ESC)
+		{
+			return i;
+		}
+
+		i++;
+	}
+
+	return len;
+}
+
+#ifdef CONLOG_ESCSCAN_LE
+/* a borrow only carries upwards, so the lowest flag is the first ESC even when higher ones are false */
+static size_t escscan_first(size_t flags)
+{
+#	ifdef _MSC_VER
+	unsigned long index;
+#		if defined(_M_X64) || defined(_M_ARM64)
+	_BitScanForward64(&index, flags);
+#		else
+	_BitScanForward(&index, flags);
+#		endif
+	return index >> 3;
+#	else
+	return (size_t)__builtin_ctzll(flags) >> 3;
+#	endif
+}
+#endif
+
+/* a word at a time, unaligned loads through memcpy, so an ESC a few bytes in costs no more than the bytewise loop */
+static size_t escscan_scalar(const unsigned char* data, size_t len)
+{
+	const size_t ones = ((size_t)-1) / 0xFF;
+	const size_t highs = ones * 0x80;
+	const size_t pattern = ones * ESC;
+	size_t i = 0;
+
+	while (i + sizeof(size_t) <= len)
+	{
+		size_t w;
+
+		memcpy(&w, data + i, sizeof(w));
+
+		w ^= pattern;
+		w = (w - ones) & ~w & highs;
+
+		if (w)
+		{
+#ifdef CONLOG_ESCSCAN_LE
+			return i + escscan_first(w);
+#else
+			break;
+#endif
+		}
+
+		i += sizeof(w);
+	}
+
+	return escscan_tail(data, i, len);
+}
+
+#ifdef CONLOG_ESCSCAN_X86
+static unsigned escscan_ctz(unsigned mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+static size_t escscan_sse2(const unsigned char* data, size_t len)
+{
+	const __m128i esc = _mm_set1_epi8(ESC);
+	size_t i = 0;
+
+	while (i + 64 <= len)
+	{
+		__m128i a = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i)), esc);
+		__m128i b = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i + 16)), esc);
+		__m128i c = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i + 32)), esc);
+		__m128i d = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i + 48)), esc);
+
+		if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d))))
+		{
+			break;
+		}
+
+		i += 64;
+	}
+
+	while (i + 16 <= len)
+	{
+		unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i)), esc));
+
+		if (mask)
+		{
+			return i + escscan_ctz(mask);
+		}
+
+		i += 16;
+	}
+
+	return escscan_tail(data, i, len);
+}
+
+static CONLOG_TARGET_AVX2 size_t escscan_avx2(const unsigned char* data, size_t len)
+{
+	const __m256i esc = _mm256_set1_epi8(ESC);
+	size_t i = 0;
+
+	while (i + 64 <= len)
+	{
+		__m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + i)), esc);
+		__m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + i + 32)), esc);
+
+		if (_mm256_movemask_epi8(_mm256_or_si256(a, b)))
+		{
+			break;
+		}
+
+		i += 64;
+	}
+
+	while (i + 32 <= len)
+	{
+		unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + i)), esc));
+
+		if (mask)
+		{
+			return i + escscan_ctz(mask);
+		}
+
+		i += 32;
+	}
+
+	return escscan_sse2(data + i, len - i) + i;
+}
+
+static int escscan_has_sse2(void)
+{
+#if defined(_M_X64) || defined(__x86_64__)
+	return 1;
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	return (info[3] >> 26) & 1;
+#else
+	unsigned a, b, c, d;
+	return __get_cpuid(1, &a, &b, &c, &d) && ((d >> 26) & 1);
+#endif
+}
+
+static int escscan_has_avx2(void)
+{
+#ifdef _MSC_VER
+	int info[4];
+
+	__cpuid(info, 0);
+
+	if (info[0] < 7)
+	{
+		return 0;
+	}
+
+	__cpuid(info, 1);
+
+	/* OSXSAVE and AVX, then confirm the OS preserves YMM state */
+	if ((info[2] & 0x18000000) != 0x18000000)
+	{
+		return 0;
+	}
+
+	if ((_xgetbv(0) & 6) != 6)
+	{
+		return 0;
+	}
+
+	__cpuidex(info, 7, 0);
+
+	return (info[1] >> 5) & 1;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+static struct conlog_escscan_variant escscan_variants[3];
+static int escscan_count;
+
+static void escscan_init(void)
+{
+	int count = 0;
+
+#ifdef CONLOG_ESCSCAN_X86
+	if (escscan_has_avx2())
+	{
+		escscan_variants[count].name = "avx2";
+		escscan_variants[count++].scan = escscan_avx2;
+	}
+
+	if (escscan_has_sse2())
+	{
+		escscan_variants[count].name = "sse2";
+		escscan_variants[count++].scan = escscan_sse2;
+	}
+#endif
+
+	escscan_variants[count].name = "scalar";
+	escscan_variants[count++].scan = escscan_scalar;
+
+	escscan_count = count;
+}
+
+/* written only by conlog_escscan_init, before any thread scans */
+static conlog_escscan_fn escscan_impl = escscan_scalar;
+
+void conlog_escscan_init(void)
+{
+	if (!escscan_count)
+	{
+		escscan_init();
+
+		escscan_impl = escscan_variants[0].scan;
+	}
+}
+
+size_t conlog_escscan(const unsigned char* data, size_t len)
+{
+	return escscan_impl(data, len);
+}
+
+const char* conlog_escscan_name(void)
+{
+	conlog_escscan_init();
+
+	return escscan_variants[0].name;
+}
+
+const struct conlog_escscan_variant* conlog_escscan_variant(int index)
+{
+	conlog_escscan_init();
+
+	return ((index >= 0) && (index < escscan_count)) ? escscan_variants + index : NULL;
+}
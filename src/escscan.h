@@ -0,0 +1,31 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_ESCSCAN_H
+#define CONLOG_ESCSCAN_H
+
+#include <stddef.h>
+
+typedef size_t (*conlog_escscan_fn)(const unsigned char* data, size_t len);
+
+struct conlog_escscan_variant
+{
+	const char* name;
+	conlog_escscan_fn scan;
+};
+
+/* chooses the variant for this processor, once before any thread scans, until then the scalar one is used */
+void conlog_escscan_init(void);
+
+/* returns the offset of the first ESC in data, or len if there is none */
+size_t conlog_escscan(const unsigned char* data, size_t len);
+
+/* name of the variant chosen for this processor */
+const char* conlog_escscan_name(void);
+
+/* enumerates the variants usable on this processor, NULL past the end */
+const struct conlog_escscan_variant* conlog_escscan_variant(int index);
+
+#endif
@@ -0,0 +1,157 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "flight.h"
+
+int conlog_flight_init(struct conlog_flight* flight, size_t size, conlog_output_fn write, void* context)
+{
+	memset(flight, 0, sizeof(*flight));
+
+	flight->ring = malloc(size);
+
+	if (!flight->ring)
+	{
+		return -1;
+	}
+
+	/* touched now so keeping output never waits on the page allocator */
+	memset(flight->ring, 0, size);
+
+	flight->write = write;
+	flight->context = context;
+	flight->size = size;
+
+	conlog_mutex_init(&flight->mutex);
+
+	return 0;
+}
+
+void conlog_flight_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	struct conlog_flight* flight = context;
+	int i;
+
+	conlog_mutex_lock(&flight->mutex);
+
+	for (i = 0; i < count; i++)
+	{
+		const unsigned char* data = iov[i].data;
+		size_t len = iov[i].len;
+
+		flight->stats.bytesIn += len;
+
+		/* only the last size bytes can survive */
+		if (len > flight->size)
+		{
+			flight->lost += len - flight->size;
+			data += len - flight->size;
+			len = flight->size;
+		}
+
+		if (flight->len + len > flight->size)
+		{
+			flight->lost += flight->len + len - flight->size;
+			flight->len = flight->size - len;
+		}
+
+		while (len)
+		{
+			size_t n = flight->size - flight->head;
+
+			if (n > len)
+			{
+				n = len;
+			}
+
+			memcpy(flight->ring + flight->head, data, n);
+
+			flight->head = (flight->head + n) % flight->size;
+			flight->len += n;
+			data += n;
+			len -= n;
+		}
+	}
+
+	conlog_mutex_unlock(&flight->mutex);
+}
+
+void conlog_flight_dump(struct conlog_flight* flight)
+{
+	conlog_mutex_lock(&flight->mutex);
+
+	if (flight->len)
+	{
+		struct conlog_iovec iov[3];
+		size_t start = (flight->head + flight->size - flight->len) % flight->size;
+		size_t len = flight->len;
+		char marker[80];
+		int count = 0, i;
+
+		if (flight->lost)
+		{
+			size_t skip = 0;
+
+			/* starts at a whole line when there is one */
+			while ((skip < len) && (flight->ring[(start + skip) % flight->size] != '\n'))
+			{
+				skip++;
+			}
+
+			if (skip < len - 1)
+			{
+				skip++;
+				start = (start + skip) % flight->size;
+				len -= skip;
+				flight->lost += skip;
+			}
+
+			iov[count].data = (const unsigned char*)marker;
+			iov[count++].len = snprintf(marker, sizeof(marker), "[conlog: %llu bytes before this were not kept]\r\n", flight->lost);
+		}
+
+		iov[count].data = flight->ring + start;
+
+		if (start + len > flight->size)
+		{
+			iov[count++].len = flight->size - start;
+			iov[count].data = flight->ring;
+			iov[count++].len = start + len - flight->size;
+		}
+		else
+		{
+			iov[count++].len = len;
+		}
+
+		flight->write(flight->context, iov, count);
+
+		for (i = 0; i < count; i++)
+		{
+			flight->stats.bytesOut += iov[i].len;
+		}
+
+		flight->stats.dumps++;
+		flight->stats.bytesLost += flight->lost;
+		flight->len = 0;
+		flight->lost = 0;
+	}
+
+	conlog_mutex_unlock(&flight->mutex);
+}
+
+void conlog_flight_finish(struct conlog_flight* flight, int bDump)
+{
+	if (bDump)
+	{
+		conlog_flight_dump(flight);
+	}
+
+	conlog_mutex_destroy(&flight->mutex);
+
+	free(flight->ring);
+	flight->ring = NULL;
+}
@@ -0,0 +1,53 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_FLIGHT_H
+#define CONLOG_FLIGHT_H
+
+#include "output.h"
+#include "platform.h"
+
+#define CONLOG_FLIGHT_MAX	((size_t)1 << 30)
+
+struct conlog_flight_stats
+{
+	unsigned long long bytesIn;
+	unsigned long long dumps;
+	unsigned long long bytesOut;
+	/* pushed out of the ring before a dump could write them */
+	unsigned long long bytesLost;
+};
+
+/*
+ * Keeps the most recent output in a ring allocated up front rather than
+ * writing it, and writes what the ring holds only when asked, such as
+ * when the child fails. A dump can be asked for from any thread.
+ */
+struct conlog_flight
+{
+	conlog_output_fn write;
+	void* context;
+	unsigned char* ring;
+	size_t size;
+	/* where the next byte goes and how many the ring holds */
+	size_t head, len;
+	/* overwritten since the last dump */
+	unsigned long long lost;
+	conlog_mutex mutex;
+	struct conlog_flight_stats stats;
+};
+
+int conlog_flight_init(struct conlog_flight* flight, size_t size, conlog_output_fn write, void* context);
+
+/* a conlog_output_fn */
+void conlog_flight_write(void* context, const struct conlog_iovec* iov, int count);
+
+/* writes what is held and empties the ring, the first line is dropped if it was cut */
+void conlog_flight_dump(struct conlog_flight* flight);
+
+/* dumps what is left if bDump, otherwise it is discarded */
+void conlog_flight_finish(struct conlog_flight* flight, int bDump);
+
+#endif
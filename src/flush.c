@@ -0,0 +1,265 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "flush.h"
+#include "trace.h"
+
+static void flush_out(struct conlog_flush* flush, const struct conlog_iovec* iov, int count)
+{
+	int i;
+
+	flush->write(flush->context, iov, count);
+	flush->stats.writes++;
+	flush->bDirty = 1;
+
+	for (i = 0; i < count; i++)
+	{
+		flush->stats.bytesOut += iov[i].len;
+	}
+}
+
+/* writes the first len bytes held */
+static void flush_held(struct conlog_flush* flush, size_t len)
+{
+	if (len)
+	{
+		struct conlog_iovec iov;
+
+		iov.data = flush->buffer;
+		iov.len = len;
+
+		flush_out(flush, &iov, 1);
+
+		memmove(flush->buffer, flush->buffer + len, flush->len - len);
+		flush->len -= len;
+	}
+}
+
+static void flush_sync(struct conlog_flush* flush)
+{
+	if (flush->sync && flush->bDirty)
+	{
+		flush->sync(flush->context);
+		flush->stats.syncs++;
+		flush->bDirty = 0;
+	}
+
+	flush->synced = conlog_clock();
+}
+
+static void flush_main(void* arg)
+{
+	struct conlog_flush* flush = arg;
+
+	CONLOG_TRACE_THREAD("log flush");
+
+	conlog_mutex_lock(&flush->mutex);
+
+	while (!flush->stopping)
+	{
+		unsigned long long now = conlog_clock(), due = 0;
+
+		if ((flush->policy == CONLOG_FLUSH_TIME) && flush->len)
+		{
+			if (now - flush->held >= flush->delay)
+			{
+				flush_held(flush, flush->len);
+				continue;
+			}
+
+			due = flush->held + flush->delay;
+		}
+
+		/* a sync first writes out whatever is held */
+		if (flush->syncPolicy == CONLOG_SYNC_PERIODIC)
+		{
+			if (now - flush->synced >= flush->syncInterval)
+			{
+				flush_held(flush, flush->len);
+				flush_sync(flush);
+				continue;
+			}
+
+			if (!due || (flush->synced + flush->syncInterval < due))
+			{
+				due = flush->synced + flush->syncInterval;
+			}
+		}
+
+		if (due)
+		{
+			conlog_cond_timedwait(&flush->wake, &flush->mutex, (unsigned)((due - now + 999999) / 1000000));
+		}
+		else
+		{
+			conlog_cond_wait(&flush->wake, &flush->mutex);
+		}
+	}
+
+	conlog_mutex_unlock(&flush->mutex);
+}
+
+int conlog_flush_init(struct conlog_flush* flush, int policy, size_t size, unsigned ms, int syncPolicy, unsigned syncSeconds, conlog_output_fn write, conlog_sync_fn sync, void* context)
+{
+	memset(flush, 0, sizeof(*flush));
+
+	flush->write = write;
+	flush->sync = sync;
+	flush->context = context;
+	flush->policy = policy;
+	flush->syncPolicy = syncPolicy;
+	flush->delay = ms * 1000000ULL;
+	flush->syncInterval = syncSeconds * 1000000000ULL;
+	flush->synced = conlog_clock();
+
+	if (policy != CONLOG_FLUSH_NOW)
+	{
+		flush->size = (policy == CONLOG_FLUSH_SIZE) ? size : CONLOG_FLUSH_BUFFER;
+		flush->buffer = malloc(flush->size);
+
+		if (!flush->buffer)
+		{
+			return -1;
+		}
+	}
+
+	if ((policy == CONLOG_FLUSH_TIME) || (syncPolicy == CONLOG_SYNC_PERIODIC))
+	{
+		conlog_mutex_init(&flush->mutex);
+		conlog_cond_init(&flush->wake);
+
+		if (conlog_thread_start(&flush->thread, flush_main, flush))
+		{
+			conlog_cond_destroy(&flush->wake);
+			conlog_mutex_destroy(&flush->mutex);
+			free(flush->buffer);
+
+			return -1;
+		}
+
+		flush->bThread = 1;
+	}
+
+	return 0;
+}
+
+void conlog_flush_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	struct conlog_flush* flush = context;
+	int bEmpty, i;
+	size_t added = 0;
+
+	if (flush->bThread)
+	{
+		conlog_mutex_lock(&flush->mutex);
+	}
+
+	if (flush->policy == CONLOG_FLUSH_NOW)
+	{
+		flush_out(flush, iov, count);
+	}
+	else
+	{
+		bEmpty = !flush->len;
+
+		for (i = 0; i < count; i++)
+		{
+			const unsigned char* data = iov[i].data;
+			size_t len = iov[i].len;
+
+			while (len)
+			{
+				size_t n = flush->size - flush->len;
+
+				/* as much as the buffer holds goes straight out */
+				if (!flush->len && (len >= flush->size))
+				{
+					struct conlog_iovec direct;
+
+					direct.data = data;
+					direct.len = len;
+
+					flush_out(flush, &direct, 1);
+					added = 0;
+					break;
+				}
+
+				if (n > len)
+				{
+					n = len;
+				}
+
+				memcpy(flush->buffer + flush->len, data, n);
+				flush->len += n;
+				added += n;
+				data += n;
+				len -= n;
+
+				if (flush->len == flush->size)
+				{
+					flush_held(flush, flush->len);
+					added = 0;
+				}
+			}
+		}
+
+		/* what was held before had no newline, so only what was added is searched */
+		if ((flush->policy == CONLOG_FLUSH_LINE) && added)
+		{
+			size_t end = flush->len;
+
+			while ((end > flush->len - added) && (flush->buffer[end - 1] != '\n'))
+			{
+				end--;
+			}
+
+			if (end > flush->len - added)
+			{
+				flush_held(flush, end);
+			}
+		}
+
+		if ((flush->policy == CONLOG_FLUSH_TIME) && bEmpty && flush->len)
+		{
+			flush->held = conlog_clock();
+			conlog_cond_signal(&flush->wake);
+		}
+	}
+
+	if (flush->bThread)
+	{
+		conlog_mutex_unlock(&flush->mutex);
+	}
+}
+
+void conlog_flush_finish(struct conlog_flush* flush)
+{
+	if (flush->bThread)
+	{
+		conlog_mutex_lock(&flush->mutex);
+		conlog_atomic_store(&flush->stopping, 1);
+		conlog_cond_signal(&flush->wake);
+		conlog_mutex_unlock(&flush->mutex);
+
+		conlog_thread_join(&flush->thread);
+
+		conlog_cond_destroy(&flush->wake);
+		conlog_mutex_destroy(&flush->mutex);
+
+		flush->bThread = 0;
+	}
+
+	flush_held(flush, flush->len);
+
+	if (flush->syncPolicy != CONLOG_SYNC_NONE)
+	{
+		flush_sync(flush);
+	}
+
+	free(flush->buffer);
+	flush->buffer = NULL;
+}
@@ -0,0 +1,71 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_FLUSH_H
+#define CONLOG_FLUSH_H
+
+#include "output.h"
+#include "platform.h"
+
+/* when what is held is written */
+#define CONLOG_FLUSH_NOW	0
+#define CONLOG_FLUSH_LINE	1
+#define CONLOG_FLUSH_SIZE	2
+#define CONLOG_FLUSH_TIME	3
+
+/* when what is written is made durable */
+#define CONLOG_SYNC_NONE		0
+#define CONLOG_SYNC_EXIT		1
+#define CONLOG_SYNC_PERIODIC	2
+
+/* what line and time flushing hold at most */
+#define CONLOG_FLUSH_BUFFER		(64 << 10)
+#define CONLOG_FLUSH_MAX		(64 << 20)
+#define CONLOG_FLUSH_TIME_MAX	60000
+
+struct conlog_flush_stats
+{
+	/* calls to the file, each one system call */
+	unsigned long long writes;
+	unsigned long long bytesOut;
+	unsigned long long syncs;
+};
+
+/*
+ * Gathers a file channel's small writes into fewer large ones. The file
+ * is only written under the mutex, so a timed flush or sync from the
+ * flush thread never meets a write or a rotation half done.
+ */
+struct conlog_flush
+{
+	conlog_output_fn write;
+	conlog_sync_fn sync;
+	void* context;
+	int policy;
+	int syncPolicy;
+	unsigned char* buffer;
+	size_t len, size;
+	/* nanoseconds, and when the oldest byte held arrived and the last sync */
+	unsigned long long delay, syncInterval;
+	unsigned long long held, synced;
+	int bDirty;
+	int bThread;
+	struct conlog_thread thread;
+	conlog_mutex mutex;
+	conlog_cond wake;
+	size_t stopping;
+	struct conlog_flush_stats stats;
+};
+
+/* size is the threshold for CONLOG_FLUSH_SIZE, ms the delay for CONLOG_FLUSH_TIME, syncSeconds the period for CONLOG_SYNC_PERIODIC */
+int conlog_flush_init(struct conlog_flush* flush, int policy, size_t size, unsigned ms, int syncPolicy, unsigned syncSeconds, conlog_output_fn write, conlog_sync_fn sync, void* context);
+
+/* a conlog_output_fn */
+void conlog_flush_write(void* context, const struct conlog_iovec* iov, int count);
+
+/* writes what is held, syncs if asked to and stops the flush thread */
+void conlog_flush_finish(struct conlog_flush* flush);
+
+#endif
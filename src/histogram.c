@@ -0,0 +1,100 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifdef _MSC_VER
+#	include <intrin.h>
+#endif
+#include "histogram.h"
+
+static int histogram_bucket(unsigned long long value)
+{
+	int n;
+
+	if (!value)
+	{
+		return 0;
+	}
+
+#ifdef _MSC_VER
+	{
+		unsigned long index;
+
+		/* in halves, which 32 bit targets have as well */
+		if (value >> 32)
+		{
+			_BitScanReverse(&index, (unsigned long)(value >> 32));
+			n = (int)index + 33;
+		}
+		else
+		{
+			_BitScanReverse(&index, (unsigned long)value);
+			n = (int)index + 1;
+		}
+	}
+#else
+	n = 64 - __builtin_clzll(value);
+#endif
+
+	return (n < CONLOG_HISTOGRAM_BUCKETS) ? n : CONLOG_HISTOGRAM_BUCKETS - 1;
+}
+
+void conlog_histogram_add(struct conlog_histogram* histogram, unsigned long long value)
+{
+	histogram->count++;
+	histogram->total += value;
+	histogram->buckets[histogram_bucket(value)]++;
+
+	if (value > histogram->max)
+	{
+		histogram->max = value;
+	}
+}
+
+void conlog_histogram_merge(struct conlog_histogram* histogram, const struct conlog_histogram* from)
+{
+	int i;
+
+	histogram->count += from->count;
+	histogram->total += from->total;
+
+	if (from->max > histogram->max)
+	{
+		histogram->max = from->max;
+	}
+
+	for (i = 0; i < CONLOG_HISTOGRAM_BUCKETS; i++)
+	{
+		histogram->buckets[i] += from->buckets[i];
+	}
+}
+
+unsigned long long conlog_histogram_percentile(const struct conlog_histogram* histogram, unsigned percent)
+{
+	unsigned long long rank = (histogram->count * percent + 99) / 100, seen = 0;
+	int i;
+
+	if (!rank)
+	{
+		return 0;
+	}
+
+	for (i = 0; i < CONLOG_HISTOGRAM_BUCKETS; i++)
+	{
+		unsigned long long n = histogram->buckets[i];
+
+		if (seen + n >= rank)
+		{
+			double low = i ? (double)(1ULL << (i - 1)) : 0;
+			double high = (i == CONLOG_HISTOGRAM_BUCKETS - 1) ? (double)histogram->max : i ? (double)((1ULL << i) - 1) : 0;
+			unsigned long long value = (unsigned long long)(low + (high - low) * (rank - seen) / n);
+
+			return (value < histogram->max) ? value : histogram->max;
+		}
+
+		seen += n;
+	}
+
+	return histogram->max;
+}
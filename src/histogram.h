@@ -0,0 +1,30 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_HISTOGRAM_H
+#define CONLOG_HISTOGRAM_H
+
+#define CONLOG_HISTOGRAM_BUCKETS	48
+
+/*
+ * Values counted by powers of two, bucket 0 holds zero and bucket n holds
+ * 2^(n-1) up to 2^n - 1, so adding one is a bit scan and an increment.
+ * Kept by one thread, another may read it while it changes.
+ */
+struct conlog_histogram
+{
+	unsigned long long count;
+	unsigned long long total;
+	unsigned long long max;
+	unsigned long long buckets[CONLOG_HISTOGRAM_BUCKETS];
+};
+
+void conlog_histogram_add(struct conlog_histogram* histogram, unsigned long long value);
+void conlog_histogram_merge(struct conlog_histogram* histogram, const struct conlog_histogram* from);
+
+/* the value percent of those added are at or below, placed linearly within its bucket */
+unsigned long long conlog_histogram_percentile(const struct conlog_histogram* histogram, unsigned percent);
+
+#endif
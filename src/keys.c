@@ -0,0 +1,225 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <string.h>
+#include "keys.h"
+
+/* the parameter sent only when a modifier is held, and SS3 rather than CSI without one */
+#define KEYS_MODIFIED	1
+#define KEYS_SS3		2
+
+struct keys_entry
+{
+	unsigned short vk;
+	unsigned char param;
+	unsigned char flags;
+	char final;
+};
+
+static const struct keys_entry keys_table[] =
+{
+	{ CONLOG_KEY_ESCAPE, 0, 0, 'P' },
+	{ CONLOG_KEY_UP, 1, KEYS_MODIFIED, 'A' },
+	{ CONLOG_KEY_DOWN, 1, KEYS_MODIFIED, 'B' },
+	{ CONLOG_KEY_RIGHT, 1, KEYS_MODIFIED, 'C' },
+	{ CONLOG_KEY_LEFT, 1, KEYS_MODIFIED, 'D' },
+	{ CONLOG_KEY_CLEAR, 1, KEYS_MODIFIED, 'E' },
+	{ CONLOG_KEY_F1, 1, KEYS_MODIFIED | KEYS_SS3, 'P' },
+	{ CONLOG_KEY_F1 + 1, 1, KEYS_MODIFIED | KEYS_SS3, 'Q' },
+	{ CONLOG_KEY_F1 + 2, 1, KEYS_MODIFIED | KEYS_SS3, 'R' },
+	{ CONLOG_KEY_F1 + 3, 1, KEYS_MODIFIED | KEYS_SS3, 'S' },
+	{ CONLOG_KEY_HOME, 1, 0, '~' },
+	{ CONLOG_KEY_INSERT, 2, 0, '~' },
+	{ CONLOG_KEY_DELETE, 3, 0, '~' },
+	{ CONLOG_KEY_END, 4, 0, '~' },
+	{ CONLOG_KEY_PRIOR, 5, 0, '~' },
+	{ CONLOG_KEY_NEXT, 6, 0, '~' },
+	{ CONLOG_KEY_F1 + 4, 15, 0, '~' },
+	{ CONLOG_KEY_F1 + 5, 17, 0, '~' },
+	{ CONLOG_KEY_F1 + 6, 18, 0, '~' },
+	{ CONLOG_KEY_F1 + 7, 19, 0, '~' },
+	{ CONLOG_KEY_F1 + 8, 20, 0, '~' },
+	{ CONLOG_KEY_F1 + 9, 21, 0, '~' },
+	{ CONLOG_KEY_F1 + 10, 23, 0, '~' },
+	{ CONLOG_KEY_F12, 24, 0, '~' }
+};
+
+/* the xterm modifier parameter for shift, alt and ctrl, alt alone is left to the console */
+static const unsigned char keys_modifier[8] = { 0, 2, 0, 4, 5, 6, 7, 8 };
+
+static const char keys_paste_start[] = "\033[200~";
+static const char keys_paste_end[] = "\033[201~";
+
+void conlog_keys_init(struct conlog_keys* keys)
+{
+	memset(keys, 0, sizeof(*keys));
+}
+
+static void keys_append(struct conlog_keys* keys, const char* data, size_t len)
+{
+	memcpy(keys->buf + keys->len, data, len);
+	keys->len += len;
+}
+
+static void keys_number(struct conlog_keys* keys, unsigned n)
+{
+	if (n >= 10)
+	{
+		keys->buf[keys->len++] = (unsigned char)('0' + n / 10);
+	}
+
+	keys->buf[keys->len++] = (unsigned char)('0' + n % 10);
+}
+
+static void keys_utf8(struct conlog_keys* keys, unsigned c)
+{
+	unsigned char* p = keys->buf + keys->len;
+
+	if (c < 0x80)
+	{
+		*p++ = (unsigned char)c;
+	}
+	else if (c < 0x800)
+	{
+		*p++ = (unsigned char)(0xC0 | (c >> 6));
+		*p++ = (unsigned char)(0x80 | (c & 0x3F));
+	}
+	else if (c < 0x10000)
+	{
+		*p++ = (unsigned char)(0xE0 | (c >> 12));
+		*p++ = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+		*p++ = (unsigned char)(0x80 | (c & 0x3F));
+	}
+	else
+	{
+		*p++ = (unsigned char)(0xF0 | (c >> 18));
+		*p++ = (unsigned char)(0x80 | ((c >> 12) & 0x3F));
+		*p++ = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+		*p++ = (unsigned char)(0x80 | (c & 0x3F));
+	}
+
+	keys->len = p - keys->buf;
+}
+
+/* a surrogate without its other half becomes U+FFFD */
+static void keys_char(struct conlog_keys* keys, const struct conlog_key* key)
+{
+	unsigned c = key->ch;
+
+	if (keys->high)
+	{
+		if ((c >= 0xDC00) && (c < 0xE000))
+		{
+			keys_utf8(keys, 0x10000 + ((keys->high - 0xD800) << 10) + (c - 0xDC00));
+			keys->high = 0;
+			return;
+		}
+
+		keys_utf8(keys, 0xFFFD);
+		keys->high = 0;
+	}
+
+	if ((c >= 0xD800) && (c < 0xDC00))
+	{
+		keys->high = (unsigned short)c;
+	}
+	else if ((c >= 0xDC00) && (c < 0xE000))
+	{
+		keys_utf8(keys, 0xFFFD);
+	}
+	else if ((c == ' ') && (key->modifiers & CONLOG_KEY_CTRL))
+	{
+		keys->buf[keys->len++] = 0;
+	}
+	else if ((c == 0x1B) && keys->bPasting)
+	{
+		/* so a paste cannot end itself early */
+	}
+	else
+	{
+		keys_utf8(keys, c);
+	}
+}
+
+static void keys_sequence(struct conlog_keys* keys, const struct conlog_key* key)
+{
+	const struct keys_entry* entry = keys_table;
+	const struct keys_entry* end = keys_table + sizeof(keys_table) / sizeof(keys_table[0]);
+	unsigned m = keys_modifier[key->modifiers & 7];
+
+	while ((entry < end) && (entry->vk != key->vk))
+	{
+		entry++;
+	}
+
+	if (entry == end)
+	{
+		return;
+	}
+
+	keys->buf[keys->len++] = 0x1B;
+	keys->buf[keys->len++] = ((entry->flags & KEYS_SS3) && !m) ? 'O' : '[';
+
+	if (entry->param && (m || !(entry->flags & KEYS_MODIFIED)))
+	{
+		keys_number(keys, entry->param);
+
+		if (m)
+		{
+			keys->buf[keys->len++] = ';';
+			keys_number(keys, m);
+		}
+	}
+
+	keys->buf[keys->len++] = entry->final;
+}
+
+void conlog_keys_encode(struct conlog_keys* keys, const struct conlog_key* key, int count, int bMore)
+{
+	int chars = 0, i;
+
+	keys->len = 0;
+
+	for (i = 0; i < count; i++)
+	{
+		if (!key[i].ch)
+		{
+			break;
+		}
+
+		chars++;
+	}
+
+	/* more characters in one wake than anyone types, and nothing else */
+	if (keys->bBracketed && !keys->bPasting && (chars == count) && (chars >= CONLOG_KEYS_PASTE))
+	{
+		keys_append(keys, keys_paste_start, sizeof(keys_paste_start) - 1);
+		keys->bPasting = 1;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		if (key[i].ch)
+		{
+			keys_char(keys, key + i);
+		}
+		else
+		{
+			if (keys->bPasting)
+			{
+				keys_append(keys, keys_paste_end, sizeof(keys_paste_end) - 1);
+				keys->bPasting = 0;
+			}
+
+			keys_sequence(keys, key + i);
+		}
+	}
+
+	if (keys->bPasting && !bMore)
+	{
+		keys_append(keys, keys_paste_end, sizeof(keys_paste_end) - 1);
+		keys->bPasting = 0;
+	}
+}
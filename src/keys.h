@@ -0,0 +1,68 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_KEYS_H
+#define CONLOG_KEYS_H
+
+#include <stddef.h>
+
+/* modifiers held with a key */
+#define CONLOG_KEY_SHIFT	1
+#define CONLOG_KEY_ALT		2
+#define CONLOG_KEY_CTRL		4
+
+/* keys that send sequences, numbered as Windows virtual key codes */
+#define CONLOG_KEY_CLEAR	0x0C
+#define CONLOG_KEY_ESCAPE	0x1B
+#define CONLOG_KEY_PRIOR	0x21
+#define CONLOG_KEY_NEXT		0x22
+#define CONLOG_KEY_END		0x23
+#define CONLOG_KEY_HOME		0x24
+#define CONLOG_KEY_LEFT		0x25
+#define CONLOG_KEY_UP		0x26
+#define CONLOG_KEY_RIGHT	0x27
+#define CONLOG_KEY_DOWN		0x28
+#define CONLOG_KEY_INSERT	0x2D
+#define CONLOG_KEY_DELETE	0x2E
+#define CONLOG_KEY_F1		0x70
+#define CONLOG_KEY_F12		0x7B
+
+/* presses encoded at once, and the most bytes one can become */
+#define CONLOG_KEYS_BATCH	256
+#define CONLOG_KEYS_MAX		16
+/* characters in one wake with nothing else, taken as a paste */
+#define CONLOG_KEYS_PASTE	64
+
+/* a key pressed, with the UTF-16 unit it types or zero */
+struct conlog_key
+{
+	unsigned short vk;
+	unsigned short ch;
+	unsigned modifiers;
+};
+
+/*
+ * Turns the presses read in one wake into one run of bytes for the child.
+ * When the application has asked for bracketed paste, a burst of nothing
+ * but characters is sent between the paste markers, which stay open
+ * while more input is waiting to be read.
+ */
+struct conlog_keys
+{
+	/* set from the output when the application turns bracketed paste on or off */
+	int bBracketed;
+	int bPasting;
+	/* a high surrogate waiting for its low half */
+	unsigned short high;
+	size_t len;
+	unsigned char buf[CONLOG_KEYS_BATCH * CONLOG_KEYS_MAX + 16];
+};
+
+void conlog_keys_init(struct conlog_keys* keys);
+
+/* encodes up to CONLOG_KEYS_BATCH presses to buf, replacing what was there, bMore when more input is waiting */
+void conlog_keys_encode(struct conlog_keys* keys, const struct conlog_key* key, int count, int bMore);
+
+#endif
@@ -0,0 +1,535 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ *
+ * Line model for the log. Only what moves along or between lines is
+ * followed: carriage return, backspace, tab, line feed, cursor up and down,
+ * column moves, erase in line and erase below. Positioning by row and
+ * clearing the screen belong to full screen programs and are ignored.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "lines.h"
+
+#define TAB_WIDTH	8
+/* a line of cells as UTF-8 with its line feed */
+#define LINES_ENCODED	(CONLOG_LINES_WIDTH * 4 + 1)
+
+static unsigned* lines_row(struct conlog_lines* lines, int row)
+{
+	return lines->cells + (size_t)((lines->first + row) % CONLOG_LINES_HELD) * CONLOG_LINES_WIDTH;
+}
+
+static int* lines_len(struct conlog_lines* lines, int row)
+{
+	return &lines->len[(lines->first + row) % CONLOG_LINES_HELD];
+}
+
+static void lines_flush(struct conlog_lines* lines)
+{
+	if (lines->outLen)
+	{
+		struct conlog_iovec iov;
+
+		iov.data = lines->out;
+		iov.len = lines->outLen;
+
+		lines->write(lines->context, &iov, 1);
+
+		lines->stats.bytesOut += lines->outLen;
+		lines->outLen = 0;
+	}
+}
+
+/* writes the oldest held line, without trailing spaces */
+static void lines_emit(struct conlog_lines* lines)
+{
+	const unsigned* cells = lines_row(lines, 0);
+	int len = *lines_len(lines, 0);
+	unsigned char* p;
+	int i;
+
+	if (lines->outLen + LINES_ENCODED > CONLOG_LINES_BUFFER)
+	{
+		lines_flush(lines);
+	}
+
+	while (len && (cells[len - 1] == ' '))
+	{
+		len--;
+	}
+
+	p = lines->out + lines->outLen;
+
+	for (i = 0; i < len; i++)
+	{
+		unsigned c = cells[i];
+
+		if (c < 0x80)
+		{
+			*p++ = (unsigned char)c;
+		}
+		else if (c < 0x800)
+		{
+			*p++ = (unsigned char)(0xC0 | (c >> 6));
+			*p++ = (unsigned char)(0x80 | (c & 0x3F));
+		}
+		else if (c < 0x10000)
+		{
+			*p++ = (unsigned char)(0xE0 | (c >> 12));
+			*p++ = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+			*p++ = (unsigned char)(0x80 | (c & 0x3F));
+		}
+		else
+		{
+			*p++ = (unsigned char)(0xF0 | (c >> 18));
+			*p++ = (unsigned char)(0x80 | ((c >> 12) & 0x3F));
+			*p++ = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+			*p++ = (unsigned char)(0x80 | (c & 0x3F));
+		}
+	}
+
+	*p++ = '\n';
+
+	lines->outLen = p - lines->out;
+	lines->stats.lines++;
+
+	lines->first = (lines->first + 1) % CONLOG_LINES_HELD;
+	lines->count--;
+	lines->row--;
+	lines->base++;
+}
+
+/* the cursor goes down a line, a new one is started below the last */
+static void lines_linefeed(struct conlog_lines* lines)
+{
+	if (lines->row + 1 < lines->count)
+	{
+		lines->row++;
+		return;
+	}
+
+	if (lines->count == CONLOG_LINES_HELD)
+	{
+		lines_emit(lines);
+	}
+
+	*lines_len(lines, lines->count) = 0;
+	lines->count++;
+	lines->row++;
+}
+
+static void lines_put(struct conlog_lines* lines, unsigned c)
+{
+	unsigned* cells;
+	int* len;
+
+	if (lines->col >= CONLOG_LINES_WIDTH)
+	{
+		lines_linefeed(lines);
+		lines->col = 0;
+	}
+
+	cells = lines_row(lines, lines->row);
+	len = lines_len(lines, lines->row);
+
+	while (*len < lines->col)
+	{
+		cells[(*len)++] = ' ';
+	}
+
+	cells[lines->col++] = c;
+
+	if (*len < lines->col)
+	{
+		*len = lines->col;
+	}
+}
+
+/* a run of ASCII goes straight into the cells */
+static const unsigned char* lines_put_ascii(struct conlog_lines* lines, const unsigned char* data, const unsigned char* end)
+{
+	while ((data < end) && (*data < 0x80))
+	{
+		unsigned* cells;
+		int* len;
+		int n;
+
+		if (lines->col >= CONLOG_LINES_WIDTH)
+		{
+			lines_put(lines, *data++);
+			continue;
+		}
+
+		cells = lines_row(lines, lines->row);
+		len = lines_len(lines, lines->row);
+
+		while (*len < lines->col)
+		{
+			cells[(*len)++] = ' ';
+		}
+
+		n = CONLOG_LINES_WIDTH - lines->col;
+
+		while (n-- && (data < end) && (*data < 0x80))
+		{
+			cells[lines->col++] = *data++;
+		}
+
+		if (*len < lines->col)
+		{
+			*len = lines->col;
+		}
+	}
+
+	return data;
+}
+
+static void lines_print(void* context, const unsigned char* data, size_t len)
+{
+	struct conlog_lines* lines = context;
+	const unsigned char* end = data + len;
+
+	while (data < end)
+	{
+		unsigned char c;
+
+		if (!lines->utf8Need && (*data < 0x80))
+		{
+			data = lines_put_ascii(lines, data, end);
+			continue;
+		}
+
+		c = *data++;
+
+		if (c < 0x80)
+		{
+			lines->utf8Need = 0;
+			lines_put(lines, c);
+		}
+		else if (c < 0xC0)
+		{
+			if (lines->utf8Need)
+			{
+				lines->utf8 = (lines->utf8 << 6) | (c & 0x3F);
+
+				if (!--lines->utf8Need)
+				{
+					lines_put(lines, lines->utf8);
+				}
+			}
+			else
+			{
+				lines_put(lines, 0xFFFD);
+			}
+		}
+		else if (c < 0xE0)
+		{
+			lines->utf8 = c & 0x1F;
+			lines->utf8Need = 1;
+		}
+		else if (c < 0xF0)
+		{
+			lines->utf8 = c & 0x0F;
+			lines->utf8Need = 2;
+		}
+		else if (c < 0xF8)
+		{
+			lines->utf8 = c & 0x07;
+			lines->utf8Need = 3;
+		}
+		else
+		{
+			lines->utf8Need = 0;
+			lines_put(lines, 0xFFFD);
+		}
+	}
+}
+
+static void lines_execute(void* context, unsigned char c)
+{
+	struct conlog_lines* lines = context;
+
+	switch (c)
+	{
+	case '\b':
+		if (lines->col > 0)
+		{
+			lines->col--;
+		}
+		break;
+
+	case '\t':
+		lines->col = (lines->col / TAB_WIDTH + 1) * TAB_WIDTH;
+
+		if (lines->col > CONLOG_LINES_WIDTH - 1)
+		{
+			lines->col = CONLOG_LINES_WIDTH - 1;
+		}
+		break;
+
+	case '\n':
+	case '\v':
+	case '\f':
+		lines_linefeed(lines);
+		break;
+
+	case '\r':
+		lines->col = 0;
+		break;
+	}
+}
+
+static void lines_up(struct conlog_lines* lines, int n)
+{
+	lines->row = (lines->row > n) ? lines->row - n : 0;
+}
+
+static void lines_down(struct conlog_lines* lines, int n)
+{
+	lines->row = (lines->row + n < lines->count) ? lines->row + n : lines->count - 1;
+}
+
+static void lines_save(struct conlog_lines* lines)
+{
+	lines->saved = lines->base + lines->row;
+	lines->savedCol = lines->col;
+}
+
+/* a line that has been written cannot be gone back to, the cursor stops at the oldest held */
+static void lines_restore(struct conlog_lines* lines)
+{
+	lines->row = 0;
+
+	if (lines->saved > lines->base)
+	{
+		lines_down(lines, (int)(lines->saved - lines->base < CONLOG_LINES_HELD ? lines->saved - lines->base : CONLOG_LINES_HELD));
+	}
+
+	lines->col = lines->savedCol;
+}
+
+static void lines_esc(void* context, const struct conlog_vt* vt, unsigned char final)
+{
+	struct conlog_lines* lines = context;
+
+	if (vt->intermediate)
+	{
+		return;
+	}
+
+	switch (final)
+	{
+	case '7':
+		lines_save(lines);
+		break;
+
+	case '8':
+		lines_restore(lines);
+		break;
+
+	case 'D':
+		lines_linefeed(lines);
+		break;
+
+	case 'E':
+		lines_linefeed(lines);
+		lines->col = 0;
+		break;
+
+	case 'M':
+		lines_up(lines, 1);
+		break;
+	}
+}
+
+static void lines_csi(void* context, const struct conlog_vt* vt, unsigned char final)
+{
+	struct conlog_lines* lines = context;
+	int n = ((vt->paramCount > 0) && vt->params[0]) ? (int)vt->params[0] : 1;
+	unsigned* cells;
+	int* len;
+
+	if (vt->intermediate || vt->marker)
+	{
+		return;
+	}
+
+	if (n > CONLOG_LINES_WIDTH)
+	{
+		n = CONLOG_LINES_WIDTH;
+	}
+
+	cells = lines_row(lines, lines->row);
+	len = lines_len(lines, lines->row);
+
+	switch (final)
+	{
+	case 'A':
+		lines_up(lines, n);
+		break;
+
+	case 'B':
+	case 'e':
+		lines_down(lines, n);
+		break;
+
+	case 'E':
+		lines_down(lines, n);
+		lines->col = 0;
+		break;
+
+	case 'F':
+		lines_up(lines, n);
+		lines->col = 0;
+		break;
+
+	case 'C':
+	case 'a':
+		lines->col = (lines->col + n < CONLOG_LINES_WIDTH) ? lines->col + n : CONLOG_LINES_WIDTH - 1;
+		break;
+
+	case 'D':
+		lines->col = (lines->col > n) ? lines->col - n : 0;
+		break;
+
+	case 'G':
+	case '`':
+		lines->col = n - 1;
+		break;
+
+	case 'K':
+		switch ((vt->paramCount > 0) ? vt->params[0] : 0)
+		{
+		case 0:
+			if (*len > lines->col)
+			{
+				*len = lines->col;
+			}
+			break;
+
+		case 1:
+			{
+				int i;
+
+				for (i = 0; (i <= lines->col) && (i < *len); i++)
+				{
+					cells[i] = ' ';
+				}
+			}
+			break;
+
+		case 2:
+			*len = 0;
+			break;
+		}
+		break;
+
+	case 'J':
+		/* the lines below are blank until something is written there */
+		if (!((vt->paramCount > 0) ? vt->params[0] : 0))
+		{
+			if (*len > lines->col)
+			{
+				*len = lines->col;
+			}
+
+			lines->count = lines->row + 1;
+		}
+		break;
+
+	case 'X':
+		{
+			int i;
+
+			for (i = lines->col; (i < lines->col + n) && (i < *len); i++)
+			{
+				cells[i] = ' ';
+			}
+		}
+		break;
+
+	case 'P':
+		if (lines->col < *len)
+		{
+			if (n > *len - lines->col)
+			{
+				n = *len - lines->col;
+			}
+
+			memmove(cells + lines->col, cells + lines->col + n, sizeof(*cells) * (*len - lines->col - n));
+			*len -= n;
+		}
+		break;
+
+	case 's':
+		lines_save(lines);
+		break;
+
+	case 'u':
+		lines_restore(lines);
+		break;
+	}
+}
+
+int conlog_lines_init(struct conlog_lines* lines, conlog_output_fn write, void* context)
+{
+	memset(lines, 0, sizeof(*lines));
+
+	lines->write = write;
+	lines->context = context;
+	lines->cells = malloc(sizeof(*lines->cells) * CONLOG_LINES_HELD * CONLOG_LINES_WIDTH);
+	lines->out = malloc(CONLOG_LINES_BUFFER);
+
+	if (!(lines->cells && lines->out))
+	{
+		free(lines->cells);
+		free(lines->out);
+
+		return -1;
+	}
+
+	lines->count = 1;
+
+	conlog_vt_init(&lines->vt);
+
+	return 0;
+}
+
+void conlog_lines_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	static const struct conlog_vt_sink sink = { lines_print, lines_execute, lines_esc, lines_csi };
+	struct conlog_lines* lines = context;
+
+	while (count--)
+	{
+		conlog_vt_feed(&lines->vt, iov->data, iov->len, &sink, lines);
+		lines->stats.bytesIn += iov->len;
+		iov++;
+	}
+
+	lines_flush(lines);
+}
+
+void conlog_lines_finish(struct conlog_lines* lines)
+{
+	/* the line the cursor was left on after the last line feed is not a line */
+	if (!*lines_len(lines, lines->count - 1))
+	{
+		lines->count--;
+	}
+
+	while (lines->count)
+	{
+		lines_emit(lines);
+	}
+
+	lines_flush(lines);
+
+	free(lines->cells);
+	free(lines->out);
+
+	lines->cells = NULL;
+	lines->out = NULL;
+}
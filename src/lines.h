@@ -0,0 +1,56 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_LINES_H
+#define CONLOG_LINES_H
+
+#include "output.h"
+#include "vtparse.h"
+
+/* lines the cursor may still go back up to, the oldest is written when another is needed */
+#define CONLOG_LINES_HELD	32
+/* columns in a line, anything longer wraps as it would on a terminal this wide */
+#define CONLOG_LINES_WIDTH	1024
+#define CONLOG_LINES_BUFFER	(64 << 10)
+
+struct conlog_lines_stats
+{
+	unsigned long long bytesIn;
+	unsigned long long bytesOut;
+	unsigned long long lines;
+};
+
+/*
+ * A channel that writes the text of each line as it was last drawn, so a
+ * progress bar redrawn after a carriage return, or a block of them redrawn
+ * after moving the cursor up, is logged once in its final state.
+ */
+struct conlog_lines
+{
+	conlog_output_fn write;
+	void* context;
+	struct conlog_vt vt;
+	/* a ring of held lines, row counts from the oldest */
+	unsigned* cells;
+	int len[CONLOG_LINES_HELD];
+	int first, count, row, col;
+	/* lines written before the oldest held, so a saved cursor outlives scrolling */
+	unsigned long long base, saved;
+	int savedCol;
+	unsigned utf8, utf8Need;
+	unsigned char* out;
+	size_t outLen;
+	struct conlog_lines_stats stats;
+};
+
+int conlog_lines_init(struct conlog_lines* lines, conlog_output_fn write, void* context);
+
+/* a conlog_output_fn */
+void conlog_lines_write(void* context, const struct conlog_iovec* iov, int count);
+
+/* writes the lines still held */
+void conlog_lines_finish(struct conlog_lines* lines);
+
+#endif
@@ -0,0 +1,354 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "logfile.h"
+#include "trace.h"
+
+/* where a rotation has got to */
+#define LOGFILE_IDLE		0
+#define LOGFILE_REQUESTED	1
+#define LOGFILE_READY		2
+#define LOGFILE_RETIRED		3
+#define LOGFILE_FAILED		4
+
+#define LOGFILE_RETRY_MS	1000
+#define LOGFILE_WAIT_MS		60000
+
+#ifdef _WIN32
+#	define logfile_gmtime(now, tm) (gmtime_s((tm), (now)) ? -1 : 0)
+#else
+#	define logfile_gmtime(now, tm) (gmtime_r((now), (tm)) ? 0 : -1)
+#endif
+
+/* the next multiple of the interval, so an hourly log turns over on the hour */
+static time_t logfile_deadline(const struct conlog_logfile* log)
+{
+	time_t now = time(NULL);
+
+	return (now / log->interval + 1) * log->interval;
+}
+
+/* moves the file aside with the UTC time in its name, the same clock the deadline keeps, and opens a new one in its place */
+static int logfile_rotate(struct conlog_logfile* log, int* bRenamed)
+{
+	if (!*bRenamed)
+	{
+		char archive[CONLOG_LOGFILE_PATH + 32];
+		time_t now = time(NULL);
+		struct tm tm;
+		int n;
+
+		if (logfile_gmtime(&now, &tm))
+		{
+			return -1;
+		}
+
+		if (now == log->lastSecond)
+		{
+			log->sequence++;
+		}
+		else
+		{
+			log->lastSecond = now;
+			log->sequence = 0;
+		}
+
+		n = snprintf(archive, sizeof(archive), "%s.%04d%02d%02d-%02d%02d%02d", log->path,
+			tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+
+		if (log->sequence)
+		{
+			snprintf(archive + n, sizeof(archive) - n, ".%03d", log->sequence);
+		}
+
+		if (conlog_file_rename(log->path, archive))
+		{
+			return -1;
+		}
+
+		/* until the new file opens the writer carries on in the one just renamed */
+		*bRenamed = 1;
+	}
+
+	if (conlog_file_open(&log->next, log->path))
+	{
+		return -1;
+	}
+
+	/* something else may have made the file first, what it holds counts */
+	log->nextSize = conlog_file_size(log->next);
+	*bRenamed = 0;
+
+	return 0;
+}
+
+static void logfile_main(void* arg)
+{
+	struct conlog_logfile* log = arg;
+	time_t deadline = log->interval ? logfile_deadline(log) : 0;
+	int bRenamed = 0;
+
+	CONLOG_TRACE_THREAD("log rotate");
+
+	conlog_mutex_lock(&log->mutex);
+
+	while (!log->stopping)
+	{
+		switch (log->state)
+		{
+		case LOGFILE_RETIRED:
+			{
+				conlog_file file = log->retired;
+
+				conlog_mutex_unlock(&log->mutex);
+				conlog_file_close(file);
+				conlog_mutex_lock(&log->mutex);
+
+				conlog_atomic_store(&log->state, LOGFILE_IDLE);
+			}
+			break;
+
+		case LOGFILE_REQUESTED:
+			{
+				int result;
+
+				conlog_mutex_unlock(&log->mutex);
+				result = logfile_rotate(log, &bRenamed);
+				conlog_mutex_lock(&log->mutex);
+
+				if (result)
+				{
+					log->stats.failures++;
+					conlog_atomic_store(&log->state, LOGFILE_FAILED);
+				}
+				else
+				{
+					unsigned long long t = conlog_clock() - log->requested;
+
+					log->stats.rotations++;
+					log->stats.rotateTotal += t;
+
+					if (t > log->stats.rotateMax)
+					{
+						log->stats.rotateMax = t;
+					}
+
+					/* the deadline only moves on once the time rotation has happened */
+					if (deadline && (time(NULL) >= deadline))
+					{
+						deadline = logfile_deadline(log);
+					}
+
+					conlog_atomic_store(&log->state, LOGFILE_READY);
+				}
+			}
+			break;
+
+		case LOGFILE_FAILED:
+			/* the writer does not ask again until this has passed, a missed deadline is tried again from idle */
+			conlog_cond_timedwait(&log->wake, &log->mutex, LOGFILE_RETRY_MS);
+
+			if (log->state == LOGFILE_FAILED)
+			{
+				conlog_atomic_store(&log->state, LOGFILE_IDLE);
+			}
+			break;
+
+		case LOGFILE_IDLE:
+			if (deadline)
+			{
+				time_t now = time(NULL);
+
+				if (now >= deadline)
+				{
+					log->requested = conlog_clock();
+					conlog_atomic_store(&log->state, LOGFILE_REQUESTED);
+				}
+				else
+				{
+					conlog_cond_timedwait(&log->wake, &log->mutex, (deadline - now) * 1000 < LOGFILE_WAIT_MS ? (unsigned)(deadline - now) * 1000 : LOGFILE_WAIT_MS);
+				}
+
+				break;
+			}
+
+			conlog_cond_wait(&log->wake, &log->mutex);
+			break;
+
+		default:
+			conlog_cond_wait(&log->wake, &log->mutex);
+			break;
+		}
+	}
+
+	conlog_mutex_unlock(&log->mutex);
+}
+
+static void logfile_drain(struct conlog_logfile* log)
+{
+	if (log->queue.drain)
+	{
+		log->queue.drain(log->queue.context);
+	}
+}
+
+/* takes the file the rotation thread opened, the old one goes back to be closed */
+static void logfile_switch(struct conlog_logfile* log)
+{
+	logfile_drain(log);
+
+	conlog_mutex_lock(&log->mutex);
+
+	log->retired = log->file;
+	log->file = log->next;
+	log->written = log->nextSize;
+
+	conlog_atomic_store(&log->state, LOGFILE_RETIRED);
+	conlog_cond_signal(&log->wake);
+
+	conlog_mutex_unlock(&log->mutex);
+}
+
+static void logfile_request(struct conlog_logfile* log)
+{
+	conlog_mutex_lock(&log->mutex);
+
+	if (log->state == LOGFILE_IDLE)
+	{
+		log->requested = conlog_clock();
+		conlog_atomic_store(&log->state, LOGFILE_REQUESTED);
+		conlog_cond_signal(&log->wake);
+	}
+
+	conlog_mutex_unlock(&log->mutex);
+}
+
+int conlog_logfile_open(struct conlog_logfile* log, const char* path, unsigned long long maxSize, unsigned interval)
+{
+	size_t len = strlen(path);
+
+	memset(log, 0, sizeof(*log));
+
+	if (len >= sizeof(log->path))
+	{
+		return -1;
+	}
+
+	memcpy(log->path, path, len + 1);
+
+	log->maxSize = maxSize;
+	log->interval = interval;
+
+	if (conlog_file_open(&log->file, path))
+	{
+		return -1;
+	}
+
+	/* appending to an old log, it is already part of the way to maxSize */
+	log->written = conlog_file_size(log->file);
+
+	if (maxSize || interval)
+	{
+		conlog_mutex_init(&log->mutex);
+		conlog_cond_init(&log->wake);
+
+		if (conlog_thread_start(&log->thread, logfile_main, log))
+		{
+			conlog_cond_destroy(&log->wake);
+			conlog_mutex_destroy(&log->mutex);
+			conlog_file_close(log->file);
+
+			return -1;
+		}
+
+		log->bThread = 1;
+	}
+
+	return 0;
+}
+
+void conlog_logfile_set_queue(struct conlog_logfile* log, const struct conlog_logfile_queue* queue)
+{
+	log->queue = *queue;
+}
+
+void conlog_logfile_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	struct conlog_logfile* log = context;
+	unsigned long long t = log->writeTime ? conlog_clock() : CONLOG_TRACE_CLOCK();
+	int i;
+
+	if (conlog_atomic_load(&log->state) == LOGFILE_READY)
+	{
+		logfile_switch(log);
+	}
+
+	if (log->queue.write)
+	{
+		log->queue.write(log->queue.context, log->file, iov, count);
+	}
+	else
+	{
+		conlog_file_write(log->file, iov, count);
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		log->written += iov[i].len;
+	}
+
+	if (log->maxSize && (log->written >= log->maxSize) && (conlog_atomic_load(&log->state) == LOGFILE_IDLE))
+	{
+		logfile_request(log);
+	}
+
+	if (log->writeTime)
+	{
+		conlog_histogram_add(log->writeTime, conlog_clock() - t);
+	}
+
+	CONLOG_TRACE_SPAN("log write", t, count);
+}
+
+void conlog_logfile_sync(void* context)
+{
+	struct conlog_logfile* log = context;
+
+	logfile_drain(log);
+	conlog_file_sync(log->file);
+}
+
+void conlog_logfile_close(struct conlog_logfile* log)
+{
+	logfile_drain(log);
+
+	if (log->bThread)
+	{
+		conlog_mutex_lock(&log->mutex);
+		conlog_atomic_store(&log->stopping, 1);
+		conlog_cond_signal(&log->wake);
+		conlog_mutex_unlock(&log->mutex);
+
+		conlog_thread_join(&log->thread);
+
+		switch (log->state)
+		{
+		case LOGFILE_READY:
+			conlog_file_close(log->next);
+			break;
+
+		case LOGFILE_RETIRED:
+			conlog_file_close(log->retired);
+			break;
+		}
+
+		conlog_cond_destroy(&log->wake);
+		conlog_mutex_destroy(&log->mutex);
+	}
+
+	conlog_file_close(log->file);
+}
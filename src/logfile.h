@@ -0,0 +1,91 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_LOGFILE_H
+#define CONLOG_LOGFILE_H
+
+#include <time.h>
+#include "output.h"
+#include "platform.h"
+
+#define CONLOG_LOGFILE_PATH	1024
+
+struct conlog_logfile_stats
+{
+	unsigned long long rotations;
+	unsigned long long failures;
+	/* from asking for a new file to it being open, the writer does not wait for this */
+	unsigned long long rotateTotal;
+	unsigned long long rotateMax;
+};
+
+struct conlog_logfile_queue_stats
+{
+	/* system calls that submitted writes, and the writes in them */
+	unsigned long long submits;
+	unsigned long long writes;
+	unsigned long long bytes;
+	/* times every buffer was in flight and the writer had to wait */
+	unsigned long long waits;
+	/* writes cut short and finished with a plain write */
+	unsigned long long retries;
+};
+
+/* writes the file in place of conlog_file_write, such as through io_uring */
+struct conlog_logfile_queue
+{
+	void (*write)(void* context, conlog_file file, const struct conlog_iovec* iov, int count);
+	/* waits for every write queued, before the file is synced, switched or closed */
+	void (*drain)(void* context);
+	void* context;
+};
+
+/*
+ * A log file that conlog owns and rotates by size or by time.
+ * The rotation thread renames the file and opens its replacement, the
+ * writer picks the new file up on its next write and hands the old one
+ * back to be closed, so the writer never waits on the file system.
+ */
+struct conlog_logfile
+{
+	char path[CONLOG_LOGFILE_PATH];
+	unsigned long long maxSize;
+	unsigned interval;
+	/* the writer's file and how much has gone into it */
+	conlog_file file;
+	unsigned long long written;
+	struct conlog_logfile_queue queue;
+	/* when set, the nanoseconds each write took */
+	struct conlog_histogram* writeTime;
+	/* passed between the writer and the rotation thread under the mutex */
+	size_t state;
+	conlog_file next, retired;
+	unsigned long long nextSize;
+	unsigned long long requested;
+	size_t stopping;
+	int bThread;
+	conlog_mutex mutex;
+	conlog_cond wake;
+	struct conlog_thread thread;
+	time_t lastSecond;
+	int sequence;
+	struct conlog_logfile_stats stats;
+};
+
+/* opens the file, and starts the rotation thread when maxSize or interval in seconds is set */
+int conlog_logfile_open(struct conlog_logfile* log, const char* path, unsigned long long maxSize, unsigned interval);
+
+/* has the writes queued rather than made in turn, before the first write */
+void conlog_logfile_set_queue(struct conlog_logfile* log, const struct conlog_logfile_queue* queue);
+
+/* a conlog_output_fn */
+void conlog_logfile_write(void* context, const struct conlog_iovec* iov, int count);
+
+/* a conlog_sync_fn, called from the thread that writes */
+void conlog_logfile_sync(void* context);
+
+void conlog_logfile_close(struct conlog_logfile* log);
+
+#endif
@@ -0,0 +1,350 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "logwriter.h"
+#include "trace.h"
+
+#define SPILL_CHUNK 65536
+
+/* overflow kept in order on the heap while the ring is full */
+struct conlog_spill
+{
+	struct conlog_spill* next;
+	size_t len;
+	unsigned char data[SPILL_CHUNK];
+};
+
+static void logwriter_wake(struct conlog_logwriter* writer, size_t* waiting, conlog_cond* cond)
+{
+	if (conlog_atomic_load(waiting))
+	{
+		conlog_mutex_lock(&writer->mutex);
+		conlog_cond_signal(cond);
+		conlog_mutex_unlock(&writer->mutex);
+	}
+}
+
+static int logwriter_pending(struct conlog_logwriter* writer)
+{
+	return (conlog_atomic_load(&writer->ring.head) != writer->ring.tail) || conlog_atomic_load(&writer->spilling);
+}
+
+static void logwriter_unspill(struct conlog_logwriter* writer)
+{
+	struct conlog_spill* chunk;
+
+	conlog_mutex_lock(&writer->mutex);
+
+	/*
+	 * The producer may have filled the ring after the writer last found it
+	 * empty and then started spilling, what is in the ring came first.
+	 */
+	if (conlog_atomic_load(&writer->ring.head) != writer->ring.tail)
+	{
+		conlog_mutex_unlock(&writer->mutex);
+
+		return;
+	}
+
+	chunk = writer->spillHead;
+	writer->spillHead = NULL;
+	writer->spillTail = NULL;
+	writer->spillBytes = 0;
+
+	/* the producer only fills the ring again once everything spilled is written */
+	if (!chunk)
+	{
+		conlog_atomic_store(&writer->spilling, 0);
+	}
+
+	conlog_mutex_unlock(&writer->mutex);
+
+	while (chunk)
+	{
+		struct conlog_spill* next = chunk->next;
+		struct conlog_iovec iov;
+
+		iov.data = chunk->data;
+		iov.len = chunk->len;
+
+		writer->write(writer->context, &iov, 1);
+
+		free(chunk);
+		chunk = next;
+	}
+}
+
+static void logwriter_main(void* arg)
+{
+	struct conlog_logwriter* writer = arg;
+
+	CONLOG_TRACE_THREAD("log writer");
+
+	for (;;)
+	{
+		struct conlog_iovec iov[2];
+		int count = conlog_ring_peek(&writer->ring, iov);
+
+		if (count)
+		{
+			writer->write(writer->context, iov, count);
+
+			conlog_ring_consume(&writer->ring, iov[0].len + ((count > 1) ? iov[1].len : 0));
+
+			logwriter_wake(writer, &writer->producerWaiting, &writer->spaceReady);
+
+			continue;
+		}
+
+		if (conlog_atomic_load(&writer->spilling))
+		{
+			logwriter_unspill(writer);
+
+			continue;
+		}
+
+		conlog_mutex_lock(&writer->mutex);
+
+		conlog_atomic_store(&writer->consumerWaiting, 1);
+
+		while (!logwriter_pending(writer) && !conlog_atomic_load(&writer->stopping))
+		{
+			conlog_cond_wait(&writer->dataReady, &writer->mutex);
+		}
+
+		conlog_atomic_store(&writer->consumerWaiting, 0);
+
+		conlog_mutex_unlock(&writer->mutex);
+
+		if (!logwriter_pending(writer) && conlog_atomic_load(&writer->stopping))
+		{
+			break;
+		}
+	}
+}
+
+static int logwriter_spill(struct conlog_logwriter* writer, const unsigned char* data, size_t len, int force)
+{
+	conlog_mutex_lock(&writer->mutex);
+
+	if (!(force || writer->spilling))
+	{
+		conlog_mutex_unlock(&writer->mutex);
+
+		return 0;
+	}
+
+	while (len)
+	{
+		struct conlog_spill* chunk = writer->spillTail;
+		size_t n;
+
+		if (!chunk || (chunk->len == SPILL_CHUNK))
+		{
+			chunk = malloc(sizeof(*chunk));
+
+			if (!chunk)
+			{
+				writer->dropped += len;
+				writer->stats.bytesDropped += len;
+				break;
+			}
+
+			chunk->next = NULL;
+			chunk->len = 0;
+
+			if (writer->spillTail)
+			{
+				writer->spillTail->next = chunk;
+			}
+			else
+			{
+				writer->spillHead = chunk;
+			}
+
+			writer->spillTail = chunk;
+		}
+
+		n = SPILL_CHUNK - chunk->len;
+
+		if (n > len)
+		{
+			n = len;
+		}
+
+		memcpy(chunk->data + chunk->len, data, n);
+
+		chunk->len += n;
+		data += n;
+		len -= n;
+
+		writer->spillBytes += n;
+		writer->stats.bytesSpilled += n;
+	}
+
+	if (writer->spillBytes > writer->stats.spillPeak)
+	{
+		writer->stats.spillPeak = writer->spillBytes;
+	}
+
+	conlog_atomic_store(&writer->spilling, 1);
+
+	conlog_mutex_unlock(&writer->mutex);
+
+	return 1;
+}
+
+static int logwriter_marker(struct conlog_logwriter* writer)
+{
+	char marker[64];
+	int n = snprintf(marker, sizeof(marker), "\r\n[conlog: %llu bytes dropped]\r\n", writer->dropped);
+
+	if (conlog_ring_space(&writer->ring) < (size_t)n)
+	{
+		return 0;
+	}
+
+	conlog_ring_write(&writer->ring, (const unsigned char*)marker, n);
+
+	writer->dropped = 0;
+
+	return 1;
+}
+
+int conlog_logwriter_start(struct conlog_logwriter* writer, size_t size, int policy, conlog_output_fn write, void* context)
+{
+	memset(writer, 0, sizeof(*writer));
+
+	if (conlog_ring_init(&writer->ring, size))
+	{
+		return -1;
+	}
+
+	writer->policy = policy;
+	writer->write = write;
+	writer->context = context;
+
+	conlog_mutex_init(&writer->mutex);
+	conlog_cond_init(&writer->dataReady);
+	conlog_cond_init(&writer->spaceReady);
+
+	if (conlog_thread_start(&writer->thread, logwriter_main, writer))
+	{
+		conlog_cond_destroy(&writer->spaceReady);
+		conlog_cond_destroy(&writer->dataReady);
+		conlog_mutex_destroy(&writer->mutex);
+		conlog_ring_free(&writer->ring);
+
+		return -1;
+	}
+
+	return 0;
+}
+
+void conlog_logwriter_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	struct conlog_logwriter* writer = context;
+
+	while (count--)
+	{
+		const unsigned char* data = iov->data;
+		size_t len = iov->len;
+
+		writer->stats.bytesQueued += len;
+
+		while (len)
+		{
+			size_t n;
+
+			if (conlog_atomic_load(&writer->spilling) && logwriter_spill(writer, data, len, 0))
+			{
+				break;
+			}
+
+			if (writer->dropped && !logwriter_marker(writer))
+			{
+				writer->dropped += len;
+				writer->stats.bytesDropped += len;
+				break;
+			}
+
+			n = conlog_ring_write(&writer->ring, data, len);
+
+			data += n;
+			len -= n;
+
+			if (len)
+			{
+				logwriter_wake(writer, &writer->consumerWaiting, &writer->dataReady);
+
+				switch (writer->policy)
+				{
+				case CONLOG_OVERFLOW_DROP:
+					writer->dropped += len;
+					writer->stats.bytesDropped += len;
+					len = 0;
+					break;
+
+				case CONLOG_OVERFLOW_SPILL:
+					logwriter_spill(writer, data, len, 1);
+					len = 0;
+					break;
+
+				default:
+					conlog_mutex_lock(&writer->mutex);
+
+					conlog_atomic_store(&writer->producerWaiting, 1);
+
+					while (!conlog_ring_space(&writer->ring))
+					{
+						conlog_cond_wait(&writer->spaceReady, &writer->mutex);
+					}
+
+					conlog_atomic_store(&writer->producerWaiting, 0);
+
+					conlog_mutex_unlock(&writer->mutex);
+
+					writer->stats.stalls++;
+					break;
+				}
+			}
+		}
+
+		iov++;
+	}
+
+	logwriter_wake(writer, &writer->consumerWaiting, &writer->dataReady);
+}
+
+void conlog_logwriter_stop(struct conlog_logwriter* writer)
+{
+	conlog_mutex_lock(&writer->mutex);
+	conlog_atomic_store(&writer->stopping, 1);
+	conlog_cond_signal(&writer->dataReady);
+	conlog_mutex_unlock(&writer->mutex);
+
+	conlog_thread_join(&writer->thread);
+
+	if (writer->dropped)
+	{
+		char marker[64];
+		struct conlog_iovec iov;
+
+		iov.data = (const unsigned char*)marker;
+		iov.len = snprintf(marker, sizeof(marker), "\r\n[conlog: %llu bytes dropped]\r\n", writer->dropped);
+
+		writer->write(writer->context, &iov, 1);
+
+		writer->dropped = 0;
+	}
+
+	conlog_cond_destroy(&writer->spaceReady);
+	conlog_cond_destroy(&writer->dataReady);
+	conlog_mutex_destroy(&writer->mutex);
+	conlog_ring_free(&writer->ring);
+}
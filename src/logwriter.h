@@ -0,0 +1,54 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_LOGWRITER_H
+#define CONLOG_LOGWRITER_H
+
+#include "output.h"
+#include "ring.h"
+#include "platform.h"
+
+/* what to do when the ring is full */
+#define CONLOG_OVERFLOW_BLOCK	0
+#define CONLOG_OVERFLOW_DROP	1
+#define CONLOG_OVERFLOW_SPILL	2
+
+struct conlog_spill;
+
+struct conlog_logwriter_stats
+{
+	unsigned long long bytesQueued;
+	unsigned long long bytesDropped;
+	unsigned long long bytesSpilled;
+	unsigned long long stalls;
+	unsigned long long spillPeak;
+};
+
+/* moves a channel onto its own thread, fed through a ring */
+struct conlog_logwriter
+{
+	struct conlog_ring ring;
+	int policy;
+	conlog_output_fn write;
+	void* context;
+	struct conlog_thread thread;
+	conlog_mutex mutex;
+	conlog_cond dataReady, spaceReady;
+	size_t consumerWaiting, producerWaiting, stopping, spilling;
+	struct conlog_spill *spillHead, *spillTail;
+	size_t spillBytes;
+	unsigned long long dropped;
+	struct conlog_logwriter_stats stats;
+};
+
+int conlog_logwriter_start(struct conlog_logwriter* writer, size_t size, int policy, conlog_output_fn write, void* context);
+
+/* a conlog_output_fn for the producer */
+void conlog_logwriter_write(void* context, const struct conlog_iovec* iov, int count);
+
+/* drains what is queued, then joins the writer thread */
+void conlog_logwriter_stop(struct conlog_logwriter* writer);
+
+#endif
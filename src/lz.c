@@ -0,0 +1,242 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <string.h>
+#include "lz.h"
+
+#define LZ_MIN_MATCH	4
+#define LZ_WINDOW		65535
+/* as LZ4 requires, matches are not started this close to the end and the last bytes are always literals */
+#define LZ_TAIL			12
+#define LZ_LAST_LITERALS	5
+
+static unsigned lz_read32(const unsigned char* p)
+{
+	unsigned v;
+
+	memcpy(&v, p, sizeof(v));
+
+	return v;
+}
+
+static unsigned lz_hash(unsigned v)
+{
+	return (v * 2654435761u) >> (32 - CONLOG_LZ_HASH_BITS);
+}
+
+/* a length of 15 or more continues in bytes of 255 */
+static unsigned char* lz_length(unsigned char* out, size_t n)
+{
+	while (n >= 255)
+	{
+		*out++ = 255;
+		n -= 255;
+	}
+
+	*out++ = (unsigned char)n;
+
+	return out;
+}
+
+static unsigned char* lz_sequence(unsigned char* out, const unsigned char* end, const unsigned char* literals, size_t literalLen, size_t offset, size_t matchLen)
+{
+	unsigned char* token = out;
+	size_t need = 1 + literalLen + literalLen / 255 + 1 + 2 + (matchLen / 255) + 1;
+
+	if ((size_t)(end - out) < need)
+	{
+		return NULL;
+	}
+
+	out++;
+
+	*token = (unsigned char)((literalLen < 15 ? literalLen : 15) << 4);
+
+	if (literalLen >= 15)
+	{
+		out = lz_length(out, literalLen - 15);
+	}
+
+	memcpy(out, literals, literalLen);
+	out += literalLen;
+
+	if (matchLen)
+	{
+		matchLen -= LZ_MIN_MATCH;
+
+		*out++ = (unsigned char)offset;
+		*out++ = (unsigned char)(offset >> 8);
+
+		*token |= (unsigned char)(matchLen < 15 ? matchLen : 15);
+
+		if (matchLen >= 15)
+		{
+			out = lz_length(out, matchLen - 15);
+		}
+	}
+
+	return out;
+}
+
+size_t conlog_lz_compress(const unsigned char* data, size_t len, unsigned char* out, size_t size, unsigned* table)
+{
+	const unsigned char* p = data;
+	const unsigned char* anchor = data;
+	const unsigned char* end = data + len;
+	const unsigned char* limit = (len > LZ_TAIL) ? end - LZ_TAIL : data;
+	const unsigned char* matchEnd = (len > LZ_TAIL) ? end - LZ_LAST_LITERALS : data;
+	unsigned char* op = out;
+	unsigned char* oend = out + size;
+
+	memset(table, 0, sizeof(*table) * CONLOG_LZ_TABLE);
+
+	while (p < limit)
+	{
+		unsigned seq = lz_read32(p);
+		unsigned h = lz_hash(seq);
+		const unsigned char* ref = data + table[h];
+
+		table[h] = (unsigned)(p - data);
+
+		if ((ref < p) && (p - ref <= LZ_WINDOW) && (lz_read32(ref) == seq))
+		{
+			const unsigned char* m = p + LZ_MIN_MATCH;
+			const unsigned char* r = ref + LZ_MIN_MATCH;
+
+			while ((m < matchEnd) && (*m == *r))
+			{
+				m++;
+				r++;
+			}
+
+			/* take in what matches before the hashed position too */
+			while ((p > anchor) && (ref > data) && (p[-1] == ref[-1]))
+			{
+				p--;
+				ref--;
+			}
+
+			op = lz_sequence(op, oend, anchor, p - anchor, p - ref, m - p);
+
+			if (!op)
+			{
+				return 0;
+			}
+
+			p = m;
+			anchor = p;
+
+			if (p < limit)
+			{
+				table[lz_hash(lz_read32(p - 2))] = (unsigned)(p - 2 - data);
+			}
+		}
+		else
+		{
+			/* step further the longer nothing has matched */
+			p += 1 + ((p - anchor) >> 6);
+		}
+	}
+
+	op = lz_sequence(op, oend, anchor, end - anchor, 0, 0);
+
+	return op ? (size_t)(op - out) : 0;
+}
+
+long conlog_lz_decompress(const unsigned char* data, size_t len, unsigned char* out, size_t size)
+{
+	const unsigned char* p = data;
+	const unsigned char* end = data + len;
+	unsigned char* op = out;
+	unsigned char* oend = out + size;
+
+	while (p < end)
+	{
+		unsigned token = *p++;
+		size_t n = token >> 4;
+		size_t offset;
+		const unsigned char* ref;
+
+		if (n == 15)
+		{
+			unsigned char b;
+
+			do
+			{
+				if (p == end)
+				{
+					return -1;
+				}
+
+				b = *p++;
+				n += b;
+			} while (b == 255);
+		}
+
+		if (((size_t)(end - p) < n) || ((size_t)(oend - op) < n))
+		{
+			return -1;
+		}
+
+		memcpy(op, p, n);
+		op += n;
+		p += n;
+
+		/* the last sequence has only literals */
+		if (p == end)
+		{
+			break;
+		}
+
+		if (end - p < 2)
+		{
+			return -1;
+		}
+
+		offset = p[0] | ((size_t)p[1] << 8);
+		p += 2;
+
+		n = (token & 15) + LZ_MIN_MATCH;
+
+		if ((token & 15) == 15)
+		{
+			unsigned char b;
+
+			do
+			{
+				if (p == end)
+				{
+					return -1;
+				}
+
+				b = *p++;
+				n += b;
+			} while (b == 255);
+		}
+
+		if (!offset || ((size_t)(op - out) < offset) || ((size_t)(oend - op) < n))
+		{
+			return -1;
+		}
+
+		ref = op - offset;
+
+		/* the match may overlap what it is producing */
+		if (offset >= n)
+		{
+			memcpy(op, ref, n);
+			op += n;
+		}
+		else
+		{
+			while (n--)
+			{
+				*op++ = *ref++;
+			}
+		}
+	}
+
+	return (long)(op - out);
+}
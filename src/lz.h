@@ -0,0 +1,29 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_LZ_H
+#define CONLOG_LZ_H
+
+#include <stddef.h>
+
+#define CONLOG_LZ_HASH_BITS	14
+#define CONLOG_LZ_TABLE		(1 << CONLOG_LZ_HASH_BITS)
+
+/* worst case output for len bytes of input */
+#define CONLOG_LZ_BOUND(len)	((len) + (len) / 255 + 16)
+
+/*
+ * LZ77 with a 64K window writing LZ4 blocks: a token holding the literal
+ * and match lengths, the literals, then a two byte offset, keeping to
+ * LZ4's rules for the end of a block so any LZ4 block decoder reads them.
+ * table holds CONLOG_LZ_TABLE entries of scratch space.
+ * Returns the compressed length, or zero if it does not fit in size.
+ */
+size_t conlog_lz_compress(const unsigned char* data, size_t len, unsigned char* out, size_t size, unsigned* table);
+
+/* returns the decompressed length, or -1 if the input is damaged or out is too small */
+long conlog_lz_decompress(const unsigned char* data, size_t len, unsigned char* out, size_t size);
+
+#endif
@@ -0,0 +1,161 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "manifest.h"
+
+static int manifest_space(char c)
+{
+	return (c == ' ') || (c == '\t');
+}
+
+static char* manifest_read(const char* path)
+{
+	FILE* fp = fopen(path, "rb");
+	char* text = NULL;
+	size_t len = 0, size = 0;
+
+	if (!fp)
+	{
+		return NULL;
+	}
+
+	for (;;)
+	{
+		size_t n;
+
+		if (len + 1 >= size)
+		{
+			char* p = realloc(text, size ? size * 2 : 4096);
+
+			if (!p)
+			{
+				free(text);
+				text = NULL;
+				break;
+			}
+
+			text = p;
+			size = size ? size * 2 : 4096;
+		}
+
+		n = fread(text + len, 1, size - len - 1, fp);
+
+		if (!n)
+		{
+			text[len] = 0;
+			break;
+		}
+
+		len += n;
+	}
+
+	fclose(fp);
+
+	return text;
+}
+
+int conlog_manifest_load(struct conlog_manifest* manifest, const char* path, int* line)
+{
+	char* p;
+	int size = 0, number = 0;
+
+	memset(manifest, 0, sizeof(*manifest));
+	*line = 0;
+
+	manifest->text = manifest_read(path);
+
+	if (!manifest->text)
+	{
+		return -1;
+	}
+
+	p = manifest->text;
+
+	while (*p)
+	{
+		char* end = p + strcspn(p, "\n");
+		char* next = *end ? end + 1 : end;
+		char* log;
+
+		number++;
+
+		/* the line is cut where it ends, with a carriage return or trailing spaces taken off */
+		while ((end > p) && (manifest_space(end[-1]) || (end[-1] == '\r')))
+		{
+			end--;
+		}
+
+		*end = 0;
+
+		while (manifest_space(*p))
+		{
+			p++;
+		}
+
+		if (*p && (*p != '#'))
+		{
+			log = p;
+
+			while (*p && !manifest_space(*p))
+			{
+				p++;
+			}
+
+			if (!*p)
+			{
+				*line = number;
+				break;
+			}
+
+			*p++ = 0;
+
+			while (manifest_space(*p))
+			{
+				p++;
+			}
+
+			if (manifest->count == size)
+			{
+				struct conlog_manifest_entry* entries = realloc(manifest->entries, sizeof(*entries) * (size ? size * 2 : 16));
+
+				if (!entries)
+				{
+					conlog_manifest_free(manifest);
+
+					return -1;
+				}
+
+				manifest->entries = entries;
+				size = size ? size * 2 : 16;
+			}
+
+			manifest->entries[manifest->count].log = log;
+			manifest->entries[manifest->count].command = p;
+			manifest->count++;
+		}
+
+		p = next;
+	}
+
+	if (*line)
+	{
+		conlog_manifest_free(manifest);
+	}
+
+	return 0;
+}
+
+void conlog_manifest_free(struct conlog_manifest* manifest)
+{
+	free(manifest->entries);
+	free(manifest->text);
+
+	manifest->entries = NULL;
+	manifest->text = NULL;
+	manifest->count = 0;
+}
@@ -0,0 +1,43 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_MANIFEST_H
+#define CONLOG_MANIFEST_H
+
+#include <stddef.h>
+
+/* one session, the log it writes and the command line the shell runs */
+struct conlog_manifest_entry
+{
+	const char* log;
+	const char* command;
+};
+
+/*
+ * A file of sessions, one to a line, each the log path then the command.
+ * Blank lines and lines starting with # are skipped.
+ */
+struct conlog_manifest
+{
+	char* text;
+	struct conlog_manifest_entry* entries;
+	int count;
+};
+
+struct conlog_manifest_stats
+{
+	unsigned long long sessions;
+	unsigned long long failed;
+	/* the most running at once, and the threads serving them */
+	unsigned long long peak;
+	int workers;
+};
+
+/* returns non-zero if the file cannot be read, or the number of the first line that is not valid in line */
+int conlog_manifest_load(struct conlog_manifest* manifest, const char* path, int* line);
+
+void conlog_manifest_free(struct conlog_manifest* manifest);
+
+#endif
@@ -0,0 +1,502 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "options.h"
+#include "logwriter.h"
+#include "blocklog.h"
+#include "encode.h"
+#include "flush.h"
+#include "flight.h"
+#include "share.h"
+
+/* a count with an optional K, M or G suffix, refusing one that does not fit in a size_t once scaled */
+static int options_size(const char* value, size_t* result)
+{
+	char* end = NULL;
+	unsigned long long n;
+	int shift = 0;
+
+	/* strtoull would take a sign and wrap a negative */
+	if ((*value < '0') || (*value > '9'))
+	{
+		return -1;
+	}
+
+	errno = 0;
+	n = strtoull(value, &end, 10);
+
+	if (errno)
+	{
+		return -1;
+	}
+
+	switch (*end)
+	{
+	case 'k':
+	case 'K':
+		shift = 10;
+		end++;
+		break;
+
+	case 'm':
+	case 'M':
+		shift = 20;
+		end++;
+		break;
+
+	case 'g':
+	case 'G':
+		shift = 30;
+		end++;
+		break;
+	}
+
+	if (*end || (n > (SIZE_MAX >> shift)))
+	{
+		return -1;
+	}
+
+	*result = (size_t)n << shift;
+
+	return 0;
+}
+
+static int options_number(const char* value, unsigned max, unsigned* result)
+{
+	char* end = NULL;
+	unsigned long n = strtoul(value, &end, 10);
+
+	if ((end == value) || *end || (n > max))
+	{
+		return -1;
+	}
+
+	*result = (unsigned)n;
+
+	return 0;
+}
+
+/* seconds with an optional s, m, h or d suffix */
+static int options_seconds(const char* value, unsigned* result)
+{
+	char* end = NULL;
+	unsigned long long n = strtoull(value, &end, 10);
+
+	if (end == value)
+	{
+		return -1;
+	}
+
+	switch (*end)
+	{
+	case 's':
+		end++;
+		break;
+
+	case 'm':
+		n *= 60;
+		end++;
+		break;
+
+	case 'h':
+		n *= 3600;
+		end++;
+		break;
+
+	case 'd':
+		n *= 86400;
+		end++;
+		break;
+	}
+
+	if (*end || (n > CONLOG_ROTATE_TIME_MAX))
+	{
+		return -1;
+	}
+
+	*result = (unsigned)n;
+
+	return 0;
+}
+
+/* COLSxROWS as for a terminal window */
+static int options_window(const char* value, unsigned* rows, unsigned* cols)
+{
+	char* end = NULL;
+	unsigned long c = strtoul(value, &end, 10), r;
+
+	if ((end == value) || ((*end != 'x') && (*end != 'X')))
+	{
+		return -1;
+	}
+
+	value = end + 1;
+	r = strtoul(value, &end, 10);
+
+	if ((end == value) || *end || !r || !c || (r > CONLOG_HEADLESS_MAX) || (c > CONLOG_HEADLESS_MAX))
+	{
+		return -1;
+	}
+
+	*rows = (unsigned)r;
+	*cols = (unsigned)c;
+
+	return 0;
+}
+
+static int options_path(const char* value, char* result)
+{
+	size_t len = strlen(value);
+
+	if (!len || (len >= CONLOG_OPTIONS_PATH))
+	{
+		return -1;
+	}
+
+	memcpy(result, value, len + 1);
+
+	return 0;
+}
+
+static int options_is(const char* arg, size_t len, const char* name)
+{
+	return (strlen(name) == len) && !memcmp(arg, name, len);
+}
+
+void conlog_options_init(struct conlog_options* options)
+{
+	memset(options, 0, sizeof(*options));
+
+	options->logBuffer = CONLOG_LOG_BUFFER_DEFAULT;
+	options->logOverflow = CONLOG_OVERFLOW_BLOCK;
+	options->logFormat = CONLOG_LOG_RAW;
+	options->logEncoding = CONLOG_ENCODING_RAW;
+	options->logFlush = CONLOG_FLUSH_NOW;
+	options->logSync = CONLOG_SYNC_NONE;
+	options->logIo = CONLOG_LOG_IO_WRITE;
+	options->io = CONLOG_IO_THREADS;
+	options->dsr = CONLOG_DSR_CONSOLE;
+	options->shareBuffer = CONLOG_SHARE_BUFFER_DEFAULT;
+}
+
+int conlog_options_parse(struct conlog_options* options, const char* arg)
+{
+	const char* value;
+	size_t len;
+
+	if (strncmp(arg, "--", 2))
+	{
+		return -1;
+	}
+
+	arg += 2;
+	value = strchr(arg, '=');
+
+	if (!value)
+	{
+		return -1;
+	}
+
+	len = value++ - arg;
+
+	if (options_is(arg, len, "log"))
+	{
+		return options_path(value, options->log);
+	}
+
+	if (options_is(arg, len, "record"))
+	{
+		return options_path(value, options->record);
+	}
+
+	if (options_is(arg, len, "share"))
+	{
+		return options_path(value, options->share);
+	}
+
+	if (options_is(arg, len, "share-buffer"))
+	{
+		return (options_size(value, &options->shareBuffer) || (options->shareBuffer < CONLOG_SHARE_BUFFER_MIN) || (options->shareBuffer > CONLOG_SHARE_BUFFER_MAX)) ? -1 : 0;
+	}
+
+	if (options_is(arg, len, "headless"))
+	{
+		if (!strcmp(value, "on"))
+		{
+			options->headlessRows = CONLOG_HEADLESS_ROWS;
+			options->headlessCols = CONLOG_HEADLESS_COLS;
+
+			return 0;
+		}
+
+		return options_window(value, &options->headlessRows, &options->headlessCols);
+	}
+
+	if (options_is(arg, len, "input"))
+	{
+		return options_path(value, options->input);
+	}
+
+	if (options_is(arg, len, "manifest"))
+	{
+		return options_path(value, options->manifest);
+	}
+
+	if (options_is(arg, len, "sessions"))
+	{
+		return options_number(value, CONLOG_SESSIONS_MAX, &options->sessions);
+	}
+
+	if (options_is(arg, len, "workers"))
+	{
+		return options_number(value, CONLOG_WORKERS_MAX, &options->workers);
+	}
+
+	if (options_is(arg, len, "log-rotate-size"))
+	{
+		return options_size(value, &options->logRotateSize);
+	}
+
+	if (options_is(arg, len, "log-rotate-time"))
+	{
+		return options_seconds(value, &options->logRotateTime);
+	}
+
+	if (options_is(arg, len, "log-buffer"))
+	{
+		return options_size(value, &options->logBuffer);
+	}
+
+	if (options_is(arg, len, "log-compress"))
+	{
+		if (!strcmp(value, "on"))
+		{
+			options->logCompress = CONLOG_BLOCKLOG_DEFAULT;
+
+			return 0;
+		}
+
+		return (options_size(value, &options->logCompress) || (options->logCompress > CONLOG_BLOCKLOG_MAX)) ? -1 : 0;
+	}
+
+	if (options_is(arg, len, "log-flight"))
+	{
+		return (options_size(value, &options->logFlight) || (options->logFlight > CONLOG_FLIGHT_MAX)) ? -1 : 0;
+	}
+
+	if (options_is(arg, len, "log-overflow"))
+	{
+		if (!strcmp(value, "block"))
+		{
+			options->logOverflow = CONLOG_OVERFLOW_BLOCK;
+		}
+		else if (!strcmp(value, "drop"))
+		{
+			options->logOverflow = CONLOG_OVERFLOW_DROP;
+		}
+		else if (!strcmp(value, "spill"))
+		{
+			options->logOverflow = CONLOG_OVERFLOW_SPILL;
+		}
+		else
+		{
+			return -1;
+		}
+
+		return 0;
+	}
+
+	if (options_is(arg, len, "log-format"))
+	{
+		if (!strcmp(value, "raw"))
+		{
+			options->logFormat = CONLOG_LOG_RAW;
+		}
+		else if (!strcmp(value, "text"))
+		{
+			options->logFormat = CONLOG_LOG_TEXT;
+		}
+		else if (!strcmp(value, "lines"))
+		{
+			options->logFormat = CONLOG_LOG_LINES;
+		}
+		else
+		{
+			return -1;
+		}
+
+		return 0;
+	}
+
+	if (options_is(arg, len, "log-flush"))
+	{
+		size_t n = strlen(value);
+
+		if (!strcmp(value, "now"))
+		{
+			options->logFlush = CONLOG_FLUSH_NOW;
+		}
+		else if (!strcmp(value, "line"))
+		{
+			options->logFlush = CONLOG_FLUSH_LINE;
+		}
+		else if ((n > 2) && !strcmp(value + n - 2, "ms"))
+		{
+			char number[16];
+
+			if (n - 2 >= sizeof(number))
+			{
+				return -1;
+			}
+
+			memcpy(number, value, n - 2);
+			number[n - 2] = 0;
+
+			if (options_number(number, CONLOG_FLUSH_TIME_MAX, &options->logFlushTime) || !options->logFlushTime)
+			{
+				return -1;
+			}
+
+			options->logFlush = CONLOG_FLUSH_TIME;
+		}
+		else if (!options_size(value, &options->logFlushSize) && options->logFlushSize && (options->logFlushSize <= CONLOG_FLUSH_MAX))
+		{
+			options->logFlush = CONLOG_FLUSH_SIZE;
+		}
+		else
+		{
+			return -1;
+		}
+
+		return 0;
+	}
+
+	if (options_is(arg, len, "log-sync"))
+	{
+		if (!strcmp(value, "none"))
+		{
+			options->logSync = CONLOG_SYNC_NONE;
+		}
+		else if (!strcmp(value, "exit"))
+		{
+			options->logSync = CONLOG_SYNC_EXIT;
+		}
+		else if (!options_seconds(value, &options->logSyncTime) && options->logSyncTime)
+		{
+			options->logSync = CONLOG_SYNC_PERIODIC;
+		}
+		else
+		{
+			return -1;
+		}
+
+		return 0;
+	}
+
+	if (options_is(arg, len, "log-encoding"))
+	{
+		size_t n = strlen(value);
+
+		if (!strcmp(value, "raw"))
+		{
+			options->logEncoding = CONLOG_ENCODING_RAW;
+		}
+		else if (!strcmp(value, "utf8"))
+		{
+			options->logEncoding = CONLOG_ENCODING_UTF8;
+		}
+		else if (!strcmp(value, "utf16"))
+		{
+			options->logEncoding = CONLOG_ENCODING_UTF16;
+		}
+		else if (n && (n < sizeof(options->logCodePage)))
+		{
+			/* whether the platform knows it is found out when it is opened */
+			options->logEncoding = CONLOG_ENCODING_CODEPAGE;
+			memcpy(options->logCodePage, value, n + 1);
+		}
+		else
+		{
+			return -1;
+		}
+
+		return 0;
+	}
+
+	if (options_is(arg, len, "log-io"))
+	{
+		if (!strcmp(value, "write"))
+		{
+			options->logIo = CONLOG_LOG_IO_WRITE;
+		}
+		else if (!strcmp(value, "uring"))
+		{
+			options->logIo = CONLOG_LOG_IO_URING;
+		}
+		else
+		{
+			return -1;
+		}
+
+		return 0;
+	}
+
+	if (options_is(arg, len, "io"))
+	{
+		if (!strcmp(value, "threads"))
+		{
+			options->io = CONLOG_IO_THREADS;
+		}
+		else if (!strcmp(value, "events"))
+		{
+			options->io = CONLOG_IO_EVENTS;
+		}
+		else
+		{
+			return -1;
+		}
+
+		return 0;
+	}
+
+	if (options_is(arg, len, "dsr"))
+	{
+		if (!strcmp(value, "console"))
+		{
+			options->dsr = CONLOG_DSR_CONSOLE;
+		}
+		else if (!strcmp(value, "screen"))
+		{
+			options->dsr = CONLOG_DSR_SCREEN;
+		}
+		else
+		{
+			return -1;
+		}
+
+		return 0;
+	}
+
+	if (options_is(arg, len, "frame-rate"))
+	{
+		return options_number(value, CONLOG_FRAME_RATE_MAX, &options->frameRate);
+	}
+
+	if (options_is(arg, len, "stats"))
+	{
+		return options_path(value, options->stats);
+	}
+
+	if (options_is(arg, len, "trace"))
+	{
+		return options_path(value, options->trace);
+	}
+
+	return -1;
+}
@@ -0,0 +1,90 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_OPTIONS_H
+#define CONLOG_OPTIONS_H
+
+#include <stddef.h>
+
+#define CONLOG_LOG_BUFFER_DEFAULT	(1 << 20)
+#define CONLOG_OPTIONS_PATH			1024
+#define CONLOG_FRAME_RATE_MAX		1000
+#define CONLOG_ROTATE_TIME_MAX		(366 * 86400)
+#define CONLOG_OPTIONS_CODEPAGE		64
+#define CONLOG_HEADLESS_ROWS		24
+#define CONLOG_HEADLESS_COLS		80
+#define CONLOG_HEADLESS_MAX			1000
+#define CONLOG_WORKERS_MAX			256
+#define CONLOG_SESSIONS_MAX			65536
+
+/* how the child is serviced */
+#define CONLOG_IO_THREADS	0
+#define CONLOG_IO_EVENTS	1
+
+/* what the log is given */
+#define CONLOG_LOG_RAW		0
+#define CONLOG_LOG_TEXT		1
+#define CONLOG_LOG_LINES	2
+
+/* how the log file is written */
+#define CONLOG_LOG_IO_WRITE	0
+#define CONLOG_LOG_IO_URING	1
+
+/* who answers cursor position requests */
+#define CONLOG_DSR_CONSOLE	0
+#define CONLOG_DSR_SCREEN	1
+
+struct conlog_options
+{
+	size_t logBuffer;
+	/* block size for a compressed log, zero writes it as it is */
+	size_t logCompress;
+	int logOverflow;
+	int logFormat;
+	/* when the log file is written to and made durable, see flush.h */
+	int logFlush;
+	size_t logFlushSize;
+	unsigned logFlushTime;
+	int logSync;
+	unsigned logSyncTime;
+	/* what the log is written in, with the code page name if it is one */
+	int logEncoding;
+	char logCodePage[CONLOG_OPTIONS_CODEPAGE];
+	/* the last output kept in memory and written only when the child fails, zero writes it all */
+	size_t logFlight;
+	/* io_uring where the platform has it, plain writes otherwise */
+	int logIo;
+	/* a log file conlog opens itself, and when to rotate it */
+	char log[CONLOG_OPTIONS_PATH];
+	size_t logRotateSize;
+	unsigned logRotateTime;
+	int io;
+	int dsr;
+	/* console frames per second, zero passes every byte to the console */
+	unsigned frameRate;
+	/* a timed recording of the session for replay */
+	char record[CONLOG_OPTIONS_PATH];
+	/* where viewers connect to watch the session live, and the output held for them */
+	char share[CONLOG_OPTIONS_PATH];
+	size_t shareBuffer;
+	/* no console, the child is given a terminal of this size, zero when there is a console */
+	unsigned headlessRows, headlessCols;
+	/* what a headless child reads, - for stdin, empty for nothing */
+	char input[CONLOG_OPTIONS_PATH];
+	/* sessions run together from a manifest, how many at once and the threads serving them, zero for all and for one per processor */
+	char manifest[CONLOG_OPTIONS_PATH];
+	unsigned sessions;
+	unsigned workers;
+	char stats[CONLOG_OPTIONS_PATH];
+	/* Chrome trace JSON written at the end, needs a build with CONLOG_TRACE */
+	char trace[CONLOG_OPTIONS_PATH];
+};
+
+void conlog_options_init(struct conlog_options* options);
+
+/* parses one --name=value argument, returns non-zero if it is not valid */
+int conlog_options_parse(struct conlog_options* options, const char* arg);
+
+#endif
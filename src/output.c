@@ -0,0 +1,168 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <string.h>
+#include "output.h"
+#include "platform.h"
+#include "trace.h"
+
+void conlog_output_init(struct conlog_output* output)
+{
+	memset(output, 0, sizeof(*output));
+}
+
+int conlog_output_add(struct conlog_output* output, conlog_output_fn write, void* context)
+{
+	struct conlog_output_channel* channel;
+
+	if (output->nChannels == CONLOG_OUTPUT_CHANNELS)
+	{
+		return -1;
+	}
+
+	channel = output->channels + output->nChannels;
+
+	channel->write = write;
+	channel->context = context;
+	channel->text = 0;
+
+	output->stats.channels = output->nChannels + 1;
+
+	return output->nChannels++;
+}
+
+int conlog_output_add_text(struct conlog_output* output, conlog_output_fn write, void* context)
+{
+	int index = conlog_output_add(output, write, context);
+
+	if (index >= 0)
+	{
+		output->channels[index].text = 1;
+		output->nText++;
+	}
+
+	return index;
+}
+
+/* sends one of the lists to the channels that take it */
+static void output_send(struct conlog_output* output, int text)
+{
+	int nChannels = output->nChannels;
+	struct conlog_output_channel* channel = output->channels;
+	struct conlog_iovec* iov = text ? output->textIov : output->iov;
+	int* count = text ? &output->textCount : &output->iovCount;
+
+	if (output->bTimed && !(output->stats.flushes & (CONLOG_OUTPUT_SAMPLE - 1)))
+	{
+		struct conlog_histogram* time = output->stats.channelTime;
+		unsigned long long t = conlog_clock();
+
+		while (nChannels--)
+		{
+			if (channel->text == text)
+			{
+				unsigned long long now;
+
+				channel->write(channel->context, iov, *count);
+				CONLOG_TRACE_SPAN("flush", t, channel - output->channels);
+
+				now = conlog_clock();
+				conlog_histogram_add(time, now - t);
+				t = now;
+			}
+
+			channel++;
+			time++;
+		}
+	}
+	else
+	{
+		while (nChannels--)
+		{
+			if (channel->text == text)
+			{
+				unsigned long long t = CONLOG_TRACE_CLOCK();
+
+				channel->write(channel->context, iov, *count);
+				CONLOG_TRACE_SPAN("flush", t, channel - output->channels);
+			}
+
+			channel++;
+		}
+	}
+
+	output->stats.flushes++;
+	output->stats.vectors += *count;
+	*count = 0;
+}
+
+void conlog_output_write(struct conlog_output* output, const unsigned char* data, size_t len)
+{
+	if (len)
+	{
+		if (output->iovCount)
+		{
+			struct conlog_iovec* last = output->iov + output->iovCount - 1;
+
+			if (last->data + last->len == data)
+			{
+				last->len += len;
+				output->stats.bytesWritten += len;
+
+				return;
+			}
+
+			if (output->iovCount == CONLOG_OUTPUT_IOV)
+			{
+				output_send(output, 0);
+			}
+		}
+
+		output->iov[output->iovCount].data = data;
+		output->iov[output->iovCount++].len = len;
+		output->stats.bytesWritten += len;
+	}
+}
+
+void conlog_output_text(struct conlog_output* output, const unsigned char* data, size_t len)
+{
+	if (len)
+	{
+		output->stats.bytesText += len;
+
+		if (output->textCount)
+		{
+			struct conlog_iovec* last = output->textIov + output->textCount - 1;
+
+			if (last->data + last->len == data)
+			{
+				last->len += len;
+
+				return;
+			}
+
+			if (output->textCount == CONLOG_OUTPUT_IOV)
+			{
+				output_send(output, 1);
+			}
+		}
+
+		output->textIov[output->textCount].data = data;
+		output->textIov[output->textCount++].len = len;
+	}
+}
+
+void conlog_output_flush(struct conlog_output* output)
+{
+	if (output->iovCount)
+	{
+		output_send(output, 0);
+	}
+
+	if (output->textCount)
+	{
+		output_send(output, 1);
+	}
+}
@@ -0,0 +1,79 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_OUTPUT_H
+#define CONLOG_OUTPUT_H
+
+#include <stddef.h>
+#include "histogram.h"
+
+#define CONLOG_OUTPUT_CHANNELS	8
+#define CONLOG_OUTPUT_IOV		16
+/* when timed, one flush in this many is, a power of two */
+#define CONLOG_OUTPUT_SAMPLE	64
+
+struct conlog_iovec
+{
+	const unsigned char* data;
+	size_t len;
+};
+
+typedef void (*conlog_output_fn)(void* context, const struct conlog_iovec* iov, int count);
+
+/* makes what a channel has written durable */
+typedef void (*conlog_sync_fn)(void* context);
+
+struct conlog_output_channel
+{
+	conlog_output_fn write;
+	void* context;
+	/* given the text with the escape sequences taken out */
+	int text;
+};
+
+struct conlog_output_stats
+{
+	unsigned long long bytesRead;
+	unsigned long long bytesWritten;
+	unsigned long long bytesCopied;
+	unsigned long long flushes;
+	unsigned long long vectors;
+	unsigned long long bytesText;
+	/* sequences the backend is told about rather than the console */
+	unsigned long long dsr;
+	unsigned long long focus;
+	/* bytes in each read from the child */
+	struct conlog_histogram reads;
+	/* nanoseconds each channel took to take a flush, for one flush in CONLOG_OUTPUT_SAMPLE when timed */
+	int channels;
+	struct conlog_histogram channelTime[CONLOG_OUTPUT_CHANNELS];
+};
+
+struct conlog_output
+{
+	int nChannels;
+	struct conlog_output_channel channels[CONLOG_OUTPUT_CHANNELS];
+	int iovCount;
+	struct conlog_iovec iov[CONLOG_OUTPUT_IOV];
+	int nText;
+	int textCount;
+	struct conlog_iovec textIov[CONLOG_OUTPUT_IOV];
+	/* set when the statistics are wanted, reading the clock on the sampled flushes is the only cost */
+	int bTimed;
+	struct conlog_output_stats stats;
+};
+
+void conlog_output_init(struct conlog_output* output);
+int conlog_output_add(struct conlog_output* output, conlog_output_fn write, void* context);
+/* a channel given only the text between escape sequences */
+int conlog_output_add_text(struct conlog_output* output, conlog_output_fn write, void* context);
+
+/* records a range to send, data must stay valid until the next flush */
+void conlog_output_write(struct conlog_output* output, const unsigned char* data, size_t len);
+/* records a range of text for the text channels, under the same rule */
+void conlog_output_text(struct conlog_output* output, const unsigned char* data, size_t len);
+void conlog_output_flush(struct conlog_output* output);
+
+#endif
@@ -0,0 +1,125 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_PLATFORM_H
+#define CONLOG_PLATFORM_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#	include <windows.h>
+typedef SRWLOCK conlog_mutex;
+typedef CONDITION_VARIABLE conlog_cond;
+typedef HANDLE conlog_file;
+typedef UINT conlog_codepage;
+struct conlog_thread
+{
+	HANDLE handle;
+	void (*start)(void*);
+	void* arg;
+};
+/* a named pipe, the next instance waits for the next viewer */
+struct conlog_listener
+{
+	HANDLE pipe;
+	HANDLE connected, stop;
+	char path[256];
+};
+struct conlog_viewer
+{
+	HANDLE pipe;
+	HANDLE written, hangup;
+};
+#	define conlog_atomic_load(p) ((size_t)InterlockedCompareExchangePointer((PVOID volatile*)(p), NULL, NULL))
+#	define conlog_atomic_store(p, v) ((void)InterlockedExchangePointer((PVOID volatile*)(p), (PVOID)(size_t)(v)))
+#	define conlog_atomic_exchange(p, v) ((size_t)InterlockedExchangePointer((PVOID volatile*)(p), (PVOID)(size_t)(v)))
+#else
+#	include <pthread.h>
+#	include <iconv.h>
+typedef pthread_mutex_t conlog_mutex;
+typedef pthread_cond_t conlog_cond;
+typedef int conlog_file;
+typedef iconv_t conlog_codepage;
+struct conlog_thread
+{
+	pthread_t handle;
+	void (*start)(void*);
+	void* arg;
+};
+/* a Unix domain socket, removed again when closed */
+struct conlog_listener
+{
+	int fd;
+	char path[108];
+};
+struct conlog_viewer
+{
+	int fd;
+};
+#	define conlog_atomic_load(p) __atomic_load_n((p), __ATOMIC_SEQ_CST)
+#	define conlog_atomic_store(p, v) __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+#	define conlog_atomic_exchange(p, v) __atomic_exchange_n((p), (v), __ATOMIC_SEQ_CST)
+#endif
+
+/* monotonic time in nanoseconds */
+unsigned long long conlog_clock(void);
+
+/* processor time this process has used in nanoseconds, and the most memory it has had resident in bytes */
+void conlog_process_usage(unsigned long long* cpu, unsigned long long* peak);
+
+/* returns 0, or the error that stopped the thread starting */
+int conlog_thread_start(struct conlog_thread* thread, void (*start)(void*), void* arg);
+void conlog_thread_join(struct conlog_thread* thread);
+
+void conlog_mutex_init(conlog_mutex* mutex);
+void conlog_mutex_lock(conlog_mutex* mutex);
+void conlog_mutex_unlock(conlog_mutex* mutex);
+void conlog_mutex_destroy(conlog_mutex* mutex);
+
+void conlog_cond_init(conlog_cond* cond);
+void conlog_cond_wait(conlog_cond* cond, conlog_mutex* mutex);
+/* returns early when signalled */
+void conlog_cond_timedwait(conlog_cond* cond, conlog_mutex* mutex, unsigned ms);
+void conlog_cond_signal(conlog_cond* cond);
+void conlog_cond_broadcast(conlog_cond* cond);
+void conlog_cond_destroy(conlog_cond* cond);
+
+struct conlog_iovec;
+
+/* opens a file for appending, creating it if needed, it can be renamed while open */
+int conlog_file_open(conlog_file* file, const char* path);
+void conlog_file_write(conlog_file file, const struct conlog_iovec* iov, int count);
+void conlog_file_close(conlog_file file);
+/* waits until what has been written is on the disk */
+int conlog_file_sync(conlog_file file);
+/* how big the file is now, 0 if it cannot tell */
+unsigned long long conlog_file_size(conlog_file file);
+/* replaces to if it exists */
+int conlog_file_rename(const char* from, const char* to);
+/* fopen, on Windows without the CRT's deprecation and shared as fopen shares it */
+FILE* conlog_fopen(const char* path, const char* mode);
+
+/* a legacy code page by name, acp for the system's own */
+int conlog_codepage_open(conlog_codepage* cp, const char* name);
+/* returns the bytes written, characters the code page does not have become ? */
+size_t conlog_codepage_encode(conlog_codepage cp, const unsigned short* wide, size_t count, unsigned char* out, size_t size);
+void conlog_codepage_close(conlog_codepage cp);
+
+/* a local endpoint viewers connect to, a socket path or a pipe name such as \\.\pipe\conlog */
+int conlog_listener_open(struct conlog_listener* listener, const char* path);
+/* waits for the next viewer, fails once the listener is stopped */
+int conlog_listener_accept(struct conlog_listener* listener, struct conlog_viewer* viewer);
+/* wakes an accept waiting on another thread, which then fails */
+void conlog_listener_stop(struct conlog_listener* listener);
+void conlog_listener_close(struct conlog_listener* listener);
+
+/* sends all of it, fails once the viewer has gone or been hung up */
+int conlog_viewer_send(struct conlog_viewer* viewer, const void* data, size_t len);
+/* makes a send waiting on another thread fail, and every send after it */
+void conlog_viewer_hangup(struct conlog_viewer* viewer);
+void conlog_viewer_close(struct conlog_viewer* viewer);
+
+#endif
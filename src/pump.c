@@ -0,0 +1,116 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include "pump.h"
+#include "trace.h"
+
+static void pump_pass(void* context, const unsigned char* data, size_t len)
+{
+	struct conlog_pump* pump = context;
+
+	conlog_output_write(&pump->output, data, len);
+
+	if (pump->render)
+	{
+		conlog_render_lock(pump->render);
+		conlog_screen_feed(pump->screen, data, len);
+		conlog_render_unlock(pump->render);
+	}
+	else if (pump->screen)
+	{
+		conlog_screen_feed(pump->screen, data, len);
+	}
+}
+
+static void pump_text(void* context, const unsigned char* data, size_t len)
+{
+	struct conlog_pump* pump = context;
+
+	conlog_output_text(&pump->output, data, len);
+}
+
+static int pump_report(void* context, int event)
+{
+	struct conlog_pump* pump = context;
+
+	switch (event)
+	{
+	case CONLOG_VT_DSR_CPR:
+		pump->output.stats.dsr++;
+
+		if (pump->screen)
+		{
+			char reply[32];
+			int n;
+
+			if (pump->render)
+			{
+				conlog_render_lock(pump->render);
+				n = conlog_screen_report(pump->screen, reply, sizeof(reply));
+				conlog_render_unlock(pump->render);
+			}
+			else
+			{
+				n = conlog_screen_report(pump->screen, reply, sizeof(reply));
+			}
+
+			return pump->backend->reply(pump->context, reply, n);
+		}
+
+		/* the reply must follow everything already written */
+		conlog_output_flush(&pump->output);
+
+		return pump->backend->cursor(pump->context);
+
+	case CONLOG_VT_FOCUS_ON:
+		pump->output.stats.focus++;
+		pump->backend->focus(pump->context, 1);
+		break;
+
+	case CONLOG_VT_FOCUS_OFF:
+		pump->output.stats.focus++;
+		pump->backend->focus(pump->context, 0);
+		break;
+
+	/* taken out so the console does not bracket the pastes as well */
+	case CONLOG_VT_PASTE_ON:
+	case CONLOG_VT_PASTE_OFF:
+		if (pump->backend->paste)
+		{
+			return pump->backend->paste(pump->context, event == CONLOG_VT_PASTE_ON);
+		}
+		break;
+	}
+
+	return 0;
+}
+
+void conlog_pump_init(struct conlog_pump* pump, const struct conlog_backend* backend, void* context)
+{
+	conlog_vt_init(&pump->vt);
+	conlog_output_init(&pump->output);
+
+	pump->backend = backend;
+	pump->context = context;
+	pump->screen = NULL;
+	pump->render = NULL;
+}
+
+void conlog_pump_data(struct conlog_pump* pump, const unsigned char* data, size_t len)
+{
+	static const struct conlog_vt_handler handler = { pump_pass, pump_report, NULL };
+	static const struct conlog_vt_handler textHandler = { pump_pass, pump_report, pump_text };
+	unsigned long long t = CONLOG_TRACE_CLOCK();
+
+	pump->output.stats.bytesRead += len;
+	conlog_histogram_add(&pump->output.stats.reads, len);
+
+	conlog_vt_parse(&pump->vt, data, len, pump->output.nText ? &textHandler : &handler, pump);
+	conlog_output_flush(&pump->output);
+
+	pump->output.stats.bytesCopied = pump->vt.copied;
+
+	CONLOG_TRACE_SPAN("parse", t, len);
+}
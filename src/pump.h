@@ -0,0 +1,45 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_PUMP_H
+#define CONLOG_PUMP_H
+
+#include "vtparse.h"
+#include "output.h"
+#include "screen.h"
+#include "render.h"
+
+/* what a platform backend does with the sequences the parser reports */
+struct conlog_backend
+{
+	/* the application asked for the cursor position, return non-zero if the backend answers it */
+	int (*cursor)(void* context);
+	/* the application turned focus reporting on or off */
+	void (*focus)(void* context, int enable);
+	/* sends bytes to the input of the child, returns non-zero once sent */
+	int (*reply)(void* context, const char* data, size_t len);
+	/* optional, the application turned bracketed paste on or off, return non-zero if the backend brackets pastes itself */
+	int (*paste)(void* context, int enable);
+};
+
+/* carries the output of the child through the parser to the channels */
+struct conlog_pump
+{
+	struct conlog_vt vt;
+	struct conlog_output output;
+	const struct conlog_backend* backend;
+	void* context;
+	/* when set, cursor position requests are answered from the model */
+	struct conlog_screen* screen;
+	/* when set, the model is drawn to the console by the renderer and changed under its lock */
+	struct conlog_render* render;
+};
+
+void conlog_pump_init(struct conlog_pump* pump, const struct conlog_backend* backend, void* context);
+
+/* parses one read from the child and flushes it to every channel */
+void conlog_pump_data(struct conlog_pump* pump, const unsigned char* data, size_t len);
+
+#endif
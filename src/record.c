@@ -0,0 +1,826 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef _WIN32
+#	define _FILE_OFFSET_BITS 64
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "record.h"
+#include "trace.h"
+
+#ifdef _WIN32
+#	define record_seek(fp, offset) _fseeki64((fp), (long long)(offset), SEEK_SET)
+#	define record_tell(fp) ((unsigned long long)_ftelli64(fp))
+#	define record_seek_end(fp) _fseeki64((fp), 0, SEEK_END)
+#else
+#	define record_seek(fp, offset) fseeko((fp), (off_t)(offset), SEEK_SET)
+#	define record_tell(fp) ((unsigned long long)ftello(fp))
+#	define record_seek_end(fp) fseeko((fp), 0, SEEK_END)
+#endif
+
+#define RECORD_MAGIC		"CONLOGR1"
+#define RECORD_FOOTER		"CONLOGRI"
+#define RECORD_HEADER		24
+#define RECORD_VARINT		10
+#define RECORD_KEYFRAME		12
+
+static void record_put16(unsigned char* p, unsigned v)
+{
+	p[0] = (unsigned char)v;
+	p[1] = (unsigned char)(v >> 8);
+}
+
+static void record_put64(unsigned char* p, unsigned long long v)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+	{
+		p[i] = (unsigned char)(v >> (i * 8));
+	}
+}
+
+static unsigned record_get16(const unsigned char* p)
+{
+	return p[0] | ((unsigned)p[1] << 8);
+}
+
+static unsigned long long record_get64(const unsigned char* p)
+{
+	unsigned long long v = 0;
+	int i;
+
+	for (i = 7; i >= 0; i--)
+	{
+		v = (v << 8) | p[i];
+	}
+
+	return v;
+}
+
+static unsigned char* record_put_varint(unsigned char* p, unsigned long long v)
+{
+	while (v >= 0x80)
+	{
+		*p++ = (unsigned char)(v | 0x80);
+		v >>= 7;
+	}
+
+	*p++ = (unsigned char)v;
+
+	return p;
+}
+
+/* records in memory were written by this process, so are trusted */
+static const unsigned char* record_get_varint(const unsigned char* p, unsigned long long* v)
+{
+	int shift = 0;
+
+	*v = 0;
+
+	do
+	{
+		*v |= (unsigned long long)(*p & 0x7F) << shift;
+		shift += 7;
+	} while (*p++ & 0x80);
+
+	return p;
+}
+
+static void record_emit(struct conlog_record* record, const struct conlog_iovec* iov, int count)
+{
+	int i;
+
+	record->write(record->context, iov, count);
+
+	for (i = 0; i < count; i++)
+	{
+		record->offset += iov[i].len;
+		record->stats.bytesWritten += iov[i].len;
+	}
+}
+
+static int record_frame_reserve(struct conlog_record* record, size_t len)
+{
+	if (record->frameLen + len > record->frameSize)
+	{
+		size_t size = record->frameSize ? record->frameSize : 4096;
+		unsigned char* frame;
+
+		while (size < record->frameLen + len)
+		{
+			size <<= 1;
+		}
+
+		frame = realloc(record->frame, size);
+
+		if (!frame)
+		{
+			return -1;
+		}
+
+		record->frame = frame;
+		record->frameSize = size;
+	}
+
+	return 0;
+}
+
+static void record_frame_put(struct conlog_record* record, const char* data, size_t len)
+{
+	if (!record_frame_reserve(record, len))
+	{
+		memcpy(record->frame + record->frameLen, data, len);
+		record->frameLen += len;
+	}
+}
+
+/* the renderer draws the keyframe into the frame buffer */
+static void record_frame_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	struct conlog_record* record = context;
+
+	while (count--)
+	{
+		record_frame_put(record, (const char*)iov->data, iov->len);
+		iov++;
+	}
+}
+
+/* the screen as the model has it, with the time and size */
+static void record_keyframe(struct conlog_record* record)
+{
+	struct conlog_screen* screen = &record->screen;
+	unsigned char head[1 + 2 * RECORD_VARINT + RECORD_KEYFRAME];
+	unsigned char* p = head;
+	struct conlog_iovec iov[2];
+
+	record->frameLen = 0;
+
+	conlog_render_full(&record->render);
+
+	if (record->count == record->capacity)
+	{
+		size_t capacity = record->capacity ? record->capacity * 2 : 256;
+		struct conlog_record_entry* index = realloc(record->index, sizeof(*index) * capacity);
+
+		if (index)
+		{
+			record->index = index;
+			record->capacity = capacity;
+		}
+	}
+
+	/* a keyframe missing from the index is still found by walking the records */
+	if (record->count < record->capacity)
+	{
+		record->index[record->count].time = record->time;
+		record->index[record->count].offset = record->offset;
+		record->count++;
+	}
+
+	*p++ = CONLOG_RECORD_KEYFRAME;
+	p = record_put_varint(p, 0);
+	p = record_put_varint(p, RECORD_KEYFRAME + record->frameLen);
+	record_put64(p, record->time);
+	record_put16(p + 8, screen->rows);
+	record_put16(p + 10, screen->cols);
+	p += RECORD_KEYFRAME;
+
+	iov[0].data = head;
+	iov[0].len = p - head;
+	iov[1].data = record->frame;
+	iov[1].len = record->frameLen;
+
+	record_emit(record, iov, 2);
+
+	record->stats.keyframes++;
+	record->keyframeTime = record->time;
+	record->keyframeBytes = 0;
+}
+
+/* writes the records taken from the producers, feeding the output to the model for the keyframes */
+static void record_process(struct conlog_record* record, const unsigned char* data, size_t len)
+{
+	const unsigned char* p = data;
+	const unsigned char* end = data + len;
+	const unsigned char* segment = data;
+
+	while (p < end)
+	{
+		int type = *p;
+		unsigned long long delta, n;
+		const unsigned char* payload = record_get_varint(record_get_varint(p + 1, &delta), &n);
+
+		record->time += delta;
+		p = payload + n;
+
+		switch (type)
+		{
+		case CONLOG_RECORD_OUTPUT:
+			conlog_screen_feed(&record->screen, payload, (size_t)n);
+			record->keyframeBytes += n;
+
+			if ((record->keyframeBytes >= CONLOG_RECORD_KEYFRAME_BYTES) || (record->time - record->keyframeTime >= CONLOG_RECORD_KEYFRAME_TIME))
+			{
+				struct conlog_iovec iov;
+
+				iov.data = segment;
+				iov.len = p - segment;
+
+				record_emit(record, &iov, 1);
+				record_keyframe(record);
+
+				segment = p;
+			}
+			break;
+
+		case CONLOG_RECORD_RESIZE:
+			conlog_screen_resize(&record->screen, record_get16(payload), record_get16(payload + 2));
+			break;
+		}
+	}
+
+	if (end > segment)
+	{
+		struct conlog_iovec iov;
+
+		iov.data = segment;
+		iov.len = end - segment;
+
+		record_emit(record, &iov, 1);
+	}
+}
+
+static void record_main(void* arg)
+{
+	struct conlog_record* record = arg;
+
+	CONLOG_TRACE_THREAD("record");
+
+	conlog_mutex_lock(&record->mutex);
+
+	for (;;)
+	{
+		unsigned char* data;
+		size_t len, size;
+
+		while (!record->pendingLen && !record->stopping)
+		{
+			record->writerWaiting = 1;
+			conlog_cond_wait(&record->dataReady, &record->mutex);
+			record->writerWaiting = 0;
+		}
+
+		if (!record->pendingLen)
+		{
+			break;
+		}
+
+		data = record->pending;
+		len = record->pendingLen;
+		size = record->pendingSize;
+
+		record->pending = record->working;
+		record->pendingSize = record->workingSize;
+		record->pendingLen = 0;
+		record->working = data;
+		record->workingSize = size;
+
+		if (record->producerWaiting)
+		{
+			conlog_cond_signal(&record->spaceReady);
+		}
+
+		conlog_mutex_unlock(&record->mutex);
+
+		record_process(record, data, len);
+
+		conlog_mutex_lock(&record->mutex);
+	}
+
+	conlog_mutex_unlock(&record->mutex);
+}
+
+static void record_append(struct conlog_record* record, int type, const struct conlog_iovec* iov, int count)
+{
+	size_t len = 0, need;
+	unsigned long long t;
+	unsigned char* p;
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		len += iov[i].len;
+	}
+
+	need = 1 + 2 * RECORD_VARINT + len;
+
+	conlog_mutex_lock(&record->mutex);
+
+	while (record->pendingLen && (record->pendingLen + need > record->pendingSize))
+	{
+		record->stats.stalls++;
+		record->producerWaiting = 1;
+
+		if (record->writerWaiting)
+		{
+			conlog_cond_signal(&record->dataReady);
+		}
+
+		conlog_cond_wait(&record->spaceReady, &record->mutex);
+		record->producerWaiting = 0;
+	}
+
+	/* a record larger than the buffer gets a buffer of its own */
+	if (need > record->pendingSize)
+	{
+		unsigned char* pending = realloc(record->pending, need);
+
+		if (!pending)
+		{
+			conlog_mutex_unlock(&record->mutex);
+			return;
+		}
+
+		record->pending = pending;
+		record->pendingSize = need;
+	}
+
+	/* taken under the mutex so the times are in the order of the records */
+	t = (conlog_clock() - record->start) / 1000;
+
+	p = record->pending + record->pendingLen;
+	*p++ = (unsigned char)type;
+	p = record_put_varint(p, t - record->last);
+	p = record_put_varint(p, len);
+
+	for (i = 0; i < count; i++)
+	{
+		memcpy(p, iov[i].data, iov[i].len);
+		p += iov[i].len;
+	}
+
+	record->pendingLen = p - record->pending;
+	record->last = t;
+	record->stats.records++;
+	record->stats.bytesRecorded += len;
+
+	if (record->writerWaiting)
+	{
+		conlog_cond_signal(&record->dataReady);
+	}
+
+	conlog_mutex_unlock(&record->mutex);
+}
+
+int conlog_record_start(struct conlog_record* record, int rows, int cols, conlog_output_fn write, void* context)
+{
+	unsigned char header[RECORD_HEADER];
+	struct conlog_iovec iov;
+
+	memset(record, 0, sizeof(*record));
+
+	record->write = write;
+	record->context = context;
+	record->pending = malloc(CONLOG_RECORD_BUFFER);
+	record->working = malloc(CONLOG_RECORD_BUFFER);
+	record->pendingSize = CONLOG_RECORD_BUFFER;
+	record->workingSize = CONLOG_RECORD_BUFFER;
+
+	if (!(record->pending && record->working) || conlog_screen_init(&record->screen, rows, cols))
+	{
+		free(record->pending);
+		free(record->working);
+
+		return -1;
+	}
+
+	if (conlog_render_init(&record->render, &record->screen, 1, record_frame_write, record))
+	{
+		conlog_screen_free(&record->screen);
+		free(record->pending);
+		free(record->working);
+
+		return -1;
+	}
+
+	conlog_mutex_init(&record->mutex);
+	conlog_cond_init(&record->dataReady);
+	conlog_cond_init(&record->spaceReady);
+
+	memcpy(header, RECORD_MAGIC, 8);
+	record_put16(header + 8, rows);
+	record_put16(header + 10, cols);
+	memset(header + 12, 0, 4);
+	record_put64(header + 16, (unsigned long long)time(NULL));
+
+	iov.data = header;
+	iov.len = sizeof(header);
+
+	record_emit(record, &iov, 1);
+	record_keyframe(record);
+
+	record->start = conlog_clock();
+
+	if (conlog_thread_start(&record->thread, record_main, record))
+	{
+		conlog_cond_destroy(&record->spaceReady);
+		conlog_cond_destroy(&record->dataReady);
+		conlog_mutex_destroy(&record->mutex);
+		conlog_render_stop(&record->render);
+		conlog_screen_free(&record->screen);
+		free(record->pending);
+		free(record->working);
+		free(record->frame);
+		free(record->index);
+
+		return -1;
+	}
+
+	return 0;
+}
+
+void conlog_record_output(void* context, const struct conlog_iovec* iov, int count)
+{
+	record_append(context, CONLOG_RECORD_OUTPUT, iov, count);
+}
+
+void conlog_record_input(struct conlog_record* record, const void* data, size_t len)
+{
+	struct conlog_iovec iov;
+
+	iov.data = data;
+	iov.len = len;
+
+	record_append(record, CONLOG_RECORD_INPUT, &iov, 1);
+}
+
+void conlog_record_resize(struct conlog_record* record, int rows, int cols)
+{
+	unsigned char size[4];
+	struct conlog_iovec iov;
+
+	record_put16(size, rows);
+	record_put16(size + 2, cols);
+
+	iov.data = size;
+	iov.len = sizeof(size);
+
+	record_append(record, CONLOG_RECORD_RESIZE, &iov, 1);
+}
+
+void conlog_record_stop(struct conlog_record* record)
+{
+	unsigned char footer[24];
+	unsigned long long indexOffset;
+	struct conlog_iovec iov;
+	size_t i;
+
+	conlog_mutex_lock(&record->mutex);
+	record->stopping = 1;
+	conlog_cond_signal(&record->dataReady);
+	conlog_mutex_unlock(&record->mutex);
+
+	conlog_thread_join(&record->thread);
+
+	indexOffset = record->offset;
+
+	for (i = 0; i < record->count; i++)
+	{
+		unsigned char entry[16];
+
+		record_put64(entry, record->index[i].time);
+		record_put64(entry + 8, record->index[i].offset);
+
+		iov.data = entry;
+		iov.len = sizeof(entry);
+
+		record_emit(record, &iov, 1);
+	}
+
+	/* with a keyframe missing, the reader walks the records rather than trust the index */
+	if (record->count == record->stats.keyframes)
+	{
+		record_put64(footer, record->count);
+		record_put64(footer + 8, indexOffset);
+		memcpy(footer + 16, RECORD_FOOTER, 8);
+
+		iov.data = footer;
+		iov.len = sizeof(footer);
+
+		record_emit(record, &iov, 1);
+	}
+
+	conlog_cond_destroy(&record->spaceReady);
+	conlog_cond_destroy(&record->dataReady);
+	conlog_mutex_destroy(&record->mutex);
+	conlog_render_stop(&record->render);
+	conlog_screen_free(&record->screen);
+
+	free(record->pending);
+	free(record->working);
+	free(record->frame);
+	free(record->index);
+}
+
+static int replay_varint(FILE* fp, unsigned long long* v)
+{
+	int shift = 0, c;
+
+	*v = 0;
+
+	do
+	{
+		c = getc(fp);
+
+		if ((c == EOF) || (shift > 63))
+		{
+			return -1;
+		}
+
+		*v |= (unsigned long long)(c & 0x7F) << shift;
+		shift += 7;
+	} while (c & 0x80);
+
+	return 0;
+}
+
+/* reads the record at the current position, leaving its payload in data */
+static int replay_read(struct conlog_replay* replay, int* type, unsigned long long* delta, size_t* len)
+{
+	unsigned long long n;
+	int c;
+
+	if (record_tell(replay->fp) >= replay->end)
+	{
+		return -1;
+	}
+
+	c = getc(replay->fp);
+
+	if ((c == EOF) || replay_varint(replay->fp, delta) || replay_varint(replay->fp, &n) || (n > (size_t)-1))
+	{
+		return -1;
+	}
+
+	if (n > replay->size)
+	{
+		unsigned char* data = realloc(replay->data, (size_t)n);
+
+		if (!data)
+		{
+			return -1;
+		}
+
+		replay->data = data;
+		replay->size = (size_t)n;
+	}
+
+	if (fread(replay->data, 1, (size_t)n, replay->fp) != n)
+	{
+		return -1;
+	}
+
+	*type = c;
+	*len = (size_t)n;
+
+	return 0;
+}
+
+static int replay_load_index(struct conlog_replay* replay, unsigned long long fileSize)
+{
+	unsigned char footer[24];
+	unsigned long long count, offset;
+	size_t i;
+
+	if ((fileSize < RECORD_HEADER + sizeof(footer)) || record_seek(replay->fp, fileSize - sizeof(footer)) ||
+		(fread(footer, 1, sizeof(footer), replay->fp) != sizeof(footer)) || memcmp(footer + 16, RECORD_FOOTER, 8))
+	{
+		return -1;
+	}
+
+	count = record_get64(footer);
+	offset = record_get64(footer + 8);
+
+	if ((offset < RECORD_HEADER) || (offset + count * 16 + sizeof(footer) != fileSize) || record_seek(replay->fp, offset))
+	{
+		return -1;
+	}
+
+	replay->index = malloc(sizeof(*replay->index) * (count ? (size_t)count : 1));
+
+	if (!replay->index)
+	{
+		return -1;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		unsigned char entry[16];
+
+		if (fread(entry, 1, sizeof(entry), replay->fp) != sizeof(entry))
+		{
+			return -1;
+		}
+
+		replay->index[i].time = record_get64(entry);
+		replay->index[i].offset = record_get64(entry + 8);
+	}
+
+	replay->count = (size_t)count;
+	replay->end = offset;
+
+	return 0;
+}
+
+/* a recording cut short has no index, the keyframes are found in the records themselves */
+static void replay_walk(struct conlog_replay* replay, unsigned long long fileSize)
+{
+	size_t capacity = 0;
+	unsigned long long offset = RECORD_HEADER;
+
+	free(replay->index);
+	replay->index = NULL;
+	replay->count = 0;
+	replay->end = fileSize;
+
+	record_seek(replay->fp, offset);
+
+	for (;;)
+	{
+		int type;
+		unsigned long long delta;
+		size_t len;
+
+		if (replay_read(replay, &type, &delta, &len))
+		{
+			break;
+		}
+
+		if ((type == CONLOG_RECORD_KEYFRAME) && (len >= RECORD_KEYFRAME))
+		{
+			if (replay->count == capacity)
+			{
+				size_t n = capacity ? capacity * 2 : 256;
+				struct conlog_record_entry* index = realloc(replay->index, sizeof(*index) * n);
+
+				if (!index)
+				{
+					break;
+				}
+
+				replay->index = index;
+				capacity = n;
+			}
+
+			replay->index[replay->count].time = record_get64(replay->data);
+			replay->index[replay->count].offset = offset;
+			replay->count++;
+		}
+
+		offset = record_tell(replay->fp);
+	}
+
+	/* a record cut off part way is not read */
+	replay->end = offset;
+}
+
+int conlog_replay_open(struct conlog_replay* replay, const char* path)
+{
+	unsigned char header[RECORD_HEADER];
+	unsigned long long fileSize;
+
+	memset(replay, 0, sizeof(*replay));
+
+	replay->fp = conlog_fopen(path, "rb");
+
+	if (!replay->fp)
+	{
+		return -1;
+	}
+
+	if ((fread(header, 1, sizeof(header), replay->fp) != sizeof(header)) || memcmp(header, RECORD_MAGIC, 8) || record_seek_end(replay->fp))
+	{
+		fclose(replay->fp);
+		replay->fp = NULL;
+
+		return -1;
+	}
+
+	replay->rows = record_get16(header + 8);
+	replay->cols = record_get16(header + 10);
+	replay->started = record_get64(header + 16);
+
+	fileSize = record_tell(replay->fp);
+
+	if (replay_load_index(replay, fileSize))
+	{
+		replay_walk(replay, fileSize);
+	}
+
+	record_seek(replay->fp, RECORD_HEADER);
+
+	return 0;
+}
+
+unsigned long long conlog_replay_seek(struct conlog_replay* replay, unsigned long long time)
+{
+	size_t lo = 0, hi = replay->count;
+
+	if (!replay->count)
+	{
+		record_seek(replay->fp, RECORD_HEADER);
+		replay->time = 0;
+
+		return 0;
+	}
+
+	/* the last keyframe at or before time */
+	while (hi - lo > 1)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (replay->index[mid].time <= time)
+		{
+			lo = mid;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	record_seek(replay->fp, replay->index[lo].offset);
+	replay->time = replay->index[lo].time;
+
+	return replay->time;
+}
+
+int conlog_replay_next(struct conlog_replay* replay, struct conlog_replay_event* event)
+{
+	unsigned long long delta;
+	size_t len;
+	int type;
+
+	if (replay_read(replay, &type, &delta, &len))
+	{
+		return 0;
+	}
+
+	replay->time += delta;
+
+	event->type = type;
+	event->rows = replay->rows;
+	event->cols = replay->cols;
+	event->data = replay->data;
+	event->len = len;
+
+	switch (type)
+	{
+	case CONLOG_RECORD_KEYFRAME:
+		if (len < RECORD_KEYFRAME)
+		{
+			return 0;
+		}
+
+		replay->time = record_get64(replay->data);
+		replay->rows = event->rows = record_get16(replay->data + 8);
+		replay->cols = event->cols = record_get16(replay->data + 10);
+		event->data += RECORD_KEYFRAME;
+		event->len -= RECORD_KEYFRAME;
+		break;
+
+	case CONLOG_RECORD_RESIZE:
+		if (len >= 4)
+		{
+			replay->rows = event->rows = record_get16(replay->data);
+			replay->cols = event->cols = record_get16(replay->data + 2);
+		}
+		break;
+	}
+
+	event->time = replay->time;
+
+	return 1;
+}
+
+void conlog_replay_close(struct conlog_replay* replay)
+{
+	if (replay->fp)
+	{
+		fclose(replay->fp);
+	}
+
+	free(replay->index);
+	free(replay->data);
+
+	replay->fp = NULL;
+	replay->index = NULL;
+	replay->data = NULL;
+}
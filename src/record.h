@@ -0,0 +1,125 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ *
+ * Timed recording of a session.
+ *
+ *   header   "CONLOGR1", u16 rows, u16 cols, u32 zero, u64 start in seconds since 1970
+ *   record   u8 type, varint microseconds since the previous record, varint length, data
+ *   index    u64 time in microseconds, u64 file offset, for each keyframe
+ *   footer   u64 keyframe count, u64 file offset of the index, "CONLOGRI"
+ *
+ * Integers are little endian, varints hold seven bits a byte, low bits first.
+ * A keyframe holds its own time, u64 microseconds, then u16 rows, u16 cols
+ * and the sequences that draw the screen as it was, so replay can start at
+ * any keyframe. A recording without its footer is read by walking the records.
+ */
+
+#ifndef CONLOG_RECORD_H
+#define CONLOG_RECORD_H
+
+#include <stdio.h>
+#include "output.h"
+#include "screen.h"
+#include "render.h"
+#include "platform.h"
+
+#define CONLOG_RECORD_OUTPUT	'o'
+#define CONLOG_RECORD_INPUT		'i'
+#define CONLOG_RECORD_RESIZE	'r'
+#define CONLOG_RECORD_KEYFRAME	'k'
+
+/* records are gathered here before the recording thread takes them */
+#define CONLOG_RECORD_BUFFER	(1 << 20)
+/* a keyframe follows this much output, or this many microseconds */
+#define CONLOG_RECORD_KEYFRAME_BYTES	(1 << 20)
+#define CONLOG_RECORD_KEYFRAME_TIME		5000000ULL
+
+struct conlog_record_entry
+{
+	unsigned long long time;
+	unsigned long long offset;
+};
+
+struct conlog_record_stats
+{
+	unsigned long long records;
+	unsigned long long bytesRecorded;
+	unsigned long long bytesWritten;
+	unsigned long long keyframes;
+	unsigned long long stalls;
+};
+
+/* a channel that records output, and input from the input side, with the time of each */
+struct conlog_record
+{
+	conlog_output_fn write;
+	void* context;
+	unsigned long long start, last;
+	/* filled by the producers under the mutex, swapped with working by the thread */
+	unsigned char *pending, *working;
+	size_t pendingLen, pendingSize, workingSize;
+	size_t writerWaiting, producerWaiting, stopping;
+	conlog_mutex mutex;
+	conlog_cond dataReady, spaceReady;
+	struct conlog_thread thread;
+	/* the thread's model of the screen, drawn into keyframes */
+	struct conlog_screen screen;
+	struct conlog_render render;
+	unsigned char* frame;
+	size_t frameLen, frameSize;
+	unsigned long long time, keyframeTime, keyframeBytes, offset;
+	struct conlog_record_entry* index;
+	size_t count, capacity;
+	struct conlog_record_stats stats;
+};
+
+/* writes the header and a first keyframe of the blank screen, then starts the thread */
+int conlog_record_start(struct conlog_record* record, int rows, int cols, conlog_output_fn write, void* context);
+
+/* a conlog_output_fn for the output of the child */
+void conlog_record_output(void* context, const struct conlog_iovec* iov, int count);
+
+/* what was sent to the child */
+void conlog_record_input(struct conlog_record* record, const void* data, size_t len);
+
+void conlog_record_resize(struct conlog_record* record, int rows, int cols);
+
+/* writes what is pending and the index */
+void conlog_record_stop(struct conlog_record* record);
+
+struct conlog_replay_event
+{
+	int type;
+	/* microseconds from the start of the recording */
+	unsigned long long time;
+	/* the size for resize and keyframe events */
+	int rows, cols;
+	/* output, input or the sequences of a keyframe, valid until the next event */
+	const unsigned char* data;
+	size_t len;
+};
+
+/* reads a recording in order, from the start or from a keyframe */
+struct conlog_replay
+{
+	FILE* fp;
+	int rows, cols;
+	unsigned long long started, end, time;
+	struct conlog_record_entry* index;
+	size_t count;
+	unsigned char* data;
+	size_t size;
+};
+
+int conlog_replay_open(struct conlog_replay* replay, const char* path);
+
+/* goes to the last keyframe at or before time, returning the time of that keyframe */
+unsigned long long conlog_replay_seek(struct conlog_replay* replay, unsigned long long time);
+
+/* returns non-zero with the next event, zero at the end */
+int conlog_replay_next(struct conlog_replay* replay, struct conlog_replay_event* event);
+
+void conlog_replay_close(struct conlog_replay* replay);
+
+#endif
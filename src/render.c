@@ -0,0 +1,586 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "render.h"
+#include "trace.h"
+
+/* the most one cell can take, a cursor move, an SGR and the character */
+#define RENDER_CELL	80
+
+static int render_reserve(struct conlog_render* render, size_t len)
+{
+	if (render->frameLen + len > render->frameSize)
+	{
+		size_t size = render->frameSize ? render->frameSize : 4096;
+		unsigned char* frame;
+
+		while (size < render->frameLen + len)
+		{
+			size <<= 1;
+		}
+
+		frame = realloc(render->frame, size);
+
+		if (!frame)
+		{
+			return -1;
+		}
+
+		render->frame = frame;
+		render->frameSize = size;
+	}
+
+	return 0;
+}
+
+/* callers reserve the space first */
+static void render_put(struct conlog_render* render, const char* data, size_t len)
+{
+	memcpy(render->frame + render->frameLen, data, len);
+	render->frameLen += len;
+}
+
+static void render_printf(struct conlog_render* render, const char* format, int a, int b)
+{
+	render->frameLen += snprintf((char*)render->frame + render->frameLen, render->frameSize - render->frameLen, format, a, b);
+}
+
+static void render_move(struct conlog_render* render, int row, int col)
+{
+	if (!(render->cursorValid && (render->row == row) && (render->col == col)))
+	{
+		render_printf(render, "\033[%d;%dH", row + 1, col + 1);
+
+		render->row = row;
+		render->col = col;
+		render->cursorValid = 1;
+	}
+}
+
+static void render_color(struct conlog_render* render, unsigned color, int base, int bright)
+{
+	if (color < 8)
+	{
+		render_printf(render, ";%d", base + color, 0);
+	}
+	else if (color < 16)
+	{
+		render_printf(render, ";%d", bright + color - 8, 0);
+	}
+	else if (color < 256)
+	{
+		render_printf(render, ";%d;5;%d", base + 8, color);
+	}
+}
+
+/* always from a reset, so it does not depend on what the console had */
+static void render_sgr(struct conlog_render* render, unsigned attr)
+{
+	static const struct
+	{
+		unsigned flag;
+		const char* code;
+	} flags[] = {
+		{ CONLOG_ATTR_BOLD, ";1" },
+		{ CONLOG_ATTR_DIM, ";2" },
+		{ CONLOG_ATTR_ITALIC, ";3" },
+		{ CONLOG_ATTR_UNDERLINE, ";4" },
+		{ CONLOG_ATTR_BLINK, ";5" },
+		{ CONLOG_ATTR_INVERSE, ";7" },
+		{ CONLOG_ATTR_HIDDEN, ";8" },
+		{ CONLOG_ATTR_STRIKE, ";9" }
+	};
+	size_t i;
+
+	if (render->attrValid && (render->attr == attr))
+	{
+		return;
+	}
+
+	render_put(render, "\033[0", 3);
+
+	for (i = 0; i < sizeof(flags) / sizeof(flags[0]); i++)
+	{
+		if (attr & flags[i].flag)
+		{
+			render_put(render, flags[i].code, 2);
+		}
+	}
+
+	render_color(render, CONLOG_ATTR_FG(attr), 30, 90);
+	render_color(render, CONLOG_ATTR_BG(attr), 40, 100);
+	render_put(render, "m", 1);
+
+	render->attr = attr;
+	render->attrValid = 1;
+}
+
+static void render_char(struct conlog_render* render, unsigned c)
+{
+	unsigned char* out = render->frame + render->frameLen;
+
+	if (c < 0x80)
+	{
+		out[0] = (unsigned char)c;
+		render->frameLen += 1;
+	}
+	else if (c < 0x800)
+	{
+		out[0] = (unsigned char)(0xC0 | (c >> 6));
+		out[1] = (unsigned char)(0x80 | (c & 0x3F));
+		render->frameLen += 2;
+	}
+	else if (c < 0x10000)
+	{
+		out[0] = (unsigned char)(0xE0 | (c >> 12));
+		out[1] = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+		out[2] = (unsigned char)(0x80 | (c & 0x3F));
+		render->frameLen += 3;
+	}
+	else
+	{
+		out[0] = (unsigned char)(0xF0 | (c >> 18));
+		out[1] = (unsigned char)(0x80 | ((c >> 12) & 0x3F));
+		out[2] = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+		out[3] = (unsigned char)(0x80 | (c & 0x3F));
+		render->frameLen += 4;
+	}
+}
+
+static int render_same(const struct conlog_cell* a, const struct conlog_cell* b)
+{
+	return (a->ch == b->ch) && (a->attr == b->attr);
+}
+
+/* writes the cells of one row that differ from what the console shows */
+static int render_row(struct conlog_render* render, int r)
+{
+	const struct conlog_cell* line = conlog_screen_line(render->screen, r);
+	struct conlog_cell* shown = render->shown + (size_t)r * render->cols;
+	int cols = render->cols, known = render->known[r];
+	int end = cols, c = 0;
+
+	while ((end > 0) && (line[end - 1].ch == ' ') && (line[end - 1].attr == CONLOG_ATTR_DEFAULT))
+	{
+		end--;
+	}
+
+	while (c < end)
+	{
+		int width = ((c + 1 < cols) && (line[c + 1].ch == CONLOG_CELL_CONTINUE)) ? 2 : 1;
+
+		/* the right half of a double width character is drawn with the left */
+		if (line[c].ch == CONLOG_CELL_CONTINUE)
+		{
+			shown[c] = line[c];
+			c++;
+			continue;
+		}
+
+		if (known && render_same(line + c, shown + c) && ((width == 1) || render_same(line + c + 1, shown + c + 1)))
+		{
+			c += width;
+			continue;
+		}
+
+		if (render_reserve(render, RENDER_CELL))
+		{
+			return -1;
+		}
+
+		render_move(render, r, c);
+		render_sgr(render, line[c].attr);
+		render_char(render, line[c].ch);
+
+		memcpy(shown + c, line + c, sizeof(*line) * width);
+
+		c += width;
+		render->col = c;
+
+		/* the console may be waiting to wrap, so the next move is explicit */
+		if (c >= cols)
+		{
+			render->cursorValid = 0;
+		}
+	}
+
+	if (end < cols)
+	{
+		int clear = !known;
+
+		for (c = end; !clear && (c < cols); c++)
+		{
+			clear = !render_same(line + c, shown + c);
+		}
+
+		if (clear)
+		{
+			if (render_reserve(render, RENDER_CELL))
+			{
+				return -1;
+			}
+
+			render_move(render, r, end);
+			render_sgr(render, CONLOG_ATTR_DEFAULT);
+			render_put(render, "\033[K", 3);
+
+			memcpy(shown + end, line + end, sizeof(*line) * (cols - end));
+		}
+	}
+
+	render->known[r] = 1;
+
+	return 0;
+}
+
+/* a new size starts again from a clear console */
+static int render_resize(struct conlog_render* render)
+{
+	struct conlog_screen* screen = render->screen;
+	size_t count = (size_t)screen->rows * screen->cols;
+	struct conlog_cell* shown = realloc(render->shown, sizeof(*shown) * count);
+	unsigned char* known;
+	size_t i;
+
+	if (!shown)
+	{
+		return -1;
+	}
+
+	render->shown = shown;
+
+	known = realloc(render->known, screen->rows);
+
+	if (!known)
+	{
+		return -1;
+	}
+
+	render->known = known;
+	render->rows = screen->rows;
+	render->cols = screen->cols;
+
+	for (i = 0; i < count; i++)
+	{
+		shown[i].ch = ' ';
+		shown[i].attr = CONLOG_ATTR_DEFAULT;
+	}
+
+	memset(known, 1, render->rows);
+	memset(screen->dirty, 1, render->rows);
+
+	render->attr = CONLOG_ATTR_DEFAULT;
+	render->attrValid = 1;
+	render->cursorValid = 0;
+
+	render_put(render, "\033[0m\033[H\033[2J", 11);
+
+	return 0;
+}
+
+/* called with the mutex held */
+static void render_build(struct conlog_render* render)
+{
+	struct conlog_screen* screen = render->screen;
+	char modes[256];
+	size_t len;
+	int r;
+
+	render->frameLen = 0;
+
+	if (render_reserve(render, sizeof(modes) + 64))
+	{
+		return;
+	}
+
+	len = conlog_screen_modes(screen, render->modes, modes, sizeof(modes));
+	render_put(render, modes, len);
+
+	/* hide the cursor while it moves about */
+	if (render->cursorVisible)
+	{
+		render_put(render, "\033[?25l", 6);
+	}
+
+	if (((screen->rows != render->rows) || (screen->cols != render->cols)) && render_resize(render))
+	{
+		render->frameLen = 0;
+		return;
+	}
+
+	for (r = 0; r < render->rows; r++)
+	{
+		if (screen->dirty[r])
+		{
+			screen->dirty[r] = 0;
+
+			if (render_row(render, r))
+			{
+				/* out of memory, what was recorded as shown cannot be trusted */
+				memset(screen->dirty, 1, render->rows);
+				memset(render->known, 0, render->rows);
+				render->frameLen = 0;
+				render->cursorValid = 0;
+				render->attrValid = 0;
+				return;
+			}
+		}
+	}
+
+	if (render_reserve(render, RENDER_CELL))
+	{
+		render->frameLen = 0;
+		return;
+	}
+
+	render_move(render, screen->row, screen->col);
+	render_sgr(render, screen->attr);
+
+	if (screen->cursorVisible)
+	{
+		render_put(render, "\033[?25h", 6);
+	}
+
+	render->cursorVisible = screen->cursorVisible;
+	render->modes = screen->modes;
+}
+
+/* called with the mutex held, which is released while the frame is written */
+static void render_draw(struct conlog_render* render)
+{
+	render->dirty = 0;
+	render->due = conlog_clock() + render->interval;
+
+	render_build(render);
+
+	if (render->frameLen)
+	{
+		struct conlog_iovec iov;
+
+		iov.data = render->frame;
+		iov.len = render->frameLen;
+
+		conlog_mutex_unlock(&render->mutex);
+
+		render->write(render->context, &iov, 1);
+
+		conlog_mutex_lock(&render->mutex);
+
+		render->stats.frames++;
+		render->stats.bytesDrawn += iov.len;
+	}
+}
+
+static void render_main(void* arg)
+{
+	struct conlog_render* render = arg;
+
+	CONLOG_TRACE_THREAD("render");
+
+	conlog_mutex_lock(&render->mutex);
+
+	for (;;)
+	{
+		unsigned long long now;
+
+		while (!render->dirty && !render->stopping)
+		{
+			conlog_cond_wait(&render->changed, &render->mutex);
+		}
+
+		if (render->stopping)
+		{
+			break;
+		}
+
+		now = conlog_clock();
+
+		/* the wait ends early when stopping */
+		if (now < render->due)
+		{
+			conlog_cond_timedwait(&render->changed, &render->mutex, (unsigned)((render->due - now + 999999) / 1000000));
+			continue;
+		}
+
+		render_draw(render);
+	}
+
+	conlog_mutex_unlock(&render->mutex);
+}
+
+int conlog_render_init(struct conlog_render* render, struct conlog_screen* screen, unsigned fps, conlog_output_fn write, void* context)
+{
+	size_t i;
+
+	memset(render, 0, sizeof(*render));
+
+	render->screen = screen;
+	render->write = write;
+	render->context = context;
+	render->interval = 1000000000ULL / (fps ? fps : 1);
+	render->due = conlog_clock();
+	render->rows = screen->rows;
+	render->cols = screen->cols;
+	render->cursorVisible = 1;
+
+	render->shown = malloc(sizeof(struct conlog_cell) * render->rows * render->cols);
+	render->known = calloc(render->rows, 1);
+
+	if (!(render->shown && render->known))
+	{
+		free(render->shown);
+		free(render->known);
+
+		return -1;
+	}
+
+	for (i = 0; i < (size_t)render->rows * render->cols; i++)
+	{
+		render->shown[i].ch = ' ';
+		render->shown[i].attr = CONLOG_ATTR_DEFAULT;
+	}
+
+	conlog_mutex_init(&render->mutex);
+	conlog_cond_init(&render->changed);
+
+	return 0;
+}
+
+int conlog_render_start(struct conlog_render* render)
+{
+	if (conlog_thread_start(&render->thread, render_main, render))
+	{
+		return -1;
+	}
+
+	render->threaded = 1;
+
+	return 0;
+}
+
+void conlog_render_lock(struct conlog_render* render)
+{
+	conlog_mutex_lock(&render->mutex);
+}
+
+void conlog_render_unlock(struct conlog_render* render)
+{
+	if (!render->dirty)
+	{
+		render->dirty = 1;
+
+		if (render->threaded)
+		{
+			conlog_cond_signal(&render->changed);
+		}
+	}
+
+	conlog_mutex_unlock(&render->mutex);
+}
+
+unsigned long long conlog_render_due(struct conlog_render* render)
+{
+	unsigned long long due;
+
+	conlog_mutex_lock(&render->mutex);
+
+	due = render->dirty ? render->due : 0;
+
+	conlog_mutex_unlock(&render->mutex);
+
+	return due;
+}
+
+void conlog_render_frame(struct conlog_render* render)
+{
+	conlog_mutex_lock(&render->mutex);
+
+	if (render->dirty)
+	{
+		render_draw(render);
+	}
+
+	conlog_mutex_unlock(&render->mutex);
+}
+
+void conlog_render_reset(struct conlog_render* render)
+{
+	conlog_mutex_lock(&render->mutex);
+
+	memset(render->known, 0, render->rows);
+	memset(render->screen->dirty, 1, render->screen->rows);
+
+	render->cursorValid = 0;
+	render->attrValid = 0;
+	render->cursorVisible = 1;
+	render->modes = 0;
+	render->dirty = 1;
+
+	conlog_mutex_unlock(&render->mutex);
+}
+
+void conlog_render_full(struct conlog_render* render)
+{
+	struct conlog_screen* screen = render->screen;
+	struct conlog_iovec iov;
+	char head[64];
+	size_t len = 0;
+
+	if (screen->altActive)
+	{
+		memcpy(head, "\033[?1049h", 8);
+		len = 8;
+	}
+
+	memcpy(head + len, "\033[0m\033[H\033[2J", 11);
+	len += 11;
+
+	/* the terminal may have been left with a region of its own, so it is always set */
+	len += snprintf(head + len, sizeof(head) - len, "\033[%d;%dr", screen->top + 1, screen->bottom + 1);
+
+	iov.data = (const unsigned char*)head;
+	iov.len = len;
+
+	render->write(render->context, &iov, 1);
+
+	conlog_render_reset(render);
+	conlog_render_frame(render);
+
+	iov.data = (const unsigned char*)(screen->autowrap ? "\033[?7h" : "\033[?7l");
+	iov.len = 5;
+
+	render->write(render->context, &iov, 1);
+}
+
+void conlog_render_stop(struct conlog_render* render)
+{
+	if (render->threaded)
+	{
+		conlog_mutex_lock(&render->mutex);
+		render->stopping = 1;
+		conlog_cond_signal(&render->changed);
+		conlog_mutex_unlock(&render->mutex);
+
+		conlog_thread_join(&render->thread);
+
+		render->threaded = 0;
+	}
+
+	conlog_render_frame(render);
+
+	conlog_cond_destroy(&render->changed);
+	conlog_mutex_destroy(&render->mutex);
+
+	free(render->shown);
+	free(render->known);
+	free(render->frame);
+
+	render->shown = NULL;
+	render->known = NULL;
+	render->frame = NULL;
+}
@@ -0,0 +1,72 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_RENDER_H
+#define CONLOG_RENDER_H
+
+#include "output.h"
+#include "screen.h"
+#include "platform.h"
+
+struct conlog_render_stats
+{
+	unsigned long long frames;
+	unsigned long long bytesDrawn;
+};
+
+/* draws the screen model to the console at a limited rate, as the changes since the last frame */
+struct conlog_render
+{
+	struct conlog_screen* screen;
+	conlog_output_fn write;
+	void* context;
+	unsigned long long interval, due;
+	/* what the console shows, a row that is not known still holds what was there before */
+	int rows, cols;
+	struct conlog_cell* shown;
+	unsigned char* known;
+	int row, col, cursorValid, cursorVisible;
+	unsigned attr, modes;
+	int attrValid;
+	unsigned char* frame;
+	size_t frameLen, frameSize;
+	struct conlog_thread thread;
+	int threaded;
+	conlog_mutex mutex;
+	conlog_cond changed;
+	size_t dirty, stopping;
+	struct conlog_render_stats stats;
+};
+
+int conlog_render_init(struct conlog_render* render, struct conlog_screen* screen, unsigned fps, conlog_output_fn write, void* context);
+
+/* draws frames from a thread of its own, otherwise the caller draws them with conlog_render_frame */
+int conlog_render_start(struct conlog_render* render);
+
+/* held by the producer while it changes the model */
+void conlog_render_lock(struct conlog_render* render);
+void conlog_render_unlock(struct conlog_render* render);
+
+/* when the next frame may be drawn, in conlog_clock time, zero when nothing has changed */
+unsigned long long conlog_render_due(struct conlog_render* render);
+
+/* draws what has changed */
+void conlog_render_frame(struct conlog_render* render);
+
+/* forgets what the console shows, so the next frame draws the whole screen and every mode */
+void conlog_render_reset(struct conlog_render* render);
+
+/*
+ * Draws the model as a terminal would show it, clearing it first.
+ * The scrolling region and autowrap are always set, as the terminal may
+ * have been left with others, the alternate screen is set when in use,
+ * the saved cursor and tab stops are not.
+ */
+void conlog_render_full(struct conlog_render* render);
+
+/* stops the thread and draws the final frame */
+void conlog_render_stop(struct conlog_render* render);
+
+#endif
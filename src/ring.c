@@ -0,0 +1,116 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "ring.h"
+#include "platform.h"
+
+int conlog_ring_init(struct conlog_ring* ring, size_t size)
+{
+	size_t n = CONLOG_RING_LINE;
+
+	memset(ring, 0, sizeof(*ring));
+
+	while (n < size)
+	{
+		n <<= 1;
+	}
+
+	ring->data = malloc(n);
+
+	if (!ring->data)
+	{
+		return -1;
+	}
+
+	ring->size = n;
+
+	return 0;
+}
+
+void conlog_ring_free(struct conlog_ring* ring)
+{
+	free(ring->data);
+	ring->data = NULL;
+}
+
+size_t conlog_ring_space(struct conlog_ring* ring)
+{
+	size_t space = ring->size - (ring->head - ring->tailCache);
+
+	if (space < ring->size)
+	{
+		ring->tailCache = conlog_atomic_load(&ring->tail);
+		space = ring->size - (ring->head - ring->tailCache);
+	}
+
+	return space;
+}
+
+size_t conlog_ring_write(struct conlog_ring* ring, const unsigned char* data, size_t len)
+{
+	size_t space = conlog_ring_space(ring);
+	size_t offset = ring->head & (ring->size - 1);
+	size_t n;
+
+	if (len > space)
+	{
+		len = space;
+	}
+
+	n = ring->size - offset;
+
+	if (n > len)
+	{
+		n = len;
+	}
+
+	memcpy(ring->data + offset, data, n);
+	memcpy(ring->data, data + n, len - n);
+
+	conlog_atomic_store(&ring->head, ring->head + len);
+
+	return len;
+}
+
+int conlog_ring_peek(struct conlog_ring* ring, struct conlog_iovec iov[2])
+{
+	size_t len = ring->headCache - ring->tail;
+	size_t offset, n;
+
+	if (!len)
+	{
+		ring->headCache = conlog_atomic_load(&ring->head);
+		len = ring->headCache - ring->tail;
+
+		if (!len)
+		{
+			return 0;
+		}
+	}
+
+	offset = ring->tail & (ring->size - 1);
+	n = ring->size - offset;
+
+	iov[0].data = ring->data + offset;
+
+	if (n >= len)
+	{
+		iov[0].len = len;
+		return 1;
+	}
+
+	iov[0].len = n;
+	iov[1].data = ring->data;
+	iov[1].len = len - n;
+
+	return 2;
+}
+
+void conlog_ring_consume(struct conlog_ring* ring, size_t len)
+{
+	conlog_atomic_store(&ring->tail, ring->tail + len);
+}
@@ -0,0 +1,38 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_RING_H
+#define CONLOG_RING_H
+
+#include "output.h"
+
+#define CONLOG_RING_LINE 64
+
+/* single producer, single consumer byte ring, size is a power of two */
+struct conlog_ring
+{
+	unsigned char* data;
+	size_t size;
+	/* written by the producer */
+	size_t head;
+	size_t tailCache;
+	unsigned char pad[CONLOG_RING_LINE - 2 * sizeof(size_t)];
+	/* written by the consumer */
+	size_t tail;
+	size_t headCache;
+};
+
+int conlog_ring_init(struct conlog_ring* ring, size_t size);
+void conlog_ring_free(struct conlog_ring* ring);
+
+/* producer side */
+size_t conlog_ring_space(struct conlog_ring* ring);
+size_t conlog_ring_write(struct conlog_ring* ring, const unsigned char* data, size_t len);
+
+/* consumer side, peek returns up to two ranges which stay valid until consumed */
+int conlog_ring_peek(struct conlog_ring* ring, struct conlog_iovec iov[2]);
+void conlog_ring_consume(struct conlog_ring* ring, size_t len);
+
+#endif
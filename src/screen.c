@@ -0,0 +1,1167 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ *
+ * Screen and cursor model covering what ECMA-48 and the DEC private
+ * modes do to the cursor and cells: printing with autowrap, scroll
+ * regions, insert and delete, erase, SGR and the alternate screen.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "screen.h"
+#include "platform.h"
+
+#define TAB_WIDTH	8
+#define ROTATE_CHUNK	64
+
+static int screen_min(int a, int b)
+{
+	return a < b ? a : b;
+}
+
+static int screen_max(int a, int b)
+{
+	return a > b ? a : b;
+}
+
+/* zero or missing parameters mean one for movement */
+static int screen_param(const struct conlog_vt* vt, int i, int def)
+{
+	if ((i < vt->paramCount) && vt->params[i])
+	{
+		return (int)vt->params[i];
+	}
+
+	return def;
+}
+
+/* columns taken by a code point, combining marks take none */
+static int screen_width(unsigned c)
+{
+	if ((c >= 0x300 && c <= 0x36F) || (c >= 0x200B && c <= 0x200F) || (c >= 0xFE00 && c <= 0xFE0F))
+	{
+		return 0;
+	}
+
+	if ((c >= 0x1100 && c <= 0x115F) ||
+		(c >= 0x2E80 && c <= 0xA4CF && c != 0x303F) ||
+		(c >= 0xAC00 && c <= 0xD7A3) ||
+		(c >= 0xF900 && c <= 0xFAFF) ||
+		(c >= 0xFE30 && c <= 0xFE4F) ||
+		(c >= 0xFF00 && c <= 0xFF60) ||
+		(c >= 0xFFE0 && c <= 0xFFE6) ||
+		(c >= 0x1F300 && c <= 0x1F64F) ||
+		(c >= 0x1F900 && c <= 0x1F9FF) ||
+		(c >= 0x20000 && c <= 0x3FFFD))
+	{
+		return 2;
+	}
+
+	return 1;
+}
+
+static struct conlog_cell* screen_row(struct conlog_screen* screen, int row)
+{
+	return screen->lines[row];
+}
+
+/* erased cells keep the background colour, as xterm does */
+static struct conlog_cell screen_blank(struct conlog_screen* screen)
+{
+	struct conlog_cell blank;
+
+	blank.ch = ' ';
+	blank.attr = CONLOG_ATTR_COLORS(CONLOG_COLOR_DEFAULT, CONLOG_ATTR_BG(screen->attr));
+
+	return blank;
+}
+
+static void screen_erase(struct conlog_screen* screen, int row, int from, int to)
+{
+	struct conlog_cell blank = screen_blank(screen);
+	struct conlog_cell* cell = screen_row(screen, row);
+
+	while (from < to)
+	{
+		cell[from++] = blank;
+	}
+
+	screen->dirty[row] = 1;
+}
+
+static void screen_erase_rows(struct conlog_screen* screen, int from, int to)
+{
+	while (from < to)
+	{
+		screen_erase(screen, from++, 0, screen->cols);
+	}
+}
+
+/* rotates the row pointers within top..bottom, the n rows at from end up at to */
+static void screen_rotate(struct conlog_screen* screen, int top, int bottom, int n, int up)
+{
+	struct conlog_cell** lines = screen->lines;
+	struct conlog_cell* moved[ROTATE_CHUNK];
+	int count = bottom - top + 1;
+
+	while (n)
+	{
+		int k = screen_min(n, ROTATE_CHUNK);
+
+		if (up)
+		{
+			memcpy(moved, lines + top, sizeof(*moved) * k);
+			memmove(lines + top, lines + top + k, sizeof(*moved) * (count - k));
+			memcpy(lines + bottom - k + 1, moved, sizeof(*moved) * k);
+		}
+		else
+		{
+			memcpy(moved, lines + bottom - k + 1, sizeof(*moved) * k);
+			memmove(lines + top + k, lines + top, sizeof(*moved) * (count - k));
+			memcpy(lines + top, moved, sizeof(*moved) * k);
+		}
+
+		n -= k;
+	}
+}
+
+/* moves rows within top..bottom up by n, clearing those exposed */
+static void screen_scroll_up(struct conlog_screen* screen, int top, int bottom, int n)
+{
+	int count = bottom - top + 1;
+	int i;
+
+	n = screen_min(n, count);
+
+	if (n < count)
+	{
+		screen_rotate(screen, top, bottom, n, 1);
+	}
+
+	screen_erase_rows(screen, bottom - n + 1, bottom + 1);
+
+	for (i = top; i <= bottom; i++)
+	{
+		screen->dirty[i] = 1;
+	}
+}
+
+static void screen_scroll_down(struct conlog_screen* screen, int top, int bottom, int n)
+{
+	int count = bottom - top + 1;
+	int i;
+
+	n = screen_min(n, count);
+
+	if (n < count)
+	{
+		screen_rotate(screen, top, bottom, n, 0);
+	}
+
+	screen_erase_rows(screen, top, top + n);
+
+	for (i = top; i <= bottom; i++)
+	{
+		screen->dirty[i] = 1;
+	}
+}
+
+static void screen_linefeed(struct conlog_screen* screen)
+{
+	if (screen->row == screen->bottom)
+	{
+		screen_scroll_up(screen, screen->top, screen->bottom, 1);
+	}
+	else if (screen->row < screen->rows - 1)
+	{
+		screen->row++;
+	}
+}
+
+static void screen_reverse_index(struct conlog_screen* screen)
+{
+	if (screen->row == screen->top)
+	{
+		screen_scroll_down(screen, screen->top, screen->bottom, 1);
+	}
+	else if (screen->row > 0)
+	{
+		screen->row--;
+	}
+}
+
+/* cursor addressing is relative to the scroll region in origin mode */
+static void screen_goto(struct conlog_screen* screen, int row, int col)
+{
+	int top = 0, bottom = screen->rows - 1;
+
+	if (screen->origin)
+	{
+		top = screen->top;
+		bottom = screen->bottom;
+		row += top;
+	}
+
+	screen->row = screen_max(top, screen_min(row, bottom));
+	screen->col = screen_max(0, screen_min(col, screen->cols - 1));
+	screen->wrapPending = 0;
+}
+
+static void screen_put(struct conlog_screen* screen, unsigned ch)
+{
+	int width = screen_width(ch);
+	struct conlog_cell* cell;
+
+	if (!width)
+	{
+		return;
+	}
+
+	if (screen->wrapPending || (screen->col + width > screen->cols))
+	{
+		if (screen->autowrap)
+		{
+			screen->col = 0;
+			screen_linefeed(screen);
+		}
+		else
+		{
+			screen->col = screen->cols - width;
+		}
+
+		screen->wrapPending = 0;
+	}
+
+	if (width > screen->cols)
+	{
+		return;
+	}
+
+	cell = screen_row(screen, screen->row) + screen->col;
+
+	/* never leave half of a double width character behind */
+	if ((cell->ch == CONLOG_CELL_CONTINUE) && screen->col)
+	{
+		cell[-1].ch = ' ';
+	}
+
+	if ((screen->col + width < screen->cols) && (cell[width].ch == CONLOG_CELL_CONTINUE))
+	{
+		cell[width].ch = ' ';
+	}
+
+	cell->ch = ch;
+	cell->attr = screen->attr;
+
+	if (width == 2)
+	{
+		cell[1].ch = CONLOG_CELL_CONTINUE;
+		cell[1].attr = screen->attr;
+	}
+
+	screen->dirty[screen->row] = 1;
+
+	if (screen->col + width >= screen->cols)
+	{
+		screen->col = screen->cols - 1;
+		screen->wrapPending = screen->autowrap;
+	}
+	else
+	{
+		screen->col += width;
+	}
+}
+
+/* a run of ASCII is copied a line at a time, wrapping goes through screen_put */
+static const unsigned char* screen_put_ascii(struct conlog_screen* screen, const unsigned char* data, const unsigned char* end)
+{
+	while ((data < end) && (*data < 0x80))
+	{
+		struct conlog_cell* cell;
+		unsigned attr = screen->attr;
+		int n, i;
+
+		if (screen->wrapPending || (screen->col >= screen->cols - 1))
+		{
+			screen_put(screen, *data++);
+			continue;
+		}
+
+		n = screen->cols - screen->col;
+		cell = screen_row(screen, screen->row) + screen->col;
+
+		for (i = 0; (i < n) && (data + i < end) && (data[i] < 0x80); i++)
+		{
+		}
+
+		if ((cell->ch == CONLOG_CELL_CONTINUE) && screen->col)
+		{
+			cell[-1].ch = ' ';
+		}
+
+		if ((screen->col + i < screen->cols) && (cell[i].ch == CONLOG_CELL_CONTINUE))
+		{
+			cell[i].ch = ' ';
+		}
+
+		for (n = 0; n < i; n++)
+		{
+			cell[n].ch = data[n];
+			cell[n].attr = attr;
+		}
+
+		screen->dirty[screen->row] = 1;
+		data += i;
+
+		if (screen->col + i >= screen->cols)
+		{
+			screen->col = screen->cols - 1;
+			screen->wrapPending = screen->autowrap;
+		}
+		else
+		{
+			screen->col += i;
+		}
+	}
+
+	return data;
+}
+
+static void screen_print(void* context, const unsigned char* data, size_t len)
+{
+	struct conlog_screen* screen = context;
+	const unsigned char* end = data + len;
+
+	while (data < end)
+	{
+		unsigned char c;
+
+		if (!screen->utf8Need && (*data < 0x80))
+		{
+			data = screen_put_ascii(screen, data, end);
+			continue;
+		}
+
+		c = *data++;
+
+		if (c < 0x80)
+		{
+			screen->utf8Need = 0;
+			screen_put(screen, c);
+		}
+		else if (c < 0xC0)
+		{
+			if (screen->utf8Need)
+			{
+				screen->utf8 = (screen->utf8 << 6) | (c & 0x3F);
+
+				if (!--screen->utf8Need)
+				{
+					screen_put(screen, screen->utf8);
+				}
+			}
+			else
+			{
+				screen_put(screen, 0xFFFD);
+			}
+		}
+		else if (c < 0xE0)
+		{
+			screen->utf8 = c & 0x1F;
+			screen->utf8Need = 1;
+		}
+		else if (c < 0xF0)
+		{
+			screen->utf8 = c & 0x0F;
+			screen->utf8Need = 2;
+		}
+		else if (c < 0xF8)
+		{
+			screen->utf8 = c & 0x07;
+			screen->utf8Need = 3;
+		}
+		else
+		{
+			screen->utf8Need = 0;
+			screen_put(screen, 0xFFFD);
+		}
+	}
+}
+
+static void screen_execute(void* context, unsigned char c)
+{
+	struct conlog_screen* screen = context;
+
+	switch (c)
+	{
+	case '\b':
+		if (screen->col > 0)
+		{
+			screen->col--;
+		}
+		screen->wrapPending = 0;
+		break;
+
+	case '\t':
+		screen->col = screen_min((screen->col / TAB_WIDTH + 1) * TAB_WIDTH, screen->cols - 1);
+		break;
+
+	case '\n':
+	case '\v':
+	case '\f':
+		screen_linefeed(screen);
+		screen->wrapPending = 0;
+		break;
+
+	case '\r':
+		screen->col = 0;
+		screen->wrapPending = 0;
+		break;
+	}
+}
+
+static void screen_save(struct conlog_screen* screen, struct conlog_screen_cursor* saved)
+{
+	saved->row = screen->row;
+	saved->col = screen->col;
+	saved->attr = screen->attr;
+	saved->origin = screen->origin;
+	saved->wrapPending = screen->wrapPending;
+}
+
+static void screen_restore(struct conlog_screen* screen, const struct conlog_screen_cursor* saved)
+{
+	screen->row = screen_min(saved->row, screen->rows - 1);
+	screen->col = screen_min(saved->col, screen->cols - 1);
+	screen->attr = saved->attr;
+	screen->origin = saved->origin;
+	screen->wrapPending = saved->wrapPending;
+}
+
+static void screen_dirty_all(struct conlog_screen* screen)
+{
+	memset(screen->dirty, 1, screen->rows);
+}
+
+/* exchanges the visible and hidden screens */
+static void screen_swap(struct conlog_screen* screen)
+{
+	struct conlog_cell* cells = screen->cells;
+	struct conlog_cell** lines = screen->lines;
+
+	screen->cells = screen->alt;
+	screen->alt = cells;
+	screen->lines = screen->altLines;
+	screen->altLines = lines;
+}
+
+static void screen_reset(struct conlog_screen* screen)
+{
+	if (screen->altActive)
+	{
+		screen_swap(screen);
+		screen->altActive = 0;
+	}
+
+	screen->row = 0;
+	screen->col = 0;
+	screen->wrapPending = 0;
+	screen->top = 0;
+	screen->bottom = screen->rows - 1;
+	screen->autowrap = 1;
+	screen->origin = 0;
+	screen->cursorVisible = 1;
+	screen->attr = CONLOG_ATTR_DEFAULT;
+	screen->modes = 0;
+	screen->utf8Need = 0;
+
+	screen_save(screen, &screen->saved);
+	screen_save(screen, &screen->altSaved);
+	screen_erase_rows(screen, 0, screen->rows);
+}
+
+static void screen_esc(void* context, const struct conlog_vt* vt, unsigned char final)
+{
+	struct conlog_screen* screen = context;
+
+	if (vt->intermediate)
+	{
+		return;
+	}
+
+	switch (final)
+	{
+	case '7':
+		screen_save(screen, &screen->saved);
+		break;
+
+	case '8':
+		screen_restore(screen, &screen->saved);
+		break;
+
+	case 'D':
+		screen_linefeed(screen);
+		screen->wrapPending = 0;
+		break;
+
+	case 'E':
+		screen_linefeed(screen);
+		screen->col = 0;
+		screen->wrapPending = 0;
+		break;
+
+	case 'M':
+		screen_reverse_index(screen);
+		screen->wrapPending = 0;
+		break;
+
+	case '=':
+		screen->modes |= CONLOG_MODE_KEYPAD;
+		break;
+
+	case '>':
+		screen->modes &= ~CONLOG_MODE_KEYPAD;
+		break;
+
+	case 'c':
+		screen_reset(screen);
+		break;
+	}
+}
+
+/* switches to or from the alternate screen, the main screen is kept untouched */
+static void screen_alternate(struct conlog_screen* screen, int enable, int clear)
+{
+	if (enable == screen->altActive)
+	{
+		return;
+	}
+
+	if (!screen->alt)
+	{
+		int r;
+
+		screen->alt = malloc(sizeof(struct conlog_cell) * screen->rows * screen->cols);
+
+		if (!screen->alt)
+		{
+			return;
+		}
+
+		for (r = 0; r < screen->rows; r++)
+		{
+			screen->altLines[r] = screen->alt + (size_t)r * screen->cols;
+		}
+
+		clear = 1;
+	}
+
+	screen_swap(screen);
+	screen->altActive = enable;
+
+	if (clear)
+	{
+		screen_erase_rows(screen, 0, screen->rows);
+	}
+
+	screen_dirty_all(screen);
+}
+
+/* the DEC private mode behind each CONLOG_MODE bit, keypad has none */
+static const unsigned screen_input_modes[] = { 1, 0, 9, 1000, 1002, 1003, 1004, 1005, 1006, 1015, 2004 };
+
+static void screen_mode(struct conlog_screen* screen, const struct conlog_vt* vt, int enable)
+{
+	int i;
+	size_t m;
+
+	if (vt->marker != '?')
+	{
+		return;
+	}
+
+	for (i = 0; i < vt->paramCount; i++)
+	{
+		for (m = 0; m < sizeof(screen_input_modes) / sizeof(screen_input_modes[0]); m++)
+		{
+			if (screen_input_modes[m] && (screen_input_modes[m] == vt->params[i]))
+			{
+				screen->modes = enable ? (screen->modes | (1u << m)) : (screen->modes & ~(1u << m));
+			}
+		}
+
+		switch (vt->params[i])
+		{
+		case 6:
+			screen->origin = enable;
+			screen_goto(screen, 0, 0);
+			break;
+
+		case 7:
+			screen->autowrap = enable;
+			if (!enable)
+			{
+				screen->wrapPending = 0;
+			}
+			break;
+
+		case 25:
+			screen->cursorVisible = enable;
+			break;
+
+		case 47:
+		case 1047:
+			screen_alternate(screen, enable, vt->params[i] == 1047);
+			break;
+
+		case 1048:
+			if (enable)
+			{
+				screen_save(screen, &screen->altSaved);
+			}
+			else
+			{
+				screen_restore(screen, &screen->altSaved);
+			}
+			break;
+
+		case 1049:
+			if (enable)
+			{
+				screen_save(screen, &screen->altSaved);
+				screen_alternate(screen, 1, 1);
+			}
+			else
+			{
+				screen_alternate(screen, 0, 0);
+				screen_restore(screen, &screen->altSaved);
+			}
+			break;
+		}
+	}
+}
+
+/* nearest entry in the 6x6x6 colour cube */
+static unsigned screen_rgb(unsigned r, unsigned g, unsigned b)
+{
+	return 16 + 36 * ((r * 5 + 127) / 255) + 6 * ((g * 5 + 127) / 255) + ((b * 5 + 127) / 255);
+}
+
+static void screen_sgr(struct conlog_screen* screen, const struct conlog_vt* vt)
+{
+	unsigned attr = screen->attr;
+	int i;
+
+	if (!vt->paramCount)
+	{
+		screen->attr = CONLOG_ATTR_DEFAULT;
+		return;
+	}
+
+	for (i = 0; i < vt->paramCount; i++)
+	{
+		unsigned p = vt->params[i];
+		unsigned fg = CONLOG_ATTR_FG(attr), bg = CONLOG_ATTR_BG(attr);
+		unsigned flags = attr & ~CONLOG_ATTR_DEFAULT;
+
+		switch (p)
+		{
+		case 0:
+			fg = bg = CONLOG_COLOR_DEFAULT;
+			flags = 0;
+			break;
+		case 1:
+			flags |= CONLOG_ATTR_BOLD;
+			break;
+		case 2:
+			flags |= CONLOG_ATTR_DIM;
+			break;
+		case 3:
+			flags |= CONLOG_ATTR_ITALIC;
+			break;
+		case 4:
+			flags |= CONLOG_ATTR_UNDERLINE;
+			break;
+		case 5:
+			flags |= CONLOG_ATTR_BLINK;
+			break;
+		case 7:
+			flags |= CONLOG_ATTR_INVERSE;
+			break;
+		case 8:
+			flags |= CONLOG_ATTR_HIDDEN;
+			break;
+		case 9:
+			flags |= CONLOG_ATTR_STRIKE;
+			break;
+		case 22:
+			flags &= ~(CONLOG_ATTR_BOLD | CONLOG_ATTR_DIM);
+			break;
+		case 23:
+			flags &= ~CONLOG_ATTR_ITALIC;
+			break;
+		case 24:
+			flags &= ~CONLOG_ATTR_UNDERLINE;
+			break;
+		case 25:
+			flags &= ~CONLOG_ATTR_BLINK;
+			break;
+		case 27:
+			flags &= ~CONLOG_ATTR_INVERSE;
+			break;
+		case 28:
+			flags &= ~CONLOG_ATTR_HIDDEN;
+			break;
+		case 29:
+			flags &= ~CONLOG_ATTR_STRIKE;
+			break;
+		case 39:
+			fg = CONLOG_COLOR_DEFAULT;
+			break;
+		case 49:
+			bg = CONLOG_COLOR_DEFAULT;
+			break;
+		case 38:
+		case 48:
+			{
+				unsigned color = CONLOG_COLOR_DEFAULT;
+
+				if ((i + 2 < vt->paramCount) && (vt->params[i + 1] == 5))
+				{
+					color = vt->params[i + 2] & 0xFF;
+					i += 2;
+				}
+				else if ((i + 4 < vt->paramCount) && (vt->params[i + 1] == 2))
+				{
+					color = screen_rgb(vt->params[i + 2] & 0xFF, vt->params[i + 3] & 0xFF, vt->params[i + 4] & 0xFF);
+					i += 4;
+				}
+				else
+				{
+					i = vt->paramCount;
+				}
+
+				if (p == 38)
+				{
+					fg = color;
+				}
+				else
+				{
+					bg = color;
+				}
+			}
+			break;
+		default:
+			if (p >= 30 && p <= 37)
+			{
+				fg = p - 30;
+			}
+			else if (p >= 40 && p <= 47)
+			{
+				bg = p - 40;
+			}
+			else if (p >= 90 && p <= 97)
+			{
+				fg = p - 90 + 8;
+			}
+			else if (p >= 100 && p <= 107)
+			{
+				bg = p - 100 + 8;
+			}
+			break;
+		}
+
+		attr = flags | CONLOG_ATTR_COLORS(fg, bg);
+	}
+
+	screen->attr = attr;
+}
+
+static void screen_csi(void* context, const struct conlog_vt* vt, unsigned char final)
+{
+	struct conlog_screen* screen = context;
+	int n = screen_param(vt, 0, 1);
+	struct conlog_cell* cell;
+	int i;
+
+	if (vt->intermediate)
+	{
+		/* DECSTR */
+		if ((vt->intermediate == '!') && (final == 'p'))
+		{
+			screen->top = 0;
+			screen->bottom = screen->rows - 1;
+			screen->autowrap = 1;
+			screen->origin = 0;
+			screen->cursorVisible = 1;
+			screen->attr = CONLOG_ATTR_DEFAULT;
+			screen_save(screen, &screen->saved);
+		}
+
+		return;
+	}
+
+	if (vt->marker && (final != 'h') && (final != 'l'))
+	{
+		return;
+	}
+
+	switch (final)
+	{
+	case 'A':
+		screen->row = screen_max(screen->row - n, (screen->row >= screen->top) ? screen->top : 0);
+		screen->wrapPending = 0;
+		break;
+
+	case 'B':
+	case 'e':
+		screen->row = screen_min(screen->row + n, (screen->row <= screen->bottom) ? screen->bottom : screen->rows - 1);
+		screen->wrapPending = 0;
+		break;
+
+	case 'C':
+	case 'a':
+		screen->col = screen_min(screen->col + n, screen->cols - 1);
+		screen->wrapPending = 0;
+		break;
+
+	case 'D':
+		screen->col = screen_max(screen->col - n, 0);
+		screen->wrapPending = 0;
+		break;
+
+	case 'E':
+		screen->row = screen_min(screen->row + n, (screen->row <= screen->bottom) ? screen->bottom : screen->rows - 1);
+		screen->col = 0;
+		screen->wrapPending = 0;
+		break;
+
+	case 'F':
+		screen->row = screen_max(screen->row - n, (screen->row >= screen->top) ? screen->top : 0);
+		screen->col = 0;
+		screen->wrapPending = 0;
+		break;
+
+	case 'G':
+	case '`':
+		screen->col = screen_min(n, screen->cols) - 1;
+		screen->wrapPending = 0;
+		break;
+
+	case 'H':
+	case 'f':
+		screen_goto(screen, n - 1, screen_param(vt, 1, 1) - 1);
+		break;
+
+	case 'd':
+		screen_goto(screen, n - 1, screen->col);
+		break;
+
+	case 'J':
+		switch (screen_param(vt, 0, 0))
+		{
+		case 0:
+			screen_erase(screen, screen->row, screen->col, screen->cols);
+			screen_erase_rows(screen, screen->row + 1, screen->rows);
+			break;
+		case 1:
+			screen_erase_rows(screen, 0, screen->row);
+			screen_erase(screen, screen->row, 0, screen->col + 1);
+			break;
+		case 2:
+			screen_erase_rows(screen, 0, screen->rows);
+			break;
+		}
+		break;
+
+	case 'K':
+		switch (screen_param(vt, 0, 0))
+		{
+		case 0:
+			screen_erase(screen, screen->row, screen->col, screen->cols);
+			break;
+		case 1:
+			screen_erase(screen, screen->row, 0, screen->col + 1);
+			break;
+		case 2:
+			screen_erase(screen, screen->row, 0, screen->cols);
+			break;
+		}
+		break;
+
+	case 'L':
+		if (screen->row >= screen->top && screen->row <= screen->bottom)
+		{
+			screen_scroll_down(screen, screen->row, screen->bottom, n);
+			screen->col = 0;
+			screen->wrapPending = 0;
+		}
+		break;
+
+	case 'M':
+		if (screen->row >= screen->top && screen->row <= screen->bottom)
+		{
+			screen_scroll_up(screen, screen->row, screen->bottom, n);
+			screen->col = 0;
+			screen->wrapPending = 0;
+		}
+		break;
+
+	case '@':
+		cell = screen_row(screen, screen->row);
+		n = screen_min(n, screen->cols - screen->col);
+		memmove(cell + screen->col + n, cell + screen->col, sizeof(*cell) * (screen->cols - screen->col - n));
+		screen_erase(screen, screen->row, screen->col, screen->col + n);
+		screen->wrapPending = 0;
+		break;
+
+	case 'P':
+		cell = screen_row(screen, screen->row);
+		n = screen_min(n, screen->cols - screen->col);
+		memmove(cell + screen->col, cell + screen->col + n, sizeof(*cell) * (screen->cols - screen->col - n));
+		screen_erase(screen, screen->row, screen->cols - n, screen->cols);
+		screen->wrapPending = 0;
+		break;
+
+	case 'X':
+		screen_erase(screen, screen->row, screen->col, screen_min(screen->col + n, screen->cols));
+		screen->wrapPending = 0;
+		break;
+
+	case 'S':
+		screen_scroll_up(screen, screen->top, screen->bottom, n);
+		break;
+
+	case 'T':
+		if (vt->paramCount <= 1)
+		{
+			screen_scroll_down(screen, screen->top, screen->bottom, n);
+		}
+		break;
+
+	case 'r':
+		{
+			int top = screen_param(vt, 0, 1) - 1;
+			int bottom = screen_min(screen_param(vt, 1, screen->rows), screen->rows) - 1;
+
+			if (top < bottom)
+			{
+				screen->top = top;
+				screen->bottom = bottom;
+				screen_goto(screen, 0, 0);
+			}
+		}
+		break;
+
+	case 's':
+		if (!vt->paramCount)
+		{
+			screen_save(screen, &screen->saved);
+		}
+		break;
+
+	case 'u':
+		screen_restore(screen, &screen->saved);
+		break;
+
+	case 'm':
+		screen_sgr(screen, vt);
+		break;
+
+	case 'h':
+		screen_mode(screen, vt, 1);
+		break;
+
+	case 'l':
+		screen_mode(screen, vt, 0);
+		break;
+
+	case 'b':
+		/* REP repeats the last printed character, rarely used, treat as advancing */
+		for (i = 0; i < n && i < screen->cols; i++)
+		{
+			struct conlog_cell* last = screen_row(screen, screen->row) + screen_max(screen->col - 1, 0);
+
+			screen_put(screen, last->ch == CONLOG_CELL_CONTINUE ? ' ' : last->ch);
+		}
+		break;
+	}
+}
+
+static int screen_alloc(struct conlog_screen* screen, int rows, int cols)
+{
+	struct conlog_cell* cells = malloc(sizeof(struct conlog_cell) * rows * cols);
+	struct conlog_cell** lines = malloc(sizeof(struct conlog_cell*) * rows * 2);
+	unsigned char* dirty = malloc(rows);
+	int r, c;
+
+	if (!(cells && lines && dirty))
+	{
+		free(cells);
+		free(lines);
+		free(dirty);
+		return -1;
+	}
+
+	for (r = 0; r < rows; r++)
+	{
+		struct conlog_cell* row = cells + (size_t)r * cols;
+
+		for (c = 0; c < cols; c++)
+		{
+			row[c].ch = ' ';
+			row[c].attr = CONLOG_ATTR_DEFAULT;
+		}
+
+		/* keep what fits of the visible screen, anchored at the top, the hidden one is dropped */
+		if (screen->cells && (r < screen->rows))
+		{
+			memcpy(row, screen_row(screen, r), sizeof(struct conlog_cell) * screen_min(cols, screen->cols));
+		}
+
+		lines[r] = row;
+	}
+
+	free(screen->cells);
+	free(screen->alt);
+	free(screen->lines < screen->altLines ? screen->lines : screen->altLines);
+	free(screen->dirty);
+
+	screen->cells = cells;
+	screen->alt = NULL;
+	screen->lines = lines;
+	screen->altLines = lines + rows;
+	screen->dirty = dirty;
+	screen->rows = rows;
+	screen->cols = cols;
+
+	memset(dirty, 1, rows);
+
+	return 0;
+}
+
+static void screen_apply_resize(struct conlog_screen* screen)
+{
+	/* taken and cleared in one step, so a resize stored meanwhile waits for the next call rather than being lost */
+	size_t size = conlog_atomic_exchange(&screen->resize, 0);
+	int rows = (int)(size >> 16), cols = (int)(size & 0xFFFF);
+
+	if (!size || (rows == screen->rows && cols == screen->cols) || screen_alloc(screen, rows, cols))
+	{
+		return;
+	}
+
+	screen->top = 0;
+	screen->bottom = rows - 1;
+	screen->row = screen_min(screen->row, rows - 1);
+	screen->col = screen_min(screen->col, cols - 1);
+	screen->wrapPending = 0;
+}
+
+int conlog_screen_init(struct conlog_screen* screen, int rows, int cols)
+{
+	memset(screen, 0, sizeof(*screen));
+
+	conlog_vt_init(&screen->vt);
+
+	if (screen_alloc(screen, screen_max(rows, 1), screen_max(cols, 1)))
+	{
+		return -1;
+	}
+
+	screen_reset(screen);
+
+	return 0;
+}
+
+void conlog_screen_free(struct conlog_screen* screen)
+{
+	free(screen->cells);
+	free(screen->alt);
+	free(screen->lines < screen->altLines ? screen->lines : screen->altLines);
+	free(screen->dirty);
+
+	screen->cells = NULL;
+	screen->alt = NULL;
+	screen->lines = NULL;
+	screen->altLines = NULL;
+	screen->dirty = NULL;
+}
+
+void conlog_screen_feed(struct conlog_screen* screen, const unsigned char* data, size_t len)
+{
+	static const struct conlog_vt_sink sink = { screen_print, screen_execute, screen_esc, screen_csi };
+
+	if (conlog_atomic_load(&screen->resize))
+	{
+		screen_apply_resize(screen);
+	}
+
+	conlog_vt_feed(&screen->vt, data, len, &sink, screen);
+}
+
+void conlog_screen_resize(struct conlog_screen* screen, int rows, int cols)
+{
+	if ((rows > 0) && (cols > 0) && (rows < 0x10000) && (cols < 0x10000))
+	{
+		conlog_atomic_store(&screen->resize, ((size_t)rows << 16) | (size_t)cols);
+	}
+}
+
+void conlog_screen_move(struct conlog_screen* screen, int row, int col)
+{
+	screen->row = screen_max(0, screen_min(row, screen->rows - 1));
+	screen->col = screen_max(0, screen_min(col, screen->cols - 1));
+	screen->wrapPending = 0;
+}
+
+const struct conlog_cell* conlog_screen_line(const struct conlog_screen* screen, int row)
+{
+	return screen->lines[row];
+}
+
+int conlog_screen_report(struct conlog_screen* screen, char* buf, size_t size)
+{
+	int row;
+
+	if (conlog_atomic_load(&screen->resize))
+	{
+		screen_apply_resize(screen);
+	}
+
+	row = screen->row;
+
+	if (screen->origin)
+	{
+		row -= screen->top;
+	}
+
+	return snprintf(buf, size, "\033[%d;%dR", row + 1, screen->col + 1);
+}
+
+size_t conlog_screen_modes(const struct conlog_screen* screen, unsigned from, char* buf, size_t size)
+{
+	unsigned change = from ^ screen->modes;
+	size_t len = 0, m;
+
+	for (m = 0; m < sizeof(screen_input_modes) / sizeof(screen_input_modes[0]); m++)
+	{
+		if ((change & (1u << m)) && (len + 16 < size))
+		{
+			int on = (screen->modes >> m) & 1;
+
+			if (screen_input_modes[m])
+			{
+				len += snprintf(buf + len, size - len, "\033[?%u%c", screen_input_modes[m], on ? 'h' : 'l');
+			}
+			else
+			{
+				len += snprintf(buf + len, size - len, "\033%c", on ? '=' : '>');
+			}
+		}
+	}
+
+	return len;
+}
@@ -0,0 +1,97 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_SCREEN_H
+#define CONLOG_SCREEN_H
+
+#include "vtparse.h"
+
+/* cell attributes, colours are 0-255 or DEFAULT */
+#define CONLOG_COLOR_DEFAULT	256
+#define CONLOG_ATTR_FG(a)		((a) & 0x1FF)
+#define CONLOG_ATTR_BG(a)		(((a) >> 9) & 0x1FF)
+#define CONLOG_ATTR_COLORS(fg, bg)	((unsigned)(fg) | ((unsigned)(bg) << 9))
+#define CONLOG_ATTR_BOLD		(1u << 18)
+#define CONLOG_ATTR_DIM			(1u << 19)
+#define CONLOG_ATTR_ITALIC		(1u << 20)
+#define CONLOG_ATTR_UNDERLINE	(1u << 21)
+#define CONLOG_ATTR_BLINK		(1u << 22)
+#define CONLOG_ATTR_INVERSE		(1u << 23)
+#define CONLOG_ATTR_HIDDEN		(1u << 24)
+#define CONLOG_ATTR_STRIKE		(1u << 25)
+#define CONLOG_ATTR_DEFAULT		CONLOG_ATTR_COLORS(CONLOG_COLOR_DEFAULT, CONLOG_COLOR_DEFAULT)
+
+/* the right half of a double width character */
+#define CONLOG_CELL_CONTINUE	0xFFFFFFFFu
+
+/* modes that change what the terminal sends, a renderer passes these on */
+#define CONLOG_MODE_CURSOR_KEYS	(1u << 0)	/* ? 1 */
+#define CONLOG_MODE_KEYPAD		(1u << 1)	/* ESC = */
+#define CONLOG_MODE_MOUSE_X10	(1u << 2)	/* ? 9 */
+#define CONLOG_MODE_MOUSE		(1u << 3)	/* ? 1000 */
+#define CONLOG_MODE_MOUSE_DRAG	(1u << 4)	/* ? 1002 */
+#define CONLOG_MODE_MOUSE_ANY	(1u << 5)	/* ? 1003 */
+#define CONLOG_MODE_FOCUS		(1u << 6)	/* ? 1004 */
+#define CONLOG_MODE_MOUSE_UTF8	(1u << 7)	/* ? 1005 */
+#define CONLOG_MODE_MOUSE_SGR	(1u << 8)	/* ? 1006 */
+#define CONLOG_MODE_MOUSE_URXVT	(1u << 9)	/* ? 1015 */
+#define CONLOG_MODE_PASTE		(1u << 10)	/* ? 2004 */
+
+struct conlog_cell
+{
+	unsigned ch;
+	unsigned attr;
+};
+
+struct conlog_screen_cursor
+{
+	int row, col;
+	unsigned attr;
+	int origin, wrapPending;
+};
+
+/* the state of the console as the child sees it, kept from the output stream */
+struct conlog_screen
+{
+	struct conlog_vt vt;
+	int rows, cols;
+	int row, col, wrapPending;
+	int top, bottom;
+	int autowrap, origin, cursorVisible, altActive;
+	unsigned attr, modes;
+	struct conlog_screen_cursor saved, altSaved;
+	/* rows * cols cells, alt is allocated on first use */
+	struct conlog_cell *cells, *alt;
+	/* where each row is, scrolling moves the pointers rather than the cells */
+	struct conlog_cell **lines, **altLines;
+	/* one flag per row, set when a row changes, for a renderer to clear */
+	unsigned char* dirty;
+	unsigned utf8, utf8Need;
+	/* size requested from another thread, rows << 16 | cols, applied by the next feed */
+	size_t resize;
+};
+
+int conlog_screen_init(struct conlog_screen* screen, int rows, int cols);
+void conlog_screen_free(struct conlog_screen* screen);
+
+/* bytes as written to the console */
+void conlog_screen_feed(struct conlog_screen* screen, const unsigned char* data, size_t len);
+
+/* may be called from any thread */
+void conlog_screen_resize(struct conlog_screen* screen, int rows, int cols);
+
+/* zero based position */
+void conlog_screen_move(struct conlog_screen* screen, int row, int col);
+
+/* the cells of a zero based row of the visible screen */
+const struct conlog_cell* conlog_screen_line(const struct conlog_screen* screen, int row);
+
+/* formats the cursor position report a terminal would send for CSI 6 n */
+int conlog_screen_report(struct conlog_screen* screen, char* buf, size_t size);
+
+/* formats the sequences that take a terminal from the modes in from to those of the screen */
+size_t conlog_screen_modes(const struct conlog_screen* screen, unsigned from, char* buf, size_t size);
+
+#endif
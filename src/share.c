@@ -0,0 +1,657 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "share.h"
+#include "trace.h"
+
+static int share_frame_reserve(struct conlog_share* share, size_t len)
+{
+	if (share->frameLen + len > share->frameSize)
+	{
+		size_t size = share->frameSize ? share->frameSize : 4096;
+		unsigned char* frame;
+
+		while (size < share->frameLen + len)
+		{
+			size <<= 1;
+		}
+
+		frame = realloc(share->frame, size);
+
+		if (!frame)
+		{
+			return -1;
+		}
+
+		share->frame = frame;
+		share->frameSize = size;
+	}
+
+	return 0;
+}
+
+/* the renderer draws the screen for viewers into the frame buffer */
+static void share_frame_write(void* context, const struct conlog_iovec* iov, int count)
+{
+	struct conlog_share* share = context;
+
+	while (count--)
+	{
+		if (!share_frame_reserve(share, iov->len))
+		{
+			memcpy(share->frame + share->frameLen, iov->data, iov->len);
+			share->frameLen += iov->len;
+		}
+
+		iov++;
+	}
+}
+
+/* the ring from at towards end, as far as it goes before wrapping */
+static size_t share_span(struct conlog_share* share, unsigned long long at, unsigned long long end, const unsigned char** data)
+{
+	size_t pos = (size_t)(at % share->ringSize);
+	size_t n = share->ringSize - pos;
+
+	if (end - at < n)
+	{
+		n = (size_t)(end - at);
+	}
+
+	*data = share->ring + pos;
+
+	return n;
+}
+
+/* what was at this place in the output may have been written over, under the mutex */
+static int share_overrun(struct conlog_share* share, unsigned long long at)
+{
+	return share->head - at > share->ringSize;
+}
+
+/* asks the share thread to look at the viewers again, under the mutex */
+static void share_want(struct conlog_share* share)
+{
+	share->wanted = 1;
+
+	if (share->hubWaiting)
+	{
+		conlog_cond_signal(&share->dataReady);
+	}
+}
+
+/* a viewer a ring behind is sent the screen and carries on from there, under the mutex */
+static void share_drop(struct conlog_share* share, struct conlog_share_viewer* viewer)
+{
+	viewer->bResync = 1;
+	share->stats.drops++;
+
+	share_want(share);
+}
+
+/* a viewer waiting for the screen with nothing left to send */
+static int share_viewer_idle(const struct conlog_share_viewer* viewer)
+{
+	return viewer->bResync && !viewer->bGone && !viewer->bSending && !viewer->snapshotLen;
+}
+
+/* the model is only the share thread's, so it is fed outside the mutex */
+static void share_feed(struct conlog_share* share, unsigned long long from, unsigned long long to)
+{
+	while (from < to)
+	{
+		const unsigned char* data;
+		size_t n = share_span(share, from, to, &data);
+
+		conlog_screen_feed(&share->screen, data, n);
+
+		from += n;
+	}
+}
+
+/* draws the screen for the viewers waiting for it, who carry on from at, called and returning under the mutex */
+static void share_snapshot(struct conlog_share* share, unsigned long long at)
+{
+	struct conlog_share_viewer* viewer;
+
+	conlog_mutex_unlock(&share->mutex);
+
+	share->frameLen = 0;
+
+	/* output let go may have left the viewer inside a sequence, CAN ends it */
+	if (!share_frame_reserve(share, 1))
+	{
+		share->frame[share->frameLen++] = 0x18;
+	}
+
+	conlog_render_full(&share->render);
+
+	conlog_mutex_lock(&share->mutex);
+
+	/* only this thread gives out screens, so an idle viewer is still idle unless it has gone */
+	for (viewer = share->viewers; viewer; viewer = viewer->next)
+	{
+		if (!share_viewer_idle(viewer))
+		{
+			continue;
+		}
+
+		if (share->frameLen > viewer->snapshotSize)
+		{
+			unsigned char* snapshot = realloc(viewer->snapshot, share->frameLen);
+
+			if (!snapshot)
+			{
+				continue;
+			}
+
+			viewer->snapshot = snapshot;
+			viewer->snapshotSize = share->frameLen;
+		}
+
+		memcpy(viewer->snapshot, share->frame, share->frameLen);
+
+		viewer->snapshotLen = share->frameLen;
+		viewer->cursor = at;
+		viewer->bResync = 0;
+		share->stats.snapshots++;
+	}
+
+	if (share->viewersWaiting)
+	{
+		conlog_cond_broadcast(&share->viewerReady);
+	}
+}
+
+static void share_main(void* arg)
+{
+	struct conlog_share* share = arg;
+
+	CONLOG_TRACE_THREAD("share");
+
+	conlog_mutex_lock(&share->mutex);
+
+	for (;;)
+	{
+		struct conlog_share_viewer* viewer;
+		unsigned long long start, from, to, resizeAt;
+		int bResize, bIdle = 0, rows, cols;
+
+		while ((share->head == share->modelAt) && !share->bResize && !share->wanted && !share->stopping)
+		{
+			share->hubWaiting = 1;
+			conlog_cond_wait(&share->dataReady, &share->mutex);
+			share->hubWaiting = 0;
+		}
+
+		/* the viewers are done with the model by now */
+		if (share->stopping)
+		{
+			break;
+		}
+
+		from = share->modelAt;
+		to = share->head;
+		bResize = (int)share->bResize;
+		resizeAt = share->resizeAt;
+		rows = share->resizeRows;
+		cols = share->resizeCols;
+
+		share->bResize = 0;
+		share->wanted = 0;
+
+		/* what has been written over is lost to the model, the viewers keeping up have had it */
+		if (share_overrun(share, from))
+		{
+			share->stats.bytesLost += to - share->ringSize - from;
+			from = to - share->ringSize;
+		}
+
+		conlog_mutex_unlock(&share->mutex);
+
+		start = CONLOG_TRACE_CLOCK();
+
+		/* the model takes the output and the resize in the order they came */
+		if (bResize)
+		{
+			if (resizeAt < from)
+			{
+				resizeAt = from;
+			}
+
+			share_feed(share, from, resizeAt);
+			conlog_screen_resize(&share->screen, rows, cols);
+			share_feed(share, resizeAt, to);
+		}
+		else
+		{
+			share_feed(share, from, to);
+		}
+
+		CONLOG_TRACE_SPAN("share", start, to - from);
+
+		conlog_mutex_lock(&share->mutex);
+
+		/* output written over while the model read it may have reached it damaged */
+		if (share_overrun(share, from))
+		{
+			unsigned long long over = share->head - share->ringSize - from;
+
+			share->stats.bytesLost += (over < to - from) ? over : (to - from);
+		}
+
+		share->modelAt = to;
+
+		for (viewer = share->viewers; viewer; viewer = viewer->next)
+		{
+			bIdle |= share_viewer_idle(viewer);
+		}
+
+		if (bIdle)
+		{
+			share_snapshot(share, to);
+		}
+	}
+
+	conlog_mutex_unlock(&share->mutex);
+}
+
+/* sends the screen when there is one, then the output from the viewer's place in the ring */
+static void share_viewer_main(void* arg)
+{
+	struct conlog_share_viewer* viewer = arg;
+	struct conlog_share* share = viewer->share;
+
+	CONLOG_TRACE_THREAD("viewer");
+
+	conlog_mutex_lock(&share->mutex);
+
+	for (;;)
+	{
+		const unsigned char* data;
+		unsigned long long at = 0;
+		size_t len;
+		int bSnapshot = 0, bFailed;
+
+		/* a viewer waiting for the screen still waits for it once the session has finished */
+		while (!viewer->snapshotLen && (viewer->bResync || (viewer->cursor == share->head)) && !viewer->bGone && (viewer->bResync || !share->bFinished))
+		{
+			share->viewersWaiting++;
+			conlog_cond_wait(&share->viewerReady, &share->mutex);
+			share->viewersWaiting--;
+		}
+
+		if (viewer->bGone)
+		{
+			break;
+		}
+
+		if (viewer->snapshotLen)
+		{
+			data = viewer->snapshot;
+			len = viewer->snapshotLen;
+			bSnapshot = 1;
+		}
+		else if (!viewer->bResync && (viewer->cursor != share->head))
+		{
+			if (share_overrun(share, viewer->cursor))
+			{
+				share_drop(share, viewer);
+				continue;
+			}
+
+			at = viewer->cursor;
+			len = share_span(share, at, share->head, &data);
+		}
+		else
+		{
+			/* the session has finished and there is nothing more to send */
+			break;
+		}
+
+		viewer->bSending = 1;
+
+		conlog_mutex_unlock(&share->mutex);
+
+		bFailed = conlog_viewer_send(&viewer->viewer, data, len);
+
+		conlog_mutex_lock(&share->mutex);
+
+		viewer->bSending = 0;
+
+		if (bFailed)
+		{
+			break;
+		}
+
+		share->stats.bytesSent += len;
+
+		if (bSnapshot)
+		{
+			viewer->snapshotLen = 0;
+		}
+		else if (share_overrun(share, at))
+		{
+			/* the producer wrote over it while it was sent, the screen puts right whatever the viewer was given */
+			share_drop(share, viewer);
+		}
+		else
+		{
+			viewer->cursor = at + len;
+		}
+	}
+
+	/* the screen is let go now rather than when the viewer is reaped */
+	viewer->bGone = 1;
+	viewer->bDone = 1;
+	viewer->snapshotLen = 0;
+	viewer->snapshotSize = 0;
+
+	free(viewer->snapshot);
+
+	viewer->snapshot = NULL;
+
+	share->running--;
+	conlog_cond_signal(&share->drained);
+
+	conlog_mutex_unlock(&share->mutex);
+}
+
+static void share_viewer_free(struct conlog_share_viewer* viewer)
+{
+	conlog_thread_join(&viewer->thread);
+	conlog_viewer_close(&viewer->viewer);
+
+	free(viewer);
+}
+
+/* takes the viewers whose threads have finished out of the list */
+static struct conlog_share_viewer* share_reap(struct conlog_share* share)
+{
+	struct conlog_share_viewer** link = &share->viewers;
+	struct conlog_share_viewer* done = NULL;
+
+	while (*link)
+	{
+		struct conlog_share_viewer* viewer = *link;
+
+		if (viewer->bDone)
+		{
+			*link = viewer->next;
+			viewer->next = done;
+			done = viewer;
+		}
+		else
+		{
+			link = &viewer->next;
+		}
+	}
+
+	return done;
+}
+
+static void share_accept_main(void* arg)
+{
+	struct conlog_share* share = arg;
+
+	CONLOG_TRACE_THREAD("accept");
+
+	for (;;)
+	{
+		struct conlog_share_viewer* viewer = calloc(1, sizeof(*viewer));
+		struct conlog_share_viewer* done;
+
+		if (!viewer)
+		{
+			break;
+		}
+
+		if (conlog_listener_accept(&share->listener, &viewer->viewer))
+		{
+			free(viewer);
+			break;
+		}
+
+		viewer->share = share;
+		/* a viewer joining is sent the screen first */
+		viewer->bResync = 1;
+
+		conlog_mutex_lock(&share->mutex);
+
+		done = share_reap(share);
+
+		if (!conlog_thread_start(&viewer->thread, share_viewer_main, viewer))
+		{
+			viewer->next = share->viewers;
+			share->viewers = viewer;
+			share->running++;
+			share->stats.viewers++;
+			viewer = NULL;
+
+			share_want(share);
+		}
+
+		conlog_mutex_unlock(&share->mutex);
+
+		if (viewer)
+		{
+			conlog_viewer_close(&viewer->viewer);
+			free(viewer);
+		}
+
+		while (done)
+		{
+			viewer = done;
+			done = viewer->next;
+			share_viewer_free(viewer);
+		}
+	}
+}
+
+static void share_destroy(struct conlog_share* share)
+{
+	conlog_cond_destroy(&share->drained);
+	conlog_cond_destroy(&share->viewerReady);
+	conlog_cond_destroy(&share->dataReady);
+	conlog_mutex_destroy(&share->mutex);
+	conlog_render_stop(&share->render);
+	conlog_screen_free(&share->screen);
+
+	free(share->ring);
+	free(share->frame);
+}
+
+int conlog_share_start(struct conlog_share* share, const char* path, int rows, int cols, size_t bufferSize)
+{
+	memset(share, 0, sizeof(*share));
+
+	share->ringSize = bufferSize;
+	share->ring = malloc(bufferSize);
+
+	if (!share->ring || conlog_screen_init(&share->screen, rows, cols))
+	{
+		free(share->ring);
+
+		return -1;
+	}
+
+	if (conlog_render_init(&share->render, &share->screen, 1, share_frame_write, share))
+	{
+		conlog_screen_free(&share->screen);
+		free(share->ring);
+
+		return -1;
+	}
+
+	conlog_mutex_init(&share->mutex);
+	conlog_cond_init(&share->dataReady);
+	conlog_cond_init(&share->viewerReady);
+	conlog_cond_init(&share->drained);
+
+	if (conlog_listener_open(&share->listener, path))
+	{
+		share_destroy(share);
+
+		return -1;
+	}
+
+	if (conlog_thread_start(&share->hub, share_main, share))
+	{
+		conlog_listener_close(&share->listener);
+		share_destroy(share);
+
+		return -1;
+	}
+
+	if (conlog_thread_start(&share->accept, share_accept_main, share))
+	{
+		conlog_mutex_lock(&share->mutex);
+		share->stopping = 1;
+		conlog_cond_signal(&share->dataReady);
+		conlog_mutex_unlock(&share->mutex);
+
+		conlog_thread_join(&share->hub);
+
+		conlog_listener_close(&share->listener);
+		share_destroy(share);
+
+		return -1;
+	}
+
+	return 0;
+}
+
+void conlog_share_output(void* context, const struct conlog_iovec* iov, int count)
+{
+	struct conlog_share* share = context;
+	int i;
+
+	conlog_mutex_lock(&share->mutex);
+
+	/* the producer never waits, whoever is a ring behind is written over */
+	for (i = 0; i < count; i++)
+	{
+		const unsigned char* data = iov[i].data;
+		size_t len = iov[i].len;
+
+		if (len > share->ringSize)
+		{
+			share->head += len - share->ringSize;
+			data += len - share->ringSize;
+			len = share->ringSize;
+		}
+
+		while (len)
+		{
+			size_t pos = (size_t)(share->head % share->ringSize);
+			size_t n = share->ringSize - pos;
+
+			if (n > len)
+			{
+				n = len;
+			}
+
+			memcpy(share->ring + pos, data, n);
+
+			share->head += n;
+			data += n;
+			len -= n;
+		}
+	}
+
+	if (share->hubWaiting)
+	{
+		conlog_cond_signal(&share->dataReady);
+	}
+
+	if (share->viewersWaiting)
+	{
+		conlog_cond_broadcast(&share->viewerReady);
+	}
+
+	conlog_mutex_unlock(&share->mutex);
+}
+
+void conlog_share_resize(struct conlog_share* share, int rows, int cols)
+{
+	conlog_mutex_lock(&share->mutex);
+
+	/* a second resize before the thread takes the first wins, from where the first came */
+	if (!share->bResize)
+	{
+		share->resizeAt = share->head;
+	}
+
+	share->resizeRows = rows;
+	share->resizeCols = cols;
+	share->bResize = 1;
+
+	if (share->hubWaiting)
+	{
+		conlog_cond_signal(&share->dataReady);
+	}
+
+	conlog_mutex_unlock(&share->mutex);
+}
+
+void conlog_share_stop(struct conlog_share* share)
+{
+	struct conlog_share_viewer* viewer;
+	unsigned long long deadline;
+
+	conlog_listener_stop(&share->listener);
+	conlog_thread_join(&share->accept);
+
+	conlog_mutex_lock(&share->mutex);
+
+	/* the share thread carries on, so a viewer falling behind now is still sent the screen */
+	share->bFinished = 1;
+	conlog_cond_broadcast(&share->viewerReady);
+
+	deadline = conlog_clock() + CONLOG_SHARE_DRAIN * 1000000ULL;
+
+	while (share->running)
+	{
+		unsigned long long now = conlog_clock();
+
+		if (now >= deadline)
+		{
+			break;
+		}
+
+		conlog_cond_timedwait(&share->drained, &share->mutex, (unsigned)((deadline - now) / 1000000) + 1);
+	}
+
+	/* a viewer still sending is not waited for any longer */
+	for (viewer = share->viewers; viewer; viewer = viewer->next)
+	{
+		if (!viewer->bDone)
+		{
+			viewer->bGone = 1;
+			conlog_viewer_hangup(&viewer->viewer);
+		}
+	}
+
+	conlog_cond_broadcast(&share->viewerReady);
+
+	share->stopping = 1;
+	conlog_cond_signal(&share->dataReady);
+
+	conlog_mutex_unlock(&share->mutex);
+
+	conlog_thread_join(&share->hub);
+
+	while (share->viewers)
+	{
+		viewer = share->viewers;
+		share->viewers = viewer->next;
+		share_viewer_free(viewer);
+	}
+
+	conlog_listener_close(&share->listener);
+	share_destroy(share);
+}
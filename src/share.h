@@ -0,0 +1,96 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ *
+ * Live viewing of a session over a local socket, or a named pipe on Windows.
+ *
+ * The output is copied into a ring and the producer never waits. Each
+ * viewer has a thread of its own sending from its own place in the ring,
+ * and the share thread follows it too, keeping a model of the screen. A
+ * viewer that falls so far behind that the ring has been written over has
+ * its place moved, it is sent the screen as the model has it and carries
+ * on live from there, while the other viewers are not touched. A viewer
+ * joining starts the same way. Output the share thread itself falls a
+ * ring behind on is lost to the model only.
+ */
+
+#ifndef CONLOG_SHARE_H
+#define CONLOG_SHARE_H
+
+#include "output.h"
+#include "screen.h"
+#include "render.h"
+#include "platform.h"
+
+/* the output held in the ring for the viewers and the share thread */
+#define CONLOG_SHARE_BUFFER_DEFAULT	(1 << 20)
+#define CONLOG_SHARE_BUFFER_MIN		(1 << 16)
+#define CONLOG_SHARE_BUFFER_MAX		(1 << 26)
+/* how long viewers are given to take what they have queued when the session ends, in milliseconds */
+#define CONLOG_SHARE_DRAIN		1000
+
+struct conlog_share_stats
+{
+	/* viewers that connected */
+	unsigned long long viewers;
+	/* screens sent, to viewers joining and to viewers that fell behind */
+	unsigned long long snapshots;
+	/* times a viewer fell a ring behind */
+	unsigned long long drops;
+	/* output the share thread did not take in time, the model misses it but the viewers keeping up do not */
+	unsigned long long bytesLost;
+	unsigned long long bytesSent;
+};
+
+struct conlog_share;
+
+struct conlog_share_viewer
+{
+	struct conlog_share_viewer* next;
+	struct conlog_share* share;
+	struct conlog_viewer viewer;
+	struct conlog_thread thread;
+	/* where in the output the viewer has sent up to */
+	unsigned long long cursor;
+	/* the screen to send before carrying on from cursor */
+	unsigned char* snapshot;
+	size_t snapshotLen, snapshotSize;
+	int bSending, bResync, bGone, bDone;
+};
+
+struct conlog_share
+{
+	struct conlog_listener listener;
+	/* everything below is under the mutex but the model, which is the share thread's own */
+	conlog_mutex mutex;
+	conlog_cond dataReady, viewerReady, drained;
+	unsigned char* ring;
+	size_t ringSize;
+	/* all the output there has been, and how much of it the model has had */
+	unsigned long long head, modelAt;
+	int resizeRows, resizeCols;
+	unsigned long long resizeAt;
+	size_t bResize, wanted, hubWaiting, viewersWaiting, stopping;
+	struct conlog_thread hub, accept;
+	struct conlog_share_viewer* viewers;
+	int running, bFinished;
+	/* the share thread's model of the screen, drawn for viewers that need it */
+	struct conlog_screen screen;
+	struct conlog_render render;
+	unsigned char* frame;
+	size_t frameLen, frameSize;
+	struct conlog_share_stats stats;
+};
+
+/* listens at path, bufferSize is the ring the viewers send from */
+int conlog_share_start(struct conlog_share* share, const char* path, int rows, int cols, size_t bufferSize);
+
+/* a conlog_output_fn for the output of the child, it never waits on a viewer */
+void conlog_share_output(void* context, const struct conlog_iovec* iov, int count);
+
+void conlog_share_resize(struct conlog_share* share, int rows, int cols);
+
+/* gives viewers a moment to take what is queued, then hangs up on them */
+void conlog_share_stop(struct conlog_share* share);
+
+#endif
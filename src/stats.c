@@ -0,0 +1,311 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stats.h"
+#include "platform.h"
+#include "trace.h"
+
+void conlog_stats_init(struct conlog_stats* stats, const char* io)
+{
+	memset(stats, 0, sizeof(*stats));
+
+	stats->io = io;
+	stats->threads = 1;
+}
+
+void conlog_stats_dsr_request(struct conlog_stats* stats)
+{
+	if (!conlog_atomic_load(&stats->dsrPending))
+	{
+		stats->dsrStart = conlog_clock();
+		conlog_atomic_store(&stats->dsrPending, 1);
+		CONLOG_TRACE_MARK("dsr request", 0);
+	}
+}
+
+void conlog_stats_dsr_reply(struct conlog_stats* stats)
+{
+	if (conlog_atomic_load(&stats->dsrPending))
+	{
+		unsigned long long t = conlog_clock() - stats->dsrStart;
+
+		CONLOG_TRACE_SPAN("dsr round trip", stats->dsrStart, t);
+		stats->dsrCount++;
+		stats->dsrTotal += t;
+
+		if (t > stats->dsrMax)
+		{
+			stats->dsrMax = t;
+		}
+
+		conlog_atomic_store(&stats->dsrPending, 0);
+	}
+}
+
+void conlog_stats_key(struct conlog_stats* stats)
+{
+	if (!conlog_atomic_load(&stats->echoPending))
+	{
+		stats->echoStart = conlog_clock();
+		conlog_atomic_store(&stats->echoPending, 1);
+	}
+}
+
+void conlog_stats_echo(struct conlog_stats* stats)
+{
+	if (conlog_atomic_load(&stats->echoPending))
+	{
+		unsigned long long t = conlog_clock() - stats->echoStart;
+
+		CONLOG_TRACE_SPAN("echo", stats->echoStart, t);
+		conlog_histogram_add(&stats->echo, t);
+		conlog_atomic_store(&stats->echoPending, 0);
+	}
+}
+
+/* on one line, with the buckets up to the last that is not empty */
+static void stats_histogram(FILE* fp, const struct conlog_histogram* histogram)
+{
+	int n = CONLOG_HISTOGRAM_BUCKETS, i;
+
+	while (n && !histogram->buckets[n - 1])
+	{
+		n--;
+	}
+
+	fprintf(fp, "{ \"count\": %llu, \"total\": %llu, \"max\": %llu, \"buckets\": [", histogram->count, histogram->total, histogram->max);
+
+	for (i = 0; i < n; i++)
+	{
+		fprintf(fp, i ? ", %llu" : "%llu", histogram->buckets[i]);
+	}
+
+	fprintf(fp, "] }");
+}
+
+int conlog_stats_write(const struct conlog_stats* stats, const char* path, const struct conlog_output_stats* output)
+{
+	const struct conlog_logwriter_stats* log = stats->log;
+	const struct conlog_render_stats* render = stats->render;
+	const struct conlog_blocklog_stats* compress = stats->compress;
+	const struct conlog_logfile_stats* rotate = stats->rotate;
+	const struct conlog_record_stats* record = stats->record;
+	const struct conlog_lines_stats* lines = stats->lines;
+	const struct conlog_encode_stats* encode = stats->encode;
+	const struct conlog_manifest_stats* supervisor = stats->supervisor;
+	const struct conlog_flush_stats* flush = stats->flush;
+	const struct conlog_logfile_queue_stats* uring = stats->uring;
+	const struct conlog_flight_stats* flight = stats->flight;
+	const struct conlog_share_stats* share = stats->share;
+	size_t len = strlen(path);
+	char* temp = malloc(len + 5);
+	unsigned long long cpu, peak;
+	FILE* fp;
+	int i;
+
+	if (!temp)
+	{
+		return -1;
+	}
+
+	/* a reader never sees it half written */
+	memcpy(temp, path, len);
+	memcpy(temp + len, ".tmp", 5);
+
+	fp = conlog_fopen(temp, "w");
+
+	if (!fp)
+	{
+		free(temp);
+		return -1;
+	}
+
+	fprintf(fp, "{\n");
+	fprintf(fp, "\t\"io\": \"%s\",\n", stats->io);
+	fprintf(fp, "\t\"threads\": %d,\n", stats->threads);
+	conlog_process_usage(&cpu, &peak);
+	fprintf(fp, "\t\"process\": {\n");
+	fprintf(fp, "\t\t\"cpuNanoseconds\": %llu,\n", cpu);
+	fprintf(fp, "\t\t\"peakBytes\": %llu\n", peak);
+	fprintf(fp, "\t},\n");
+	fprintf(fp, "\t\"output\": {\n");
+	fprintf(fp, "\t\t\"bytesRead\": %llu,\n", output->bytesRead);
+	fprintf(fp, "\t\t\"bytesWritten\": %llu,\n", output->bytesWritten);
+	fprintf(fp, "\t\t\"bytesCopied\": %llu,\n", output->bytesCopied);
+	fprintf(fp, "\t\t\"flushes\": %llu,\n", output->flushes);
+	fprintf(fp, "\t\t\"vectors\": %llu,\n", output->vectors);
+	fprintf(fp, "\t\t\"bytesText\": %llu,\n", output->bytesText);
+	fprintf(fp, "\t\t\"dsrSequences\": %llu,\n", output->dsr);
+	fprintf(fp, "\t\t\"focusSequences\": %llu,\n", output->focus);
+	fprintf(fp, "\t\t\"readBytes\": ");
+	stats_histogram(fp, &output->reads);
+	fprintf(fp, ",\n");
+	fprintf(fp, "\t\t\"channelNanoseconds\": [");
+
+	for (i = 0; i < output->channels; i++)
+	{
+		fprintf(fp, i ? ",\n\t\t\t" : "\n\t\t\t");
+		stats_histogram(fp, output->channelTime + i);
+	}
+
+	fprintf(fp, output->channels ? "\n\t\t]\n" : "]\n");
+	fprintf(fp, "\t},\n");
+	fprintf(fp, "\t\"dsr\": {\n");
+	fprintf(fp, "\t\t\"count\": %llu,\n", stats->dsrCount);
+	fprintf(fp, "\t\t\"meanMicroseconds\": %.1f,\n", stats->dsrCount ? stats->dsrTotal / 1e3 / stats->dsrCount : 0.0);
+	fprintf(fp, "\t\t\"maxMicroseconds\": %.1f\n", stats->dsrMax / 1e3);
+	fprintf(fp, "\t},\n");
+	fprintf(fp, "\t\"input\": {\n");
+	fprintf(fp, "\t\t\"events\": %llu\n", stats->inputEvents);
+	fprintf(fp, "\t},\n");
+	fprintf(fp, "\t\"echo\": {\n");
+	fprintf(fp, "\t\t\"count\": %llu,\n", stats->echo.count);
+	fprintf(fp, "\t\t\"p50Microseconds\": %.1f,\n", conlog_histogram_percentile(&stats->echo, 50) / 1e3);
+	fprintf(fp, "\t\t\"p99Microseconds\": %.1f,\n", conlog_histogram_percentile(&stats->echo, 99) / 1e3);
+	fprintf(fp, "\t\t\"maxMicroseconds\": %.1f,\n", stats->echo.max / 1e3);
+	fprintf(fp, "\t\t\"nanoseconds\": ");
+	stats_histogram(fp, &stats->echo);
+	fprintf(fp, "\n");
+	fprintf(fp, "\t},\n");
+	fprintf(fp, "\t\"blocked\": {\n");
+	fprintf(fp, "\t\t\"consoleNanoseconds\": ");
+	stats_histogram(fp, &stats->consoleWrite);
+	fprintf(fp, ",\n");
+	fprintf(fp, "\t\t\"fileNanoseconds\": ");
+	stats_histogram(fp, &stats->fileWrite);
+	fprintf(fp, "\n");
+
+	if (log)
+	{
+		fprintf(fp, "\t},\n");
+		fprintf(fp, "\t\"log\": {\n");
+		fprintf(fp, "\t\t\"bytesQueued\": %llu,\n", log->bytesQueued);
+		fprintf(fp, "\t\t\"bytesDropped\": %llu,\n", log->bytesDropped);
+		fprintf(fp, "\t\t\"bytesSpilled\": %llu,\n", log->bytesSpilled);
+		fprintf(fp, "\t\t\"stalls\": %llu,\n", log->stalls);
+		fprintf(fp, "\t\t\"spillPeak\": %llu\n", log->spillPeak);
+	}
+
+	if (render)
+	{
+		fprintf(fp, "\t},\n");
+		fprintf(fp, "\t\"render\": {\n");
+		fprintf(fp, "\t\t\"frames\": %llu,\n", render->frames);
+		fprintf(fp, "\t\t\"bytesDrawn\": %llu\n", render->bytesDrawn);
+	}
+
+	if (compress)
+	{
+		fprintf(fp, "\t},\n");
+		fprintf(fp, "\t\"compress\": {\n");
+		fprintf(fp, "\t\t\"bytesIn\": %llu,\n", compress->bytesIn);
+		fprintf(fp, "\t\t\"bytesOut\": %llu,\n", compress->bytesOut);
+		fprintf(fp, "\t\t\"blocks\": %llu,\n", compress->blocks);
+		fprintf(fp, "\t\t\"ratio\": %.2f,\n", compress->bytesOut ? (double)compress->bytesIn / compress->bytesOut : 0.0);
+		fprintf(fp, "\t\t\"megabytesPerSecond\": %.1f\n", compress->compressTime ? compress->bytesIn * 1e3 / compress->compressTime : 0.0);
+	}
+
+	if (rotate)
+	{
+		fprintf(fp, "\t},\n");
+		fprintf(fp, "\t\"rotate\": {\n");
+		fprintf(fp, "\t\t\"rotations\": %llu,\n", rotate->rotations);
+		fprintf(fp, "\t\t\"failures\": %llu,\n", rotate->failures);
+		fprintf(fp, "\t\t\"meanMicroseconds\": %.1f,\n", rotate->rotations ? rotate->rotateTotal / 1e3 / rotate->rotations : 0.0);
+		fprintf(fp, "\t\t\"maxMicroseconds\": %.1f\n", rotate->rotateMax / 1e3);
+	}
+
+	if (record)
+	{
+		fprintf(fp, "\t},\n");
+		fprintf(fp, "\t\"record\": {\n");
+		fprintf(fp, "\t\t\"records\": %llu,\n", record->records);
+		fprintf(fp, "\t\t\"bytesRecorded\": %llu,\n", record->bytesRecorded);
+		fprintf(fp, "\t\t\"bytesWritten\": %llu,\n", record->bytesWritten);
+		fprintf(fp, "\t\t\"keyframes\": %llu,\n", record->keyframes);
+		fprintf(fp, "\t\t\"stalls\": %llu\n", record->stalls);
+	}
+
+	if (lines)
+	{
+		fprintf(fp, "\t},\n");
+		fprintf(fp, "\t\"lines\": {\n");
+		fprintf(fp, "\t\t\"bytesIn\": %llu,\n", lines->bytesIn);
+		fprintf(fp, "\t\t\"bytesOut\": %llu,\n", lines->bytesOut);
+		fprintf(fp, "\t\t\"lines\": %llu\n", lines->lines);
+	}
+
+	if (encode)
+	{
+		fprintf(fp, "\t},\n");
+		fprintf(fp, "\t\"encode\": {\n");
+		fprintf(fp, "\t\t\"bytesIn\": %llu,\n", encode->bytesIn);
+		fprintf(fp, "\t\t\"bytesOut\": %llu,\n", encode->bytesOut);
+		fprintf(fp, "\t\t\"replaced\": %llu\n", encode->replaced);
+	}
+
+	if (supervisor)
+	{
+		fprintf(fp, "\t},\n");
+		fprintf(fp, "\t\"supervisor\": {\n");
+		fprintf(fp, "\t\t\"sessions\": %llu,\n", supervisor->sessions);
+		fprintf(fp, "\t\t\"failed\": %llu,\n", supervisor->failed);
+		fprintf(fp, "\t\t\"peak\": %llu,\n", supervisor->peak);
+		fprintf(fp, "\t\t\"workers\": %d\n", supervisor->workers);
+	}
+
+	if (flush)
+	{
+		fprintf(fp, "\t},\n");
+		fprintf(fp, "\t\"flush\": {\n");
+		fprintf(fp, "\t\t\"writes\": %llu,\n", flush->writes);
+		fprintf(fp, "\t\t\"bytesOut\": %llu,\n", flush->bytesOut);
+		fprintf(fp, "\t\t\"syncs\": %llu\n", flush->syncs);
+	}
+
+	if (uring)
+	{
+		fprintf(fp, "\t},\n");
+		fprintf(fp, "\t\"uring\": {\n");
+		fprintf(fp, "\t\t\"submits\": %llu,\n", uring->submits);
+		fprintf(fp, "\t\t\"writes\": %llu,\n", uring->writes);
+		fprintf(fp, "\t\t\"bytes\": %llu,\n", uring->bytes);
+		fprintf(fp, "\t\t\"waits\": %llu,\n", uring->waits);
+		fprintf(fp, "\t\t\"retries\": %llu\n", uring->retries);
+	}
+
+	if (flight)
+	{
+		fprintf(fp, "\t},\n");
+		fprintf(fp, "\t\"flight\": {\n");
+		fprintf(fp, "\t\t\"bytesIn\": %llu,\n", flight->bytesIn);
+		fprintf(fp, "\t\t\"dumps\": %llu,\n", flight->dumps);
+		fprintf(fp, "\t\t\"bytesOut\": %llu,\n", flight->bytesOut);
+		fprintf(fp, "\t\t\"bytesLost\": %llu\n", flight->bytesLost);
+	}
+
+	if (share)
+	{
+		fprintf(fp, "\t},\n");
+		fprintf(fp, "\t\"share\": {\n");
+		fprintf(fp, "\t\t\"viewers\": %llu,\n", share->viewers);
+		fprintf(fp, "\t\t\"snapshots\": %llu,\n", share->snapshots);
+		fprintf(fp, "\t\t\"drops\": %llu,\n", share->drops);
+		fprintf(fp, "\t\t\"bytesLost\": %llu,\n", share->bytesLost);
+		fprintf(fp, "\t\t\"bytesSent\": %llu\n", share->bytesSent);
+	}
+
+	fprintf(fp, "\t}\n");
+	fprintf(fp, "}\n");
+
+	i = (fclose(fp) || conlog_file_rename(temp, path)) ? -1 : 0;
+
+	free(temp);
+
+	return i;
+}
@@ -0,0 +1,73 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_STATS_H
+#define CONLOG_STATS_H
+
+#include "output.h"
+#include "logwriter.h"
+#include "render.h"
+#include "blocklog.h"
+#include "logfile.h"
+#include "record.h"
+#include "lines.h"
+#include "encode.h"
+#include "manifest.h"
+#include "flush.h"
+#include "flight.h"
+#include "share.h"
+
+/* what a session cost, written as JSON with --stats */
+struct conlog_stats
+{
+	const char* io;
+	int threads;
+	unsigned long long dsrCount, dsrTotal, dsrMax;
+	/* a request may be answered on another thread */
+	unsigned long long dsrStart;
+	size_t dsrPending;
+	/* console input handed to the child, reads on Linux and input records on Windows */
+	unsigned long long inputEvents;
+	/* from a key being read to the output that follows it being written, on another thread */
+	unsigned long long echoStart;
+	size_t echoPending;
+	struct conlog_histogram echo;
+	/* nanoseconds blocked writing to the console, and to the log file or redirected handle */
+	struct conlog_histogram consoleWrite;
+	struct conlog_histogram fileWrite;
+	/* set by the channels that are in use */
+	const struct conlog_logwriter_stats* log;
+	const struct conlog_render_stats* render;
+	const struct conlog_blocklog_stats* compress;
+	const struct conlog_logfile_stats* rotate;
+	const struct conlog_record_stats* record;
+	const struct conlog_lines_stats* lines;
+	const struct conlog_encode_stats* encode;
+	const struct conlog_manifest_stats* supervisor;
+	const struct conlog_flush_stats* flush;
+	const struct conlog_logfile_queue_stats* uring;
+	const struct conlog_flight_stats* flight;
+	const struct conlog_share_stats* share;
+};
+
+void conlog_stats_init(struct conlog_stats* stats, const char* io);
+
+/* a cursor position request seen in the output, and the reply sent to the child */
+void conlog_stats_dsr_request(struct conlog_stats* stats);
+void conlog_stats_dsr_reply(struct conlog_stats* stats);
+
+/*
+ * Console input read, and output from the child written out. Only the first
+ * key before each output is timed, and output the child would have sent
+ * anyway is taken as the echo, so the latency is measured best against a
+ * child that is otherwise quiet.
+ */
+void conlog_stats_key(struct conlog_stats* stats);
+void conlog_stats_echo(struct conlog_stats* stats);
+
+/* can be called while the session runs, the file is replaced whole */
+int conlog_stats_write(const struct conlog_stats* stats, const char* path, const struct conlog_output_stats* output);
+
+#endif
@@ -0,0 +1,92 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <string.h>
+#include "timer.h"
+
+void conlog_timers_init(struct conlog_timers* timers)
+{
+	memset(timers, 0, sizeof(*timers));
+}
+
+int conlog_timers_start(struct conlog_timers* timers, unsigned long long due, conlog_timer_fn fire, void* context)
+{
+	int i;
+
+	for (i = 0; i < CONLOG_TIMERS; i++)
+	{
+		struct conlog_timer* timer = timers->timer + i;
+
+		if (!timer->fire)
+		{
+			timer->due = due;
+			timer->fire = fire;
+			timer->context = context;
+
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+void conlog_timers_cancel(struct conlog_timers* timers, int index)
+{
+	if ((index >= 0) && (index < CONLOG_TIMERS))
+	{
+		timers->timer[index].fire = NULL;
+	}
+}
+
+int conlog_timers_wait(struct conlog_timers* timers, unsigned long long now)
+{
+	unsigned long long next = 0;
+	int i, found = 0;
+
+	for (i = 0; i < CONLOG_TIMERS; i++)
+	{
+		struct conlog_timer* timer = timers->timer + i;
+
+		if (timer->fire && (!found || (timer->due < next)))
+		{
+			next = timer->due;
+			found = 1;
+		}
+	}
+
+	if (!found)
+	{
+		return -1;
+	}
+
+	if (next <= now)
+	{
+		return 0;
+	}
+
+	next = (next - now + 999999) / 1000000;
+
+	return (next > 0x7FFFFFFF) ? 0x7FFFFFFF : (int)next;
+}
+
+void conlog_timers_run(struct conlog_timers* timers, unsigned long long now)
+{
+	int i;
+
+	for (i = 0; i < CONLOG_TIMERS; i++)
+	{
+		struct conlog_timer* timer = timers->timer + i;
+
+		if (timer->fire && (timer->due <= now))
+		{
+			conlog_timer_fn fire = timer->fire;
+
+			/* cleared first so the callback may start it again */
+			timer->fire = NULL;
+
+			fire(timer->context);
+		}
+	}
+}
@@ -0,0 +1,38 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_TIMER_H
+#define CONLOG_TIMER_H
+
+#define CONLOG_TIMERS	8
+
+typedef void (*conlog_timer_fn)(void* context);
+
+/* one shot timers for an event loop, times are from conlog_clock */
+struct conlog_timer
+{
+	unsigned long long due;
+	conlog_timer_fn fire;
+	void* context;
+};
+
+struct conlog_timers
+{
+	struct conlog_timer timer[CONLOG_TIMERS];
+};
+
+void conlog_timers_init(struct conlog_timers* timers);
+
+/* returns the timer index, or -1 when all are in use */
+int conlog_timers_start(struct conlog_timers* timers, unsigned long long due, conlog_timer_fn fire, void* context);
+void conlog_timers_cancel(struct conlog_timers* timers, int index);
+
+/* milliseconds until the next timer is due, -1 when none are set */
+int conlog_timers_wait(struct conlog_timers* timers, unsigned long long now);
+
+/* fires every timer that is due */
+void conlog_timers_run(struct conlog_timers* timers, unsigned long long now);
+
+#endif
@@ -0,0 +1,192 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "trace.h"
+#include "platform.h"
+
+#ifdef _MSC_VER
+#	define TRACE_LOCAL __declspec(thread)
+#else
+#	define TRACE_LOCAL __thread
+#endif
+
+struct trace_event
+{
+	const char* name;
+	unsigned long long start;
+	/* zero for a moment rather than a span */
+	unsigned long long end;
+	unsigned long long value;
+};
+
+struct trace_thread
+{
+	struct trace_thread* next;
+	const char* name;
+	int id;
+	/* events recorded, the last CONLOG_TRACE_EVENTS are kept */
+	unsigned long long count;
+	struct trace_event events[CONLOG_TRACE_EVENTS];
+};
+
+static int trace_enabled;
+static unsigned long long trace_origin;
+static conlog_mutex trace_mutex;
+static struct trace_thread* trace_threads;
+static int trace_ids;
+static TRACE_LOCAL struct trace_thread* trace_self;
+
+void conlog_trace_start(void)
+{
+	conlog_mutex_init(&trace_mutex);
+
+	trace_origin = conlog_clock();
+	trace_enabled = 1;
+}
+
+/* the lock is taken only the first time a thread traces */
+static struct trace_thread* trace_current(void)
+{
+	struct trace_thread* thread = trace_self;
+
+	if (!thread)
+	{
+		thread = malloc(sizeof(*thread));
+
+		if (!thread)
+		{
+			return NULL;
+		}
+
+		thread->name = NULL;
+		thread->count = 0;
+
+		conlog_mutex_lock(&trace_mutex);
+		thread->id = ++trace_ids;
+		thread->next = trace_threads;
+		trace_threads = thread;
+		conlog_mutex_unlock(&trace_mutex);
+
+		trace_self = thread;
+	}
+
+	return thread;
+}
+
+static void trace_record(const char* name, unsigned long long start, unsigned long long end, unsigned long long value)
+{
+	struct trace_thread* thread = trace_current();
+
+	if (thread)
+	{
+		struct trace_event* event = thread->events + (thread->count++ % CONLOG_TRACE_EVENTS);
+
+		event->name = name;
+		event->start = start;
+		event->end = end;
+		event->value = value;
+	}
+}
+
+void conlog_trace_thread(const char* name)
+{
+	if (trace_enabled)
+	{
+		struct trace_thread* thread = trace_current();
+
+		if (thread)
+		{
+			thread->name = name;
+		}
+	}
+}
+
+unsigned long long conlog_trace_clock(void)
+{
+	return trace_enabled ? conlog_clock() : 0;
+}
+
+void conlog_trace_span(const char* name, unsigned long long start, unsigned long long value)
+{
+	if (start && trace_enabled)
+	{
+		trace_record(name, start, conlog_clock(), value);
+	}
+}
+
+void conlog_trace_mark(const char* name, unsigned long long value)
+{
+	if (trace_enabled)
+	{
+		trace_record(name, conlog_clock(), 0, value);
+	}
+}
+
+int conlog_trace_finish(const char* path)
+{
+	FILE* fp;
+	int result = -1;
+
+	if (!trace_enabled)
+	{
+		return 0;
+	}
+
+	trace_enabled = 0;
+
+	fp = conlog_fopen(path, "w");
+
+	if (fp)
+	{
+		struct trace_thread* thread;
+		const char* separator = "\n";
+
+		fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+		for (thread = trace_threads; thread; thread = thread->next)
+		{
+			unsigned long long i = (thread->count > CONLOG_TRACE_EVENTS) ? thread->count - CONLOG_TRACE_EVENTS : 0;
+
+			fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", separator, thread->id, thread->name ? thread->name : "thread");
+			separator = ",\n";
+
+			for (; i < thread->count; i++)
+			{
+				const struct trace_event* event = thread->events + (i % CONLOG_TRACE_EVENTS);
+
+				if (event->end)
+				{
+					fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"value\":%llu}}",
+						event->name, thread->id, (event->start - trace_origin) / 1e3, (event->end - event->start) / 1e3, event->value);
+				}
+				else
+				{
+					fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"args\":{\"value\":%llu}}",
+						event->name, thread->id, (event->start - trace_origin) / 1e3, event->value);
+				}
+			}
+		}
+
+		fprintf(fp, "\n]}\n");
+
+		result = fclose(fp) ? -1 : 0;
+	}
+
+	trace_self = NULL;
+
+	while (trace_threads)
+	{
+		struct trace_thread* thread = trace_threads;
+
+		trace_threads = thread->next;
+		free(thread);
+	}
+
+	conlog_mutex_destroy(&trace_mutex);
+
+	return result;
+}
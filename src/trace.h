@@ -0,0 +1,47 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_TRACE_H
+#define CONLOG_TRACE_H
+
+/* events each thread keeps, older ones are overwritten */
+#define CONLOG_TRACE_EVENTS	(1 << 16)
+
+/*
+ * Trace points are built in only with CONLOG_TRACE defined, otherwise
+ * the macros leave nothing behind. Each thread records into a ring of
+ * its own that no other thread touches until the trace is written, so
+ * recording takes no lock. A span is timed from CONLOG_TRACE_CLOCK,
+ * which is zero when --trace was not given, and a span with a start of
+ * zero or while the trace is off records nothing.
+ */
+#ifdef CONLOG_TRACE
+#	define CONLOG_TRACE_THREAD(name) conlog_trace_thread(name)
+#	define CONLOG_TRACE_CLOCK() conlog_trace_clock()
+#	define CONLOG_TRACE_SPAN(name, start, value) conlog_trace_span(name, start, value)
+#	define CONLOG_TRACE_MARK(name, value) conlog_trace_mark(name, value)
+#else
+#	define CONLOG_TRACE_THREAD(name) ((void)0)
+#	define CONLOG_TRACE_CLOCK() 0
+#	define CONLOG_TRACE_SPAN(name, start, value) ((void)(start))
+#	define CONLOG_TRACE_MARK(name, value) ((void)0)
+#endif
+
+/* before any thread traces */
+void conlog_trace_start(void);
+
+/* the name the calling thread has in the trace */
+void conlog_trace_thread(const char* name);
+
+unsigned long long conlog_trace_clock(void);
+
+/* name must be a string that lasts, such as a literal */
+void conlog_trace_span(const char* name, unsigned long long start, unsigned long long value);
+void conlog_trace_mark(const char* name, unsigned long long value);
+
+/* once the threads that traced have stopped, writes Chrome trace JSON and frees the rings */
+int conlog_trace_finish(const char* path);
+
+#endif
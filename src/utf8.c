@@ -0,0 +1,435 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ *
+ * UTF-8 validation. Sequences are checked against the Unicode table of
+ * well-formed byte sequences. The AVX2 variant checks 32 bytes at a time
+ * by looking up the nibbles of each byte and the one before it, after
+ * Keiser and Lemire, "Validating UTF-8 In Less Than One Instruction Per
+ * Byte", and hands the block with the first error to the scalar decoder
+ * to say where it is.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "utf8.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#	define CONLOG_UTF8_X86
+#	ifdef _MSC_VER
+#		include <intrin.h>
+#		define CONLOG_TARGET_AVX2
+#	else
+#		define CONLOG_TARGET_AVX2 __attribute__((target("avx2")))
+#	endif
+#	include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#	define CONLOG_UTF8_SSE2
+#endif
+
+size_t conlog_utf8_decode(const unsigned char* data, size_t len, unsigned* c)
+{
+	unsigned char b = data[0], lo = 0x80, hi = 0xBF;
+	unsigned v;
+	size_t n, i;
+
+	if (b < 0x80)
+	{
+		*c = b;
+		return 1;
+	}
+
+	if ((b < 0xC2) || (b > 0xF4))
+	{
+		*c = CONLOG_UTF8_BAD;
+		return 1;
+	}
+
+	if (b < 0xE0)
+	{
+		n = 2;
+		v = b & 0x1F;
+	}
+	else if (b < 0xF0)
+	{
+		n = 3;
+		v = b & 0x0F;
+
+		if (b == 0xE0)
+		{
+			lo = 0xA0;
+		}
+		else if (b == 0xED)
+		{
+			hi = 0x9F;
+		}
+	}
+	else
+	{
+		n = 4;
+		v = b & 0x07;
+
+		if (b == 0xF0)
+		{
+			lo = 0x90;
+		}
+		else if (b == 0xF4)
+		{
+			hi = 0x8F;
+		}
+	}
+
+	for (i = 1; i < n; i++)
+	{
+		if (i == len)
+		{
+			return 0;
+		}
+
+		if ((data[i] < lo) || (data[i] > hi))
+		{
+			*c = CONLOG_UTF8_BAD;
+			return i;
+		}
+
+		v = (v << 6) | (data[i] & 0x3F);
+		lo = 0x80;
+		hi = 0xBF;
+	}
+
+	*c = v;
+
+	return n;
+}
+
+static size_t utf8_ascii_scalar(const unsigned char* data, size_t len)
+{
+	const size_t highs = (((size_t)-1) / 0xFF) * 0x80;
+	size_t i = 0;
+
+	while (i + sizeof(size_t) <= len)
+	{
+		size_t w;
+
+		memcpy(&w, data + i, sizeof(w));
+
+		if (w & highs)
+		{
+			break;
+		}
+
+		i += sizeof(w);
+	}
+
+	while ((i < len) && (data[i] < 0x80))
+	{
+		i++;
+	}
+
+	return i;
+}
+
+size_t conlog_utf8_ascii(const unsigned char* data, size_t len)
+{
+#ifdef CONLOG_UTF8_SSE2
+	size_t i = 0;
+
+	while ((i + 16 <= len) && !_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(data + i))))
+	{
+		i += 16;
+	}
+
+	while ((i < len) && (data[i] < 0x80))
+	{
+		i++;
+	}
+
+	return i;
+#else
+	return utf8_ascii_scalar(data, len);
+#endif
+}
+
+/* runs of ASCII are skipped a word at a time, the rest a sequence at a time */
+static size_t utf8_scalar(const unsigned char* data, size_t len)
+{
+	size_t i = 0;
+
+	while (i < len)
+	{
+		unsigned c;
+		size_t n;
+
+		if (data[i] < 0x80)
+		{
+			i += utf8_ascii_scalar(data + i, len - i);
+			continue;
+		}
+
+		n = conlog_utf8_decode(data + i, len - i, &c);
+
+		if (!n || (c == CONLOG_UTF8_BAD))
+		{
+			break;
+		}
+
+		i += n;
+	}
+
+	return i;
+}
+
+#ifdef CONLOG_UTF8_SSE2
+static size_t utf8_sse2(const unsigned char* data, size_t len)
+{
+	size_t i = 0;
+
+	while (i < len)
+	{
+		unsigned c;
+		size_t n;
+
+		if (data[i] < 0x80)
+		{
+			i += conlog_utf8_ascii(data + i, len - i);
+			continue;
+		}
+
+		n = conlog_utf8_decode(data + i, len - i, &c);
+
+		if (!n || (c == CONLOG_UTF8_BAD))
+		{
+			break;
+		}
+
+		i += n;
+	}
+
+	return i;
+}
+#endif
+
+#ifdef CONLOG_UTF8_X86
+/* the start of the sequence that runs over offset i, so the scalar decoder can carry on from there */
+static size_t utf8_boundary(const unsigned char* data, size_t i)
+{
+	size_t k;
+
+	for (k = 1; (k <= 3) && (k <= i); k++)
+	{
+		unsigned char b = data[i - k];
+
+		if (b < 0x80)
+		{
+			break;
+		}
+
+		if (b >= 0xC0)
+		{
+			size_t n = (b >= 0xF0) ? 4 : (b >= 0xE0) ? 3 : 2;
+
+			return (n > k) ? i - k : i;
+		}
+	}
+
+	return i;
+}
+
+/* the error classes, a byte and the one before it are in error when all three lookups share a bit */
+#define UTF8_TOO_SHORT		0x01
+#define UTF8_TOO_LONG		0x02
+#define UTF8_OVERLONG_3		0x04
+#define UTF8_TOO_LARGE		0x08
+#define UTF8_SURROGATE		0x10
+#define UTF8_OVERLONG_2		0x20
+#define UTF8_TOO_LARGE_1000	0x40
+#define UTF8_OVERLONG_4		0x40
+#define UTF8_TWO_CONTS		0x80
+#define UTF8_CARRY			(UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+#define UTF8_TABLE(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p) \
+	_mm256_setr_epi8((char)(a), (char)(b), (char)(c), (char)(d), (char)(e), (char)(f), (char)(g), (char)(h), \
+		(char)(i), (char)(j), (char)(k), (char)(l), (char)(m), (char)(n), (char)(o), (char)(p), \
+		(char)(a), (char)(b), (char)(c), (char)(d), (char)(e), (char)(f), (char)(g), (char)(h), \
+		(char)(i), (char)(j), (char)(k), (char)(l), (char)(m), (char)(n), (char)(o), (char)(p))
+
+static CONLOG_TARGET_AVX2 size_t utf8_avx2(const unsigned char* data, size_t len)
+{
+	const __m256i byte1High = UTF8_TABLE(
+		UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+		UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+		UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+		UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+		UTF8_TOO_SHORT,
+		UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+		UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4);
+	const __m256i byte1Low = UTF8_TABLE(
+		UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+		UTF8_CARRY | UTF8_OVERLONG_2,
+		UTF8_CARRY,
+		UTF8_CARRY,
+		UTF8_CARRY | UTF8_TOO_LARGE,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000);
+	const __m256i byte2High = UTF8_TABLE(
+		UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+		UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+		UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+		UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+		UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+		UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+		UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT);
+	const __m256i nibble = _mm256_set1_epi8(0x0F);
+	const __m256i third = _mm256_set1_epi8((char)(0xE0 - 0x80));
+	const __m256i fourth = _mm256_set1_epi8((char)(0xF0 - 0x80));
+	const __m256i high = _mm256_set1_epi8((char)0x80);
+	__m256i prev = _mm256_setzero_si256();
+	int prevAscii = 1;
+	size_t i = 0;
+
+	while (i + 32 <= len)
+	{
+		__m256i input = _mm256_loadu_si256((const __m256i*)(data + i));
+		int ascii = !_mm256_movemask_epi8(input);
+
+		/* nothing can be carried out of ASCII */
+		if (!(ascii && prevAscii))
+		{
+			__m256i carried = _mm256_permute2x128_si256(prev, input, 0x21);
+			__m256i prev1 = _mm256_alignr_epi8(input, carried, 15);
+			__m256i prev2 = _mm256_alignr_epi8(input, carried, 14);
+			__m256i prev3 = _mm256_alignr_epi8(input, carried, 13);
+			__m256i special = _mm256_and_si256(
+				_mm256_and_si256(
+					_mm256_shuffle_epi8(byte1High, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+					_mm256_shuffle_epi8(byte1Low, _mm256_and_si256(prev1, nibble))),
+				_mm256_shuffle_epi8(byte2High, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+			/* the third and fourth bytes of a sequence must be continuations */
+			__m256i must = _mm256_and_si256(_mm256_or_si256(_mm256_subs_epu8(prev2, third), _mm256_subs_epu8(prev3, fourth)), high);
+			__m256i error = _mm256_xor_si256(must, special);
+
+			if (!_mm256_testz_si256(error, error))
+			{
+				break;
+			}
+		}
+
+		prev = input;
+		prevAscii = ascii;
+		i += 32;
+	}
+
+	i = utf8_boundary(data, i);
+
+	return i + utf8_scalar(data + i, len - i);
+}
+
+static int utf8_has_avx2(void)
+{
+#ifdef _MSC_VER
+	int info[4];
+
+	__cpuid(info, 0);
+
+	if (info[0] < 7)
+	{
+		return 0;
+	}
+
+	__cpuid(info, 1);
+
+	/* OSXSAVE and AVX, then confirm the OS preserves YMM state */
+	if ((info[2] & 0x18000000) != 0x18000000)
+	{
+		return 0;
+	}
+
+	if ((_xgetbv(0) & 6) != 6)
+	{
+		return 0;
+	}
+
+	__cpuidex(info, 7, 0);
+
+	return (info[1] >> 5) & 1;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+static struct conlog_utf8_variant utf8_variants[3];
+static int utf8_count;
+
+static void utf8_init(void)
+{
+	int count = 0;
+
+#ifdef CONLOG_UTF8_X86
+	if (utf8_has_avx2())
+	{
+		utf8_variants[count].name = "avx2";
+		utf8_variants[count++].valid = utf8_avx2;
+	}
+#endif
+
+#ifdef CONLOG_UTF8_SSE2
+	utf8_variants[count].name = "sse2";
+	utf8_variants[count++].valid = utf8_sse2;
+#endif
+
+	utf8_variants[count].name = "scalar";
+	utf8_variants[count++].valid = utf8_scalar;
+
+	utf8_count = count;
+}
+
+static size_t utf8_resolve(const unsigned char* data, size_t len);
+
+static conlog_utf8_fn utf8_impl = utf8_resolve;
+
+static size_t utf8_resolve(const unsigned char* data, size_t len)
+{
+	utf8_init();
+
+	utf8_impl = utf8_variants[0].valid;
+
+	return utf8_impl(data, len);
+}
+
+size_t conlog_utf8_valid(const unsigned char* data, size_t len)
+{
+	return utf8_impl(data, len);
+}
+
+const char* conlog_utf8_name(void)
+{
+	if (!utf8_count)
+	{
+		utf8_init();
+	}
+
+	return utf8_variants[0].name;
+}
+
+const struct conlog_utf8_variant* conlog_utf8_variant(int index)
+{
+	if (!utf8_count)
+	{
+		utf8_init();
+	}
+
+	return ((index >= 0) && (index < utf8_count)) ? utf8_variants + index : NULL;
+}
@@ -0,0 +1,41 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_UTF8_H
+#define CONLOG_UTF8_H
+
+#include <stddef.h>
+
+/* from conlog_utf8_decode, a sequence that is not well formed */
+#define CONLOG_UTF8_BAD		0x110000
+
+typedef size_t (*conlog_utf8_fn)(const unsigned char* data, size_t len);
+
+struct conlog_utf8_variant
+{
+	const char* name;
+	conlog_utf8_fn valid;
+};
+
+/* the length of the valid UTF-8 at the start of data, a sequence cut off at the end is not counted */
+size_t conlog_utf8_valid(const unsigned char* data, size_t len);
+
+/* the length of the ASCII at the start of data */
+size_t conlog_utf8_ascii(const unsigned char* data, size_t len);
+
+/*
+ * Decodes the sequence at the start of data. Returns its length, or zero
+ * when it is cut off by the end of data. A sequence that is not well formed
+ * gives CONLOG_UTF8_BAD and the length of its maximal subpart.
+ */
+size_t conlog_utf8_decode(const unsigned char* data, size_t len, unsigned* c);
+
+/* name of the variant chosen for this processor */
+const char* conlog_utf8_name(void);
+
+/* enumerates the variants usable on this processor, NULL past the end */
+const struct conlog_utf8_variant* conlog_utf8_variant(int index);
+
+#endif
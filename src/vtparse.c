@@ -0,0 +1,509 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ *
+ * Escape sequence recogniser following the DEC VT500 state diagram,
+ * with bytes 0x80-0xFF treated as data so UTF-8 passes untouched.
+ */
+
+#include <string.h>
+#include "vtparse.h"
+#include "escscan.h"
+
+enum
+{
+	S_GROUND,
+	S_ESCAPE,
+	S_ESCAPE_INTERMEDIATE,
+	S_CSI_ENTRY,
+	S_CSI_PARAM,
+	S_CSI_INTERMEDIATE,
+	S_CSI_IGNORE,
+	S_DCS_ENTRY,
+	S_DCS_PARAM,
+	S_DCS_INTERMEDIATE,
+	S_DCS_PASSTHROUGH,
+	S_DCS_IGNORE,
+	S_OSC_STRING,
+	S_SOS_PM_APC_STRING,
+	S_STAY = 15
+};
+
+enum
+{
+	A_NONE,
+	A_IGNORE,
+	A_PRINT,
+	A_EXECUTE,
+	A_CLEAR,
+	A_COLLECT,
+	A_PARAM,
+	A_ESC_DISPATCH,
+	A_CSI_DISPATCH,
+	A_HOOK,
+	A_PUT,
+	A_UNHOOK,
+	A_OSC_START,
+	A_OSC_PUT,
+	A_OSC_END
+};
+
+enum
+{
+	C_CTL,
+	C_BEL,
+	C_CAN,
+	C_ESC,
+	C_INT,
+	C_DIG,
+	C_COL,
+	C_SEM,
+	C_PRV,
+	C_FIN,
+	C_DCS,
+	C_SPA,
+	C_CSI,
+	C_OSC,
+	C_DEL,
+	C_HI
+};
+
+#define HI16 C_HI, C_HI, C_HI, C_HI, C_HI, C_HI, C_HI, C_HI, C_HI, C_HI, C_HI, C_HI, C_HI, C_HI, C_HI, C_HI
+
+static const unsigned char vt_class[256] =
+{
+	C_CTL, C_CTL, C_CTL, C_CTL, C_CTL, C_CTL, C_CTL, C_BEL, C_CTL, C_CTL, C_CTL, C_CTL, C_CTL, C_CTL, C_CTL, C_CTL,
+	C_CTL, C_CTL, C_CTL, C_CTL, C_CTL, C_CTL, C_CTL, C_CTL, C_CAN, C_CTL, C_CAN, C_ESC, C_CTL, C_CTL, C_CTL, C_CTL,
+	C_INT, C_INT, C_INT, C_INT, C_INT, C_INT, C_INT, C_INT, C_INT, C_INT, C_INT, C_INT, C_INT, C_INT, C_INT, C_INT,
+	C_DIG, C_DIG, C_DIG, C_DIG, C_DIG, C_DIG, C_DIG, C_DIG, C_DIG, C_DIG, C_COL, C_SEM, C_PRV, C_PRV, C_PRV, C_PRV,
+	C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN,
+	C_DCS, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_SPA, C_FIN, C_FIN, C_CSI, C_FIN, C_OSC, C_SPA, C_SPA,
+	C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN,
+	C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_FIN, C_DEL,
+	HI16, HI16, HI16, HI16, HI16, HI16, HI16, HI16
+};
+
+#define T(a, s) ((A_##a << 4) | S_##s)
+
+/* columns follow the C_ classes, high nibble is the action, low nibble the next state */
+static const unsigned char vt_table[14][16] =
+{
+	/* GROUND */
+	{ T(EXECUTE, STAY), T(EXECUTE, STAY), T(EXECUTE, STAY), T(NONE, ESCAPE), T(PRINT, STAY), T(PRINT, STAY), T(PRINT, STAY), T(PRINT, STAY),
+	  T(PRINT, STAY), T(PRINT, STAY), T(PRINT, STAY), T(PRINT, STAY), T(PRINT, STAY), T(PRINT, STAY), T(IGNORE, STAY), T(PRINT, STAY) },
+	/* ESCAPE */
+	{ T(EXECUTE, STAY), T(EXECUTE, STAY), T(EXECUTE, GROUND), T(NONE, ESCAPE), T(COLLECT, ESCAPE_INTERMEDIATE), T(ESC_DISPATCH, GROUND), T(ESC_DISPATCH, GROUND), T(ESC_DISPATCH, GROUND),
+	  T(ESC_DISPATCH, GROUND), T(ESC_DISPATCH, GROUND), T(NONE, DCS_ENTRY), T(NONE, SOS_PM_APC_STRING), T(NONE, CSI_ENTRY), T(NONE, OSC_STRING), T(IGNORE, STAY), T(PRINT, GROUND) },
+	/* ESCAPE_INTERMEDIATE */
+	{ T(EXECUTE, STAY), T(EXECUTE, STAY), T(EXECUTE, GROUND), T(NONE, ESCAPE), T(COLLECT, STAY), T(ESC_DISPATCH, GROUND), T(ESC_DISPATCH, GROUND), T(ESC_DISPATCH, GROUND),
+	  T(ESC_DISPATCH, GROUND), T(ESC_DISPATCH, GROUND), T(ESC_DISPATCH, GROUND), T(ESC_DISPATCH, GROUND), T(ESC_DISPATCH, GROUND), T(ESC_DISPATCH, GROUND), T(IGNORE, STAY), T(PRINT, GROUND) },
+	/* CSI_ENTRY */
+	{ T(EXECUTE, STAY), T(EXECUTE, STAY), T(EXECUTE, GROUND), T(NONE, ESCAPE), T(COLLECT, CSI_INTERMEDIATE), T(PARAM, CSI_PARAM), T(PARAM, CSI_PARAM), T(PARAM, CSI_PARAM),
+	  T(COLLECT, CSI_PARAM), T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND), T(IGNORE, STAY), T(IGNORE, CSI_IGNORE) },
+	/* CSI_PARAM */
+	{ T(EXECUTE, STAY), T(EXECUTE, STAY), T(EXECUTE, GROUND), T(NONE, ESCAPE), T(COLLECT, CSI_INTERMEDIATE), T(PARAM, STAY), T(PARAM, STAY), T(PARAM, STAY),
+	  T(IGNORE, CSI_IGNORE), T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND), T(IGNORE, STAY), T(IGNORE, CSI_IGNORE) },
+	/* CSI_INTERMEDIATE */
+	{ T(EXECUTE, STAY), T(EXECUTE, STAY), T(EXECUTE, GROUND), T(NONE, ESCAPE), T(COLLECT, STAY), T(IGNORE, CSI_IGNORE), T(IGNORE, CSI_IGNORE), T(IGNORE, CSI_IGNORE),
+	  T(IGNORE, CSI_IGNORE), T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND), T(IGNORE, STAY), T(IGNORE, CSI_IGNORE) },
+	/* CSI_IGNORE */
+	{ T(EXECUTE, STAY), T(EXECUTE, STAY), T(EXECUTE, GROUND), T(NONE, ESCAPE), T(IGNORE, STAY), T(IGNORE, STAY), T(IGNORE, STAY), T(IGNORE, STAY),
+	  T(IGNORE, STAY), T(NONE, GROUND), T(NONE, GROUND), T(NONE, GROUND), T(NONE, GROUND), T(NONE, GROUND), T(IGNORE, STAY), T(IGNORE, STAY) },
+	/* DCS_ENTRY */
+	{ T(IGNORE, STAY), T(IGNORE, STAY), T(EXECUTE, GROUND), T(NONE, ESCAPE), T(COLLECT, DCS_INTERMEDIATE), T(PARAM, DCS_PARAM), T(PARAM, DCS_PARAM), T(PARAM, DCS_PARAM),
+	  T(COLLECT, DCS_PARAM), T(NONE, DCS_PASSTHROUGH), T(NONE, DCS_PASSTHROUGH), T(NONE, DCS_PASSTHROUGH), T(NONE, DCS_PASSTHROUGH), T(NONE, DCS_PASSTHROUGH), T(IGNORE, STAY), T(IGNORE, DCS_IGNORE) },
+	/* DCS_PARAM */
+	{ T(IGNORE, STAY), T(IGNORE, STAY), T(EXECUTE, GROUND), T(NONE, ESCAPE), T(COLLECT, DCS_INTERMEDIATE), T(PARAM, STAY), T(PARAM, STAY), T(PARAM, STAY),
+	  T(IGNORE, DCS_IGNORE), T(NONE, DCS_PASSTHROUGH), T(NONE, DCS_PASSTHROUGH), T(NONE, DCS_PASSTHROUGH), T(NONE, DCS_PASSTHROUGH), T(NONE, DCS_PASSTHROUGH), T(IGNORE, STAY), T(IGNORE, DCS_IGNORE) },
+	/* DCS_INTERMEDIATE */
+	{ T(IGNORE, STAY), T(IGNORE, STAY), T(EXECUTE, GROUND), T(NONE, ESCAPE), T(COLLECT, STAY), T(IGNORE, DCS_IGNORE), T(IGNORE, DCS_IGNORE), T(IGNORE, DCS_IGNORE),
+	  T(IGNORE, DCS_IGNORE), T(NONE, DCS_PASSTHROUGH), T(NONE, DCS_PASSTHROUGH), T(NONE, DCS_PASSTHROUGH), T(NONE, DCS_PASSTHROUGH), T(NONE, DCS_PASSTHROUGH), T(IGNORE, STAY), T(IGNORE, DCS_IGNORE) },
+	/* DCS_PASSTHROUGH */
+	{ T(PUT, STAY), T(PUT, STAY), T(EXECUTE, GROUND), T(NONE, ESCAPE), T(PUT, STAY), T(PUT, STAY), T(PUT, STAY), T(PUT, STAY),
+	  T(PUT, STAY), T(PUT, STAY), T(PUT, STAY), T(PUT, STAY), T(PUT, STAY), T(PUT, STAY), T(IGNORE, STAY), T(PUT, STAY) },
+	/* DCS_IGNORE */
+	{ T(IGNORE, STAY), T(IGNORE, STAY), T(EXECUTE, GROUND), T(NONE, ESCAPE), T(IGNORE, STAY), T(IGNORE, STAY), T(IGNORE, STAY), T(IGNORE, STAY),
+	  T(IGNORE, STAY), T(IGNORE, STAY), T(IGNORE, STAY), T(IGNORE, STAY), T(IGNORE, STAY), T(IGNORE, STAY), T(IGNORE, STAY), T(IGNORE, STAY) },
+	/* OSC_STRING, BEL terminates as well as ST */
+	{ T(IGNORE, STAY), T(NONE, GROUND), T(EXECUTE, GROUND), T(NONE, ESCAPE), T(OSC_PUT, STAY), T(OSC_PUT, STAY), T(OSC_PUT, STAY), T(OSC_PUT, STAY),
+	  T(OSC_PUT, STAY), T(OSC_PUT, STAY), T(OSC_PUT, STAY), T(OSC_PUT, STAY), T(OSC_PUT, STAY), T(OSC_PUT, STAY), T(IGNORE, STAY), T(OSC_PUT, STAY) },
+	/* SOS_PM_APC_STRING */
+	{ T(IGNORE, STAY), T(IGNORE, STAY), T(EXECUTE, GROUND), T(NONE, ESCAPE), T(IGNORE, STAY), T(IGNORE, STAY), T(IGNORE, STAY), T(IGNORE, STAY),
+	  T(IGNORE, STAY), T(IGNORE, STAY), T(IGNORE, STAY), T(IGNORE, STAY), T(IGNORE, STAY), T(IGNORE, STAY), T(IGNORE, STAY), T(IGNORE, STAY) }
+};
+
+#undef T
+
+/* states where the sequence so far could still be one that is reported */
+#define VT_CANDIDATE ((1u << S_ESCAPE) | (1u << S_CSI_ENTRY) | (1u << S_CSI_PARAM))
+
+void conlog_vt_init(struct conlog_vt* vt)
+{
+	memset(vt, 0, sizeof(*vt));
+}
+
+static void vt_clear(struct conlog_vt* vt)
+{
+	vt->marker = 0;
+	vt->intermediate = 0;
+	vt->paramCount = 0;
+	vt->params[0] = 0;
+}
+
+static void vt_collect(struct conlog_vt* vt, unsigned char c)
+{
+	if (c >= 0x3C && c <= 0x3F && !vt->paramCount && !vt->marker)
+	{
+		vt->marker = c;
+	}
+	else
+	{
+		vt->intermediate = c;
+	}
+}
+
+static void vt_param(struct conlog_vt* vt, unsigned char c)
+{
+	if (!vt->paramCount)
+	{
+		vt->paramCount = 1;
+	}
+
+	if (c >= '0' && c <= '9')
+	{
+		unsigned* v = vt->params + vt->paramCount - 1;
+
+		if (*v < 10000)
+		{
+			*v = (*v * 10) + (c - '0');
+		}
+	}
+	else if (vt->paramCount < CONLOG_VT_PARAMS)
+	{
+		vt->params[vt->paramCount++] = 0;
+	}
+}
+
+static int vt_csi_event(const struct conlog_vt* vt, unsigned char final)
+{
+	int i;
+
+	if (vt->intermediate)
+	{
+		return 0;
+	}
+
+	switch (final)
+	{
+	case 'n':
+		if (!vt->marker && vt->paramCount && vt->params[0] == 6)
+		{
+			return CONLOG_VT_DSR_CPR;
+		}
+		break;
+
+	case 'h':
+	case 'l':
+		if (vt->marker == '?')
+		{
+			for (i = 0; i < vt->paramCount; i++)
+			{
+				if (vt->params[i] == 1004)
+				{
+					return final == 'h' ? CONLOG_VT_FOCUS_ON : CONLOG_VT_FOCUS_OFF;
+				}
+
+				if (vt->params[i] == 2004)
+				{
+					return final == 'h' ? CONLOG_VT_PASTE_ON : CONLOG_VT_PASTE_OFF;
+				}
+			}
+		}
+		break;
+	}
+
+	return 0;
+}
+
+static void vt_release(struct conlog_vt* vt, const struct conlog_vt_handler* handler, void* context)
+{
+	if (vt->holdLen)
+	{
+		handler->pass(context, vt->hold[vt->holdIndex], vt->holdLen);
+		vt->holdLen = 0;
+	}
+}
+
+void conlog_vt_parse(struct conlog_vt* vt, const unsigned char* data, size_t len, const struct conlog_vt_handler* handler, void* context)
+{
+	const unsigned char* p = data;
+	const unsigned char* end = data + len;
+	/* start of the bytes not yet passed on */
+	const unsigned char* run = data;
+	/* start of a candidate sequence within this buffer */
+	const unsigned char* seq = NULL;
+	/* candidate sequence began in a previous buffer and is in the hold */
+	int held = vt->holdLen != 0;
+	unsigned state = vt->state;
+
+	while (p < end)
+	{
+		unsigned entry, next;
+		unsigned char c;
+
+		if (state == S_GROUND)
+		{
+			const unsigned char* ground = p;
+
+			p += conlog_escscan(p, end - p);
+
+			/* the scan that finds the next sequence also bounds the text */
+			if (handler->text && (p > ground))
+			{
+				handler->text(context, ground, p - ground);
+			}
+
+			if (p == end)
+			{
+				break;
+			}
+		}
+
+		c = *p;
+		entry = vt_table[state][vt_class[c]];
+		next = entry & 0xF;
+
+		switch (entry >> 4)
+		{
+		case A_PRINT:
+			if (handler->text)
+			{
+				handler->text(context, p, 1);
+			}
+			break;
+
+		case A_EXECUTE:
+			/* controls inside a sequence still act, except the two that cancel it */
+			if (handler->text && (c != 0x18) && (c != 0x1A))
+			{
+				handler->text(context, p, 1);
+			}
+			break;
+
+		case A_COLLECT:
+			vt_collect(vt, c);
+			break;
+
+		case A_PARAM:
+			vt_param(vt, c);
+			break;
+
+		case A_CSI_DISPATCH:
+			{
+				int event = vt_csi_event(vt, c);
+
+				if (event)
+				{
+					if (seq || held)
+					{
+						const unsigned char* start = seq ? seq : data;
+
+						if (start > run)
+						{
+							handler->pass(context, run, start - run);
+						}
+
+						run = start;
+
+						if (handler->report(context, event))
+						{
+							vt->holdLen = 0;
+							run = p + 1;
+						}
+						else
+						{
+							vt_release(vt, handler, context);
+						}
+
+						seq = NULL;
+						held = 0;
+					}
+					else
+					{
+						handler->report(context, event);
+					}
+				}
+			}
+			break;
+
+		default:
+			break;
+		}
+
+		if (next != S_STAY)
+		{
+			if ((seq || held) && ((next == S_ESCAPE) || !(VT_CANDIDATE & (1u << next))))
+			{
+				if (held)
+				{
+					vt_release(vt, handler, context);
+					held = 0;
+				}
+
+				seq = NULL;
+			}
+
+			switch (next)
+			{
+			case S_ESCAPE:
+				seq = p;
+				vt_clear(vt);
+				break;
+
+			case S_CSI_ENTRY:
+			case S_DCS_ENTRY:
+				vt_clear(vt);
+				break;
+
+			default:
+				break;
+			}
+
+			state = next;
+		}
+
+		p++;
+	}
+
+	if (seq)
+	{
+		size_t n = end - seq;
+
+		if (seq > run)
+		{
+			handler->pass(context, run, seq - run);
+		}
+
+		if (n <= CONLOG_VT_HOLD)
+		{
+			vt->holdIndex ^= 1;
+			memcpy(vt->hold[vt->holdIndex], seq, n);
+			vt->holdLen = n;
+			vt->copied += n;
+		}
+		else
+		{
+			handler->pass(context, seq, n);
+		}
+	}
+	else if (held)
+	{
+		size_t n = end - data;
+
+		if (vt->holdLen + n <= CONLOG_VT_HOLD)
+		{
+			memcpy(vt->hold[vt->holdIndex] + vt->holdLen, data, n);
+			vt->holdLen += n;
+			vt->copied += n;
+		}
+		else
+		{
+			vt_release(vt, handler, context);
+			handler->pass(context, data, n);
+		}
+	}
+	else if (end > run)
+	{
+		handler->pass(context, run, end - run);
+	}
+
+	vt->state = (unsigned char)state;
+}
+
+void conlog_vt_feed(struct conlog_vt* vt, const unsigned char* data, size_t len, const struct conlog_vt_sink* sink, void* context)
+{
+	const unsigned char* p = data;
+	const unsigned char* end = data + len;
+	unsigned state = vt->state;
+
+	while (p < end)
+	{
+		unsigned entry, next;
+		unsigned char c;
+
+		if (state == S_GROUND)
+		{
+			const unsigned char* run = p;
+
+			while ((p < end) && (*p >= 0x20) && (*p != 0x7F))
+			{
+				p++;
+			}
+
+			if (p > run)
+			{
+				sink->print(context, run, p - run);
+			}
+
+			if (p == end)
+			{
+				break;
+			}
+		}
+
+		c = *p;
+		entry = vt_table[state][vt_class[c]];
+		next = entry & 0xF;
+
+		switch (entry >> 4)
+		{
+		case A_PRINT:
+			sink->print(context, p, 1);
+			break;
+
+		case A_EXECUTE:
+			sink->execute(context, c);
+			break;
+
+		case A_COLLECT:
+			vt_collect(vt, c);
+			break;
+
+		case A_PARAM:
+			vt_param(vt, c);
+			break;
+
+		case A_ESC_DISPATCH:
+			sink->esc(context, vt, c);
+			break;
+
+		case A_CSI_DISPATCH:
+			sink->csi(context, vt, c);
+			break;
+
+		default:
+			break;
+		}
+
+		if (next != S_STAY)
+		{
+			switch (next)
+			{
+			case S_ESCAPE:
+			case S_CSI_ENTRY:
+			case S_DCS_ENTRY:
+				vt_clear(vt);
+				break;
+
+			default:
+				break;
+			}
+
+			state = next;
+		}
+
+		p++;
+	}
+
+	vt->state = (unsigned char)state;
+}
@@ -0,0 +1,58 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#ifndef CONLOG_VTPARSE_H
+#define CONLOG_VTPARSE_H
+
+#include <stddef.h>
+
+#define CONLOG_VT_HOLD		32
+#define CONLOG_VT_PARAMS	16
+
+/* sequences reported to the handler */
+#define CONLOG_VT_DSR_CPR	1	/* CSI 6 n */
+#define CONLOG_VT_FOCUS_ON	2	/* CSI ? 1004 h */
+#define CONLOG_VT_FOCUS_OFF	3	/* CSI ? 1004 l */
+#define CONLOG_VT_PASTE_ON	4	/* CSI ? 2004 h */
+#define CONLOG_VT_PASTE_OFF	5	/* CSI ? 2004 l */
+
+struct conlog_vt_handler
+{
+	/* bytes to pass through, valid until the next call to conlog_vt_parse */
+	void (*pass)(void* context, const unsigned char* data, size_t len);
+	/* return non-zero to remove the sequence from the stream */
+	int (*report)(void* context, int event);
+	/* optional, the bytes outside escape sequences, valid until the next call to conlog_vt_parse */
+	void (*text)(void* context, const unsigned char* data, size_t len);
+};
+
+struct conlog_vt
+{
+	unsigned char state;
+	unsigned char marker;
+	unsigned char intermediate;
+	unsigned char holdIndex;
+	int paramCount;
+	unsigned params[CONLOG_VT_PARAMS];
+	size_t holdLen;
+	unsigned char hold[2][CONLOG_VT_HOLD];
+	unsigned long long copied;
+};
+
+/* every sequence, for a consumer that interprets the whole stream */
+struct conlog_vt_sink
+{
+	/* a run of printable bytes, UTF-8 sequences may be split between calls */
+	void (*print)(void* context, const unsigned char* data, size_t len);
+	void (*execute)(void* context, unsigned char c);
+	void (*esc)(void* context, const struct conlog_vt* vt, unsigned char final);
+	void (*csi)(void* context, const struct conlog_vt* vt, unsigned char final);
+};
+
+void conlog_vt_init(struct conlog_vt* vt);
+void conlog_vt_parse(struct conlog_vt* vt, const unsigned char* data, size_t len, const struct conlog_vt_handler* handler, void* context);
+void conlog_vt_feed(struct conlog_vt* vt, const unsigned char* data, size_t len, const struct conlog_vt_sink* sink, void* context);
+
+#endif
@@ -7,6 +7,31 @@
 #include <winerror.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include "escscan.h"
+#include "pump.h"
+#include "logwriter.h"
+#include "blocklog.h"
+#include "logfile.h"
+#include "lines.h"
+#include "encode.h"
+#include "flush.h"
+#include "flight.h"
+#include "keys.h"
+#include "options.h"
+#include "record.h"
+#include "share.h"
+#include "stats.h"
+#include "timer.h"
+#include "trace.h"
+
+/* console input records taken per read, one at a time as before until batched reads have been run on Windows */
+#define CONLOG_INPUT_BATCH	1
+
+static struct conlog_flight* conlog_flight_target;
+static struct conlog_stats* conlog_stats_target;
+static const char* conlog_stats_path;
+static const struct conlog_output_stats* conlog_stats_output;
 
 struct conlog_input
 {
@@ -14,556 +39,356 @@ struct conlog_input
 	BOOL running, reportFocus, hasFocus, appFocus;
 	HANDLE hRead, hWrite, hEvent, hControl, hScreen;
 	HPCON hPC;
+	struct conlog_stats* stats;
+	struct conlog_screen* screen;
+	struct conlog_record* record;
+	struct conlog_share* share;
+	struct conlog_keys keys;
+	/* headless input comes from a file or pipe, whether it last ended a line and whether it read a carriage return */
+	BOOL bHeadless, bLineStart, bReturn;
+	HANDLE hInput;
 };
 
-struct conlog_output_channel
+struct conlog_channel
 {
 	DWORD mode;
-	int cp;
 	BOOL bConsole;
 	HANDLE hWrite;
+	/* when set, the nanoseconds each write took */
+	struct conlog_histogram* time;
 };
 
-struct conlog_output
+struct conlog_reader
 {
 	HANDLE hRead, hControl;
 	int nChannels;
-	struct conlog_output_channel channels[2];
+	struct conlog_channel channels[2];
 	struct conlog_input* input;
-	BYTE buffer[4096];
-	DWORD bufferLength;
+	struct conlog_pump pump;
+	/* the timer for the next console frame in the event loop */
+	int frame;
 };
 
-static void conlog_output_flush(struct conlog_output* state)
+static void conlog_channel_write(void* context, const struct conlog_iovec* iov, int count)
 {
-	if (state->bufferLength)
+	struct conlog_channel* channel = context;
+	unsigned long long t = channel->time ? conlog_clock() : 0;
+
+	while (count--)
 	{
-		int nChannels = state->nChannels;
-		struct conlog_output_channel* channel = state->channels;
+		const BYTE* p = iov->data;
+		DWORD len = (DWORD)iov->len;
 
-		while (nChannels--)
+		while (len)
 		{
-			const BYTE* p = state->buffer;
-			DWORD len = state->bufferLength;
+			DWORD dw;
+			BOOL bWrite;
 
-			while (len)
+			if (channel->bConsole)
 			{
-				DWORD dw;
-				BOOL bWrite;
-
-				if (channel->bConsole)
-				{
-					bWrite = WriteConsoleA(channel->hWrite, p, len, &dw, NULL);
-				}
-				else
-				{
-					bWrite = WriteFile(channel->hWrite, p, len, &dw, NULL);
-				}
-
-				if (!bWrite) break;
-				if (!dw) break;
-
-				p += dw;
-				len -= dw;
+				bWrite = WriteConsoleA(channel->hWrite, p, len, &dw, NULL);
+			}
+			else
+			{
+				bWrite = WriteFile(channel->hWrite, p, len, &dw, NULL);
 			}
 
-			channel++;
+			if (!bWrite) break;
+			if (!dw) break;
+
+			p += dw;
+			len -= dw;
 		}
 
-		state->bufferLength = 0;
+		iov++;
 	}
+
+	if (channel->time)
+	{
+		conlog_histogram_add(channel->time, conlog_clock() - t);
+	}
+}
+
+/* a pipe cannot be flushed to disk, which is harmless */
+static void conlog_channel_sync(void* context)
+{
+	struct conlog_channel* channel = context;
+
+	FlushFileBuffers(channel->hWrite);
 }
 
-static void conlog_output_write(struct conlog_output* state, const BYTE* data, DWORD len)
+static int conlog_reader_cursor(void* context)
 {
-	while (len)
+	struct conlog_reader* state = context;
+	DWORD dw;
+
+	conlog_stats_dsr_request(state->input->stats);
+
+	if (WriteFile(state->hControl, "\002", 1, &dw, NULL) && dw)
 	{
-		DWORD n = sizeof(state->buffer) - state->bufferLength;
+		SetEvent(state->input->hEvent);
 
-		if (n)
-		{
-			if (n > len)
-			{
-				n = len;
-			}
+		return TRUE;
+	}
 
-			memcpy(state->buffer + state->bufferLength, data, n);
+	return FALSE;
+}
 
-			data += n;
-			len -= n;
-			state->bufferLength += n;
-		}
-		else
+static void conlog_reader_focus(void* context, int enable)
+{
+	struct conlog_reader* state = context;
+	DWORD dw;
+
+	if (!enable)
+	{
+		state->input->reportFocus = FALSE;
+	}
+	else if (!state->input->reportFocus)
+	{
+		state->input->appFocus = !state->input->hasFocus;
+		state->input->reportFocus = TRUE;
+
+		if (WriteFile(state->hControl, "\001", 1, &dw, NULL) && dw)
 		{
-			conlog_output_flush(state);
+			SetEvent(state->input->hEvent);
 		}
 	}
+}
+
+/* read by the input thread when it next encodes keys, as the focus flag is */
+static int conlog_reader_paste(void* context, int enable)
+{
+	struct conlog_reader* state = context;
+
+	state->input->keys.bBracketed = enable;
+
+	return TRUE;
+}
+
+static int conlog_reader_reply(void* context, const char* data, size_t len)
+{
+	struct conlog_reader* state = context;
+	DWORD dw;
+	BOOL b;
+
+	conlog_stats_dsr_request(state->input->stats);
+
+	b = WriteFile(state->input->hWrite, data, (DWORD)len, &dw, NULL) && (dw == len);
+
+	if (b)
+	{
+		conlog_stats_dsr_reply(state->input->stats);
+	}
+
+	return b;
+}
+
+/* a headless child's requests are answered from the model, one that is not goes unanswered */
+static int conlog_headless_cursor(void* context)
+{
+	return FALSE;
+}
 
-	if (state->bufferLength == sizeof(state->buffer))
+/* a headless console always has the focus */
+static void conlog_headless_focus(void* context, int enable)
+{
+	struct conlog_reader* state = context;
+	DWORD dw;
+
+	if (enable)
 	{
-		conlog_output_flush(state);
+		WriteFile(state->input->hWrite, "\033[I", 3, &dw, NULL);
 	}
 }
 
 static DWORD CALLBACK output_thread(LPVOID pv)
 {
-	struct conlog_output* state = pv;
-	char buf[4096];
+	struct conlog_reader* state = pv;
+	BYTE buf[4096];
 	DWORD dwRead;
-	int colonCount = 0;
-	int digitCount = 0;
-	int escapeCommittee = 0;
-	int args[5];
-	char escapeRoom[128];
-	int escapeLen = 0;
 
-	while (ReadFile(state->hRead, buf, sizeof(buf), &dwRead, NULL))
+	CONLOG_TRACE_THREAD("output");
+
+	for (;;)
 	{
-		const char* input = buf;
-		DWORD offset = 0;
+		unsigned long long t = CONLOG_TRACE_CLOCK();
+		BOOL bRead;
 
-		if (dwRead == 0) break;
+		bRead = ReadFile(state->hRead, buf, sizeof(buf), &dwRead, NULL);
+		CONLOG_TRACE_SPAN("read", t, bRead ? dwRead : 0);
 
-		while (offset < dwRead)
-		{
-			char c = input[offset];
+		if (!bRead || (dwRead == 0)) break;
 
-			if (escapeLen)
-			{
-				if (escapeLen < sizeof(escapeRoom))
-				{
-					escapeRoom[escapeLen++] = c;
-					offset++;
+		conlog_pump_data(&state->pump, buf, dwRead);
+		conlog_stats_echo(state->input->stats);
+	}
 
-					switch (escapeCommittee)
-					{
-					case 1:
-						if (c == '[')
-						{
-							colonCount = 0;
-							digitCount = 0;
-							escapeCommittee = 2;
-							args[0] = 0;
-						}
-						else
-						{
-							conlog_output_write(state, escapeRoom, escapeLen);
-							escapeCommittee = 0;
-							escapeLen = 0;
-							input += offset;
-							dwRead -= offset;
-							offset = 0;
-						}
-						break;
+	return 0;
+}
 
-					case 2:
-					case 3:
-						switch (c)
-						{
-						case ';':
-							if (colonCount < (sizeof(args) / sizeof(args[0])))
-							{
-								args[colonCount++] = 0;
-								digitCount = 0;
-							}
-							break;
+/* sends a focus change the application has not yet seen */
+static BOOL conlog_input_focus(struct conlog_input* state)
+{
+	DWORD dw;
 
-						case '?':
-							if (escapeCommittee == 2 && colonCount == 0 && digitCount == 0)
-							{
-								escapeCommittee = 3;
-							}
-							else
-							{
-								conlog_output_write(state, escapeRoom, escapeLen);
-								escapeCommittee = 0;
-								escapeLen = 0;
-								input += offset;
-								dwRead -= offset;
-								offset = 0;
-							}
-							break;
+	if (state->reportFocus && (state->hasFocus != state->appFocus))
+	{
+		state->appFocus = state->hasFocus;
 
-						default:
-							if (isdigit(c))
-							{
-								if (colonCount < (sizeof(args) / sizeof(args[0])))
-								{
-									args[colonCount] = (args[colonCount] * 10) + (c - '0');
-									digitCount++;
-								}
-							}
-							else
-							{
-								switch (escapeCommittee)
-								{
-								case 3:
-									switch (c)
-									{
-									case 'h':
-										if (digitCount && (args[0] == 1004))
-										{
-											if (!state->input->reportFocus)
-											{
-												DWORD dw;
-												state->input->appFocus = !state->input->hasFocus;
-												state->input->reportFocus = TRUE;
-												if (WriteFile(state->hControl, "\001", 1, &dw, NULL) && dw)
-												{
-													SetEvent(state->input->hEvent);
-												}
-											}
-										}
-										break;
+		return WriteFile(state->hWrite, state->hasFocus ? "\033[I" : "\033[O", 3, &dw, NULL);
+	}
 
-									case 'l':
-										if (digitCount && (args[0] == 1004))
-										{
-											state->input->reportFocus = FALSE;
-										}
-										break;
-									}
-									break;
+	return TRUE;
+}
 
-								case 2:
-									switch (c)
-									{
-									case 'n':
-										if (digitCount && (args[0] == 6))
-										{
-											DWORD dw;
+/* turns the records read in one wake into one write to the child, bMore when more are waiting */
+static BOOL conlog_input_records(struct conlog_input* state, const INPUT_RECORD* records, DWORD count, BOOL bMore)
+{
+	struct conlog_key keys[CONLOG_KEYS_BATCH];
+	const WINDOW_BUFFER_SIZE_RECORD* size = NULL;
+	BOOL running = TRUE, bFocus = FALSE;
+	int n = 0;
+	DWORD i, dw;
 
-											conlog_output_flush(state);
+	for (i = 0; i < count; i++)
+	{
+		const INPUT_RECORD* record = records + i;
 
-											if (WriteFile(state->hControl, "\002", 1, &dw, NULL) && dw)
-											{
-												SetEvent(state->input->hEvent);
-												escapeLen = 0;
-											}
-										}
-										break;
-									}
-									break;
-								}
-								conlog_output_write(state, escapeRoom, escapeLen);
-								escapeCommittee = 0;
-								escapeLen = 0;
-								input += offset;
-								dwRead -= offset;
-								offset = 0;
-							}
-							break;
-						}
-						break;
+		switch (record->EventType)
+		{
+		case WINDOW_BUFFER_SIZE_EVENT:
+			/* only the last of a run of resizes is passed on */
+			size = &record->Event.WindowBufferSizeEvent;
+			break;
 
-					default:
-						break;
-					}
-				}
-				else
-				{
-					conlog_output_write(state, escapeRoom, escapeLen);
-					escapeCommittee = 0;
-					escapeLen = 0;
-					input += offset;
-					dwRead -= offset;
-					offset = 0;
-				}
-			}
-			else
+		case KEY_EVENT:
+			if (record->Event.KeyEvent.bKeyDown)
 			{
-				if (c == 27)
-				{
-					conlog_output_write(state, input, offset);
-
-					escapeRoom[escapeLen++] = c;
-					offset++;
-					dwRead -= offset;
-					input += offset;
-					offset = 0;
-					escapeCommittee = 1;
-				}
-				else
-				{
-					offset++;
-				}
+				DWORD control = record->Event.KeyEvent.dwControlKeyState;
+
+				keys[n].vk = record->Event.KeyEvent.wVirtualKeyCode;
+				keys[n].ch = record->Event.KeyEvent.uChar.UnicodeChar;
+				keys[n].modifiers = ((control & SHIFT_PRESSED) ? CONLOG_KEY_SHIFT : 0) |
+					((control & (LEFT_ALT_PRESSED | RIGHT_ALT_PRESSED)) ? CONLOG_KEY_ALT : 0) |
+					((control & (LEFT_CTRL_PRESSED | RIGHT_CTRL_PRESSED)) ? CONLOG_KEY_CTRL : 0);
+				n++;
 			}
-		}
-
-		conlog_output_write(state, input, offset);
-		conlog_output_flush(state);
-	}
+			break;
 
-	return 0;
-}
+		case FOCUS_EVENT:
+			state->hasFocus = record->Event.FocusEvent.bSetFocus;
+			bFocus = TRUE;
+			break;
 
-static DWORD CALLBACK input_thread(LPVOID pv)
-{
-	struct conlog_input* state = pv;
-	BOOL running = TRUE;
+		default:
+			break;
+		}
+	}
 
-	while (state->running && running)
+	if (n)
 	{
-		HANDLE hEvent[] = { state->hRead,state->hEvent };
-		INPUT_RECORD input;
-		DWORD dw = WaitForMultipleObjects(2, hEvent, FALSE, INFINITE);
+		unsigned long long t = CONLOG_TRACE_CLOCK();
 
-		switch (dw)
-		{
-		case WAIT_OBJECT_0:
-			running = ReadConsoleInput(state->hRead, &input, 1, &dw);
+		conlog_stats_key(state->stats);
+		conlog_keys_encode(&state->keys, keys, n, bMore);
+		CONLOG_TRACE_SPAN("translate", t, n);
 
-			if (running)
+		if (state->keys.len)
+		{
+			if (state->record)
 			{
-				switch (input.EventType)
-				{
-				case WINDOW_BUFFER_SIZE_EVENT:
-					ResizePseudoConsole(state->hPC, input.Event.WindowBufferSizeEvent.dwSize);
-					break;
+				conlog_record_input(state->record, state->keys.buf, state->keys.len);
+			}
 
-				case KEY_EVENT:
-					if (input.Event.KeyEvent.bKeyDown)
-					{
-						char read_buffer[256];
-						int read_len = 0;
+			state->stats->inputEvents += n;
 
-						if (input.Event.KeyEvent.uChar.UnicodeChar)
-						{
-							wchar_t wide = input.Event.KeyEvent.uChar.UnicodeChar;
+			t = CONLOG_TRACE_CLOCK();
+			running = WriteFile(state->hWrite, state->keys.buf, (DWORD)state->keys.len, &dw, NULL) && (dw == state->keys.len);
+			CONLOG_TRACE_SPAN("write", t, state->keys.len);
+		}
+	}
 
-							switch (wide)
-							{
-							case ' ':
-								if (input.Event.KeyEvent.dwControlKeyState & (LEFT_CTRL_PRESSED | RIGHT_CTRL_PRESSED))
-								{
-									read_buffer[read_len++] = 0;
-								}
-								else
-								{
-									read_buffer[read_len++] = ' ';
-								}
-								break;
-							default:
-								read_len = WideCharToMultiByte(CP_UTF8, 0, &wide, 1, read_buffer, sizeof(read_buffer), NULL, NULL);
-								break;
-							}
-						}
-						else
-						{
-							char code = 0, cis = '[';
-							int argc = 0;
-							int argv[10];
-							int shift = 0;
+	if (size)
+	{
+		ResizePseudoConsole(state->hPC, size->dwSize);
 
-							switch (input.Event.KeyEvent.dwControlKeyState & (SHIFT_PRESSED | LEFT_ALT_PRESSED | RIGHT_ALT_PRESSED | LEFT_CTRL_PRESSED | RIGHT_CTRL_PRESSED))
-							{
-							case SHIFT_PRESSED:
-								shift = 2;
-								break;
-							case SHIFT_PRESSED | LEFT_ALT_PRESSED:
-							case SHIFT_PRESSED | RIGHT_ALT_PRESSED:
-								shift = 4;
-								break;
-							case LEFT_CTRL_PRESSED:
-							case RIGHT_CTRL_PRESSED:
-								shift = 5;
-								break;
-							case SHIFT_PRESSED | LEFT_CTRL_PRESSED:
-							case SHIFT_PRESSED | RIGHT_CTRL_PRESSED:
-								shift = 6;
-								break;
-							case LEFT_ALT_PRESSED | LEFT_CTRL_PRESSED:
-							case LEFT_ALT_PRESSED | RIGHT_CTRL_PRESSED:
-							case RIGHT_ALT_PRESSED | LEFT_CTRL_PRESSED:
-							case RIGHT_ALT_PRESSED | RIGHT_CTRL_PRESSED:
-								shift = 7;
-								break;
-							case SHIFT_PRESSED | LEFT_ALT_PRESSED | LEFT_CTRL_PRESSED:
-							case SHIFT_PRESSED | LEFT_ALT_PRESSED | RIGHT_CTRL_PRESSED:
-							case SHIFT_PRESSED | RIGHT_ALT_PRESSED | LEFT_CTRL_PRESSED:
-							case SHIFT_PRESSED | RIGHT_ALT_PRESSED | RIGHT_CTRL_PRESSED:
-								shift = 8;
-								break;
-							}
+		if (state->screen)
+		{
+			conlog_screen_resize(state->screen, size->dwSize.Y, size->dwSize.X);
+		}
 
-							switch (input.Event.KeyEvent.wVirtualKeyCode)
-							{
-							case VK_ESCAPE:
-								code = 'P';
-								break;
-							case VK_UP:
-								if (shift)
-								{
-									argv[argc++] = 1;
-								}
-								code = 'A';
-								break;
-							case VK_DOWN:
-								if (shift)
-								{
-									argv[argc++] = 1;
-								}
-								code = 'B';
-								break;
-							case VK_RIGHT:
-								if (shift)
-								{
-									argv[argc++] = 1;
-								}
-								code = 'C';
-								break;
-							case VK_LEFT:
-								if (shift)
-								{
-									argv[argc++] = 1;
-								}
-								code = 'D';
-								break;
-							case VK_CLEAR:
-								if (shift)
-								{
-									argv[argc++] = 1;
-								}
-								code = 'E';
-								break;
-							case VK_F1:
-								if (shift)
-								{
-									argv[argc++] = 1;
-								}
-								else
-								{
-									cis = 'O';
-								}
-								code = 'P';
-								break;
-							case VK_F2:
-								if (shift)
-								{
-									argv[argc++] = 1;
-								}
-								else
-								{
-									cis = 'O';
-								}
-								code = 'Q';
-								break;
-							case VK_F3:
-								if (shift)
-								{
-									argv[argc++] = 1;
-								}
-								else
-								{
-									cis = 'O';
-								}
-								code = 'R';
-								break;
-							case VK_F4:
-								if (shift)
-								{
-									argv[argc++] = 1;
-								}
-								else
-								{
-									cis = 'O';
-								}
-								code = 'S';
-								break;
-							case VK_HOME:
-								code = '~'; argv[argc++] = 1;
-								break;
-							case VK_INSERT:
-								code = '~'; argv[argc++] = 2;
-								break;
-							case VK_DELETE:
-								code = '~'; argv[argc++] = 3;
-								break;
-							case VK_END:
-								code = '~'; argv[argc++] = 4;
-								break;
-							case VK_PRIOR:
-								code = '~'; argv[argc++] = 5;
-								break;
-							case VK_NEXT:
-								code = '~'; argv[argc++] = 6;
-								break;
-							case VK_F5:
-								code = '~'; argv[argc++] = 15;
-								break;
-							case VK_F6:
-								code = '~'; argv[argc++] = 17;
-								break;
-							case VK_F7:
-								code = '~'; argv[argc++] = 18;
-								break;
-							case VK_F8:
-								code = '~'; argv[argc++] = 19;
-								break;
-							case VK_F9:
-								code = '~'; argv[argc++] = 20;
-								break;
-							case VK_F10:
-								code = '~'; argv[argc++] = 21;
-								break;
-							case VK_F11:
-								code = '~'; argv[argc++] = 23;
-								break;
-							case VK_F12:
-								code = '~'; argv[argc++] = 24;
-								break;
-							}
+		if (state->record)
+		{
+			conlog_record_resize(state->record, size->dwSize.Y, size->dwSize.X);
+		}
 
-							if (code)
-							{
-								int i = 0;
-								read_buffer[read_len++] = 27;
-								read_buffer[read_len++] = cis;
+		if (state->share)
+		{
+			conlog_share_resize(state->share, size->dwSize.Y, size->dwSize.X);
+		}
+	}
 
-								if (shift && argc)
-								{
-									argv[argc++] = shift;
-								}
+	if (bFocus)
+	{
+		conlog_input_focus(state);
+	}
 
-								while (i < argc)
-								{
-									if (i)
-									{
-										read_buffer[read_len++] = ';';
-									}
+	return running;
+}
 
-									read_len += sprintf_s(read_buffer + read_len, sizeof(read_buffer) - read_len, "%d", argv[i++]);
-								}
+/* reads what is waiting, up to a batch */
+static BOOL conlog_input_read(struct conlog_input* state)
+{
+	INPUT_RECORD records[CONLOG_INPUT_BATCH];
+	DWORD dw, more;
 
-								read_buffer[read_len++] = code;
-							}
-						}
+	if (!ReadConsoleInput(state->hRead, records, CONLOG_INPUT_BATCH, &dw))
+	{
+		return FALSE;
+	}
 
-						if (read_len)
-						{
-							running = WriteFile(state->hWrite, read_buffer, read_len, &dw, NULL) && (dw == read_len);
-						}
-					}
+	return conlog_input_records(state, records, dw, GetNumberOfConsoleInputEvents(state->hRead, &more) && more);
+}
 
-					break;
+/* answers a cursor position request from the console */
+static BOOL conlog_input_cursor(struct conlog_input* state)
+{
+	CONSOLE_SCREEN_BUFFER_INFO screen;
+	BOOL running = GetConsoleScreenBufferInfo(state->hScreen, &screen);
 
-				case FOCUS_EVENT:
-					state->hasFocus = input.Event.FocusEvent.bSetFocus;
+	if (running)
+	{
+		char response[32];
+		int i = sprintf_s(response, sizeof(response), "\033[%d;%dR", screen.dwCursorPosition.Y + 1, screen.dwCursorPosition.X + 1);
+		DWORD dw;
 
-					if (state->reportFocus && (state->hasFocus != state->appFocus))
-					{
-						state->appFocus = state->hasFocus;
+		running = WriteFile(state->hWrite, response, i, &dw, NULL);
 
-						WriteFile(state->hWrite, input.Event.FocusEvent.bSetFocus ? "\033[I" : "\033[O", 3, &dw, NULL);
-					}
+		conlog_stats_dsr_reply(state->stats);
+	}
 
-					break;
+	return running;
+}
 
-				default:
-					break;
-				}
-			}
+static DWORD CALLBACK input_thread(LPVOID pv)
+{
+	struct conlog_input* state = pv;
+	BOOL running = TRUE;
+
+	CONLOG_TRACE_THREAD("input");
 
+	while (state->running && running)
+	{
+		HANDLE hEvent[] = { state->hRead,state->hEvent };
+		unsigned long long t = CONLOG_TRACE_CLOCK();
+		DWORD dw = WaitForMultipleObjects(2, hEvent, FALSE, INFINITE);
+
+		CONLOG_TRACE_SPAN("wait", t, 0);
+
+		switch (dw)
+		{
+		case WAIT_OBJECT_0:
+			running = conlog_input_read(state);
 			break;
 
 		case WAIT_OBJECT_0 + 1:
@@ -580,7 +405,7 @@ static DWORD CALLBACK input_thread(LPVOID pv)
 
 					if (running)
 					{
-						CONSOLE_SCREEN_BUFFER_INFO screen;
+						t = CONLOG_TRACE_CLOCK();
 
 						switch (buf[0])
 						{
@@ -589,25 +414,15 @@ static DWORD CALLBACK input_thread(LPVOID pv)
 							break;
 
 						case 1:
-							if (state->reportFocus && (state->hasFocus != state->appFocus))
-							{
-								state->appFocus = state->hasFocus;
-								running = WriteFile(state->hWrite, state->hasFocus ? "\033[I" : "\033[O", 3, &dw, NULL);
-							}
+							running = conlog_input_focus(state);
 							break;
 
 						case 2:
-							running = GetConsoleScreenBufferInfo(state->hScreen, &screen);
-
-							if (running)
-							{
-								char response[32];
-								int i = sprintf_s(response, sizeof(response), "\033[%d;%dR", screen.dwCursorPosition.Y + 1, screen.dwCursorPosition.X + 1);
-								running = WriteFile(state->hWrite, response, i, &dw, NULL);
-							}
-
+							running = conlog_input_cursor(state);
 							break;
 						}
+
+						CONLOG_TRACE_SPAN("control", t, buf[0]);
 					}
 				}
 				else
@@ -626,11 +441,419 @@ static DWORD CALLBACK input_thread(LPVOID pv)
 	return 0;
 }
 
+/* the console ends a line on a carriage return alone, so each line end in the input is sent as one */
+static DWORD conlog_headless_lines(struct conlog_input* state, char* buf, DWORD len)
+{
+	DWORD i, n = 0;
+
+	for (i = 0; i < len; i++)
+	{
+		char c = buf[i];
+
+		if ((c == '\n') && state->bReturn)
+		{
+			state->bReturn = FALSE;
+			continue;
+		}
+
+		state->bReturn = (c == '\r');
+		buf[n++] = (c == '\n') ? '\r' : c;
+	}
+
+	if (n)
+	{
+		state->bLineStart = (buf[n - 1] == '\r');
+	}
+
+	return n;
+}
+
+/*
+ * When headless input runs out the child is sent Ctrl+Z at the start of a
+ * line, which a console reading lines takes for end of file. A line that
+ * was not ended is completed first.
+ */
+static BOOL conlog_headless_eof(struct conlog_input* state)
+{
+	DWORD dw;
+
+	if (!state->bLineStart && !WriteFile(state->hWrite, "\r", 1, &dw, NULL))
+	{
+		return FALSE;
+	}
+
+	return WriteFile(state->hWrite, "\032\r", 2, &dw, NULL);
+}
+
+/* feeds headless input to the child in either I/O mode, a file or pipe cannot be waited on as the console is */
+static DWORD CALLBACK headless_thread(LPVOID pv)
+{
+	struct conlog_input* state = pv;
+	BOOL running = TRUE;
+
+	CONLOG_TRACE_THREAD("input");
+
+	while (state->running && state->hInput)
+	{
+		char buf[256];
+		DWORD dw, n;
+		unsigned long long t;
+
+		/* cancelled once the child has gone */
+		if (!ReadFile(state->hInput, buf, sizeof(buf), &dw, NULL) || !dw)
+		{
+			break;
+		}
+
+		n = conlog_headless_lines(state, buf, dw);
+
+		if (!n)
+		{
+			continue;
+		}
+
+		if (state->record)
+		{
+			conlog_record_input(state->record, buf, n);
+		}
+
+		state->stats->inputEvents++;
+
+		t = CONLOG_TRACE_CLOCK();
+		running = WriteFile(state->hWrite, buf, n, &dw, NULL) && (dw == n);
+		CONLOG_TRACE_SPAN("write", t, n);
+
+		if (!running)
+		{
+			break;
+		}
+	}
+
+	if (running && state->running)
+	{
+		conlog_headless_eof(state);
+	}
+
+	return 0;
+}
+
+/* the console input thread is woken by its event, a headless read of stdin may never finish so it is cancelled until the thread sees the flag */
+static void conlog_input_stop(struct conlog_input* state, HANDLE thread)
+{
+	state->running = FALSE;
+
+	if (state->bHeadless)
+	{
+		do
+		{
+			CancelSynchronousIo(thread);
+		}
+		while (WaitForSingleObject(thread, 10) == WAIT_TIMEOUT);
+	}
+	else
+	{
+		SetEvent(state->hEvent);
+		WaitForSingleObject(thread, INFINITE);
+	}
+
+	CloseHandle(thread);
+}
+
+static int conlog_loop_cursor(void* context)
+{
+	struct conlog_reader* state = context;
+
+	conlog_stats_dsr_request(state->input->stats);
+
+	return conlog_input_cursor(state->input);
+}
+
+static void conlog_loop_focus(void* context, int enable)
+{
+	struct conlog_reader* state = context;
+
+	if (!enable)
+	{
+		state->input->reportFocus = FALSE;
+	}
+	else if (!state->input->reportFocus)
+	{
+		state->input->appFocus = !state->input->hasFocus;
+		state->input->reportFocus = TRUE;
+
+		conlog_input_focus(state->input);
+	}
+}
+
+/* closing the pseudo console can wait for its output to be read, so it is done beside the loop */
+static void conlog_loop_close(void* context)
+{
+	struct conlog_input* input = context;
+
+	ClosePseudoConsole(input->hPC);
+}
+
+static void conlog_loop_frame(void* context)
+{
+	struct conlog_reader* reader = context;
+
+	reader->frame = -1;
+
+	conlog_render_frame(reader->pump.render);
+}
+
+/* output arriving before the frame interval is up waits for the timer */
+static void conlog_loop_render(struct conlog_reader* reader, struct conlog_timers* timers)
+{
+	if (reader->pump.render && (reader->frame < 0))
+	{
+		unsigned long long due = conlog_render_due(reader->pump.render);
+
+		if (due)
+		{
+			reader->frame = conlog_timers_start(timers, due, conlog_loop_frame, reader);
+		}
+	}
+}
+
+/*
+ * Services the child, the console and the timers from one thread, the
+ * output pipe must be overlapped. Once the child has exited the pseudo
+ * console is closed and the output read to the end.
+ */
+static DWORD conlog_loop(struct conlog_reader* reader, struct conlog_input* input, HANDLE hProcess, struct conlog_timers* timers)
+{
+	BYTE buf[4096];
+	OVERLAPPED ov;
+	BOOL running = TRUE, bPending = FALSE, bExited = FALSE;
+	struct conlog_thread closer;
+
+	ZeroMemory(&ov, sizeof(ov));
+
+	ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+	if (!ov.hEvent)
+	{
+		return GetLastError();
+	}
+
+	CONLOG_TRACE_THREAD("loop");
+
+	while (running)
+	{
+		HANDLE hEvent[3];
+		DWORD dw, count = 0;
+		unsigned long long t;
+		int timeout;
+
+		/* a read that completes at once still signals the event */
+		if (!bPending)
+		{
+			if (!ReadFile(reader->hRead, buf, sizeof(buf), &dw, &ov) && (GetLastError() != ERROR_IO_PENDING))
+			{
+				break;
+			}
+
+			bPending = TRUE;
+		}
+
+		hEvent[count++] = ov.hEvent;
+
+		/* there is no child to give input to once it has gone, headless input has a thread of its own */
+		if (!bExited)
+		{
+			hEvent[count++] = hProcess;
+
+			if (!input->bHeadless)
+			{
+				hEvent[count++] = input->hRead;
+			}
+		}
+
+		timeout = conlog_timers_wait(timers, conlog_clock());
+		t = CONLOG_TRACE_CLOCK();
+		dw = WaitForMultipleObjects(count, hEvent, FALSE, (timeout < 0) ? INFINITE : (DWORD)timeout);
+		CONLOG_TRACE_SPAN("wait", t, dw);
+
+		switch (dw)
+		{
+		case WAIT_OBJECT_0:
+			bPending = FALSE;
+
+			if (GetOverlappedResult(reader->hRead, &ov, &dw, FALSE) && dw)
+			{
+				conlog_pump_data(&reader->pump, buf, dw);
+				conlog_stats_echo(input->stats);
+				conlog_loop_render(reader, timers);
+			}
+			else
+			{
+				running = FALSE;
+			}
+			break;
+
+		case WAIT_OBJECT_0 + 1:
+			bExited = TRUE;
+
+			/* the output ends when the pseudo console has closed its side of the pipe */
+			if (conlog_thread_start(&closer, conlog_loop_close, input))
+			{
+				bExited = FALSE;
+				running = FALSE;
+			}
+			break;
+
+		case WAIT_OBJECT_0 + 2:
+			running = conlog_input_read(input);
+			break;
+
+		case WAIT_TIMEOUT:
+			break;
+
+		default:
+			running = FALSE;
+			break;
+		}
+
+		conlog_timers_run(timers, conlog_clock());
+	}
+
+	if (bPending)
+	{
+		DWORD dw;
+
+		CancelIoEx(reader->hRead, &ov);
+		GetOverlappedResult(reader->hRead, &ov, &dw, TRUE);
+	}
+
+	if (bExited)
+	{
+		conlog_thread_join(&closer);
+		input->hPC = NULL;
+	}
+
+	conlog_timers_cancel(timers, reader->frame);
+	reader->frame = -1;
+
+	CloseHandle(ov.hEvent);
+
+	return 0;
+}
+
+/* the event loop needs an overlapped read side, which CreatePipe cannot give */
+static BOOL conlog_pipe(HANDLE* hRead, HANDLE* hWrite, BOOL bOverlapped)
+{
+	static LONG serial;
+	wchar_t name[64];
+
+	if (!bOverlapped)
+	{
+		return CreatePipe(hRead, hWrite, NULL, 0);
+	}
+
+	swprintf_s(name, sizeof(name) / sizeof(name[0]), L"\\\\.\\pipe\\conlog-%lu-%ld", GetCurrentProcessId(), InterlockedIncrement(&serial));
+
+	*hRead = CreateNamedPipeW(name,
+		PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+		PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+		1,
+		0,
+		65536,
+		0,
+		NULL);
+
+	if (*hRead == INVALID_HANDLE_VALUE)
+	{
+		return FALSE;
+	}
+
+	*hWrite = CreateFileW(name, GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (*hWrite == INVALID_HANDLE_VALUE)
+	{
+		DWORD dw = GetLastError();
+
+		CloseHandle(*hRead);
+		*hRead = INVALID_HANDLE_VALUE;
+
+		SetLastError(dw);
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* reads one option from the command line as UTF-8, removing quotes */
+static const wchar_t* conlog_option_token(const wchar_t* cmdLine, char* arg, int size)
+{
+	wchar_t token[1024];
+	int len = 0;
+	BOOL bQuoted = FALSE;
+
+	while (*cmdLine && (bQuoted || (0x20 < *cmdLine)))
+	{
+		if (0x22 == *cmdLine)
+		{
+			bQuoted = !bQuoted;
+		}
+		else if (len < (sizeof(token) / sizeof(token[0])) - 1)
+		{
+			token[len++] = *cmdLine;
+		}
+
+		cmdLine++;
+	}
+
+	token[len] = 0;
+
+	if (!WideCharToMultiByte(CP_UTF8, 0, token, -1, arg, size, NULL, NULL))
+	{
+		arg[0] = 0;
+	}
+
+	return cmdLine;
+}
+
+static void conlog_ctrl_report(void)
+{
+	if (conlog_flight_target)
+	{
+		conlog_flight_dump(conlog_flight_target);
+	}
+
+	if (conlog_stats_target)
+	{
+		conlog_stats_write(conlog_stats_target, conlog_stats_path, conlog_stats_output);
+	}
+}
+
+/* a break asks for the flight recorder and the statistics to be written, closing the console writes them before conlog is ended */
+static BOOL WINAPI conlog_ctrl_handler(DWORD type)
+{
+	switch (type)
+	{
+	case CTRL_BREAK_EVENT:
+		conlog_ctrl_report();
+		return TRUE;
+
+	case CTRL_CLOSE_EVENT:
+	case CTRL_LOGOFF_EVENT:
+	case CTRL_SHUTDOWN_EVENT:
+		conlog_ctrl_report();
+		break;
+	}
+
+	return FALSE;
+}
+
 int main(int argc, char** argv)
 {
-	int cp = GetACP();
+	static const struct conlog_backend backend = { conlog_reader_cursor, conlog_reader_focus, conlog_reader_reply, conlog_reader_paste };
+	static const struct conlog_backend loopBackend = { conlog_loop_cursor, conlog_loop_focus, conlog_reader_reply, conlog_reader_paste };
+	static const struct conlog_backend headlessBackend = { conlog_headless_cursor, conlog_headless_focus, conlog_reader_reply };
 	const wchar_t* cmdLine = GetCommandLineW();
-	struct conlog_output output;
+	struct conlog_reader reader;
 	struct conlog_input input;
 	wchar_t comspec[260];
 	DWORD tidInput = 0, tidOutput = 0;
@@ -638,18 +861,180 @@ int main(int argc, char** argv)
 	int exitCode = ERROR_INVALID_FUNCTION;
 	CONSOLE_SCREEN_BUFFER_INFO info;
 	int nChannels;
-	struct conlog_output_channel* channel = output.channels;
-	BOOL bHaveConsole = FALSE, bWriteError = TRUE;
+	struct conlog_channel* channel = reader.channels;
+	struct conlog_channel* logChannel = NULL;
+	BOOL bHaveConsole = FALSE, bWriteError = TRUE, bLogWriter = FALSE, bBlockLog = FALSE, bLines = FALSE, bEncode = FALSE, bFlush = FALSE, bFlight = FALSE, bLogFile = FALSE, bRecordFile = FALSE, bRecord = FALSE, bShare = FALSE;
+	struct conlog_options options;
+	struct conlog_logwriter logwriter;
+	struct conlog_blocklog blocklog;
+	struct conlog_lines lines;
+	struct conlog_encode encode;
+	struct conlog_flush flush;
+	struct conlog_flight flight;
+	struct conlog_logfile logfile, recordFile;
+	struct conlog_record record;
+	struct conlog_share share;
+	struct conlog_stats stats;
+	struct conlog_timers timers;
+	struct conlog_screen screen;
+	struct conlog_render render;
+	BOOL bRender = FALSE;
+
+	SetErrorMode(GetErrorMode() | SEM_FAILCRITICALERRORS | SEM_NOOPENFILEERRORBOX);
+
+	/* the scanner is chosen before any thread starts */
+	conlog_escscan_init();
+	conlog_options_init(&options);
+
+	if (0x22 == *cmdLine)
+	{
+		cmdLine++;
+
+		while (*cmdLine && (0x22 != *cmdLine))
+		{
+			cmdLine++;
+		}
+
+		if (0x22 == *cmdLine)
+		{
+			cmdLine++;
+		}
+	}
+	else
+	{
+		while (*cmdLine && (0x20 < *cmdLine))
+		{
+			cmdLine++;
+		}
+	}
+
+	while (*cmdLine && (0x20 >= *cmdLine))
+	{
+		cmdLine++;
+	}
+
+	while ((0x2D == cmdLine[0]) && (0x2D == cmdLine[1]))
+	{
+		char arg[1024];
+
+		cmdLine = conlog_option_token(cmdLine, arg, sizeof(arg));
+
+		while (*cmdLine && (0x20 >= *cmdLine))
+		{
+			cmdLine++;
+		}
+
+		if (!strcmp(arg, "--"))
+		{
+			break;
+		}
+
+		if (conlog_options_parse(&options, arg))
+		{
+			fprintf(stderr, "Invalid option %s\n", arg);
+			fflush(stderr);
+
+			return ERROR_INVALID_PARAMETER;
+		}
+	}
+
+	if ((options.logRotateSize || options.logRotateTime) && !options.log[0])
+	{
+		fprintf(stderr, "Log rotation needs --log\n");
+		fflush(stderr);
+
+		return ERROR_INVALID_PARAMETER;
+	}
+
+	if ((options.logRotateSize || options.logRotateTime) && options.logCompress)
+	{
+		fprintf(stderr, "A compressed log cannot be rotated\n");
+		fflush(stderr);
+
+		return ERROR_INVALID_PARAMETER;
+	}
+
+#ifndef CONLOG_TRACE
+	if (options.trace[0])
+	{
+		fprintf(stderr, "Tracing is not built in, rebuild with TRACE=1\n");
+		fflush(stderr);
+
+		return ERROR_INVALID_PARAMETER;
+	}
+#endif
+
+	if (options.trace[0])
+	{
+		conlog_trace_start();
+		CONLOG_TRACE_THREAD("main");
+	}
+
+	/* many sessions from one process are served by the Linux supervisor */
+	if (options.manifest[0])
+	{
+		fprintf(stderr, "A manifest is not supported on Windows\n");
+		fflush(stderr);
+
+		return ERROR_NOT_SUPPORTED;
+	}
+
+	/* the overlapped event loop is kept out of use until it has been run on Windows */
+	if (options.io == CONLOG_IO_EVENTS)
+	{
+		fprintf(stderr, "The event loop is not supported on Windows yet\n");
+		fflush(stderr);
+
+		return ERROR_NOT_SUPPORTED;
+	}
+
+	if (options.input[0] && !options.headlessRows)
+	{
+		fprintf(stderr, "Input from a file needs --headless\n");
+		fflush(stderr);
+
+		return ERROR_INVALID_PARAMETER;
+	}
+
+	if (options.headlessRows && options.frameRate)
+	{
+		fprintf(stderr, "A headless session has no console to draw\n");
+		fflush(stderr);
 
-	SetErrorMode(GetErrorMode() | SEM_FAILCRITICALERRORS | SEM_NOOPENFILEERRORBOX);
+		return ERROR_INVALID_PARAMETER;
+	}
+
+	if (options.logEncoding == CONLOG_ENCODING_CODEPAGE)
+	{
+		conlog_codepage cp;
+
+		if (conlog_codepage_open(&cp, options.logCodePage))
+		{
+			fprintf(stderr, "Unknown code page %s\n", options.logCodePage);
+			fflush(stderr);
+
+			return ERROR_INVALID_PARAMETER;
+		}
+
+		conlog_codepage_close(cp);
+	}
 
 	ZeroMemory(&info, sizeof(info));
-	ZeroMemory(&output, sizeof(output));
+	ZeroMemory(&reader, sizeof(reader));
 	ZeroMemory(&input, sizeof(input));
 
-	output.input = &input;
+	conlog_stats_init(&stats, (options.io == CONLOG_IO_EVENTS) ? "events" : "threads");
+	conlog_timers_init(&timers);
+
+	reader.input = &input;
+	reader.frame = -1;
+	input.stats = &stats;
+	input.bHeadless = options.headlessRows != 0;
+	input.bLineStart = TRUE;
+	conlog_keys_init(&input.keys);
 
-	if (!CreatePipe(&input.hControl, &output.hControl, NULL, 0))
+	/* a headless session has no console to ask */
+	if ((options.io == CONLOG_IO_THREADS) && !input.bHeadless && !CreatePipe(&input.hControl, &reader.hControl, NULL, 0))
 	{
 		exitCode = GetLastError();
 
@@ -659,39 +1044,71 @@ int main(int argc, char** argv)
 		return exitCode;
 	}
 
-	input.hRead = GetStdHandle(STD_INPUT_HANDLE);
-
-	if (!GetConsoleMode(input.hRead, &input.mode))
+	if (input.bHeadless)
 	{
-		exitCode = GetLastError();
+		/* without --input the child is sent end of file at once */
+		if (!strcmp(options.input, "-"))
+		{
+			input.hInput = GetStdHandle(STD_INPUT_HANDLE);
+		}
+		else if (options.input[0])
+		{
+			input.hInput = CreateFileA(options.input, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
 
-		fprintf(stderr, "Input is not a console\n");
-		fflush(stderr);
+			if (input.hInput == INVALID_HANDLE_VALUE)
+			{
+				exitCode = GetLastError();
 
-		return exitCode;
-	}
+				fprintf(stderr, "Failed to open input %s\n", options.input);
+				fflush(stderr);
 
-	if (!SetConsoleMode(input.hRead, (ENABLE_WINDOW_INPUT | input.mode) & (~(ENABLE_LINE_INPUT | ENABLE_ECHO_INPUT | ENABLE_PROCESSED_INPUT))))
+				return exitCode;
+			}
+		}
+	}
+	else
 	{
-		exitCode = GetLastError();
+		input.hRead = GetStdHandle(STD_INPUT_HANDLE);
 
-		fprintf(stderr, "Input does not support required mode\n");
-		fflush(stderr);
+		if (!GetConsoleMode(input.hRead, &input.mode))
+		{
+			exitCode = GetLastError();
 
-		return exitCode;
+			fprintf(stderr, "Input is not a console\n");
+			fflush(stderr);
+
+			return exitCode;
+		}
+
+		if (!SetConsoleMode(input.hRead, (ENABLE_WINDOW_INPUT | input.mode) & (~(ENABLE_LINE_INPUT | ENABLE_ECHO_INPUT | ENABLE_PROCESSED_INPUT))))
+		{
+			exitCode = GetLastError();
+
+			fprintf(stderr, "Input does not support required mode\n");
+			fflush(stderr);
+
+			return exitCode;
+		}
 	}
 
 	input.hEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
 
-	output.channels[0].cp = CP_UTF8;
-	output.channels[0].hWrite = GetStdHandle(STD_OUTPUT_HANDLE);
-	output.channels[0].bConsole = GetConsoleMode(output.channels[0].hWrite, &output.channels[0].mode);
+	reader.channels[0].hWrite = GetStdHandle(STD_OUTPUT_HANDLE);
+	reader.channels[0].bConsole = !input.bHeadless && GetConsoleMode(reader.channels[0].hWrite, &reader.channels[0].mode);
 
-	output.channels[1].cp = CP_UTF8;
-	output.channels[1].hWrite = GetStdHandle(STD_ERROR_HANDLE);
-	output.channels[1].bConsole = GetConsoleMode(output.channels[1].hWrite, &output.channels[1].mode);
+	reader.channels[1].hWrite = GetStdHandle(STD_ERROR_HANDLE);
+	reader.channels[1].bConsole = !input.bHeadless && GetConsoleMode(reader.channels[1].hWrite, &reader.channels[1].mode);
 
-	if (output.channels[0].bConsole && output.channels[1].bConsole)
+	/* the time blocked on the console and on the redirected handle, for --stats */
+	reader.channels[0].time = options.stats[0] ? (reader.channels[0].bConsole ? &stats.consoleWrite : &stats.fileWrite) : NULL;
+	reader.channels[1].time = options.stats[0] ? (reader.channels[1].bConsole ? &stats.consoleWrite : &stats.fileWrite) : NULL;
+
+	if (input.bHeadless)
+	{
+		/* nothing is drawn, the output goes to --log or else to stdout */
+		reader.nChannels = options.log[0] ? 0 : 1;
+	}
+	else if (reader.channels[0].bConsole && reader.channels[1].bConsole && !options.log[0])
 	{
 		SetConsoleMode(input.hRead, input.mode);
 
@@ -700,8 +1117,7 @@ int main(int argc, char** argv)
 
 		return ERROR_NOT_SUPPORTED;
 	}
-
-	if (!(output.channels[0].bConsole || output.channels[1].bConsole))
+	else if (!(reader.channels[0].bConsole || reader.channels[1].bConsole))
 	{
 		SetConsoleMode(input.hRead, input.mode);
 
@@ -710,47 +1126,75 @@ int main(int argc, char** argv)
 
 		return ERROR_NOT_SUPPORTED;
 	}
-
-	output.nChannels = 2;
-
-	if (output.channels[1].bConsole)
-	{
-		SetStdHandle(STD_OUTPUT_HANDLE, output.channels[1].hWrite);
-	}
 	else
 	{
-		SetStdHandle(STD_ERROR_HANDLE, output.channels[0].hWrite);
+		/* with --log the redirected handle is left alone, and stdout is the console if both are */
+		reader.nChannels = (reader.channels[0].bConsole && reader.channels[1].bConsole) ? 1 : 2;
 	}
 
-	input.hScreen = GetStdHandle(STD_OUTPUT_HANDLE);
+	if (options.log[0])
+	{
+		if (conlog_logfile_open(&logfile, options.log, options.logRotateSize, options.logRotateTime))
+		{
+			exitCode = GetLastError();
+
+			SetConsoleMode(input.hRead, input.mode);
 
-	SetConsoleOutputCP(CP_UTF8);
+			fprintf(stderr, "Failed to open log %s\n", options.log);
+			fflush(stderr);
 
-	if (0x22 == *cmdLine)
-	{
-		cmdLine++;
+			return exitCode;
+		}
 
-		while (*cmdLine && (0x22 != *cmdLine))
+		bLogFile = TRUE;
+
+		if (options.stats[0])
 		{
-			cmdLine++;
+			logfile.writeTime = &stats.fileWrite;
 		}
 
-		if (0x22 == *cmdLine)
+		if (logfile.bThread)
 		{
-			cmdLine++;
+			stats.threads++;
+			stats.rotate = &logfile.stats;
 		}
 	}
-	else
+
+	if (options.record[0])
 	{
-		while (*cmdLine && (0x20 < *cmdLine))
+		if (conlog_logfile_open(&recordFile, options.record, 0, 0))
 		{
-			cmdLine++;
+			exitCode = GetLastError();
+
+			SetConsoleMode(input.hRead, input.mode);
+
+			fprintf(stderr, "Failed to open recording %s\n", options.record);
+			fflush(stderr);
+
+			return exitCode;
 		}
+
+		bRecordFile = TRUE;
 	}
 
-	while (*cmdLine && (0x20 >= *cmdLine))
+	conlog_pump_init(&reader.pump, input.bHeadless ? &headlessBackend : (options.io == CONLOG_IO_EVENTS) ? &loopBackend : &backend, &reader);
+	reader.pump.output.bTimed = options.stats[0] != 0;
+
+	/* a headless session leaves the handles and the code page as they are */
+	if (!input.bHeadless)
 	{
-		cmdLine++;
+		if (reader.channels[1].bConsole)
+		{
+			SetStdHandle(STD_OUTPUT_HANDLE, reader.channels[1].hWrite);
+		}
+		else
+		{
+			SetStdHandle(STD_ERROR_HANDLE, reader.channels[0].hWrite);
+		}
+
+		input.hScreen = GetStdHandle(STD_OUTPUT_HANDLE);
+
+		SetConsoleOutputCP(CP_UTF8);
 	}
 
 	if (!*cmdLine)
@@ -768,9 +1212,17 @@ int main(int argc, char** argv)
 		}
 	}
 
-	if (cmdLine && cmdLine[0])
+	/* a headless pseudo console stands in for the console, at the size given and with the cursor at home */
+	if (cmdLine && cmdLine[0] && input.bHeadless)
+	{
+		info.dwSize.X = (SHORT)options.headlessCols;
+		info.dwSize.Y = (SHORT)options.headlessRows;
+
+		bHaveConsole = TRUE;
+	}
+	else if (cmdLine && cmdLine[0])
 	{
-		nChannels = output.nChannels;
+		nChannels = reader.nChannels;
 
 		while (nChannels--)
 		{
@@ -791,14 +1243,177 @@ int main(int argc, char** argv)
 		}
 	}
 
+	/* the model starts where the pseudo console inherits the cursor, a console drawn in frames answers from it too */
+	if (bHaveConsole && ((options.dsr == CONLOG_DSR_SCREEN) || options.frameRate || input.bHeadless) && !conlog_screen_init(&screen, info.dwSize.Y, info.dwSize.X))
+	{
+		conlog_screen_move(&screen, info.dwCursorPosition.Y, info.dwCursorPosition.X);
+
+		reader.pump.screen = &screen;
+		input.screen = &screen;
+
+		if (options.frameRate && !conlog_render_init(&render, &screen, options.frameRate, conlog_channel_write, reader.channels[0].bConsole ? &reader.channels[0] : &reader.channels[1]))
+		{
+			bRender = TRUE;
+			reader.pump.render = &render;
+			stats.render = &render.stats;
+		}
+	}
+
+	nChannels = reader.nChannels;
+	channel = reader.channels;
+
+	while (nChannels--)
+	{
+		if (channel->bConsole && bRender)
+		{
+			/* drawn by the renderer */
+		}
+		else if (!channel->bConsole)
+		{
+			logChannel = channel;
+		}
+		else
+		{
+			conlog_output_add(&reader.pump.output, conlog_channel_write, channel);
+		}
+
+		channel++;
+	}
+
+	/* the log goes after the console */
+	if (bLogFile || logChannel)
+	{
+		conlog_output_fn write = bLogFile ? conlog_logfile_write : conlog_channel_write;
+		void* context = bLogFile ? (void*)&logfile : (void*)logChannel;
+
+		/* the file is written in fewer, larger pieces, the console is not held back */
+		if (((options.logFlush != CONLOG_FLUSH_NOW) || (options.logSync != CONLOG_SYNC_NONE)) &&
+			!conlog_flush_init(&flush, options.logFlush, options.logFlushSize, options.logFlushTime, options.logSync, options.logSyncTime, write, bLogFile ? conlog_logfile_sync : conlog_channel_sync, context))
+		{
+			bFlush = TRUE;
+			stats.flush = &flush.stats;
+			write = conlog_flush_write;
+			context = &flush;
+
+			if (flush.bThread)
+			{
+				stats.threads++;
+			}
+		}
+
+		if (options.logCompress && !conlog_blocklog_init(&blocklog, options.logCompress, write, context))
+		{
+			bBlockLog = TRUE;
+			stats.compress = &blocklog.stats;
+			write = conlog_blocklog_write;
+			context = &blocklog;
+		}
+
+		/* encoded after the lines are collapsed, which works on UTF-8 */
+		if ((options.logEncoding != CONLOG_ENCODING_RAW) && !conlog_encode_init(&encode, options.logEncoding, options.logCodePage, write, context))
+		{
+			bEncode = TRUE;
+			stats.encode = &encode.stats;
+			write = conlog_encode_write;
+			context = &encode;
+		}
+
+		/* the collapsed lines are kept, and encoded only if they are written */
+		if (options.logFlight && !conlog_flight_init(&flight, options.logFlight, write, context))
+		{
+			bFlight = TRUE;
+			stats.flight = &flight.stats;
+			write = conlog_flight_write;
+			context = &flight;
+
+			conlog_flight_target = &flight;
+		}
+
+		/* collapsed on the log writer thread when there is one */
+		if ((options.logFormat == CONLOG_LOG_LINES) && !conlog_lines_init(&lines, write, context))
+		{
+			bLines = TRUE;
+			stats.lines = &lines.stats;
+			write = conlog_lines_write;
+			context = &lines;
+		}
+
+		if (options.logBuffer && !conlog_logwriter_start(&logwriter, options.logBuffer, options.logOverflow, write, context))
+		{
+			bLogWriter = TRUE;
+			stats.threads++;
+			stats.log = &logwriter.stats;
+			write = conlog_logwriter_write;
+			context = &logwriter;
+		}
+
+		if (options.logFormat == CONLOG_LOG_TEXT)
+		{
+			conlog_output_add_text(&reader.pump.output, write, context);
+		}
+		else
+		{
+			conlog_output_add(&reader.pump.output, write, context);
+		}
+	}
+
+	if (options.stats[0])
+	{
+		conlog_stats_target = &stats;
+		conlog_stats_path = options.stats;
+		conlog_stats_output = &reader.pump.output.stats;
+	}
+
+	if (conlog_flight_target || conlog_stats_target)
+	{
+		SetConsoleCtrlHandler(conlog_ctrl_handler, TRUE);
+	}
+
+	/* the recording starts at the size of the console */
+	if (bRecordFile)
+	{
+		if (conlog_record_start(&record, bHaveConsole ? info.dwSize.Y : 24, bHaveConsole ? info.dwSize.X : 80, conlog_logfile_write, &recordFile))
+		{
+			fprintf(stderr, "Failed to start recording %s\n", options.record);
+			fflush(stderr);
+		}
+		else
+		{
+			bRecord = TRUE;
+			input.record = &record;
+			stats.threads++;
+			stats.record = &record.stats;
+			conlog_output_add(&reader.pump.output, conlog_record_output, &record);
+		}
+	}
+
+	/* the viewers' screen starts at the size of the console too */
+	if (options.share[0])
+	{
+		if (conlog_share_start(&share, options.share, bHaveConsole ? info.dwSize.Y : 24, bHaveConsole ? info.dwSize.X : 80, options.shareBuffer))
+		{
+			fprintf(stderr, "Failed to share on %s\n", options.share);
+			fflush(stderr);
+		}
+		else
+		{
+			bShare = TRUE;
+			input.share = &share;
+			stats.threads += 2;
+			stats.share = &share.stats;
+			conlog_output_add(&reader.pump.output, conlog_share_output, &share);
+		}
+	}
+
 	if (bHaveConsole)
 	{
 		HANDLE inputReadSide = INVALID_HANDLE_VALUE, outputWriteSide = INVALID_HANDLE_VALUE;
 		HANDLE outputReadSide = INVALID_HANDLE_VALUE, inputWriteSide = INVALID_HANDLE_VALUE;
 
-		if (CreatePipe(&inputReadSide, &inputWriteSide, NULL, 0) && CreatePipe(&outputReadSide, &outputWriteSide, NULL, 0))
+		if (CreatePipe(&inputReadSide, &inputWriteSide, NULL, 0) && conlog_pipe(&outputReadSide, &outputWriteSide, options.io == CONLOG_IO_EVENTS))
 		{
-			HRESULT hr = CreatePseudoConsole(info.dwSize, inputReadSide, outputWriteSide, PSEUDOCONSOLE_INHERIT_CURSOR, &input.hPC);
+			/* inheriting the cursor asks the console where it is, which a headless session has no console to answer */
+			HRESULT hr = CreatePseudoConsole(info.dwSize, inputReadSide, outputWriteSide, input.bHeadless ? 0 : PSEUDOCONSOLE_INHERIT_CURSOR, &input.hPC);
 
 			if (SUCCEEDED(hr))
 			{
@@ -855,15 +1470,39 @@ int main(int argc, char** argv)
 
 								input.running = TRUE;
 								input.hWrite = inputWriteSide;
-								output.hRead = outputReadSide;
+								reader.hRead = outputReadSide;
+
+								if (input.bHeadless)
+								{
+									threadInput = CreateThread(NULL, 0, headless_thread, &input, 0, &tidInput);
 
-								threadInput = CreateThread(NULL, 0, input_thread, &input, 0, &tidInput);
+									if (threadInput)
+									{
+										stats.threads++;
+									}
+									else
+									{
+										exitCode = GetLastError();
+									}
+								}
 
-								if (threadInput)
+								if (input.bHeadless && !threadInput)
 								{
-									threadOutput = CreateThread(NULL, 0, output_thread, &output, 0, &tidOutput);
+									/* the child is ended with the pseudo console */
+								}
+								else if (options.io == CONLOG_IO_EVENTS)
+								{
+									exitCode = conlog_loop(&reader, &input, pi.hProcess, &timers);
+
+									CloseHandle(reader.hRead);
+									reader.hRead = NULL;
+
+									if (threadInput)
+									{
+										conlog_input_stop(&input, threadInput);
+									}
 
-									if (threadOutput)
+									if (!exitCode)
 									{
 										WaitForSingleObject(pi.hProcess, INFINITE);
 
@@ -876,22 +1515,57 @@ int main(int argc, char** argv)
 										{
 											exitCode = GetLastError();
 										}
+									}
+								}
+								else
+								{
+									if (bRender && !conlog_render_start(&render))
+									{
+										stats.threads++;
+									}
+
+									if (!input.bHeadless)
+									{
+										threadInput = CreateThread(NULL, 0, input_thread, &input, 0, &tidInput);
+
+										if (threadInput)
+										{
+											stats.threads++;
+										}
+									}
+
+									if (threadInput)
+									{
+										threadOutput = CreateThread(NULL, 0, output_thread, &reader, 0, &tidOutput);
 
-										input.running = FALSE;
-										SetEvent(input.hEvent);
+										if (threadOutput)
+										{
+											stats.threads++;
+
+											WaitForSingleObject(pi.hProcess, INFINITE);
+
+											if (GetExitCodeProcess(pi.hProcess, &ex))
+											{
+												bWriteError = FALSE;
+												exitCode = ex;
+											}
+											else
+											{
+												exitCode = GetLastError();
+											}
+										}
+										else
+										{
+											exitCode = GetLastError();
+										}
 
-										WaitForSingleObject(threadInput, INFINITE);
-										CloseHandle(threadInput);
+										conlog_input_stop(&input, threadInput);
 									}
 									else
 									{
 										exitCode = GetLastError();
 									}
 								}
-								else
-								{
-									exitCode = GetLastError();
-								}
 
 								CloseHandle(pi.hProcess);
 								CloseHandle(pi.hThread);
@@ -914,7 +1588,11 @@ int main(int argc, char** argv)
 					exitCode = ERROR_OUTOFMEMORY;
 				}
 
-				ClosePseudoConsole(input.hPC);
+				/* the event loop has closed it already */
+				if (input.hPC)
+				{
+					ClosePseudoConsole(input.hPC);
+				}
 
 				if (threadOutput)
 				{
@@ -933,8 +1611,86 @@ int main(int argc, char** argv)
 		}
 	}
 
-	nChannels = output.nChannels;
-	channel = output.channels;
+	if (bRender)
+	{
+		conlog_render_stop(&render);
+	}
+
+	if (bLogWriter)
+	{
+		conlog_logwriter_stop(&logwriter);
+	}
+
+	if (bLines)
+	{
+		conlog_lines_finish(&lines);
+	}
+
+	if (conlog_flight_target || conlog_stats_target)
+	{
+		SetConsoleCtrlHandler(conlog_ctrl_handler, FALSE);
+	}
+
+	/* kept only if the child or conlog failed */
+	if (bFlight)
+	{
+		conlog_flight_finish(&flight, exitCode != 0);
+	}
+
+	if (bEncode)
+	{
+		conlog_encode_finish(&encode);
+	}
+
+	if (bBlockLog)
+	{
+		conlog_blocklog_finish(&blocklog);
+	}
+
+	if (bFlush)
+	{
+		conlog_flush_finish(&flush);
+	}
+
+	if (bLogFile)
+	{
+		conlog_logfile_close(&logfile);
+	}
+
+	if (bRecord)
+	{
+		conlog_record_stop(&record);
+	}
+
+	if (bRecordFile)
+	{
+		conlog_logfile_close(&recordFile);
+	}
+
+	if (bShare)
+	{
+		conlog_share_stop(&share);
+	}
+
+	if (reader.pump.screen)
+	{
+		conlog_screen_free(reader.pump.screen);
+	}
+
+	if (options.stats[0] && conlog_stats_write(&stats, options.stats, &reader.pump.output.stats))
+	{
+		fprintf(stderr, "Failed to write statistics to %s\n", options.stats);
+		fflush(stderr);
+	}
+
+	if (options.trace[0] && conlog_trace_finish(options.trace))
+	{
+		fprintf(stderr, "Failed to write trace to %s\n", options.trace);
+		fflush(stderr);
+	}
+
+	nChannels = reader.nChannels;
+	channel = reader.channels;
 
 	while (nChannels--)
 	{
@@ -946,7 +1702,17 @@ int main(int argc, char** argv)
 		channel++;
 	}
 
-	SetConsoleMode(input.hRead, input.mode);
+	if (input.bHeadless)
+	{
+		if (input.hInput && strcmp(options.input, "-"))
+		{
+			CloseHandle(input.hInput);
+		}
+	}
+	else
+	{
+		SetConsoleMode(input.hRead, input.mode);
+	}
 
 	if (bWriteError && exitCode)
 	{
@@ -962,7 +1728,7 @@ int main(int argc, char** argv)
 
 		if (dw)
 		{
-			WriteFile(output.channels[1].hWrite, buf, dw, &dw, NULL);
+			WriteFile(reader.channels[1].hWrite, buf, dw, &dw, NULL);
 		}
 	}
 
@@ -0,0 +1,429 @@
+/************************************
+ * Copyright (c) 2025 Roger Brown.
+ * Licensed under the MIT License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <share.h>
+#include "platform.h"
+#include <psapi.h>
+#include "output.h"
+
+unsigned long long conlog_clock(void)
+{
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+
+	if (!frequency.QuadPart)
+	{
+		QueryPerformanceFrequency(&frequency);
+	}
+
+	QueryPerformanceCounter(&counter);
+
+	return (unsigned long long)(counter.QuadPart / frequency.QuadPart) * 1000000000ULL +
+		(unsigned long long)(counter.QuadPart % frequency.QuadPart) * 1000000000ULL / frequency.QuadPart;
+}
+
+void conlog_process_usage(unsigned long long* cpu, unsigned long long* peak)
+{
+	FILETIME creation, exit, kernel, user;
+	PROCESS_MEMORY_COUNTERS memory;
+
+	*cpu = 0;
+	*peak = 0;
+
+	/* in 100 nanosecond units */
+	if (GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+	{
+		*cpu = ((((unsigned long long)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) +
+			(((unsigned long long)user.dwHighDateTime << 32) | user.dwLowDateTime)) * 100;
+	}
+
+	if (K32GetProcessMemoryInfo(GetCurrentProcess(), &memory, sizeof(memory)))
+	{
+		*peak = memory.PeakWorkingSetSize;
+	}
+}
+
+static DWORD CALLBACK conlog_thread_main(LPVOID pv)
+{
+	struct conlog_thread* thread = pv;
+
+	thread->start(thread->arg);
+
+	return 0;
+}
+
+int conlog_thread_start(struct conlog_thread* thread, void (*start)(void*), void* arg)
+{
+	DWORD tid;
+
+	thread->start = start;
+	thread->arg = arg;
+	thread->handle = CreateThread(NULL, 0, conlog_thread_main, thread, 0, &tid);
+
+	return thread->handle ? 0 : (int)GetLastError();
+}
+
+void conlog_thread_join(struct conlog_thread* thread)
+{
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+	thread->handle = NULL;
+}
+
+void conlog_mutex_init(conlog_mutex* mutex)
+{
+	InitializeSRWLock(mutex);
+}
+
+void conlog_mutex_lock(conlog_mutex* mutex)
+{
+	AcquireSRWLockExclusive(mutex);
+}
+
+void conlog_mutex_unlock(conlog_mutex* mutex)
+{
+	ReleaseSRWLockExclusive(mutex);
+}
+
+void conlog_mutex_destroy(conlog_mutex* mutex)
+{
+}
+
+void conlog_cond_init(conlog_cond* cond)
+{
+	InitializeConditionVariable(cond);
+}
+
+void conlog_cond_wait(conlog_cond* cond, conlog_mutex* mutex)
+{
+	SleepConditionVariableSRW(cond, mutex, INFINITE, 0);
+}
+
+void conlog_cond_timedwait(conlog_cond* cond, conlog_mutex* mutex, unsigned ms)
+{
+	SleepConditionVariableSRW(cond, mutex, ms, 0);
+}
+
+void conlog_cond_signal(conlog_cond* cond)
+{
+	WakeConditionVariable(cond);
+}
+
+void conlog_cond_broadcast(conlog_cond* cond)
+{
+	WakeAllConditionVariable(cond);
+}
+
+void conlog_cond_destroy(conlog_cond* cond)
+{
+}
+
+int conlog_file_open(conlog_file* file, const char* path)
+{
+	HANDLE h = CreateFileA(path, FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (h == INVALID_HANDLE_VALUE)
+	{
+		return -1;
+	}
+
+	*file = h;
+
+	return 0;
+}
+
+void conlog_file_write(conlog_file file, const struct conlog_iovec* iov, int count)
+{
+	while (count--)
+	{
+		const unsigned char* p = iov->data;
+		size_t len = iov->len;
+
+		while (len)
+		{
+			DWORD dw = 0;
+
+			if (!WriteFile(file, p, (DWORD)(len > 0x40000000 ? 0x40000000 : len), &dw, NULL) || !dw)
+			{
+				return;
+			}
+
+			p += dw;
+			len -= dw;
+		}
+
+		iov++;
+	}
+}
+
+void conlog_file_close(conlog_file file)
+{
+	CloseHandle(file);
+}
+
+int conlog_file_sync(conlog_file file)
+{
+	return FlushFileBuffers(file) ? 0 : -1;
+}
+
+unsigned long long conlog_file_size(conlog_file file)
+{
+	LARGE_INTEGER size;
+
+	return GetFileSizeEx(file, &size) ? (unsigned long long)size.QuadPart : 0;
+}
+
+int conlog_file_rename(const char* from, const char* to)
+{
+	return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) ? 0 : -1;
+}
+
+FILE* conlog_fopen(const char* path, const char* mode)
+{
+	return _fsopen(path, mode, _SH_DENYNO);
+}
+
+/* code pages go by number, as cp1252 or 1252, acp is the system's ANSI code page */
+int conlog_codepage_open(conlog_codepage* cp, const char* name)
+{
+	CPINFO info;
+
+	if (!strcmp(name, "acp"))
+	{
+		*cp = GetACP();
+	}
+	else
+	{
+		if (!_strnicmp(name, "cp", 2))
+		{
+			name += 2;
+		}
+
+		*cp = (UINT)strtoul(name, NULL, 10);
+	}
+
+	return (*cp && GetCPInfo(*cp, &info)) ? 0 : -1;
+}
+
+size_t conlog_codepage_encode(conlog_codepage cp, const unsigned short* wide, size_t count, unsigned char* out, size_t size)
+{
+	int n = WideCharToMultiByte(cp, 0, (LPCWCH)wide, (int)count, (LPSTR)out, (int)size, NULL, NULL);
+
+	return (n > 0) ? n : 0;
+}
+
+void conlog_codepage_close(conlog_codepage cp)
+{
+}
+
+static HANDLE listener_instance(struct conlog_listener* listener, DWORD first)
+{
+	return CreateNamedPipeA(listener->path, PIPE_ACCESS_OUTBOUND | FILE_FLAG_OVERLAPPED | first,
+		PIPE_TYPE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, PIPE_UNLIMITED_INSTANCES, 65536, 0, 0, NULL);
+}
+
+int conlog_listener_open(struct conlog_listener* listener, const char* path)
+{
+	size_t len = strlen(path);
+
+	if (len >= sizeof(listener->path))
+	{
+		return -1;
+	}
+
+	memcpy(listener->path, path, len + 1);
+
+	listener->connected = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+	if (!listener->connected)
+	{
+		return -1;
+	}
+
+	listener->stop = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+	if (!listener->stop)
+	{
+		CloseHandle(listener->connected);
+		return -1;
+	}
+
+	/* the first instance fails if another process has the name */
+	listener->pipe = listener_instance(listener, FILE_FLAG_FIRST_PIPE_INSTANCE);
+
+	if (listener->pipe == INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(listener->stop);
+		CloseHandle(listener->connected);
+		return -1;
+	}
+
+	return 0;
+}
+
+int conlog_listener_accept(struct conlog_listener* listener, struct conlog_viewer* viewer)
+{
+	for (;;)
+	{
+		OVERLAPPED ov;
+		DWORD dw, err = 0;
+
+		/* the stop event is never reset, so a stop before the wait is not missed */
+		if ((listener->pipe == INVALID_HANDLE_VALUE) || (WaitForSingleObject(listener->stop, 0) == WAIT_OBJECT_0))
+		{
+			return -1;
+		}
+
+		memset(&ov, 0, sizeof(ov));
+		ov.hEvent = listener->connected;
+
+		if (!ConnectNamedPipe(listener->pipe, &ov))
+		{
+			err = GetLastError();
+
+			if (err == ERROR_IO_PENDING)
+			{
+				HANDLE handles[2];
+
+				handles[0] = listener->connected;
+				handles[1] = listener->stop;
+
+				if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0)
+				{
+					CancelIoEx(listener->pipe, &ov);
+					GetOverlappedResult(listener->pipe, &ov, &dw, TRUE);
+
+					return -1;
+				}
+
+				err = GetOverlappedResult(listener->pipe, &ov, &dw, FALSE) ? 0 : GetLastError();
+			}
+			else if (err == ERROR_PIPE_CONNECTED)
+			{
+				err = 0;
+			}
+		}
+
+		if (!err)
+		{
+			break;
+		}
+
+		/* a viewer that went before it was taken is not the end */
+		if ((err != ERROR_NO_DATA) && (err != ERROR_BROKEN_PIPE) && (err != ERROR_PIPE_NOT_CONNECTED))
+		{
+			return -1;
+		}
+
+		DisconnectNamedPipe(listener->pipe);
+	}
+
+	viewer->written = CreateEvent(NULL, TRUE, FALSE, NULL);
+	viewer->hangup = viewer->written ? CreateEvent(NULL, TRUE, FALSE, NULL) : NULL;
+
+	if (!viewer->hangup)
+	{
+		if (viewer->written)
+		{
+			CloseHandle(viewer->written);
+		}
+
+		DisconnectNamedPipe(listener->pipe);
+
+		return -1;
+	}
+
+	/* the connected instance is the viewer's, a new one waits for the next */
+	viewer->pipe = listener->pipe;
+	listener->pipe = listener_instance(listener, 0);
+
+	return 0;
+}
+
+void conlog_listener_stop(struct conlog_listener* listener)
+{
+	SetEvent(listener->stop);
+}
+
+void conlog_listener_close(struct conlog_listener* listener)
+{
+	if (listener->pipe != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(listener->pipe);
+	}
+
+	CloseHandle(listener->connected);
+	CloseHandle(listener->stop);
+}
+
+int conlog_viewer_send(struct conlog_viewer* viewer, const void* data, size_t len)
+{
+	const unsigned char* p = data;
+
+	while (len)
+	{
+		OVERLAPPED ov;
+		DWORD dw = 0;
+
+		if (WaitForSingleObject(viewer->hangup, 0) == WAIT_OBJECT_0)
+		{
+			return -1;
+		}
+
+		memset(&ov, 0, sizeof(ov));
+		ov.hEvent = viewer->written;
+
+		if (!WriteFile(viewer->pipe, p, (DWORD)(len > 0x40000000 ? 0x40000000 : len), &dw, &ov))
+		{
+			HANDLE handles[2];
+
+			if (GetLastError() != ERROR_IO_PENDING)
+			{
+				return -1;
+			}
+
+			handles[0] = viewer->written;
+			handles[1] = viewer->hangup;
+
+			if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0)
+			{
+				CancelIoEx(viewer->pipe, &ov);
+				GetOverlappedResult(viewer->pipe, &ov, &dw, TRUE);
+
+				return -1;
+			}
+
+			if (!GetOverlappedResult(viewer->pipe, &ov, &dw, FALSE))
+			{
+				return -1;
+			}
+		}
+
+		if (!dw)
+		{
+			return -1;
+		}
+
+		p += dw;
+		len -= dw;
+	}
+
+	return 0;
+}
+
+void conlog_viewer_hangup(struct conlog_viewer* viewer)
+{
+	SetEvent(viewer->hangup);
+}
+
+void conlog_viewer_close(struct conlog_viewer* viewer)
+{
+	DisconnectNamedPipe(viewer->pipe);
+	CloseHandle(viewer->pipe);
+	CloseHandle(viewer->written);
+	CloseHandle(viewer->hangup);
+}